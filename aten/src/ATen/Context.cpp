@@ -51,6 +51,14 @@ void Context::setUserEnabledMkldnn(bool e) {
   enabled_mkldnn = e;
 }
 
+bool Context::userEnabledMklFFT() const {
+  return enabled_mkl_fft;
+}
+
+void Context::setUserEnabledMklFFT(bool e) {
+  enabled_mkl_fft = e;
+}
+
 bool Context::deterministicCuDNN() const {
   return deterministic_cudnn;
 }
@@ -108,6 +108,10 @@ class CAFFE2_API Context {
   void setUserEnabledCuDNN(bool e);
   bool userEnabledMkldnn() const;
   void setUserEnabledMkldnn(bool e);
+  // Whether CPU FFTs use MKL, when ATen is built with it, or the builtin
+  // implementation in native/BuiltinFFT.cpp.
+  bool userEnabledMklFFT() const;
+  void setUserEnabledMklFFT(bool e);
   bool benchmarkCuDNN() const;
   void setBenchmarkCuDNN(bool);
   bool deterministicCuDNN() const;
@@ -215,6 +219,7 @@ class CAFFE2_API Context {
   bool allow_tf32_cudnn = true;
   bool allow_tf32_cublas = true;
   bool enabled_mkldnn = true;
+  bool enabled_mkl_fft = true;
   #ifdef C10_MOBILE
   bool release_original_weights = true;
   #else
@@ -13,6 +13,12 @@
     return __VA_ARGS__();                          \
   }
 
+#define AT_PRIVATE_CASE_TYPE_USING_HINT(enum_type, type, HINT, ...) \
+  case enum_type: {                                                 \
+    using HINT = type;                                              \
+    return __VA_ARGS__();                                           \
+  }
+
 // Workaround for C10_UNUSED because CUDA 10.1 and below fails to handle unused
 // attribute in the type aliasing context. Keep name long and verbose to avoid
 // macro collisions.
@@ -313,6 +319,24 @@ inline void deprecated_AT_DISPATCH_ALL_TYPES_AND_HALF_AND_COMPLEX() {}
     }                                                                   \
   }()
 
+// Dispatches over the types that ATen accepts for indices. The lambda sees
+// the type as index_t rather than scalar_t, so that it can be nested inside
+// a dispatch over the data type.
+#define AT_DISPATCH_INDEX_TYPES(TYPE, NAME, ...)                            \
+  [&] {                                                                     \
+    const auto& the_index_type = TYPE;                                      \
+    /* don't use TYPE again in case it is an expensive or side-effect op */ \
+    at::ScalarType _it = ::detail::scalar_type(the_index_type);             \
+    switch (_it) {                                                          \
+      AT_PRIVATE_CASE_TYPE_USING_HINT(                                      \
+          at::ScalarType::Int, int32_t, index_t, __VA_ARGS__)               \
+      AT_PRIVATE_CASE_TYPE_USING_HINT(                                      \
+          at::ScalarType::Long, int64_t, index_t, __VA_ARGS__)              \
+      default:                                                              \
+        AT_ERROR(#NAME, " not implemented for '", toString(_it), "'");      \
+    }                                                                       \
+  }()
+
 #define AT_DISPATCH_ALL_TYPES(TYPE, NAME, ...)                               \
   [&] {                                                                      \
     const auto& the_type = TYPE;                                             \
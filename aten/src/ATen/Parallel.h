@@ -151,4 +151,6 @@ CAFFE2_API int intraop_default_num_threads();
 #include <ATen/ParallelNative.h>
 #elif AT_PARALLEL_NATIVE_TBB
 #include <ATen/ParallelNativeTBB.h>
+#elif AT_PARALLEL_WORK_STEALING
+#include <ATen/ParallelWorkStealing.h>
 #endif
@@ -78,12 +78,22 @@ std::string get_parallel_info() {
   ss << "native thread pool";
   #elif AT_PARALLEL_NATIVE_TBB
   ss << "native thread pool and TBB";
+  #elif AT_PARALLEL_WORK_STEALING
+  ss << "work-stealing thread pool";
   #endif
   #ifdef C10_MOBILE
   ss << " [mobile]";
   #endif
   ss << std::endl;
 
+  if (c10::IsNUMAEnabled()) {
+    ss << "NUMA nodes: " << c10::GetNumNUMANodes();
+    if (FLAGS_caffe2_cpu_numa_pin_threads) {
+      ss << ", intra-op threads pinned per node";
+    }
+    ss << std::endl;
+  }
+
   #if AT_EXPERIMENTAL_SINGLE_THREAD_POOL
   ss << "Experimental: single thread pool" << std::endl;
   #endif
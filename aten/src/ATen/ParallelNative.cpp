@@ -65,13 +65,99 @@ int _num_pool_threads(int nthreads) {
   return nthreads - 1;
 }
 
+// Intra-op pool made of one thread pool per NUMA node, used when
+// caffe2_cpu_numa_enabled and caffe2_cpu_numa_pin_threads are set on a
+// machine with more than one node. Worker threads are pinned to a CPU of
+// their node, so memory they allocate is bound to that node as well.
+class NUMAPartitionedPool final : public TaskThreadPoolBase {
+ public:
+  NUMAPartitionedPool(int pool_size, int num_nodes) {
+    TORCH_INTERNAL_ASSERT(pool_size >= 0 && num_nodes > 1);
+    for (int node = 0; node < num_nodes; ++node) {
+      int node_size = pool_size / num_nodes + (node < pool_size % num_nodes);
+      auto next_cpu = std::make_shared<std::atomic<int>>(0);
+      pools_.emplace_back(new c10::ThreadPool(
+          node_size, node, [node, next_cpu]() {
+            c10::setThreadName("PTThreadPool");
+            c10::NUMAPinCurrentThread(node, (*next_cpu)++);
+            at::init_num_threads();
+          }));
+    }
+  }
+
+  void run(std::function<void()> func) override {
+    runOnNode(next_node_++ % pools_.size(), std::move(func));
+  }
+
+  void runOnNode(size_t node, std::function<void()> func) {
+    // Nodes without workers hand their tasks to the next node.
+    for (size_t i = 0; i < pools_.size(); ++i) {
+      auto& pool = pools_[(node + i) % pools_.size()];
+      if (pool->size() > 0) {
+        pool->run(std::move(func));
+        return;
+      }
+    }
+    throw std::runtime_error("No threads to run a task");
+  }
+
+  size_t size() const override {
+    size_t total = 0;
+    for (const auto& pool : pools_) {
+      total += pool->size();
+    }
+    return total;
+  }
+
+  size_t numAvailable() const override {
+    size_t total = 0;
+    for (const auto& pool : pools_) {
+      total += pool->numAvailable();
+    }
+    return total;
+  }
+
+  bool inThreadPool() const override {
+    for (const auto& pool : pools_) {
+      if (pool->inThreadPool()) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  size_t numNodes() const {
+    return pools_.size();
+  }
+
+ private:
+  std::vector<std::unique_ptr<c10::ThreadPool>> pools_;
+  std::atomic<size_t> next_node_{0};
+};
+
+// Set once the intra-op pool is created, if it is NUMA partitioned.
+NUMAPartitionedPool* numa_intraop_pool = nullptr;
+
+std::shared_ptr<TaskThreadPoolBase> _create_intraop_pool() {
+  const int pool_size =
+      _num_pool_threads(num_intraop_threads.exchange(CONSUMED));
+  if (FLAGS_caffe2_cpu_numa_pin_threads && c10::IsNUMAEnabled()) {
+    const int num_nodes = c10::GetNumNUMANodes();
+    if (num_nodes > 1) {
+      auto pool = std::make_shared<NUMAPartitionedPool>(pool_size, num_nodes);
+      numa_intraop_pool = pool.get();
+      return pool;
+    }
+  }
+  return ThreadPoolRegistry()->Create(
+      "C10",
+      /* device_id */ 0,
+      /* pool_size */ pool_size,
+      /* create_new */ true); // create a separate thread pool for intra-op
+}
+
 TaskThreadPoolBase& _get_intraop_pool() {
-  static std::shared_ptr<TaskThreadPoolBase> pool =
-      ThreadPoolRegistry()->Create(
-          "C10",
-          /* device_id */ 0,
-          /* pool_size */ _num_pool_threads(num_intraop_threads.exchange(CONSUMED)),
-          /* create_new */ true); // create a separate thread pool for intra-op
+  static std::shared_ptr<TaskThreadPoolBase> pool = _create_intraop_pool();
   return *pool;
 }
 
@@ -81,8 +167,19 @@ TaskThreadPoolBase& _get_intraop_pool() {
 // `fn` will be called with params: (thread_pool_task_id, task_id).
 void _run_with_pool(const std::function<void(int, size_t)>& fn, size_t range) {
 #ifndef C10_MOBILE
-  for (size_t i = 1; i < range; ++i) {
-    _get_intraop_pool().run([fn, i]() { fn((int)i, i); });
+  auto& pool = _get_intraop_pool();
+  if (numa_intraop_pool != nullptr) {
+    // Hand out contiguous blocks of tasks to each node, so neighbouring
+    // chunks of the range are processed (and first touched) on one node.
+    const size_t num_nodes = numa_intraop_pool->numNodes();
+    for (size_t i = 1; i < range; ++i) {
+      numa_intraop_pool->runOnNode(
+          i * num_nodes / range, [fn, i]() { fn((int)i, i); });
+    }
+  } else {
+    for (size_t i = 1; i < range; ++i) {
+      pool.run([fn, i]() { fn((int)i, i); });
+    }
   }
   // Run the first task on the current thread directly.
   fn(0, 0);
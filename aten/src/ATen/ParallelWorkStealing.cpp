@@ -0,0 +1,426 @@
+#include <ATen/Config.h>
+#if AT_PARALLEL_WORK_STEALING
+#include <ATen/Parallel.h>
+
+#include <c10/util/thread_name.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#ifdef TH_BLAS_MKL
+#include <mkl.h>
+#endif
+
+namespace at {
+namespace {
+
+const int NOT_SET = -1;
+const int CONSUMED = -2;
+
+// Number of threads set by the user
+// NOT_SET -> positive value -> CONSUMED
+// or
+// NOT_SET -> CONSUMED
+// Meaning:
+//  - NOT_SET - pool not initialized, user value is not set
+//  - positive value - pool not initialized, user value set
+//  - CONSUMED - pool is initialized
+std::atomic<int> num_intraop_threads{NOT_SET};
+
+// 0 for threads outside of the pool, [1, pool size] for pool workers. Doubles
+// as the index of the thread's slot in every job it takes part in.
+thread_local size_t thread_num_ = 0;
+thread_local bool is_worker_ = false;
+// Number of chunks the current thread is executing, > 1 when nested.
+thread_local int parallel_depth_ = 0;
+
+struct ParallelDepthGuard {
+  ParallelDepthGuard() {
+    ++parallel_depth_;
+  }
+  ~ParallelDepthGuard() {
+    --parallel_depth_;
+  }
+};
+
+// One call to _parallel_run. The chunk ids [0, num_chunks) are split evenly
+// over one slot per thread. A thread takes chunks from the front of its own
+// slot; once it runs dry it steals the back half of another slot's range.
+struct Job {
+  // Chunk ids [lo, hi) owned by one thread.
+  struct Slot {
+    std::mutex mutex;
+    size_t lo = 0;
+    size_t hi = 0;
+  };
+
+  Job(
+      const std::function<void(int64_t, int64_t, size_t)>& fn,
+      int64_t begin,
+      int64_t end,
+      size_t chunk_size,
+      size_t num_chunks,
+      size_t num_slots)
+      : fn(fn),
+        begin(begin),
+        end(end),
+        chunk_size(chunk_size),
+        num_chunks(num_chunks),
+        num_slots(num_slots),
+        slots(new Slot[num_slots]),
+        unclaimed(num_chunks),
+        remaining(num_chunks) {
+    for (size_t i = 0; i < num_slots; ++i) {
+      slots[i].lo = i * num_chunks / num_slots;
+      slots[i].hi = (i + 1) * num_chunks / num_slots;
+    }
+  }
+
+  const std::function<void(int64_t, int64_t, size_t)>& fn;
+  const int64_t begin;
+  const int64_t end;
+  const size_t chunk_size;
+  const size_t num_chunks;
+  const size_t num_slots;
+  std::unique_ptr<Slot[]> slots;
+
+  // Chunks not yet taken by any thread.
+  std::atomic<size_t> unclaimed;
+  // Chunks not yet finished.
+  std::atomic<size_t> remaining;
+  // Pool workers currently working on this job.
+  std::atomic<int> visitors{0};
+
+  std::atomic_flag err_flag = ATOMIC_FLAG_INIT;
+  std::exception_ptr eptr;
+  std::atomic<bool> failed{false};
+
+  std::mutex done_mutex;
+  std::condition_variable done_cv;
+
+  bool claim(size_t slot_id, size_t& chunk_id) {
+    auto& slot = slots[slot_id];
+    std::lock_guard<std::mutex> guard(slot.mutex);
+    if (slot.lo == slot.hi) {
+      return false;
+    }
+    chunk_id = slot.lo++;
+    --unclaimed;
+    return true;
+  }
+
+  bool steal(size_t thief_id) {
+    for (size_t i = 1; i < num_slots; ++i) {
+      auto& victim = slots[(thief_id + i) % num_slots];
+      size_t lo, hi;
+      {
+        std::lock_guard<std::mutex> guard(victim.mutex);
+        if (victim.lo == victim.hi) {
+          continue;
+        }
+        hi = victim.hi;
+        lo = hi - (hi - victim.lo + 1) / 2;
+        victim.hi = lo;
+      }
+      auto& own = slots[thief_id];
+      std::lock_guard<std::mutex> guard(own.mutex);
+      own.lo = lo;
+      own.hi = hi;
+      return true;
+    }
+    return false;
+  }
+
+  void run_chunk(size_t chunk_id) {
+    if (!failed.load(std::memory_order_relaxed)) {
+      int64_t local_start = begin + chunk_id * chunk_size;
+      int64_t local_end = std::min(end, (int64_t)(chunk_size + local_start));
+      try {
+        ParallelDepthGuard guard;
+        fn(local_start, local_end, chunk_id);
+      } catch (...) {
+        if (!err_flag.test_and_set()) {
+          eptr = std::current_exception();
+        }
+        failed = true;
+      }
+    }
+    if (--remaining == 0) {
+      std::lock_guard<std::mutex> guard(done_mutex);
+      done_cv.notify_all();
+    }
+  }
+
+  // Runs chunks of this job only, until none are left to take.
+  void participate(size_t slot_id) {
+    size_t chunk_id;
+    while (true) {
+      if (claim(slot_id, chunk_id)) {
+        run_chunk(chunk_id);
+      } else if (unclaimed.load() == 0) {
+        return;
+      } else if (!steal(slot_id)) {
+        // Another thief is moving the last chunks between slots.
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  void wait() {
+    std::unique_lock<std::mutex> lk(done_mutex);
+    done_cv.wait(lk, [this]() { return remaining.load() == 0; });
+  }
+};
+
+class WorkStealingPool {
+ public:
+  explicit WorkStealingPool(int pool_size) {
+    for (int i = 0; i < pool_size; ++i) {
+      threads_.emplace_back([this, i]() { main_loop(i + 1); });
+    }
+  }
+
+  ~WorkStealingPool() {
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      running_ = false;
+      cv_.notify_all();
+    }
+    for (auto& t : threads_) {
+      t.join();
+    }
+  }
+
+  size_t size() const {
+    return threads_.size();
+  }
+
+  // Makes the job visible to idle workers.
+  void submit(Job* job) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    jobs_.push_back(job);
+    cv_.notify_all();
+  }
+
+  // Removes a finished job; returns once no worker references it anymore.
+  void retire(Job* job) {
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      jobs_.erase(std::find(jobs_.begin(), jobs_.end(), job));
+    }
+    while (job->visitors.load() > 0) {
+      std::this_thread::yield();
+    }
+  }
+
+  void launch(std::function<void()> func) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    tasks_.push_back(std::move(func));
+    cv_.notify_one();
+  }
+
+ private:
+  // Prefers the most recent job, which is the innermost nested region when
+  // nesting, so the threads blocked on it can resume sooner.
+  Job* find_job() {
+    for (auto it = jobs_.rbegin(); it != jobs_.rend(); ++it) {
+      if ((*it)->unclaimed.load() > 0) {
+        return *it;
+      }
+    }
+    return nullptr;
+  }
+
+  void main_loop(size_t thread_num) {
+    thread_num_ = thread_num;
+    is_worker_ = true;
+    c10::setThreadName("PTThreadPool");
+    at::init_num_threads();
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      Job* job = nullptr;
+      cv_.wait(lock, [&]() {
+        return !running_ || (job = find_job()) != nullptr || !tasks_.empty();
+      });
+      if (!running_) {
+        break;
+      }
+      if (job != nullptr) {
+        ++job->visitors;
+        lock.unlock();
+        job->participate(thread_num);
+        --job->visitors;
+        lock.lock();
+        continue;
+      }
+      auto task = std::move(tasks_.front());
+      tasks_.pop_front();
+      lock.unlock();
+      try {
+        ParallelDepthGuard guard;
+        task();
+      } catch (const std::exception& e) {
+        LOG(ERROR) << "Exception in thread pool task: " << e.what();
+      } catch (...) {
+        LOG(ERROR) << "Exception in thread pool task: unknown";
+      }
+      lock.lock();
+    }
+  }
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  bool running_ = true;
+  // Jobs that may still have chunks to take, newest last.
+  std::vector<Job*> jobs_;
+  // Tasks from intraop_launch.
+  std::deque<std::function<void()>> tasks_;
+  std::vector<std::thread> threads_;
+};
+
+int _num_pool_threads(int nthreads) {
+  if (nthreads == NOT_SET) {
+    nthreads = intraop_default_num_threads();
+  } else {
+    TORCH_INTERNAL_ASSERT(nthreads > 0);
+  }
+  // minus one because of the master thread
+  return nthreads - 1;
+}
+
+WorkStealingPool& _get_intraop_pool() {
+  static WorkStealingPool pool(
+      _num_pool_threads(num_intraop_threads.exchange(CONSUMED)));
+  return pool;
+}
+
+} // namespace
+
+namespace internal {
+
+void _parallel_run(
+  const int64_t begin,
+  const int64_t end,
+  const int64_t grain_size,
+  const std::function<void(int64_t, int64_t, size_t)>& f) {
+  at::internal::lazy_init_num_threads();
+
+  size_t num_chunks, chunk_size;
+  std::tie(num_chunks, chunk_size) =
+      internal::calc_num_chunks_and_chunk_size(begin, end, grain_size);
+
+  auto& pool = _get_intraop_pool();
+  if (num_chunks == 1 || pool.size() == 0) {
+    ParallelDepthGuard guard;
+    for (size_t chunk_id = 0; chunk_id < num_chunks; ++chunk_id) {
+      int64_t local_start = begin + chunk_id * chunk_size;
+      f(local_start,
+        std::min(end, (int64_t)(chunk_size + local_start)),
+        chunk_id);
+    }
+    return;
+  }
+
+  Job job(f, begin, end, chunk_size, num_chunks, pool.size() + 1);
+  pool.submit(&job);
+  job.participate(thread_num_);
+  job.wait();
+  pool.retire(&job);
+  if (job.eptr) {
+    std::rethrow_exception(job.eptr);
+  }
+}
+
+} // namespace internal
+
+void init_num_threads() {
+#ifdef _OPENMP
+  omp_set_num_threads(1);
+#endif
+
+#ifdef TH_BLAS_MKL
+  mkl_set_num_threads(1);
+#endif
+}
+
+void set_num_threads(int nthreads) {
+  TORCH_CHECK(nthreads > 0, "Expected positive number of threads");
+  int no_value = NOT_SET;
+  if (!num_intraop_threads.compare_exchange_strong(no_value, nthreads)) {
+    // num_intraop_threads either stores a positive integer or CONSUMED,
+    // check that requested size is the same as the current one
+    int stored_nthreads = num_intraop_threads.load();
+    if (stored_nthreads <= 0) {
+      // plus one because of master thread
+      stored_nthreads = _get_intraop_pool().size() + 1;
+    }
+    if (stored_nthreads != nthreads) {
+      TORCH_WARN(
+        "Cannot set number of intraop threads "
+        "after parallel work has started or after set_num_threads call "
+        "when using work-stealing parallel backend");
+    }
+  }
+}
+
+int get_num_threads() {
+  // not initializing pool unnecessarily,
+  // because pool cannot be resized after initialization
+  int nthreads = num_intraop_threads.load();
+  if (nthreads > 0) {
+    return nthreads;
+  } else if (nthreads == NOT_SET) {
+    return intraop_default_num_threads();
+  } else {
+    TORCH_INTERNAL_ASSERT(nthreads == CONSUMED);
+    return _get_intraop_pool().size() + 1;
+  }
+}
+
+int get_thread_num() {
+  return thread_num_;
+}
+
+bool in_parallel_region() {
+  return parallel_depth_ > 0 || is_worker_;
+}
+
+void intraop_launch(std::function<void()> func) {
+  if (!in_parallel_region() && get_num_threads() > 1) {
+    _get_intraop_pool().launch(std::move(func));
+  } else {
+    // execute inline if we're in parallel region
+    func();
+  }
+}
+
+std::shared_ptr<c10::ivalue::Future> intraop_launch_future(
+    std::function<void()> func) {
+  auto future = std::make_shared<c10::ivalue::Future>(c10::NoneType::get());
+  if (!in_parallel_region() && get_num_threads() > 1) {
+    _get_intraop_pool().launch(
+      [func, future]() {
+        func();
+        future->markCompleted();
+      }
+    );
+  } else {
+    func();
+    future->markCompleted();
+  }
+  return future;
+}
+
+} // namespace at
+#endif
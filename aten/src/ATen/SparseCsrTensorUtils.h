@@ -0,0 +1,29 @@
+#pragma once
+
+#include <ATen/ATen.h>
+#include <ATen/SparseCsrTensorImpl.h>
+
+namespace at { namespace sparse_csr {
+
+// Just for documentary purposes
+using SparseCsrTensor = Tensor;
+
+// This is an internal utility function for getting at the SparseCsrTensorImpl,
+// see get_sparse_impl in SparseTensorUtils.h.
+inline SparseCsrTensorImpl* get_sparse_csr_impl(const SparseCsrTensor& self) {
+  AT_ASSERTM(self.is_sparse_csr(), "_internal_get_SparseCsrTensorImpl: not a sparse CSR tensor");
+  return static_cast<SparseCsrTensorImpl*>(self.unsafeGetTensorImpl());
+}
+
+// Takes crow_indices, col_indices and values and directly puts them into the
+// CSR tensor, no copy.
+inline void alias_into_sparse_csr(
+    const SparseCsrTensor& self,
+    const Tensor& crow_indices,
+    const Tensor& col_indices,
+    const Tensor& values,
+    IntArrayRef size) {
+  get_sparse_csr_impl(self)->set_member_tensors_unsafe(crow_indices, col_indices, values, size);
+}
+
+}} // namespace at::sparse_csr
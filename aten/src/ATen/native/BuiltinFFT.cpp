@@ -0,0 +1,273 @@
+#include <ATen/native/BuiltinFFT.h>
+
+#include <ATen/ATen.h>
+#include <ATen/Dispatch.h>
+#include <ATen/Parallel.h>
+#include <ATen/Utils.h>
+#include <ATen/native/BuiltinFFTPlan.h>
+#include <ATen/native/SpectralOpsUtils.h>
+#include <ATen/native/utils/ParamsHash.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace at { namespace native {
+
+using builtin_fft::FFTComplexPlan;
+using builtin_fft::FFTRealPlan;
+
+namespace {
+
+constexpr size_t BUILTIN_FFT_CACHE_SIZE = 256;
+
+// Key of a one-dimensional plan. Multi-dimensional transforms combine the
+// plans of each signal dimension, so plans are shared between, e.g., 2D
+// transforms of size 64 x 64 and 1D transforms of size 64.
+// Must be a POD because ParamsHash and ParamsEqual read its bytes.
+struct BuiltinFFTParams {
+  ScalarType scalar_type;
+  bool real;
+  int64_t size;
+};
+
+// An LRU cache of plans, similar to CuFFTParamsLRUCache. Plans are held
+// through shared pointers so that a plan evicted while another thread is
+// using it stays alive until that thread is done.
+class BuiltinFFTPlanCache {
+ public:
+  using kv_t = std::pair<BuiltinFFTParams, std::shared_ptr<const void>>;
+  using map_t = std::unordered_map<BuiltinFFTParams,
+                                   std::list<kv_t>::iterator,
+                                   ParamsHash<BuiltinFFTParams>,
+                                   ParamsEqual<BuiltinFFTParams>>;
+
+  std::shared_ptr<const void> find(const BuiltinFFTParams& key) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto map_it = cache_map_.find(key);
+    if (map_it == cache_map_.end()) {
+      return nullptr;
+    }
+    usage_list_.splice(usage_list_.begin(), usage_list_, map_it->second);
+    return map_it->second->second;
+  }
+
+  // Returns the plan already cached for key, if another thread inserted one
+  // in the meantime, and plan otherwise.
+  std::shared_ptr<const void> insert(const BuiltinFFTParams& key,
+                                     std::shared_ptr<const void> plan) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto map_it = cache_map_.find(key);
+    if (map_it != cache_map_.end()) {
+      usage_list_.splice(usage_list_.begin(), usage_list_, map_it->second);
+      return map_it->second->second;
+    }
+    if (usage_list_.size() >= BUILTIN_FFT_CACHE_SIZE) {
+      cache_map_.erase(usage_list_.back().first);
+      usage_list_.pop_back();
+    }
+    usage_list_.emplace_front(key, plan);
+    cache_map_.emplace(key, usage_list_.begin());
+    return plan;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::list<kv_t> usage_list_;
+  map_t cache_map_;
+};
+
+BuiltinFFTPlanCache& plan_cache() {
+  static BuiltinFFTPlanCache cache;
+  return cache;
+}
+
+template <typename Plan>
+std::shared_ptr<const Plan> get_plan(ScalarType scalar_type, bool real, int64_t size) {
+  BuiltinFFTParams params;
+  // Zero the padding bytes, they are hashed and compared too
+  memset(&params, 0, sizeof(params));
+  params.scalar_type = scalar_type;
+  params.real = real;
+  params.size = size;
+  auto& cache = plan_cache();
+  auto plan = cache.find(params);
+  if (!plan) {
+    // Plans are built outside of the lock, computing the twiddles of a large
+    // plan takes a while.
+    plan = cache.insert(params, std::make_shared<const Plan>(size));
+  }
+  return std::static_pointer_cast<const Plan>(plan);
+}
+
+// Transforms data along one dimension. data is a contiguous complex array of
+// shape [outer, len, mid, row], of which only the first cols entries of each
+// row are transformed.
+template <typename scalar_t>
+void transform_dim(c10::complex<scalar_t>* data, int64_t outer, int64_t len,
+                   int64_t mid, int64_t row, int64_t cols,
+                   const FFTComplexPlan<scalar_t>& plan, bool forward) {
+  using cmplx = c10::complex<scalar_t>;
+  // Strided lines are copied a few at a time into a contiguous buffer. The
+  // lines of a group are adjacent in memory so the copies read whole cache
+  // lines.
+  constexpr int64_t kLinesPerGroup = 8;
+  const int64_t stride = mid * row;
+  const int64_t lines_per_outer = mid * cols;
+  const int64_t num_lines = outer * lines_per_outer;
+  const int64_t grain_size = std::max<int64_t>(1, internal::GRAIN_SIZE / len);
+  at::parallel_for(0, num_lines, grain_size, [&](int64_t begin, int64_t end) {
+    std::vector<cmplx> scratch(plan.scratch_size());
+    std::vector<cmplx> buffer(stride == 1 ? 0 : kLinesPerGroup * len);
+    int64_t line = begin;
+    while (line < end) {
+      const int64_t o = line / lines_per_outer;
+      const int64_t r = line % lines_per_outer;
+      const int64_t c = r % cols;
+      cmplx* base = data + o * len * stride + (r / cols) * row + c;
+      if (stride == 1) {
+        plan.exec(base, scratch.data(), forward);
+        line++;
+        continue;
+      }
+      const int64_t count = std::min({kLinesPerGroup, cols - c, end - line});
+      for (int64_t j = 0; j < len; j++) {
+        for (int64_t b = 0; b < count; b++) {
+          buffer[b * len + j] = base[j * stride + b];
+        }
+      }
+      for (int64_t b = 0; b < count; b++) {
+        plan.exec(buffer.data() + b * len, scratch.data(), forward);
+      }
+      for (int64_t j = 0; j < len; j++) {
+        for (int64_t b = 0; b < count; b++) {
+          base[j * stride + b] = buffer[b * len + j];
+        }
+      }
+      line += count;
+    }
+  });
+}
+
+template <typename scalar_t>
+void _fft_builtin_impl(const Tensor& input, Tensor& output, int64_t signal_ndim,
+                       bool complex_input, bool complex_output, bool inverse,
+                       IntArrayRef signal_sizes) {
+  using cmplx = c10::complex<scalar_t>;
+  const auto scalar_type = input.scalar_type();
+  const int64_t batch = input.size(0);
+  const int64_t last_size = signal_sizes[signal_ndim - 1];
+  // Number of lines along the last signal dimension
+  int64_t num_rows = batch;
+  for (int64_t d = 0; d < signal_ndim - 1; d++) {
+    num_rows *= signal_sizes[d];
+  }
+
+  // Complex transforms along all signal dimensions but the last one. data is
+  // a contiguous [num_rows, row] array of which the first cols columns are
+  // transformed.
+  auto transform_leading_dims = [&](cmplx* data, int64_t row, int64_t cols, bool forward) {
+    int64_t outer = batch;
+    for (int64_t d = 0; d < signal_ndim - 1; d++) {
+      const int64_t len = signal_sizes[d];
+      int64_t mid = 1;
+      for (int64_t i = d + 1; i < signal_ndim - 1; i++) {
+        mid *= signal_sizes[i];
+      }
+      auto plan = get_plan<FFTComplexPlan<scalar_t>>(scalar_type, false, len);
+      transform_dim(data, outer, len, mid, row, cols, *plan, forward);
+      outer *= len;
+    }
+  };
+  const int64_t grain_size = std::max<int64_t>(1, internal::GRAIN_SIZE / last_size);
+
+  if (complex_input && complex_output) {
+    output.copy_(input);
+    auto data = reinterpret_cast<cmplx*>(output.data_ptr<scalar_t>());
+    transform_leading_dims(data, last_size, last_size, !inverse);
+    auto plan = get_plan<FFTComplexPlan<scalar_t>>(scalar_type, false, last_size);
+    transform_dim(data, num_rows, last_size, 1, 1, 1, *plan, !inverse);
+  } else if (complex_output) {
+    // real-to-complex: transform the rows, then the other dimensions of the
+    // non-redundant half.
+    const int64_t out_row = output.size(signal_ndim);
+    const int64_t half = infer_ft_real_to_complex_onesided_size(last_size);
+    auto plan = get_plan<FFTRealPlan<scalar_t>>(scalar_type, true, last_size);
+    auto in = input.data_ptr<scalar_t>();
+    auto out = reinterpret_cast<cmplx*>(output.data_ptr<scalar_t>());
+    at::parallel_for(0, num_rows, grain_size, [&](int64_t begin, int64_t end) {
+      std::vector<cmplx> scratch(plan->scratch_size());
+      for (int64_t i = begin; i < end; i++) {
+        plan->r2c(in + i * last_size, out + i * out_row, scratch.data());
+      }
+    });
+    transform_leading_dims(out, out_row, half, true);
+  } else {
+    // complex-to-real: transform the other dimensions of the non-redundant
+    // half on a copy of the input, then the rows.
+    const int64_t in_row = input.size(signal_ndim);
+    const int64_t half = infer_ft_real_to_complex_onesided_size(last_size);
+    Tensor buffer = signal_ndim > 1 ? input.clone(at::MemoryFormat::Contiguous) : input;
+    auto in = reinterpret_cast<cmplx*>(buffer.data_ptr<scalar_t>());
+    transform_leading_dims(in, in_row, half, false);
+    auto plan = get_plan<FFTRealPlan<scalar_t>>(scalar_type, true, last_size);
+    auto out = output.data_ptr<scalar_t>();
+    at::parallel_for(0, num_rows, grain_size, [&](int64_t begin, int64_t end) {
+      std::vector<cmplx> scratch(plan->scratch_size());
+      for (int64_t i = begin; i < end; i++) {
+        plan->c2r(in + i * in_row, out + i * last_size, scratch.data());
+      }
+    });
+  }
+}
+
+} // anonymous namespace
+
+Tensor _fft_builtin(const Tensor& self, int64_t signal_ndim,
+                    bool complex_input, bool complex_output,
+                    bool inverse, IntArrayRef checked_signal_sizes,
+                    int64_t normalization, bool onesided,
+                    IntArrayRef output_sizes) {
+  TORCH_CHECK(self.scalar_type() == ScalarType::Float || self.scalar_type() == ScalarType::Double,
+           "builtin FFT doesn't support tensor of type: ", toString(self.scalar_type()));
+  TORCH_CHECK(complex_input || !inverse,
+           "builtin FFT: real-to-complex transforms must be forward transforms");
+  TORCH_CHECK(complex_output || inverse,
+           "builtin FFT: complex-to-real transforms must be inverse transforms");
+  Tensor input = self.contiguous();
+  Tensor output = at::empty(output_sizes, input.options());
+  if (output.numel() == 0) {
+    return output;
+  }
+
+  AT_DISPATCH_FLOATING_TYPES(input.scalar_type(), "_fft_builtin", [&] {
+    _fft_builtin_impl<scalar_t>(input, output, signal_ndim, complex_input,
+                                complex_output, inverse, checked_signal_sizes);
+  });
+
+  const auto norm = static_cast<fft_norm_mode>(normalization);
+  if (norm != fft_norm_mode::none) {
+    auto signal_numel = at::prod_intlist(checked_signal_sizes);
+    double scale;
+    if (norm == fft_norm_mode::by_root_n) {
+      scale = 1.0 / std::sqrt(static_cast<double>(signal_numel));
+    } else {
+      scale = 1.0 / static_cast<double>(signal_numel);
+    }
+    output.mul_(scale);
+  }
+  // now if needed, fill out the other half using Hermitian symmetry dim
+  if (!complex_input && complex_output && !onesided) {
+    auto size_last_signal_dim = checked_signal_sizes[signal_ndim - 1];
+    auto start_slice = infer_ft_real_to_complex_onesided_size(size_last_signal_dim);
+    _fft_fill_with_conjugate_symmetry_(output, signal_ndim, size_last_signal_dim, start_slice);
+  }
+  return output;
+}
+
+}} // namespace at::native
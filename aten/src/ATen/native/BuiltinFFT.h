@@ -0,0 +1,17 @@
+#pragma once
+
+#include <ATen/ATen.h>
+
+namespace at { namespace native {
+
+// FFT on CPU without MKL. Takes the same arguments as _fft_mkl, see
+// _fft_with_size in native_functions.yaml, and is used by it when ATen is
+// built without MKL or when at::globalContext().userEnabledMklFFT() is false.
+// See BuiltinFFTPlan.h for the algorithms.
+CAFFE2_API Tensor _fft_builtin(const Tensor& input, int64_t signal_ndim,
+                               bool complex_input, bool complex_output,
+                               bool inverse, IntArrayRef checked_signal_sizes,
+                               int64_t normalization, bool onesided,
+                               IntArrayRef output_sizes);
+
+}} // namespace at::native
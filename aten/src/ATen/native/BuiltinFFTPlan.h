@@ -0,0 +1,423 @@
+#pragma once
+
+// Portable FFT used on CPU when ATen is built without MKL, or when MKL FFT is
+// disabled with at::globalContext().setUserEnabledMklFFT(false).
+//
+// The plans below only depend on c10 so that they can be reused and tested on
+// their own. The ATen entry points (batching, multi-dimensional transforms and
+// the plan cache) are declared in BuiltinFFT.h.
+//
+// FFTComplexPlan computes unnormalized complex transforms of any length:
+//   - lengths whose prime factors are all small are decomposed into radix-4,
+//     radix-2 and generic odd-radix passes of a self-sorting Stockham
+//     algorithm, so no bit reversal is needed;
+//   - other lengths use Bluestein's algorithm, which expresses the transform
+//     as a convolution computed with power-of-two FFTs.
+// FFTRealPlan computes real-to-complex and complex-to-real transforms. Even
+// lengths pack the signal into a complex signal of half the length, so they
+// cost about half as much as the corresponding complex transform.
+
+#include <c10/util/complex.h>
+#include <c10/util/Exception.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace at { namespace native { namespace builtin_fft {
+
+template <typename T>
+class FFTComplexPlan {
+ public:
+  using cmplx = c10::complex<T>;
+
+  explicit FFTComplexPlan(int64_t n) : n_(n) {
+    TORCH_CHECK(n > 0, "FFT: invalid signal size ", n);
+    auto factors = factorize(n);
+    if (!factors.empty() && factors.back() > kMaxRadix) {
+      init_bluestein();
+    } else {
+      init_passes(factors);
+    }
+  }
+
+  int64_t size() const {
+    return n_;
+  }
+
+  // Number of complex elements of scratch space exec() needs.
+  int64_t scratch_size() const {
+    return bluestein_ ? 2 * bluestein_->size() + bluestein_->scratch_size() : n_;
+  }
+
+  // Transforms data (n contiguous elements) in place. The forward transform
+  // uses exp(-2 pi i jk / n), the backward one exp(2 pi i jk / n); neither is
+  // normalized.
+  void exec(cmplx* data, cmplx* scratch, bool forward) const {
+    if (bluestein_) {
+      exec_bluestein(data, scratch, forward);
+    } else if (forward) {
+      exec_passes<true>(data, scratch);
+    } else {
+      exec_passes<false>(data, scratch);
+    }
+  }
+
+ private:
+  // Larger prime factors make the O(radix^2) generic pass slower than
+  // Bluestein's algorithm.
+  static constexpr int64_t kMaxRadix = 61;
+
+  struct Pass {
+    int64_t radix;
+    int64_t l1;
+    int64_t ido;
+    // Offsets of the pass' twiddles and, for generic radices, roots of unity
+    size_t twiddle;
+    size_t roots;
+  };
+
+  // Prime factors in increasing order, with pairs of 2s merged into 4s first.
+  static std::vector<int64_t> factorize(int64_t n) {
+    std::vector<int64_t> factors;
+    while (n % 4 == 0) {
+      factors.push_back(4);
+      n /= 4;
+    }
+    if (n % 2 == 0) {
+      factors.push_back(2);
+      n /= 2;
+    }
+    for (int64_t p = 3; p * p <= n; p += 2) {
+      while (n % p == 0) {
+        factors.push_back(p);
+        n /= p;
+      }
+    }
+    if (n > 1) {
+      factors.push_back(n);
+    }
+    std::sort(factors.begin(), factors.end(), [](int64_t a, int64_t b) {
+      // Keep the 4s first, they make the cheapest passes
+      return (a == 4 ? 0 : a) < (b == 4 ? 0 : b);
+    });
+    return factors;
+  }
+
+  // exp(2 pi i num / den), computed in double to keep float plans accurate
+  static cmplx root(int64_t num, int64_t den) {
+    num %= den;
+    double angle = 2.0 * M_PI * static_cast<double>(num) / static_cast<double>(den);
+    return cmplx(static_cast<T>(std::cos(angle)), static_cast<T>(std::sin(angle)));
+  }
+
+  void init_passes(const std::vector<int64_t>& factors) {
+    int64_t l1 = 1;
+    for (auto radix : factors) {
+      int64_t ido = n_ / (l1 * radix);
+      Pass pass{radix, l1, ido, twiddles_.size(), roots_.size()};
+      for (int64_t j = 1; j < radix; j++) {
+        for (int64_t i = 1; i < ido; i++) {
+          twiddles_.push_back(root(j * l1 * i, n_));
+        }
+      }
+      if (radix != 2 && radix != 4) {
+        for (int64_t k = 0; k < radix; k++) {
+          roots_.push_back(root(k, radix));
+        }
+      }
+      passes_.push_back(pass);
+      l1 *= radix;
+    }
+  }
+
+  void init_bluestein() {
+    int64_t m = 1;
+    while (m < 2 * n_ - 1) {
+      m *= 2;
+    }
+    bluestein_ = std::make_unique<FFTComplexPlan>(m);
+    // chirp_[j] = exp(-pi i j^2 / n); j^2 is reduced modulo 2n to keep the
+    // angle small.
+    chirp_.resize(n_);
+    for (int64_t j = 0; j < n_; j++) {
+      chirp_[j] = std::conj(root((j * j) % (2 * n_), 2 * n_));
+    }
+    // Transform of the convolution kernel, scaled by 1/m so that the backward
+    // transform of the product does not need a separate normalization.
+    kernel_.assign(m, cmplx(0, 0));
+    kernel_[0] = std::conj(chirp_[0]);
+    for (int64_t j = 1; j < n_; j++) {
+      kernel_[j] = kernel_[m - j] = std::conj(chirp_[j]);
+    }
+    std::vector<cmplx> scratch(bluestein_->scratch_size());
+    bluestein_->exec(kernel_.data(), scratch.data(), /*forward=*/true);
+    const T scale = T(1) / static_cast<T>(m);
+    for (auto& v : kernel_) {
+      v *= scale;
+    }
+  }
+
+  // Multiplies by w for backward transforms and by conj(w) for forward ones.
+  template <bool forward>
+  static cmplx rotate(const cmplx& v, const cmplx& w) {
+    if (forward) {
+      return cmplx(v.real() * w.real() + v.imag() * w.imag(),
+                   v.imag() * w.real() - v.real() * w.imag());
+    }
+    return v * w;
+  }
+
+  // Multiplies by -i for forward transforms and by i for backward ones.
+  template <bool forward>
+  static cmplx rotate90(const cmplx& v) {
+    return forward ? cmplx(v.imag(), -v.real()) : cmplx(-v.imag(), v.real());
+  }
+
+  // Each pass reads l1 * radix * ido inputs laid out as cc[i + ido * (j + radix * k)]
+  // and writes ch[i + ido * (k + l1 * u)], where u indexes the radix outputs.
+  template <bool forward>
+  void pass2(const Pass& p, const cmplx* cc, cmplx* ch) const {
+    const int64_t ido = p.ido, l1 = p.l1;
+    const cmplx* wa = twiddles_.data() + p.twiddle;
+    for (int64_t k = 0; k < l1; k++) {
+      const cmplx* in0 = cc + ido * (2 * k);
+      const cmplx* in1 = in0 + ido;
+      cmplx* out0 = ch + ido * k;
+      cmplx* out1 = out0 + ido * l1;
+      out0[0] = in0[0] + in1[0];
+      out1[0] = in0[0] - in1[0];
+      for (int64_t i = 1; i < ido; i++) {
+        out0[i] = in0[i] + in1[i];
+        out1[i] = rotate<forward>(in0[i] - in1[i], wa[i - 1]);
+      }
+    }
+  }
+
+  template <bool forward>
+  void pass4(const Pass& p, const cmplx* cc, cmplx* ch) const {
+    const int64_t ido = p.ido, l1 = p.l1;
+    const cmplx* wa1 = twiddles_.data() + p.twiddle;
+    const cmplx* wa2 = wa1 + (ido - 1);
+    const cmplx* wa3 = wa2 + (ido - 1);
+    for (int64_t k = 0; k < l1; k++) {
+      const cmplx* in0 = cc + ido * (4 * k);
+      const cmplx* in1 = in0 + ido;
+      const cmplx* in2 = in1 + ido;
+      const cmplx* in3 = in2 + ido;
+      cmplx* out0 = ch + ido * k;
+      cmplx* out1 = out0 + ido * l1;
+      cmplx* out2 = out1 + ido * l1;
+      cmplx* out3 = out2 + ido * l1;
+      for (int64_t i = 0; i < ido; i++) {
+        cmplx t0 = in0[i] + in2[i];
+        cmplx t1 = in0[i] - in2[i];
+        cmplx t2 = in1[i] + in3[i];
+        cmplx t3 = rotate90<forward>(in1[i] - in3[i]);
+        if (i == 0) {
+          out0[0] = t0 + t2;
+          out1[0] = t1 + t3;
+          out2[0] = t0 - t2;
+          out3[0] = t1 - t3;
+        } else {
+          out0[i] = t0 + t2;
+          out1[i] = rotate<forward>(t1 + t3, wa1[i - 1]);
+          out2[i] = rotate<forward>(t0 - t2, wa2[i - 1]);
+          out3[i] = rotate<forward>(t1 - t3, wa3[i - 1]);
+        }
+      }
+    }
+  }
+
+  template <bool forward>
+  void pass_generic(const Pass& p, const cmplx* cc, cmplx* ch) const {
+    const int64_t ido = p.ido, l1 = p.l1, radix = p.radix;
+    const cmplx* wa = twiddles_.data() + p.twiddle;
+    const cmplx* roots = roots_.data() + p.roots;
+    for (int64_t k = 0; k < l1; k++) {
+      const cmplx* in = cc + ido * radix * k;
+      cmplx* out = ch + ido * k;
+      for (int64_t u = 0; u < radix; u++) {
+        cmplx* out_u = out + ido * l1 * u;
+        for (int64_t i = 0; i < ido; i++) {
+          out_u[i] = in[i];
+        }
+        // Accumulate x_j * exp(-+2 pi i j u / radix); j * u is reduced modulo
+        // radix incrementally.
+        int64_t ju = 0;
+        for (int64_t j = 1; j < radix; j++) {
+          ju += u;
+          if (ju >= radix) {
+            ju -= radix;
+          }
+          const cmplx w = roots[ju];
+          const cmplx* in_j = in + ido * j;
+          for (int64_t i = 0; i < ido; i++) {
+            out_u[i] += rotate<forward>(in_j[i], w);
+          }
+        }
+        if (u > 0) {
+          const cmplx* wa_u = wa + (u - 1) * (ido - 1);
+          for (int64_t i = 1; i < ido; i++) {
+            out_u[i] = rotate<forward>(out_u[i], wa_u[i - 1]);
+          }
+        }
+      }
+    }
+  }
+
+  template <bool forward>
+  void exec_passes(cmplx* data, cmplx* scratch) const {
+    cmplx* src = data;
+    cmplx* dst = scratch;
+    for (const auto& p : passes_) {
+      switch (p.radix) {
+        case 2:
+          pass2<forward>(p, src, dst);
+          break;
+        case 4:
+          pass4<forward>(p, src, dst);
+          break;
+        default:
+          pass_generic<forward>(p, src, dst);
+      }
+      std::swap(src, dst);
+    }
+    if (src != data) {
+      std::copy(src, src + n_, data);
+    }
+  }
+
+  void exec_bluestein(cmplx* data, cmplx* scratch, bool forward) const {
+    const int64_t m = bluestein_->size();
+    cmplx* buf = scratch;
+    cmplx* inner_scratch = scratch + m;
+    // The backward transform is the conjugate of the forward transform of
+    // the conjugated signal.
+    for (int64_t j = 0; j < n_; j++) {
+      cmplx x = forward ? data[j] : std::conj(data[j]);
+      buf[j] = x * chirp_[j];
+    }
+    std::fill(buf + n_, buf + m, cmplx(0, 0));
+    bluestein_->exec(buf, inner_scratch, /*forward=*/true);
+    for (int64_t j = 0; j < m; j++) {
+      buf[j] *= kernel_[j];
+    }
+    bluestein_->exec(buf, inner_scratch, /*forward=*/false);
+    for (int64_t k = 0; k < n_; k++) {
+      cmplx y = buf[k] * chirp_[k];
+      data[k] = forward ? y : std::conj(y);
+    }
+  }
+
+  int64_t n_;
+  std::vector<Pass> passes_;
+  std::vector<cmplx> twiddles_;
+  std::vector<cmplx> roots_;
+
+  std::unique_ptr<FFTComplexPlan> bluestein_;
+  std::vector<cmplx> chirp_;
+  std::vector<cmplx> kernel_;
+};
+
+template <typename T>
+class FFTRealPlan {
+ public:
+  using cmplx = c10::complex<T>;
+
+  explicit FFTRealPlan(int64_t n)
+      : n_(n), plan_(n % 2 == 0 ? n / 2 : n) {
+    if (n % 2 == 0) {
+      const int64_t half = n / 2;
+      twiddles_.resize(half + 1);
+      for (int64_t k = 0; k <= half; k++) {
+        double angle = -2.0 * M_PI * static_cast<double>(k) / static_cast<double>(n);
+        twiddles_[k] = cmplx(static_cast<T>(std::cos(angle)), static_cast<T>(std::sin(angle)));
+      }
+    }
+  }
+
+  int64_t size() const {
+    return n_;
+  }
+
+  int64_t scratch_size() const {
+    return plan_.size() + plan_.scratch_size();
+  }
+
+  // Forward transform of n reals into the n / 2 + 1 non-redundant outputs.
+  void r2c(const T* in, cmplx* out, cmplx* scratch) const {
+    cmplx* z = scratch;
+    cmplx* inner_scratch = scratch + plan_.size();
+    if (n_ % 2 != 0) {
+      for (int64_t j = 0; j < n_; j++) {
+        z[j] = cmplx(in[j], 0);
+      }
+      plan_.exec(z, inner_scratch, /*forward=*/true);
+      std::copy(z, z + n_ / 2 + 1, out);
+      return;
+    }
+    // Transform the even samples as real parts and the odd samples as
+    // imaginary parts, then separate the two spectra E and O using their
+    // conjugate symmetry: X[k] = E[k] + exp(-2 pi i k / n) O[k].
+    const int64_t half = n_ / 2;
+    for (int64_t j = 0; j < half; j++) {
+      z[j] = cmplx(in[2 * j], in[2 * j + 1]);
+    }
+    plan_.exec(z, inner_scratch, /*forward=*/true);
+    for (int64_t k = 0; k <= half; k++) {
+      cmplx zk = z[k == half ? 0 : k];
+      cmplx zc = std::conj(z[k == 0 ? 0 : half - k]);
+      cmplx even = (zk + zc) * T(0.5);
+      cmplx diff = (zk - zc) * T(0.5);
+      cmplx odd(diff.imag(), -diff.real());
+      out[k] = even + twiddles_[k] * odd;
+    }
+  }
+
+  // Unnormalized backward transform of the n / 2 + 1 non-redundant values of
+  // a Hermitian signal into n reals. As in other FFT libraries, the imaginary
+  // parts of the values that must be real (the first one and, for even n, the
+  // last one) are ignored.
+  void c2r(const cmplx* in, T* out, cmplx* scratch) const {
+    cmplx* z = scratch;
+    cmplx* inner_scratch = scratch + plan_.size();
+    if (n_ % 2 != 0) {
+      z[0] = cmplx(in[0].real(), 0);
+      for (int64_t k = 1; k <= n_ / 2; k++) {
+        z[k] = in[k];
+        z[n_ - k] = std::conj(in[k]);
+      }
+      plan_.exec(z, inner_scratch, /*forward=*/false);
+      for (int64_t j = 0; j < n_; j++) {
+        out[j] = z[j].real();
+      }
+      return;
+    }
+    // Inverse of the packing done by r2c: rebuild 2 * (E[k] + i O[k]) and
+    // transform it back with the half-length plan.
+    const int64_t half = n_ / 2;
+    for (int64_t k = 0; k < half; k++) {
+      cmplx xk = k == 0 ? cmplx(in[0].real(), 0) : in[k];
+      cmplx xc = k == 0 ? cmplx(in[half].real(), 0) : std::conj(in[half - k]);
+      cmplx even = xk + xc;
+      cmplx odd = (xk - xc) * std::conj(twiddles_[k]);
+      z[k] = cmplx(even.real() - odd.imag(), even.imag() + odd.real());
+    }
+    plan_.exec(z, inner_scratch, /*forward=*/false);
+    for (int64_t j = 0; j < half; j++) {
+      out[2 * j] = z[j].real();
+      out[2 * j + 1] = z[j].imag();
+    }
+  }
+
+ private:
+  int64_t n_;
+  FFTComplexPlan<T> plan_;
+  // exp(-2 pi i k / n) for k in [0, n / 2], even n only
+  std::vector<cmplx> twiddles_;
+};
+
+}}} // namespace at::native::builtin_fft
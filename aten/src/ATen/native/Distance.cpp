@@ -2,9 +2,13 @@
 #include <ATen/Dispatch.h>
 #include <ATen/NativeFunctions.h>
 #include <ATen/NamedTensorUtils.h>
+#include <ATen/NumericUtils.h>
 #include <ATen/ExpandUtils.h>
+#include <ATen/Parallel.h>
 #include <ATen/native/Distance.h>
 
+#include <algorithm>
+
 namespace at { namespace native {
 
 DEFINE_DISPATCH(pdist_forward_stub);
@@ -135,6 +139,141 @@ Tensor _cdist_forward(const Tensor& x1, const Tensor& x2, const double p, c10::o
   return result;
 }
 
+// cdist_topk works on tiles of kTopkRowBlock rows of x1 by kTopkColBlock rows
+// of x2, so that the distances of a tile stay in cache while they are merged
+// into the bounded per-row heaps, and the full distance matrix is never
+// materialized.
+static constexpr int64_t kTopkRowBlock = 64;
+static constexpr int64_t kTopkColBlock = 512;
+
+std::tuple<Tensor, Tensor> cdist_topk_cpu(const Tensor& x1, const Tensor& x2, int64_t k, const double p) {
+  TORCH_CHECK(x1.dim() >= 2, "cdist_topk only supports at least 2D tensors, X1 got: ", x1.dim(), "D");
+  TORCH_CHECK(x2.dim() >= 2, "cdist_topk only supports at least 2D tensors, X2 got: ", x2.dim(), "D");
+  TORCH_CHECK(x1.size(-1) == x2.size(-1), "X1 and X2 must have the same number of columns. X1: ", x1.size(-1), " X2: ", x2.size(-1));
+  TORCH_CHECK(at::isFloatingType(x1.scalar_type()), "cdist_topk only supports floating-point dtypes, X1 got: ", x1.scalar_type());
+  TORCH_CHECK(x1.scalar_type() == x2.scalar_type(), "X1 and X2 must have the same dtype. X1: ", x1.scalar_type(), " X2: ", x2.scalar_type());
+  TORCH_CHECK(p >= 0, "cdist_topk only supports non-negative p values");
+  int64_t c = x1.size(-1);
+  int64_t r1 = x1.size(-2);
+  int64_t r2 = x2.size(-2);
+  TORCH_CHECK(k >= 0 && k <= r2, "cdist_topk: k (", k, ") must be between 0 and the number of rows of X2 (", r2, ")");
+
+  IntArrayRef batch_tensor1(x1.sizes().data(), x1.dim() - 2);
+  IntArrayRef batch_tensor2(x2.sizes().data(), x2.dim() - 2);
+  std::vector<int64_t> expand_batch_portion = infer_size(batch_tensor1, batch_tensor2);
+  std::vector<int64_t> tensor1_expand_size(expand_batch_portion);
+  tensor1_expand_size.insert(tensor1_expand_size.end(), {r1, c});
+  std::vector<int64_t> tensor2_expand_size(expand_batch_portion);
+  tensor2_expand_size.insert(tensor2_expand_size.end(), {r2, c});
+  int64_t batch = std::accumulate(expand_batch_portion.begin(), expand_batch_portion.end(), 1, std::multiplies<int64_t>());
+
+  Tensor tensor1 = x1.expand(tensor1_expand_size).contiguous().view({batch, r1, c});
+  Tensor tensor2 = x2.expand(tensor2_expand_size).contiguous().view({batch, r2, c});
+
+  std::vector<int64_t> output_shape(expand_batch_portion);
+  output_shape.insert(output_shape.end(), {r1, k});
+  Tensor values = at::empty(output_shape, x1.options());
+  Tensor indices = at::empty(output_shape, x1.options().dtype(kLong));
+  if (values.numel() == 0) {
+    return std::make_tuple(values, indices);
+  }
+  if (c == 0) {
+    // every distance is 0, so the first k rows of x2 are the nearest
+    values.zero_();
+    indices.copy_(at::arange(k, indices.options()));
+    return std::make_tuple(values, indices);
+  }
+
+  // For p = 2 the tiles hold dot products and the squared distances are
+  // ||x1||^2 + ||x2||^2 - 2 <x1, x2>, as in _euclidean_dist. Ranking by the
+  // squared distance gives the same order, the root is only taken at the end.
+  const bool euclidean = p == 2;
+  Tensor x1_norm = euclidean ? tensor1.pow(2).sum(-1) : Tensor();
+  Tensor x2_norm = euclidean ? tensor2.pow(2).sum(-1) : Tensor();
+  Tensor values_ = values.view({batch, r1, k});
+  Tensor indices_ = indices.view({batch, r1, k});
+  const int64_t row_blocks = at::divup(r1, kTopkRowBlock);
+
+  AT_DISPATCH_FLOATING_TYPES(tensor1.scalar_type(), "cdist_topk_cpu", [&] {
+    using entry = std::pair<scalar_t, int64_t>;
+    // Orders the candidates of a row from the nearest to the farthest, NaN
+    // distances last and ties by index. The heaps keep the farthest of the
+    // current k nearest at the front.
+    auto nearer = [](const entry& a, const entry& b) {
+      if (_isnan(a.first)) {
+        return _isnan(b.first) && a.second < b.second;
+      }
+      if (_isnan(b.first)) {
+        return true;
+      }
+      return a.first < b.first || (a.first == b.first && a.second < b.second);
+    };
+
+    at::parallel_for(0, batch * row_blocks, 1, [&](int64_t begin, int64_t end) {
+      std::vector<entry> heaps(kTopkRowBlock * k);
+      std::vector<int64_t> heap_sizes(kTopkRowBlock);
+      Tensor buffer = euclidean ? at::empty({kTopkRowBlock, kTopkColBlock}, tensor1.options()) : Tensor();
+
+      for (int64_t task = begin; task < end; task++) {
+        const int64_t b = task / row_blocks;
+        const int64_t i0 = (task % row_blocks) * kTopkRowBlock;
+        const int64_t rows = std::min(kTopkRowBlock, r1 - i0);
+        Tensor x1_tile = tensor1.select(0, b).narrow(0, i0, rows);
+        std::fill(heap_sizes.begin(), heap_sizes.end(), 0);
+
+        for (int64_t j0 = 0; j0 < r2; j0 += kTopkColBlock) {
+          const int64_t cols = std::min(kTopkColBlock, r2 - j0);
+          Tensor x2_tile = tensor2.select(0, b).narrow(0, j0, cols);
+          Tensor dist;
+          if (euclidean) {
+            dist = buffer.narrow(0, 0, rows).narrow(1, 0, cols);
+            at::mm_out(dist, x1_tile, x2_tile.t());
+          } else {
+            dist = at::_cdist_forward(x1_tile, x2_tile, p, c10::nullopt);
+          }
+          const scalar_t* dist_ptr = dist.data_ptr<scalar_t>();
+          const int64_t dist_stride = dist.stride(0);
+          const scalar_t* x1_norm_ptr = euclidean ? x1_norm.data_ptr<scalar_t>() + b * r1 + i0 : nullptr;
+          const scalar_t* x2_norm_ptr = euclidean ? x2_norm.data_ptr<scalar_t>() + b * r2 + j0 : nullptr;
+
+          for (int64_t i = 0; i < rows; i++) {
+            entry* heap = heaps.data() + i * k;
+            int64_t& size = heap_sizes[i];
+            for (int64_t j = 0; j < cols; j++) {
+              scalar_t d = dist_ptr[i * dist_stride + j];
+              if (euclidean) {
+                d = x1_norm_ptr[i] + x2_norm_ptr[j] - 2 * d;
+              }
+              entry candidate(d, j0 + j);
+              if (size < k) {
+                heap[size++] = candidate;
+                std::push_heap(heap, heap + size, nearer);
+              } else if (nearer(candidate, heap[0])) {
+                std::pop_heap(heap, heap + k, nearer);
+                heap[k - 1] = candidate;
+                std::push_heap(heap, heap + k, nearer);
+              }
+            }
+          }
+        }
+
+        auto values_accessor = values_[b].accessor<scalar_t, 2>();
+        auto indices_accessor = indices_[b].accessor<int64_t, 2>();
+        for (int64_t i = 0; i < rows; i++) {
+          entry* heap = heaps.data() + i * k;
+          std::sort_heap(heap, heap + k, nearer);
+          for (int64_t j = 0; j < k; j++) {
+            scalar_t d = heap[j].first;
+            values_accessor[i0 + i][j] = euclidean ? std::sqrt(std::max(d, scalar_t(0))) : d;
+            indices_accessor[i0 + i][j] = heap[j].second;
+          }
+        }
+      }
+    });
+  });
+  return std::make_tuple(values, indices);
+}
+
 Tensor _cdist_backward(const Tensor& grad, const Tensor& x1, const Tensor& x2, const double p, const Tensor& cdist) {
   TORCH_CHECK(x1.is_contiguous(), "_cdist_backward requires X1 to be contiguous");
   TORCH_CHECK(x2.is_contiguous(), "_cdist_backward requires X2 to be contiguous");
@@ -5,6 +5,8 @@
 
 #include <TH/THBlasUtils.h>
 
+#include <caffe2/perfkernels/adagrad.h>
+
 #ifdef USE_FBGEMM
 #include <fbgemm/Fbgemm.h>
 #else
@@ -12,11 +14,14 @@
 #endif
 
 #include <algorithm>
+#include <cmath>
 #include <cstring>
 #include <iostream>
 #include <memory>
+#include <numeric>
 #include <sstream>
 #include <tuple>
+#include <type_traits>
 #include <vector>
 
 
@@ -41,11 +46,21 @@ static void make_offset2bag(const Tensor &offsets, const Tensor &indices, Tensor
 
 namespace {
 
+// Whether the sum of each bag can be computed straight from the offsets by
+// EmbeddingBagSumKernel. Half and BFloat16 tables always take this path, as
+// there are no generic kernels for them; float tables only when their rows are
+// contiguous.
 bool isFastPathIndexSelect(const Tensor& src, Tensor& output) {
+  if (src.scalar_type() == kHalf || src.scalar_type() == kBFloat16) {
+    return true;
+  }
   return src.scalar_type() == kFloat && src.stride(1) == 1 && output.stride(1) == 1;
 }
 
 bool isFastPathIndexSelectScale(const Tensor& src, const Tensor& scale, Tensor& output) {
+  if (src.scalar_type() == kHalf || src.scalar_type() == kBFloat16) {
+    return true;
+  }
   return src.scalar_type() == kFloat && src.stride(1) == 1 && output.stride(1) == 1 && scale.stride(0) == 1;
 }
 
@@ -56,9 +71,7 @@ template<typename T>
 void index_select_add(const Tensor &select_indices,
                              const Tensor &add_indices,
                              const Tensor &src,
-                             Tensor &output,
-                             const Tensor& /*offsets*/,
-                             bool /*include_last_offset*/) {
+                             Tensor &output) {
   AT_ASSERT(select_indices.numel() == add_indices.numel());
   auto* add_indices_data = add_indices.data_ptr<int64_t>();
   auto* select_indices_data = select_indices.data_ptr<int64_t>();
@@ -78,96 +91,6 @@ void index_select_add(const Tensor &select_indices,
   }
 }
 
-template<>
-void index_select_add<float>(const Tensor &select_indices,
-                             const Tensor &add_indices,
-                             const Tensor &src,
-                             Tensor &output,
-                             const Tensor& offsets,
-                             bool include_last_offset) {
-  int64_t ddim = src.size(1);
-  auto* select_indices_data = select_indices.data_ptr<int64_t>();
-  auto* output_data = output.data_ptr<float>();
-
-  if (isFastPathIndexSelect(src, output)) {
-    auto src_contig = src.contiguous();
-    auto* src_data = src_contig.data_ptr<float>();
-    int64_t output_size = offsets.numel() - 1;
-    auto* offsets_data = offsets.data_ptr<int64_t>();
-    std::vector<int64_t> offsets_include_last;
-
-    if (include_last_offset) {
-      output_size = offsets.numel() - 1;
-    } else {
-      output_size = offsets.numel();
-      offsets_include_last.resize(offsets.numel() + 1);
-      std::memcpy(
-          offsets_include_last.data(),
-          offsets.data_ptr<int64_t>(),
-          sizeof(int64_t) * offsets.numel());
-      offsets_include_last[offsets.numel()] = select_indices.numel();
-      offsets_data = offsets_include_last.data();
-    }
-
-#ifdef USE_FBGEMM
-    auto kernel_fp32_i64 =
-      fbgemm::GenerateEmbeddingSpMDM<float, int64_t, int64_t>(
-        /* block_size */ddim,
-        /* has_weight */false,
-        /* normalize_by_lengths */false,
-        /* prefetch */16,
-        /* is_weight_positional */false,
-        /* use_offsets */true
-      );
-#endif
-    at::parallel_for(
-        0, output_size, 1, [&](int64_t start_idx, int64_t end_idx) {
-#ifdef USE_FBGEMM
-          kernel_fp32_i64(
-            /* output_size */end_idx - start_idx,
-            /* index_size */offsets_data[end_idx] - offsets_data[start_idx],
-            /* data_size */src.size(0),
-            /* input */src_data,
-            /* indices */select_indices_data + offsets_data[start_idx],
-            /* offsets_or_lengths */offsets_data + start_idx,
-            /* weights */nullptr,
-            /* output */output_data + start_idx * ddim);
-#else
-          caffe2::EmbeddingLookupIdx(
-              /*block_size=*/ddim,
-              /*output_size=*/end_idx - start_idx,
-              /*index_size=*/offsets_data[end_idx] - offsets_data[start_idx],
-              /*data_size=*/src.size(0),
-              /*input=*/src_data,
-              /*indices=*/select_indices_data + offsets_data[start_idx],
-              /*offsets=*/offsets_data + start_idx,
-              /*weights=*/nullptr,
-              /*scale_bias=*/nullptr,
-              /*normalize_by_lengths=*/false,
-              /*out=*/output_data + start_idx * ddim);
-#endif
-        });
-  } else {
-    AT_ASSERT(select_indices.numel() == add_indices.numel());
-    auto* src_data = src.data_ptr<float>();
-    auto* add_indices_data = add_indices.data_ptr<int64_t>();
-    auto src_stride0 = src.stride(0);
-    auto src_stride1 = src.stride(1);
-    auto output_stride0 = output.stride(0);
-    auto output_stride1 = output.stride(1);
-    auto numel = add_indices.numel();
-    for (int64_t i = 0; i < numel; i++) {
-      THBlas_axpy<float>(
-          ddim,
-          1,
-          src_data + src_stride0 * select_indices_data[i],
-          src_stride1,
-          output_data + output_stride0 * add_indices_data[i],
-          output_stride1);
-    }
-  }
-}
-
 // This function fuses the following three fns:
 // index_select (using select_indices as the index)
 // mul (scaling by per_sample_weights)
@@ -177,9 +100,7 @@ static void index_select_scale_add(const Tensor &select_indices,
                                    const Tensor &add_indices,
                                    const Tensor &scale,
                                    const Tensor &src,
-                                   Tensor &output,
-                                   const Tensor& /*offsets*/,
-                                   bool /*include_last_offset*/) {
+                                   Tensor &output) {
   AT_ASSERT(select_indices.numel() == add_indices.numel());
   auto* add_indices_data = add_indices.data_ptr<int64_t>();
   auto* select_indices_data = select_indices.data_ptr<int64_t>();
@@ -205,98 +126,222 @@ static void index_select_scale_add(const Tensor &select_indices,
   }
 }
 
-template<>
-void index_select_scale_add<float>(const Tensor &select_indices,
-                                          const Tensor &add_indices,
-                                          const Tensor &scale,
-                                          const Tensor &src,
-                                          Tensor &output,
-                                          const Tensor& offsets,
-                                          bool include_last_offset) {
-  int64_t ddim = src.size(1);
-  auto* scale_data = scale.data_ptr<float>();
-  auto* select_indices_data = select_indices.data_ptr<int64_t>();
-  auto* output_data = output.data_ptr<float>();
-
-  if (isFastPathIndexSelectScale(src, scale, output)) {
-    auto src_contig = src.contiguous();
-    auto* src_data = src_contig.data_ptr<float>();
-    int64_t output_size = offsets.numel() - 1;
-    auto* offsets_data = offsets.data_ptr<int64_t>();
-    std::vector<int64_t> offsets_include_last;
+// The generated fbgemm kernels take offsets of the same type as the indices,
+// the caffe2 perfkernels only int64 offsets.
+#ifdef USE_FBGEMM
+template <typename index_t>
+using fast_path_offset_t = index_t;
+#else
+template <typename index_t>
+using fast_path_offset_t = int64_t;
+#endif
 
-    if (include_last_offset) {
-      output_size = offsets.numel() - 1;
-    } else {
-      output_size = offsets.numel();
-      offsets_include_last.resize(offsets.numel() + 1);
-      std::memcpy(
-          offsets_include_last.data(),
-          offsets.data_ptr<int64_t>(),
-          sizeof(int64_t) * offsets.numel());
-      offsets_include_last[offsets.numel()] = select_indices.numel();
-      offsets_data = offsets_include_last.data();
+// Reduces bags of rows of a contiguous embedding table into float outputs:
+//
+//   out[i] = sum(input[indices[j]] * (weights ? weights[j] : 1))
+//            for j in [offsets[i] - offsets[0], offsets[i + 1] - offsets[0])
+//
+// Returns false if an index is out of range. This primary template is the
+// portable kernel, used for BFloat16 tables. Rows are converted to float as
+// they are accumulated, in loops the compiler can vectorize.
+template <typename data_t, typename index_t>
+class EmbeddingBagSumKernel {
+ public:
+  using offset_t = fast_path_offset_t<index_t>;
+
+  EmbeddingBagSumKernel(int64_t block_size, bool /*has_weight*/)
+      : block_size_(block_size) {}
+
+  bool operator()(int64_t output_size, int64_t /*index_size*/, int64_t data_size,
+                  const data_t* input, const index_t* indices,
+                  const offset_t* offsets, const float* weights,
+                  float* out) const {
+    for (int64_t i = 0; i < output_size; i++) {
+      float* out_row = out + i * block_size_;
+      std::fill(out_row, out_row + block_size_, 0.f);
+      for (int64_t j = offsets[i] - offsets[0]; j < offsets[i + 1] - offsets[0]; j++) {
+        int64_t idx = indices[j];
+        if (idx < 0 || idx >= data_size) {
+          return false;
+        }
+        const data_t* in_row = input + idx * block_size_;
+        float w = weights ? weights[j] : 1.f;
+        for (int64_t k = 0; k < block_size_; k++) {
+          out_row[k] += w * static_cast<float>(in_row[k]);
+        }
+      }
     }
+    return true;
+  }
+
+ private:
+  int64_t block_size_;
+};
 
+// float and Half tables use a kernel generated by fbgemm for the block size,
+// or the caffe2 perfkernels when ATen is built without fbgemm.
 #ifdef USE_FBGEMM
-    auto kernel_fp32_i64 =
-      fbgemm::GenerateEmbeddingSpMDM<float, int64_t, int64_t>(
-        /* block_size */ddim,
-        /* has_weight */true,
-        /* normalize_by_lengths */false,
-        /* prefetch */16,
-        /* is_weight_positional */false,
-        /* use_offsets */true
-      );
+template <typename data_t, typename fbgemm_t, typename index_t>
+class FbgemmEmbeddingBagSumKernel {
+ public:
+  using offset_t = index_t;
+
+  FbgemmEmbeddingBagSumKernel(int64_t block_size, bool has_weight)
+      : kernel_(fbgemm::GenerateEmbeddingSpMDM<fbgemm_t, index_t, offset_t>(
+            /* block_size */block_size,
+            /* has_weight */has_weight,
+            /* normalize_by_lengths */false,
+            /* prefetch */16,
+            /* is_weight_positional */false,
+            /* use_offsets */true)) {}
+
+  bool operator()(int64_t output_size, int64_t index_size, int64_t data_size,
+                  const data_t* input, const index_t* indices,
+                  const offset_t* offsets, const float* weights,
+                  float* out) const {
+    return kernel_(
+        output_size, index_size, data_size,
+        reinterpret_cast<const fbgemm_t*>(input), indices, offsets, weights, out);
+  }
+
+ private:
+  typename fbgemm::EmbeddingSpMDMKernelSignature<fbgemm_t, index_t, offset_t>::Type kernel_;
+};
+
+template <typename index_t>
+class EmbeddingBagSumKernel<float, index_t>
+    : public FbgemmEmbeddingBagSumKernel<float, float, index_t> {
+  using FbgemmEmbeddingBagSumKernel<float, float, index_t>::FbgemmEmbeddingBagSumKernel;
+};
+
+template <typename index_t>
+class EmbeddingBagSumKernel<at::Half, index_t>
+    : public FbgemmEmbeddingBagSumKernel<at::Half, fbgemm::float16, index_t> {
+  using FbgemmEmbeddingBagSumKernel<at::Half, fbgemm::float16, index_t>::FbgemmEmbeddingBagSumKernel;
+};
+#else
+template <typename data_t, typename index_t>
+class Caffe2EmbeddingBagSumKernel {
+ public:
+  using offset_t = int64_t;
+
+  Caffe2EmbeddingBagSumKernel(int64_t block_size, bool /*has_weight*/)
+      : block_size_(block_size) {}
+
+  bool operator()(int64_t output_size, int64_t index_size, int64_t data_size,
+                  const data_t* input, const index_t* indices,
+                  const offset_t* offsets, const float* weights,
+                  float* out) const {
+    caffe2::EmbeddingLookupIdx(
+        /*block_size=*/block_size_,
+        /*output_size=*/output_size,
+        /*index_size=*/index_size,
+        /*data_size=*/data_size,
+        /*input=*/input,
+        /*indices=*/indices,
+        /*offsets=*/offsets,
+        /*weights=*/weights,
+        /*scale_bias=*/nullptr,
+        /*normalize_by_lengths=*/false,
+        /*out=*/out);
+    return true;
+  }
+
+ private:
+  int64_t block_size_;
+};
+
+template <typename index_t>
+class EmbeddingBagSumKernel<float, index_t>
+    : public Caffe2EmbeddingBagSumKernel<float, index_t> {
+  using Caffe2EmbeddingBagSumKernel<float, index_t>::Caffe2EmbeddingBagSumKernel;
+};
+
+template <typename index_t>
+class EmbeddingBagSumKernel<at::Half, index_t>
+    : public Caffe2EmbeddingBagSumKernel<at::Half, index_t> {
+  using Caffe2EmbeddingBagSumKernel<at::Half, index_t>::Caffe2EmbeddingBagSumKernel;
+};
 #endif
-    at::parallel_for(
-        0, output_size, 1, [&](int64_t start_idx, int64_t end_idx) {
-#ifdef USE_FBGEMM
-          kernel_fp32_i64(
+
+// Offsets with the end of the last bag, converted to the type the kernels
+// take. Copies them into storage unless they can be used as they are.
+template <typename offset_t, typename index_t>
+const offset_t* offsets_include_last(const Tensor& offsets,
+                                     int64_t num_indices,
+                                     bool include_last_offset,
+                                     std::vector<offset_t>& storage) {
+  auto* offsets_data = offsets.data_ptr<index_t>();
+  if (include_last_offset && std::is_same<offset_t, index_t>::value) {
+    return reinterpret_cast<const offset_t*>(offsets_data);
+  }
+  storage.assign(offsets_data, offsets_data + offsets.numel());
+  if (!include_last_offset) {
+    storage.push_back(num_indices);
+  }
+  return storage.data();
+}
+
+// Sums, or with per_sample_weights weighted sums, the bags straight from the
+// offsets, without offset2bag. Accumulates in float and, for Half and
+// BFloat16 tables, rounds once per output.
+template <typename data_t, typename index_t>
+void embedding_bag_sum_fast_path(const Tensor& indices,
+                                 const Tensor& offsets,
+                                 const Tensor& per_sample_weights,
+                                 const Tensor& src,
+                                 Tensor& output,
+                                 bool include_last_offset) {
+  using Kernel = EmbeddingBagSumKernel<data_t, index_t>;
+  using offset_t = typename Kernel::offset_t;
+
+  int64_t ddim = src.size(1);
+  auto src_contig = src.contiguous();
+  auto* src_data = src_contig.data_ptr<data_t>();
+  auto* indices_data = indices.data_ptr<index_t>();
+  auto* output_data = output.data_ptr<data_t>();
+  int64_t output_size = include_last_offset ? offsets.numel() - 1 : offsets.numel();
+  std::vector<offset_t> offsets_storage;
+  const offset_t* offsets_data = offsets_include_last<offset_t, index_t>(
+      offsets, indices.numel(), include_last_offset, offsets_storage);
+
+  // The kernels take float weights
+  Tensor weights;
+  const float* weights_data = nullptr;
+  if (per_sample_weights.defined()) {
+    weights = per_sample_weights.to(kFloat).contiguous();
+    weights_data = weights.data_ptr<float>();
+  }
+
+  Kernel kernel(ddim, weights_data != nullptr);
+  at::parallel_for(
+      0, output_size, 1, [&](int64_t start_idx, int64_t end_idx) {
+        // Non-float outputs are accumulated in a float buffer first
+        std::vector<float> buffer;
+        float* out;
+        if (std::is_same<data_t, float>::value) {
+          out = reinterpret_cast<float*>(output_data) + start_idx * ddim;
+        } else {
+          buffer.resize((end_idx - start_idx) * ddim);
+          out = buffer.data();
+        }
+        bool success = kernel(
             /* output_size */end_idx - start_idx,
             /* index_size */offsets_data[end_idx] - offsets_data[start_idx],
             /* data_size */src.size(0),
             /* input */src_data,
-            /* indices */select_indices_data + offsets_data[start_idx],
-            /* offsets_or_lengths */offsets_data + start_idx,
-            /* weights */scale_data + offsets_data[start_idx],
-            /* output */output_data + start_idx * ddim);
-#else
-          caffe2::EmbeddingLookupIdx(
-              /*block_size=*/ddim,
-              /*output_size=*/end_idx - start_idx,
-              /*index_size=*/offsets_data[end_idx] - offsets_data[start_idx],
-              /*data_size=*/src.size(0),
-              /*input=*/src_data,
-              /*indices=*/select_indices_data + offsets_data[start_idx],
-              /*offsets=*/offsets_data + start_idx,
-              /*weights=*/scale_data + offsets_data[start_idx],
-              /*scale_bias=*/nullptr,
-              /*normalize_by_lengths=*/false,
-              /*out=*/output_data + start_idx * ddim);
-#endif
-        });
-  } else {
-    AT_ASSERT(select_indices.numel() == add_indices.numel());
-    auto* src_data = src.data_ptr<float>();
-    auto* add_indices_data = add_indices.data_ptr<int64_t>();
-    auto src_stride0 = src.stride(0);
-    auto src_stride1 = src.stride(1);
-    auto output_stride0 = output.stride(0);
-    auto output_stride1 = output.stride(1);
-    auto scale_stride = scale.stride(0);
-    auto numel = add_indices.numel();
-
-
-    for (int64_t i = 0; i < numel; i++) {
-      auto* src_base = src_data + src_stride0 * select_indices_data[i];
-      auto* output_base = output_data + output_stride0 * add_indices_data[i];
-      auto scale = scale_data[i * scale_stride];
-      for (int64_t j = 0; j < ddim; j++) {
-        output_base[j * output_stride1] += src_base[j * src_stride1] * scale;
-      }
-    }
-  }
+            /* indices */indices_data + offsets_data[start_idx],
+            /* offsets */offsets_data + start_idx,
+            /* weights */weights_data ? weights_data + offsets_data[start_idx] : nullptr,
+            /* output */out);
+        TORCH_CHECK(success, "embedding_bag: index out of range in self");
+        if (!std::is_same<data_t, float>::value) {
+          auto* output_base = output_data + start_idx * ddim;
+          for (size_t i = 0; i < buffer.size(); i++) {
+            output_base[i] = static_cast<data_t>(buffer[i]);
+          }
+        }
+      });
 }
 
 }  // namespace
@@ -361,7 +406,9 @@ static Tensor apply_bag_size_backward(const Tensor &offsets,
   return output;
 }
 
-template <typename scalar_t>
+// Computes the bags in parallel straight from the offsets. max_indices is
+// always int64, as the backward pass uses it with index_add_.
+template <typename scalar_t, typename index_t>
 std::tuple<Tensor, Tensor, Tensor, Tensor> embedding_bag_cpu_max(
     const Tensor& weight,
     const Tensor& indices,
@@ -383,10 +430,12 @@ std::tuple<Tensor, Tensor, Tensor, Tensor> embedding_bag_cpu_max(
     numBags -= 1;
   }
   auto max_indices =
-      at::zeros({numBags, featureSize}, indices.options());
+      at::empty({numBags, featureSize}, indices.options().dtype(kLong));
 
-  auto* indices_data = indices.data_ptr<int64_t>();
-  auto* offset2bag_data = offset2bag.data_ptr<int64_t>();
+  auto* indices_data = indices.data_ptr<index_t>();
+  std::vector<index_t> offsets_storage;
+  const index_t* offsets_data = offsets_include_last<index_t, index_t>(
+      offsets, numIndices, include_last_offset, offsets_storage);
 
   auto* max_indices_data = max_indices.data_ptr<int64_t>();
   auto max_indices_stride = max_indices.stride(0);
@@ -396,23 +445,42 @@ std::tuple<Tensor, Tensor, Tensor, Tensor> embedding_bag_cpu_max(
   auto weight_stride0 = weight.stride(0);
   auto weight_stride1 = weight.stride(1);
   auto output_stride = output.stride(0);
-
-  for (int i = 0; i < numIndices; i++) {
-    auto bag = offset2bag_data[i];
-    auto word_idx = indices_data[i];
-
-    for (int dim = 0; dim < featureSize; dim++) {
-      auto& current_item = output_data[output_stride * bag + dim];
-      auto weight_item =
-          weight_data[weight_stride0 * word_idx + dim * weight_stride1];
-      bool is_first_for_bag = (i == 0) || offset2bag_data[i - 1] != bag;
-
-      if (is_first_for_bag || weight_item > current_item) {
-        current_item = weight_item;
-        max_indices_data[max_indices_stride * bag + dim] = word_idx;
+  auto num_weights = weight.size(0);
+
+  at::parallel_for(0, numBags, 1, [&](int64_t begin, int64_t end) {
+    for (int64_t bag = begin; bag < end; bag++) {
+      auto* output_row = output_data + output_stride * bag;
+      auto* max_indices_row = max_indices_data + max_indices_stride * bag;
+      int64_t start = offsets_data[bag];
+      int64_t stop = offsets_data[bag + 1];
+      if (start >= stop) {
+        // Empty bags are all zeros
+        std::fill(output_row, output_row + featureSize, static_cast<scalar_t>(0));
+        std::fill(max_indices_row, max_indices_row + featureSize, 0);
+        continue;
+      }
+      for (int64_t i = start; i < stop; i++) {
+        int64_t word_idx = indices_data[i];
+        TORCH_CHECK(word_idx >= 0 && word_idx < num_weights,
+                    "embedding_bag: index out of range in self");
+        auto* weight_row = weight_data + weight_stride0 * word_idx;
+        if (i == start) {
+          for (int64_t dim = 0; dim < featureSize; dim++) {
+            output_row[dim] = weight_row[dim * weight_stride1];
+            max_indices_row[dim] = word_idx;
+          }
+          continue;
+        }
+        for (int64_t dim = 0; dim < featureSize; dim++) {
+          auto weight_item = weight_row[dim * weight_stride1];
+          if (weight_item > output_row[dim]) {
+            output_row[dim] = weight_item;
+            max_indices_row[dim] = word_idx;
+          }
+        }
       }
     }
-  }
+  });
 
   return std::tuple<Tensor, Tensor, Tensor, Tensor>(
       output, offset2bag, bag_size, max_indices);
@@ -429,13 +497,17 @@ std::tuple<Tensor, Tensor, Tensor, Tensor> _embedding_bag_cpu_impl(
     bool include_last_offset,
     bool requires_grad) {
   auto indices_arg = TensorArg(indices, "indices", 1);
-  checkScalarType("embedding_bag", indices_arg, kLong);
+  checkScalarTypes("embedding_bag", indices_arg, {kLong, kInt});
   auto offsets_arg = TensorArg(offsets, "offsets", 1);
-  checkScalarType("embedding_bag", offsets_arg, kLong);
+  checkScalarTypes("embedding_bag", offsets_arg, {kLong, kInt});
+  checkSameType("embedding_bag", indices_arg, offsets_arg);
   auto weight_arg = TensorArg(weight, "weight", 1);
-  checkScalarTypes("embedding_bag", weight_arg, {kFloat, kDouble});
-  int64_t offset_0 = offsets.data_ptr<int64_t>()[0];
-  int64_t offset_n = offsets.data_ptr<int64_t>()[offsets.size(0)-1];
+  checkScalarTypes("embedding_bag", weight_arg, {kFloat, kDouble, kHalf, kBFloat16});
+  int64_t offset_0, offset_n;
+  AT_DISPATCH_INDEX_TYPES(offsets.scalar_type(), "embedding_bag", [&] {
+    offset_0 = offsets.data_ptr<index_t>()[0];
+    offset_n = offsets.data_ptr<index_t>()[offsets.size(0)-1];
+  });
   TORCH_CHECK(offset_0 == 0, "offsets[0] has to be 0, i.e., the first sequence "
                              "in the mini-batch has to start from position 0. "
                              "However, got ", offsets[0]);
@@ -474,8 +546,9 @@ std::tuple<Tensor, Tensor, Tensor, Tensor> _embedding_bag_cpu_impl(
        weight.size(1)},
       weight.options());
 
-  // To save compute, if we are going to go down the fast path case for the 'sum'
-  // mode, we skip calculating offset2bag, since it is not going to be used.
+  // To save compute, if we are going to go down the fast path case for the
+  // 'sum' and 'mean' modes, or in 'max' mode, we skip calculating offset2bag,
+  // since it is not going to be used. The backward pass computes it if needed.
   auto fast_path_sum = [&weight, &per_sample_weights, &output]() {
     if (per_sample_weights.defined()) {
       return isFastPathIndexSelectScale(weight, per_sample_weights, output);
@@ -487,47 +560,57 @@ std::tuple<Tensor, Tensor, Tensor, Tensor> _embedding_bag_cpu_impl(
   // Use an empty 0-element tensor as a sentinel that we have skipped the
   // creation of offset2bag because autograd chokes when trying to use an
   // undefined tensor as an input to a backward op.
-  Tensor offset2bag = at::empty({0}, offsets.options());
-  if (mode == MODE_MEAN || mode == MODE_MAX || !fast_path_sum()) {
+  Tensor offset2bag = at::empty({0}, offsets.options().dtype(kLong));
+  if (mode == MODE_MAX) {
+    return AT_DISPATCH_FLOATING_TYPES_AND2(at::ScalarType::Half, at::ScalarType::BFloat16,
+      weight.scalar_type(), "embedding_bag_cpu_max", [&]() {
+        return AT_DISPATCH_INDEX_TYPES(indices.scalar_type(), "embedding_bag_cpu_max", [&]() {
+          return embedding_bag_cpu_max<scalar_t, index_t>(
+              weight, indices, offset2bag, output, bag_size, offsets, include_last_offset);
+        });
+      }
+    );
+  }
+
+  if (fast_path_sum()) {
+    AT_DISPATCH_FLOATING_TYPES_AND2(at::ScalarType::Half, at::ScalarType::BFloat16,
+      weight.scalar_type(), "embedding_bag_cpu", [&]() {
+        AT_DISPATCH_INDEX_TYPES(indices.scalar_type(), "embedding_bag_cpu", [&]() {
+          embedding_bag_sum_fast_path<scalar_t, index_t>(
+              indices, offsets, per_sample_weights, weight, output, include_last_offset);
+        });
+      }
+    );
+  } else {
+    // The generic kernels take int64 indices
+    auto indices_long = indices.toType(kLong);
+    auto offsets_long = offsets.toType(kLong);
     // If the last entries are empty, that the last offsets are irrelevant as they
     // won't change anything in the assignment of ID -> bag, but index_add would
     // throw out of bounds error. So to keep it simple we just add one more
     // entry to the end then get rid of it after make_offset2bag.
     offset2bag = at::zeros(
-       {indices.sizes()[0] + 1}, indices.options()); // offset2bag = [0 0 0 0 0]
+       {indices.sizes()[0] + 1}, indices_long.options()); // offset2bag = [0 0 0 0 0]
 
-    make_offset2bag(offsets, indices, offset2bag);
+    make_offset2bag(offsets_long, indices_long, offset2bag);
 
     offset2bag.resize_({indices.sizes()[0]});
 
     // only initialize output in slow path
     output.zero_();
-  }
 
-  if (mode == MODE_MEAN || mode == MODE_SUM) {
     AT_DISPATCH_FLOATING_TYPES(weight.scalar_type(), "embedding_bag_cpu", [&]() {
       if (per_sample_weights.defined()) {
         AT_ASSERT(mode == MODE_SUM);
         index_select_scale_add<scalar_t>(
-            indices, offset2bag, per_sample_weights, weight, output, offsets, include_last_offset);
+            indices_long, offset2bag, per_sample_weights, weight, output);
       } else {
-        index_select_add<scalar_t>(indices, offset2bag, weight, output, offsets, include_last_offset);
+        index_select_add<scalar_t>(indices_long, offset2bag, weight, output);
       }
     });
-    auto ret = apply_bag_size(offsets, indices, mode, output, bag_size);
-    return std::tuple<Tensor, Tensor, Tensor, Tensor>(ret, offset2bag, bag_size, bag_size);
-  } else { // MODE_MAX
-    at::optional<Tensor> maybe_per_sample_weights;
-    if (per_sample_weights.defined()) {
-      maybe_per_sample_weights = per_sample_weights;
-    }
-    return AT_DISPATCH_FLOATING_TYPES_AND_HALF(
-      weight.scalar_type(), "embedding_bag_cpu_max", [&]() {
-        return embedding_bag_cpu_max<scalar_t>(
-            weight, indices, offset2bag, output, bag_size, offsets, include_last_offset);
-      }
-    );
   }
+  auto ret = apply_bag_size(offsets, indices, mode, output, bag_size);
+  return std::tuple<Tensor, Tensor, Tensor, Tensor>(ret, offset2bag, bag_size, bag_size);
 }
 
 // embedding_bag wrapper to enforce contiguity in tensors other than `weight`.
@@ -588,8 +671,8 @@ _embedding_bag_cpu(const Tensor &weight, const Tensor &indices,
 
 // Assumes all input tensors are contiguous.
 // See NOTE [ embedding_bag Native Functions ] in native_functions.yaml for details
-Tensor _embedding_bag_backward(const Tensor &grad, const Tensor &indices,
-                              const Tensor &offsets,
+Tensor _embedding_bag_backward(const Tensor &grad, const Tensor &indices_,
+                              const Tensor &offsets_,
                               const Tensor &offset2bag,
                               const Tensor &bag_size_,
                               const Tensor &max_indices_,
@@ -597,12 +680,15 @@ Tensor _embedding_bag_backward(const Tensor &grad, const Tensor &indices,
                               bool scale_grad_by_freq, int64_t mode,
                               bool sparse,
                               const Tensor& per_sample_weights) {
-  auto indices_arg = TensorArg(indices, "indices", 1);
-  checkScalarType("embedding_bag", indices_arg, kLong);
+  auto indices_arg = TensorArg(indices_, "indices", 1);
+  checkScalarTypes("embedding_bag", indices_arg, {kLong, kInt});
   checkContiguous("embedding_bag", indices_arg);
-  auto offsets_arg = TensorArg(offsets, "offsets", 1);
-  checkScalarType("embedding_bag", offsets_arg, kLong);
+  auto offsets_arg = TensorArg(offsets_, "offsets", 1);
+  checkScalarTypes("embedding_bag", offsets_arg, {kLong, kInt});
   checkContiguous("embedding_bag", offsets_arg);
+  // The backward kernels take int64 indices and offsets
+  Tensor indices = indices_.toType(kLong);
+  Tensor offsets = offsets_.toType(kLong);
 
   Tensor offset2bag_;
   if (indices.numel() != 0 && offset2bag.numel() == 0) {
@@ -874,10 +960,13 @@ Tensor _embedding_bag_per_sample_weights_backward_cpu(
     const Tensor& offsets,
     const Tensor& offset2bag,
     int64_t mode) {
+  // The forward pass also accepts int32 indices and offsets
+  auto indices_long = indices.toType(kLong);
+  auto offsets_long = offsets.toType(kLong);
   return AT_DISPATCH_FLOATING_TYPES(
     grad.scalar_type(), "_embedding_bag_per_sample_weights_backward_cpu", [&]() {
       return _embedding_bag_per_sample_weights_backward_cpu_template<scalar_t>(
-          grad, weight, indices, offsets, offset2bag, mode);
+          grad, weight, indices_long, offsets_long, offset2bag, mode);
     }
   );
 }
@@ -902,5 +991,297 @@ Tensor _embedding_bag_sparse_backward(
   return native::embedding_backward(index_grad, indices, num_weights, -1,
                                     scale_grad_by_freq, true);
 }
+
+namespace {
+
+// Calls update(row, grad_row) once for every distinct row of the embedding
+// table that indices touch, with the gradient of that row accumulated from the
+// gradient of the bags. The indices are deduplicated by sorting them, so
+// every row is updated by exactly one thread and the gradient of a row only
+// exists while it is applied.
+template <typename scalar_t, typename index_t, typename Update>
+void embedding_bag_sparse_update(
+    const Tensor& grad_,
+    const Tensor& indices,
+    const Tensor& offsets_,
+    int64_t mode,
+    const Tensor& per_sample_weights_,
+    bool include_last_offset,
+    const Update& update) {
+  auto grad = grad_.contiguous();
+  auto offsets = offsets_.contiguous();
+  const int64_t num_indices = indices.numel();
+  const int64_t num_bags = include_last_offset ? offsets.numel() - 1 : offsets.numel();
+  TORCH_CHECK(grad.dim() == 2 && grad.size(0) == num_bags,
+              "embedding_bag: expected grad with ", num_bags,
+              " rows but got shape ", grad.sizes());
+  const int64_t ddim = grad.size(1);
+  if (num_indices == 0) {
+    return;
+  }
+
+  std::vector<int64_t> offsets_storage;
+  const int64_t* offsets_data = offsets_include_last<int64_t, index_t>(
+      offsets, num_indices, include_last_offset, offsets_storage);
+  Tensor per_sample_weights;
+  const scalar_t* per_sample_weights_data = nullptr;
+  if (per_sample_weights_.defined()) {
+    per_sample_weights = per_sample_weights_.contiguous();
+    per_sample_weights_data = per_sample_weights.data_ptr<scalar_t>();
+  }
+
+  // Bag and weight of the contribution of every index
+  std::vector<int64_t> bag_of(num_indices);
+  std::vector<scalar_t> scale_of(num_indices);
+  at::parallel_for(0, num_bags, 64, [&](int64_t begin, int64_t end) {
+    for (int64_t bag = begin; bag < end; bag++) {
+      int64_t length = offsets_data[bag + 1] - offsets_data[bag];
+      scalar_t scale = (mode == MODE_MEAN && length > 0) ? scalar_t(1) / length : scalar_t(1);
+      for (int64_t i = offsets_data[bag]; i < offsets_data[bag + 1]; i++) {
+        bag_of[i] = bag;
+        scale_of[i] = per_sample_weights_data ? scale * per_sample_weights_data[i] : scale;
+      }
+    }
+  });
+
+  Tensor sorted_indices, order;
+  std::tie(sorted_indices, order) = indices.sort();
+  auto* sorted_data = sorted_indices.data_ptr<index_t>();
+  auto* order_data = order.data_ptr<int64_t>();
+
+  // Starts of the runs of equal indices: each chunk counts the runs that
+  // start in it, then writes their starts after those of the previous chunks.
+  const int64_t num_chunks = std::min<int64_t>(
+      at::get_num_threads(), divup(num_indices, internal::GRAIN_SIZE));
+  const int64_t chunk_size = divup(num_indices, num_chunks);
+  std::vector<int64_t> chunk_runs(num_chunks + 1, 0);
+  auto is_run_start = [&](int64_t i) {
+    return i == 0 || sorted_data[i] != sorted_data[i - 1];
+  };
+  at::parallel_for(0, num_chunks, 1, [&](int64_t begin, int64_t end) {
+    for (int64_t c = begin; c < end; c++) {
+      int64_t count = 0;
+      for (int64_t i = c * chunk_size; i < std::min(num_indices, (c + 1) * chunk_size); i++) {
+        count += is_run_start(i);
+      }
+      chunk_runs[c + 1] = count;
+    }
+  });
+  std::partial_sum(chunk_runs.begin(), chunk_runs.end(), chunk_runs.begin());
+  const int64_t num_runs = chunk_runs[num_chunks];
+  std::vector<int64_t> run_starts(num_runs + 1);
+  run_starts[num_runs] = num_indices;
+  at::parallel_for(0, num_chunks, 1, [&](int64_t begin, int64_t end) {
+    for (int64_t c = begin; c < end; c++) {
+      int64_t out = chunk_runs[c];
+      for (int64_t i = c * chunk_size; i < std::min(num_indices, (c + 1) * chunk_size); i++) {
+        if (is_run_start(i)) {
+          run_starts[out++] = i;
+        }
+      }
+    }
+  });
+
+  auto* grad_data = grad.data_ptr<scalar_t>();
+  const int64_t grain_size = std::max<int64_t>(1, internal::GRAIN_SIZE / ddim);
+  at::parallel_for(0, num_runs, grain_size, [&](int64_t begin, int64_t end) {
+    std::vector<scalar_t> row_grad(ddim);
+    for (int64_t run = begin; run < end; run++) {
+      int64_t row = sorted_data[run_starts[run]];
+      std::fill(row_grad.begin(), row_grad.end(), scalar_t(0));
+      for (int64_t i = run_starts[run]; i < run_starts[run + 1]; i++) {
+        int64_t position = order_data[i];
+        const scalar_t* bag_grad = grad_data + bag_of[position] * ddim;
+        scalar_t scale = scale_of[position];
+        for (int64_t k = 0; k < ddim; k++) {
+          row_grad[k] += scale * bag_grad[k];
+        }
+      }
+      update(row, row_grad.data());
+    }
+  });
+}
+
+// The update loops trust offsets and indices, so they are validated before
+// anything is written.
+template <typename index_t>
+void check_embedding_bag_offsets(const Tensor& offsets_, int64_t num_indices) {
+  auto offsets = offsets_.contiguous();
+  const auto* offsets_data = offsets.data_ptr<index_t>();
+  const int64_t num_offsets = offsets.numel();
+  if (num_offsets == 0) {
+    return;
+  }
+  TORCH_CHECK(offsets_data[0] == 0,
+              "embedding_bag: expected offsets to start at 0 but got ", offsets_data[0]);
+  for (int64_t i = 1; i < num_offsets; i++) {
+    TORCH_CHECK(offsets_data[i] >= offsets_data[i - 1],
+                "embedding_bag: expected non-decreasing offsets but offsets[", i,
+                "] = ", offsets_data[i], " < offsets[", i - 1, "] = ", offsets_data[i - 1]);
+  }
+  TORCH_CHECK(offsets_data[num_offsets - 1] <= num_indices,
+              "embedding_bag: offset ", offsets_data[num_offsets - 1],
+              " out of range for ", num_indices, " indices");
+}
+
+void check_embedding_bag_sparse_update(
+    const Tensor& weight,
+    const Tensor& grad,
+    const Tensor& indices,
+    const Tensor& offsets,
+    int64_t mode,
+    const Tensor& per_sample_weights,
+    bool include_last_offset) {
+  auto weight_arg = TensorArg(weight, "self", 1);
+  checkScalarTypes("embedding_bag", weight_arg, {kFloat, kDouble});
+  checkDim("embedding_bag", weight_arg, 2);
+  checkContiguous("embedding_bag", weight_arg);
+  auto grad_arg = TensorArg(grad, "grad", 2);
+  checkSameType("embedding_bag", weight_arg, grad_arg);
+  TORCH_CHECK(grad.dim() == 2 && grad.size(1) == weight.size(1),
+              "embedding_bag: expected grad with ", weight.size(1),
+              " columns but got shape ", grad.sizes());
+  auto indices_arg = TensorArg(indices, "indices", 3);
+  checkScalarTypes("embedding_bag", indices_arg, {kLong, kInt});
+  checkDim("embedding_bag", indices_arg, 1);
+  auto offsets_arg = TensorArg(offsets, "offsets", 4);
+  checkSameType("embedding_bag", indices_arg, offsets_arg);
+  checkDim("embedding_bag", offsets_arg, 1);
+  TORCH_CHECK(mode == MODE_SUM || mode == MODE_MEAN,
+              "embedding_bag: fused optimizer updates only support mode='sum' and mode='mean'");
+  if (per_sample_weights.defined()) {
+    TORCH_CHECK(mode == MODE_SUM,
+        "embedding_bag: per_sample_weights only supported with mode='sum'");
+    auto per_sample_weights_arg = TensorArg(per_sample_weights, "per_sample_weights", 6);
+    checkSameType("embedding_bag", weight_arg, per_sample_weights_arg);
+    TORCH_CHECK(per_sample_weights.numel() == indices.numel());
+  }
+  TORCH_CHECK(!include_last_offset || offsets.numel() > 0,
+              "embedding_bag: include_last_offset requires at least one offset");
+  AT_DISPATCH_INDEX_TYPES(offsets.scalar_type(), "embedding_bag_check_offsets", [&] {
+    check_embedding_bag_offsets<index_t>(offsets, indices.numel());
+  });
+  if (indices.numel() > 0) {
+    const int64_t min_index = indices.min().item<int64_t>();
+    const int64_t max_index = indices.max().item<int64_t>();
+    TORCH_CHECK(min_index >= 0 && max_index < weight.size(0),
+                "embedding_bag: index ", min_index < 0 ? min_index : max_index,
+                " out of range for ", weight.size(0), " rows");
+  }
+}
+
+// Adagrad step on one row. float rows use the SIMD kernel from
+// caffe2/perfkernels, whose learning rate is added, not subtracted.
+template <typename scalar_t>
+void adagrad_row_update(int64_t n, scalar_t* w, const scalar_t* g, scalar_t* h,
+                        double lr, double eps, double weight_decay) {
+  for (int64_t k = 0; k < n; k++) {
+    scalar_t gk = g[k] + weight_decay * w[k];
+    h[k] += gk * gk;
+    w[k] -= lr * gk / (std::sqrt(h[k]) + eps);
+  }
+}
+
+template <>
+void adagrad_row_update<float>(int64_t n, float* w, const float* g, float* h,
+                               double lr, double eps, double weight_decay) {
+  caffe2::adagrad_update(
+      n, w, g, h, w, h, eps, /*decay=*/1.f, -lr, weight_decay);
+}
+
+} // namespace
+
+Tensor& _embedding_bag_sparse_sgd_cpu_(
+    Tensor& self,
+    const Tensor& grad,
+    const Tensor& indices,
+    const Tensor& offsets,
+    int64_t mode,
+    const Tensor& per_sample_weights,
+    bool include_last_offset,
+    double lr) {
+  check_embedding_bag_sparse_update(
+      self, grad, indices, offsets, mode, per_sample_weights, include_last_offset);
+  AT_DISPATCH_FLOATING_TYPES(self.scalar_type(), "_embedding_bag_sparse_sgd_", [&] {
+    AT_DISPATCH_INDEX_TYPES(indices.scalar_type(), "_embedding_bag_sparse_sgd_", [&] {
+      auto* weight_data = self.data_ptr<scalar_t>();
+      const int64_t ddim = self.size(1);
+      const auto step = static_cast<scalar_t>(lr);
+      embedding_bag_sparse_update<scalar_t, index_t>(
+          grad, indices, offsets, mode, per_sample_weights, include_last_offset,
+          [&](int64_t row, const scalar_t* row_grad) {
+            scalar_t* w = weight_data + row * ddim;
+            for (int64_t k = 0; k < ddim; k++) {
+              w[k] -= step * row_grad[k];
+            }
+          });
+    });
+  });
+  return self;
+}
+
+Tensor& _embedding_bag_sparse_adagrad_cpu_(
+    Tensor& self,
+    Tensor& state_sum,
+    const Tensor& grad,
+    const Tensor& indices,
+    const Tensor& offsets,
+    int64_t mode,
+    const Tensor& per_sample_weights,
+    bool include_last_offset,
+    double lr,
+    double eps,
+    double weight_decay) {
+  check_embedding_bag_sparse_update(
+      self, grad, indices, offsets, mode, per_sample_weights, include_last_offset);
+  auto weight_arg = TensorArg(self, "self", 1);
+  auto state_sum_arg = TensorArg(state_sum, "state_sum", 2);
+  checkSameType("embedding_bag", weight_arg, state_sum_arg);
+  checkContiguous("embedding_bag", state_sum_arg);
+  // One accumulator per row selects rowwise Adagrad
+  const bool rowwise = state_sum.dim() == 1;
+  if (rowwise) {
+    TORCH_CHECK(state_sum.size(0) == self.size(0),
+                "embedding_bag: expected state_sum of shape [", self.size(0),
+                "] for rowwise Adagrad but got ", state_sum.sizes());
+  } else {
+    TORCH_CHECK(state_sum.sizes() == self.sizes(),
+                "embedding_bag: expected state_sum of shape ", self.sizes(),
+                " but got ", state_sum.sizes());
+  }
+
+  AT_DISPATCH_FLOATING_TYPES(self.scalar_type(), "_embedding_bag_sparse_adagrad_", [&] {
+    AT_DISPATCH_INDEX_TYPES(indices.scalar_type(), "_embedding_bag_sparse_adagrad_", [&] {
+      auto* weight_data = self.data_ptr<scalar_t>();
+      auto* state_sum_data = state_sum.data_ptr<scalar_t>();
+      const int64_t ddim = self.size(1);
+      embedding_bag_sparse_update<scalar_t, index_t>(
+          grad, indices, offsets, mode, per_sample_weights, include_last_offset,
+          [&](int64_t row, scalar_t* row_grad) {
+            scalar_t* w = weight_data + row * ddim;
+            if (!rowwise) {
+              adagrad_row_update<scalar_t>(
+                  ddim, w, row_grad, state_sum_data + row * ddim, lr, eps, weight_decay);
+              return;
+            }
+            // The accumulator of a row grows by the mean of the squared
+            // gradient of its elements.
+            scalar_t square_sum = 0;
+            for (int64_t k = 0; k < ddim; k++) {
+              row_grad[k] += weight_decay * w[k];
+              square_sum += row_grad[k] * row_grad[k];
+            }
+            scalar_t& h = state_sum_data[row];
+            h += square_sum / ddim;
+            const scalar_t step = lr / (std::sqrt(h) + eps);
+            for (int64_t k = 0; k < ddim; k++) {
+              w[k] -= step * row_grad[k];
+            }
+          });
+    });
+  });
+  return self;
+}
+
 }
 } // namespace at::native
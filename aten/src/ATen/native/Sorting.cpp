@@ -7,7 +7,12 @@
 #include <ATen/native/Sorting.h>
 #include <ATen/native/SortingUtils.h>
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
 #include <utility>
+#include <vector>
 
 namespace at {
 namespace native {
@@ -91,6 +96,294 @@ void quick_select_template(
   } while (true);
 }
 
+// Slices at least this long are selected with all threads when there are
+// too few slices to keep the threads busy; shorter (sub)ranges are selected
+// with std::nth_element.
+constexpr int64_t PARALLEL_SELECT_MIN_SIZE = 1 << 16;
+// Smallest number of elements a thread works on in the parallel selection.
+constexpr int64_t PARALLEL_SELECT_GRAIN_SIZE = 1 << 15;
+
+// Selection key of a value: its RadixKey, except that -0.0 and 0.0 share a
+// key, so that the keys order the values exactly as operator< does and NaN
+// comes last.
+template <typename scalar_t>
+typename RadixKey<scalar_t>::key_t _select_key(scalar_t v) {
+  return RadixKey<scalar_t>::to_key(v == scalar_t(0) ? scalar_t(0) : v);
+}
+
+// Finds the elements at the unique ascending ranks[0..num_ranks) of
+// [first, last) with recursive nth_element calls, partitioning the range
+// around the middle rank and descending into both sides.
+template <typename elem_t>
+void _multi_nth_element(
+    elem_t* first,
+    elem_t* last,
+    const int64_t* ranks,
+    int64_t num_ranks,
+    int64_t* out) {
+  if (num_ranks == 0) {
+    return;
+  }
+  const int64_t mid = num_ranks / 2;
+  const int64_t rank = ranks[mid];
+  std::nth_element(first, first + rank, last);
+  out[mid] = first[rank].second;
+  _multi_nth_element(first, first + rank, ranks, mid, out);
+  std::vector<int64_t> right_ranks(ranks + mid + 1, ranks + num_ranks);
+  for (auto& r : right_ranks) {
+    r -= rank + 1;
+  }
+  _multi_nth_element(
+      first + rank + 1, last, right_ranks.data(), num_ranks - mid - 1, out + mid + 1);
+}
+
+// Reads the (key, index) pairs gathered from a bucket by _radix_partition.
+template <typename elem_t>
+struct BucketGetter {
+  const elem_t* data;
+  elem_t operator()(int64_t i) const {
+    return data[i];
+  }
+};
+
+// One radix pass of the multi-select: where every bucket starts in sorted
+// order, the bucket of every rank, and the gathered (key, index) pairs of
+// the buckets that hold a rank.
+template <typename key_t>
+struct RadixPartition {
+  std::vector<int64_t> bucket_start;
+  std::vector<int64_t> rank_bucket;
+  std::vector<std::vector<std::pair<key_t, int64_t>>> buckets;
+};
+
+// Splits the (key, index) pairs returned by get(0..n) in parallel by the
+// byte of their keys at shift. Returns false without gathering anything if
+// all n pairs fall into one bucket, in which case the same pairs have to be
+// split by the next byte instead.
+template <typename key_t, typename get_t>
+bool _radix_partition(
+    const get_t& get,
+    int64_t n,
+    int shift,
+    const int64_t* ranks,
+    int64_t num_ranks,
+    RadixPartition<key_t>& part) {
+  constexpr int64_t num_buckets = 256;
+  const int64_t num_chunks = std::min<int64_t>(
+      at::get_num_threads(), at::divup(n, PARALLEL_SELECT_GRAIN_SIZE));
+  const int64_t chunk_size = at::divup(n, num_chunks);
+  std::vector<int64_t> counts(num_chunks * num_buckets);
+  at::parallel_for(0, num_chunks, 1, [&](int64_t begin, int64_t end) {
+    for (int64_t c = begin; c < end; c++) {
+      int64_t* count = counts.data() + c * num_buckets;
+      const int64_t last = std::min(n, (c + 1) * chunk_size);
+      for (int64_t i = c * chunk_size; i < last; i++) {
+        count[(get(i).first >> shift) & 0xff]++;
+      }
+    }
+  });
+
+  // Turn the counts into the offsets of every chunk within its bucket and
+  // find the bucket of every rank.
+  std::vector<int64_t>& bucket_start = part.bucket_start;
+  bucket_start.assign(num_buckets + 1, 0);
+  for (int64_t b = 0; b < num_buckets; b++) {
+    int64_t offset = 0;
+    for (int64_t c = 0; c < num_chunks; c++) {
+      int64_t& count = counts[c * num_buckets + b];
+      const int64_t chunk_count = count;
+      count = offset;
+      offset += chunk_count;
+    }
+    bucket_start[b + 1] = bucket_start[b] + offset;
+  }
+  std::vector<int64_t>& rank_bucket = part.rank_bucket;
+  rank_bucket.resize(num_ranks);
+  std::vector<bool> needed(num_buckets, false);
+  for (int64_t r = 0; r < num_ranks; r++) {
+    rank_bucket[r] = std::upper_bound(bucket_start.begin(), bucket_start.end(), ranks[r]) -
+        bucket_start.begin() - 1;
+    needed[rank_bucket[r]] = true;
+  }
+  if (bucket_start[rank_bucket[0] + 1] - bucket_start[rank_bucket[0]] == n) {
+    return false;
+  }
+
+  auto& buckets = part.buckets;
+  buckets.assign(num_buckets, {});
+  for (int64_t b = 0; b < num_buckets; b++) {
+    if (needed[b]) {
+      buckets[b].resize(bucket_start[b + 1] - bucket_start[b]);
+    }
+  }
+  at::parallel_for(0, num_chunks, 1, [&](int64_t begin, int64_t end) {
+    for (int64_t c = begin; c < end; c++) {
+      int64_t* offsets = counts.data() + c * num_buckets;
+      const int64_t last = std::min(n, (c + 1) * chunk_size);
+      for (int64_t i = c * chunk_size; i < last; i++) {
+        const auto elem = get(i);
+        const int64_t b = (elem.first >> shift) & 0xff;
+        if (needed[b]) {
+          buckets[b][offsets[b]++] = elem;
+        }
+      }
+    }
+  });
+  return true;
+}
+
+inline bool _select_serially(int64_t n, int shift) {
+  return n < PARALLEL_SELECT_MIN_SIZE || shift < 0 || at::in_parallel_region() ||
+      at::get_num_threads() == 1;
+}
+
+template <typename key_t>
+void _multi_select_owned(
+    std::vector<std::pair<key_t, int64_t>> elems,
+    int shift,
+    const int64_t* ranks,
+    int64_t num_ranks,
+    int64_t* out);
+
+// Selects the ranks of a partition split at shift within their buckets,
+// handing every bucket over to the selection on the next byte.
+template <typename key_t>
+void _multi_select_buckets(
+    RadixPartition<key_t>& part,
+    int shift,
+    const int64_t* ranks,
+    int64_t num_ranks,
+    int64_t* out) {
+  for (int64_t r = 0; r < num_ranks;) {
+    const int64_t b = part.rank_bucket[r];
+    int64_t r_end = r;
+    std::vector<int64_t> bucket_ranks;
+    for (; r_end < num_ranks && part.rank_bucket[r_end] == b; r_end++) {
+      bucket_ranks.push_back(ranks[r_end] - part.bucket_start[b]);
+    }
+    _multi_select_owned<key_t>(
+        std::move(part.buckets[b]), shift - 8, bucket_ranks.data(), r_end - r, out + r);
+    r = r_end;
+  }
+}
+
+// Multi-select on gathered (key, index) pairs, see _multi_select_level. The
+// pairs are released as soon as their buckets are gathered, and pairs that
+// all share a byte are not gathered at all, so the pairs alive at any time
+// never number more than twice the length of the slice.
+template <typename key_t>
+void _multi_select_owned(
+    std::vector<std::pair<key_t, int64_t>> elems,
+    int shift,
+    const int64_t* ranks,
+    int64_t num_ranks,
+    int64_t* out) {
+  using elem_t = std::pair<key_t, int64_t>;
+  RadixPartition<key_t> part;
+  for (;; shift -= 8) {
+    const int64_t n = elems.size();
+    if (_select_serially(n, shift)) {
+      _multi_nth_element(elems.data(), elems.data() + n, ranks, num_ranks, out);
+      return;
+    }
+    if (_radix_partition<key_t>(
+            BucketGetter<elem_t>{elems.data()}, n, shift, ranks, num_ranks, part)) {
+      break;
+    }
+  }
+  std::vector<elem_t>().swap(elems);
+  _multi_select_buckets<key_t>(part, shift, ranks, num_ranks, out);
+}
+
+// Multi-select on the (key, index) pairs returned by get(0..n): writes to
+// out the index of the element at each of the unique ascending ranks. Long
+// ranges are split in parallel by the byte of the keys at shift, and only
+// the buckets holding a requested rank are gathered and selected further,
+// so a few quantiles of a long slice cost a few linear passes.
+template <typename key_t, typename get_t>
+void _multi_select_level(
+    const get_t& get,
+    int64_t n,
+    int shift,
+    const int64_t* ranks,
+    int64_t num_ranks,
+    int64_t* out) {
+  using elem_t = std::pair<key_t, int64_t>;
+  RadixPartition<key_t> part;
+  for (;; shift -= 8) {
+    if (_select_serially(n, shift)) {
+      std::vector<elem_t> buffer(n);
+      for (int64_t i = 0; i < n; i++) {
+        buffer[i] = get(i);
+      }
+      _multi_nth_element(buffer.data(), buffer.data() + n, ranks, num_ranks, out);
+      return;
+    }
+    if (_radix_partition<key_t>(get, n, shift, ranks, num_ranks, part)) {
+      break;
+    }
+  }
+  _multi_select_buckets<key_t>(part, shift, ranks, num_ranks, out);
+}
+
+// Writes to out the indices of the elements of the strided slice at the
+// given ranks, in the order of the selection keys with ties broken by
+// index. All the ranks are selected together, each distinct rank once.
+template <typename scalar_t>
+void _multi_select(
+    const scalar_t* data,
+    int64_t stride,
+    int64_t n,
+    const std::vector<int64_t>& ranks,
+    int64_t* out) {
+  using key_t = typename RadixKey<scalar_t>::key_t;
+  std::vector<int64_t> unique_ranks(ranks);
+  std::sort(unique_ranks.begin(), unique_ranks.end());
+  unique_ranks.erase(std::unique(unique_ranks.begin(), unique_ranks.end()), unique_ranks.end());
+  std::vector<int64_t> unique_out(unique_ranks.size());
+  _multi_select_level<key_t>(
+      [data, stride](int64_t i) {
+        return std::make_pair(_select_key(data[i * stride]), i);
+      },
+      n, int(sizeof(key_t) * 8) - 8, unique_ranks.data(), unique_ranks.size(), unique_out.data());
+  for (size_t r = 0; r < ranks.size(); r++) {
+    out[r] = unique_out[
+        std::lower_bound(unique_ranks.begin(), unique_ranks.end(), ranks[r]) - unique_ranks.begin()];
+  }
+}
+
+// Number of NaNs in the strided slice, counted in parallel for long slices.
+template <typename scalar_t>
+int64_t _count_nan(const scalar_t* data, int64_t stride, int64_t n) {
+  return at::parallel_reduce(
+      0, n, PARALLEL_SELECT_GRAIN_SIZE, int64_t(0),
+      [&](int64_t begin, int64_t end, int64_t count) {
+        for (int64_t i = begin; i < end; i++) {
+          count += _isnan(data[i * stride]);
+        }
+        return count;
+      },
+      std::plus<int64_t>());
+}
+
+// Calls f(slice) for the rows of a [num_slices, n] problem: in parallel over
+// the slices when there are enough of them, otherwise one slice at a time so
+// that every slice can use all threads.
+template <typename func_t>
+void _for_each_slice(int64_t num_slices, int64_t n, const func_t& f) {
+  if (n >= PARALLEL_SELECT_MIN_SIZE && num_slices < at::get_num_threads()) {
+    for (int64_t i = 0; i < num_slices; i++) {
+      f(i);
+    }
+    return;
+  }
+  at::parallel_for(0, num_slices, 1, [&](int64_t begin, int64_t end) {
+    for (int64_t i = begin; i < end; i++) {
+      f(i);
+    }
+  });
+}
+
 void quantile_impl(
     Tensor& out,
     const Tensor& self,
@@ -144,6 +437,63 @@ void quantile_impl(
         "quantile() q values must be in the range [0, 1]");
   }
 
+  // On CPU the elements below and above every q are selected together from
+  // each slice instead of sorting the slices. Only their indices come from
+  // the selection; they are gathered and interpolated with differentiable
+  // ops, as in the sort based path.
+  if (self.device().is_cpu()) {
+    Tensor in = !_dim ? self.flatten() : self.unsqueeze(-1).transpose(dim, -1);
+    const int64_t n = in.size(-1);
+    TORCH_CHECK(n <= std::pow(2, 24), "quantile() input tensor is too large");
+    in = in.reshape({-1, n});
+    const int64_t num_slices = in.size(0);
+    Tensor q_flat = q.reshape({-1}).contiguous();
+    const int64_t num_q = q_flat.numel();
+    Tensor indices = at::empty({num_slices, 2 * num_q}, self.options().dtype(kLong));
+    Tensor weights = at::empty({num_slices, num_q}, self.options());
+
+    AT_DISPATCH_FLOATING_TYPES(self.scalar_type(), "quantile_cpu", [&] {
+      const scalar_t* q_data = q_flat.data_ptr<scalar_t>();
+      const scalar_t* in_data = in.data_ptr<scalar_t>();
+      int64_t* indices_data = indices.data_ptr<int64_t>();
+      scalar_t* weights_data = weights.data_ptr<scalar_t>();
+      const int64_t slice_stride = in.stride(0);
+      const int64_t stride = in.stride(1);
+      _for_each_slice(num_slices, n, [&](int64_t i) {
+        const scalar_t* data = in_data + i * slice_stride;
+        std::vector<int64_t> ranks(2 * num_q);
+        scalar_t* slice_weights = weights_data + i * num_q;
+        const int64_t num_nan = _count_nan(data, stride, n);
+        if (num_nan == n || (!ignore_nan && num_nan > 0)) {
+          // Select a nan: the last element for quantile, the first one for
+          // nanquantile, where all values are nan.
+          std::fill(ranks.begin(), ranks.end(), ignore_nan ? 0 : n - 1);
+          std::fill(slice_weights, slice_weights + num_q, scalar_t(0));
+        } else {
+          // Convert q in [0, 1] to ranks among the non-nan values, in scalar_t
+          // as in the sort based path
+          const scalar_t last_index = n - num_nan - 1;
+          for (int64_t j = 0; j < num_q; j++) {
+            const scalar_t rank = q_data[j] * last_index;
+            ranks[2 * j] = static_cast<int64_t>(rank);
+            ranks[2 * j + 1] = static_cast<int64_t>(std::ceil(rank));
+            slice_weights[j] = rank - ranks[2 * j];
+          }
+        }
+        _multi_select(data, stride, n, ranks, indices_data + i * 2 * num_q);
+      });
+    });
+
+    // Interpolate to compute quantiles; result is reduced_size x num_q and
+    // out is q_size + reduced_size
+    indices = indices.view({num_slices, num_q, 2});
+    Tensor values_below = in.gather(-1, indices.select(-1, 0));
+    Tensor values_above = in.gather(-1, indices.select(-1, 1));
+    values_below.lerp_(values_above, weights);
+    out.copy_(values_below.t().reshape(out.sizes()));
+    return;
+  }
+
   // Flatten input if no dim provided else move dim to reduce as last dimension.
   // Sort to efficiently query kth values.
   Tensor sorted;
@@ -328,34 +678,15 @@ std::tuple<Tensor&, Tensor&> median_with_indices_impl(
         }
       }
 
-      // Vector of indices for indirectly partitioning input around median
-      std::vector<int64_t> idx(size);
-      auto first = idx.begin();
-      auto last = idx.end();
-      std::iota(first, last, 0);
+      // The median is the element at rank (size - 1) / 2 of the (value,
+      // index) order. For torch.nanmedian, compute median of non-nan values
+      // only, which come first in that order.
+      int64_t num_nan = ignore_nan ? _count_nan(ip, 1, size) : 0;
+      int64_t index;
+      _multi_select(ip, 1, size, {(size - num_nan - 1) / 2}, &index);
 
-      // We partition the input around the median indirectly using the indices
-      // vector so that nth points to the index of the median in the unmodified
-      // input tensor.
-      auto nth = first;
-      if (!ignore_nan) {
-        // If we got here, there are no nan values
-        nth += (size - 1) / 2;
-        std::nth_element(first, nth, last, [&ip](int64_t i, int64_t j) {
-          return ip[i] < ip[j] || (ip[i] == ip[j] && i < j);
-        });
-      } else {
-        // For torch.nanmedian, compute median of non-nan values only
-        int64_t num_nan = std::count_if(ip, ip + size, _isnan<scalar_t>);
-        nth += (size - num_nan - 1) / 2;
-        std::nth_element(first, nth, last, [&ip](int64_t i, int64_t j) {
-          return ip[i] < ip[j] || (ip[i] == ip[j] && i < j) ||
-              (_isnan(ip[j]) && !_isnan(ip[i]));
-        });
-      }
-
-      *tl[1].data_ptr<scalar_t>() = ip[*nth];
-      *tl[2].data_ptr<int64_t>() = *nth;
+      *tl[1].data_ptr<scalar_t>() = ip[index];
+      *tl[2].data_ptr<int64_t>() = index;
     });
   });
 
@@ -371,36 +702,25 @@ Tensor median_impl(const Tensor& self, bool ignore_nan) {
       size > 0,
       "median() operation does not have an identity for empty input tensor");
 
-  // Clone the input tensor so we can partition it around the median value
-  Tensor in = self.clone();
+  // The selection leaves the input intact, so it does not need a copy
+  Tensor in = self.contiguous();
   Tensor out = at::empty({}, self.options());
 
   AT_DISPATCH_ALL_TYPES(in.scalar_type(), "median_cpu", [&] {
     scalar_t* op = out.data_ptr<scalar_t>();
-    scalar_t* first = in.data_ptr<scalar_t>();
-    scalar_t* last = first + size;
+    const scalar_t* first = in.data_ptr<scalar_t>();
+    const int64_t num_nan = _count_nan(first, 1, size);
 
     // For torch.median, if there are nan values return nan
-    if (!ignore_nan && std::any_of(first, last, _isnan<scalar_t>)) {
+    if (!ignore_nan && num_nan > 0) {
       *op = std::numeric_limits<scalar_t>::quiet_NaN();
       return;
     }
 
-    scalar_t* median = first;
-    if (!ignore_nan) {
-      // If we got here, there are no nan values
-      median += (size - 1) / 2;
-      std::nth_element(first, median, last);
-    } else {
-      // For torch.nanmedian, compute median of non-nan values only
-      int64_t num_nan = std::count_if(first, last, _isnan<scalar_t>);
-      median += (size - num_nan - 1) / 2;
-      std::nth_element(first, median, last, [](scalar_t a, scalar_t b) {
-        return a < b || (_isnan(b) && !_isnan(a));
-      });
-    }
-
-    *op = *median;
+    // For torch.nanmedian, compute median of non-nan values only
+    int64_t index;
+    _multi_select(first, 1, size, {(size - num_nan - 1) / 2}, &index);
+    *op = first[index];
   });
 
   return out;
@@ -1,7 +1,12 @@
 #pragma once
 
+#include <ATen/NumericUtils.h>
 #include <ATen/Parallel.h>
 
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
 namespace at {
 namespace native {
 
@@ -40,6 +45,71 @@ void dim_apply(TensorList tensors, int64_t dim, Fn f) {
   });
 }
 
+// RadixKey maps a value to an unsigned integer with the same order, NaN
+// being larger than every other value, and back.
+template <typename scalar_t, typename = void>
+struct RadixKey {
+  static constexpr bool supported = false;
+};
+
+template <>
+struct RadixKey<bool> {
+  static constexpr bool supported = true;
+  using key_t = uint8_t;
+  static key_t to_key(bool v) {
+    return v;
+  }
+  static bool from_key(key_t k) {
+    return k;
+  }
+};
+
+template <typename scalar_t>
+struct RadixKey<
+    scalar_t,
+    typename std::enable_if<std::is_integral<scalar_t>::value>::type> {
+  static constexpr bool supported = true;
+  using key_t = typename std::make_unsigned<scalar_t>::type;
+  static constexpr key_t sign_bit = std::is_signed<scalar_t>::value
+      ? key_t(key_t(1) << (sizeof(key_t) * 8 - 1))
+      : key_t(0);
+  static key_t to_key(scalar_t v) {
+    return static_cast<key_t>(v) ^ sign_bit;
+  }
+  static scalar_t from_key(key_t k) {
+    return static_cast<scalar_t>(k ^ sign_bit);
+  }
+};
+
+template <typename scalar_t, typename bits_t>
+struct FloatRadixKey {
+  static constexpr bool supported = true;
+  using key_t = bits_t;
+  static constexpr key_t sign_bit = key_t(1) << (sizeof(key_t) * 8 - 1);
+  // Negative values have all their bits flipped so that larger magnitudes
+  // come first; non-negative ones only get the sign bit set. Every NaN maps
+  // to the largest key, which only NaNs can have.
+  static key_t to_key(scalar_t v) {
+    if (_isnan(v)) {
+      return std::numeric_limits<key_t>::max();
+    }
+    key_t bits;
+    std::memcpy(&bits, &v, sizeof(bits));
+    return (bits & sign_bit) ? ~bits : (bits | sign_bit);
+  }
+  static scalar_t from_key(key_t k) {
+    key_t bits = (k & sign_bit) ? (k & ~sign_bit) : ~k;
+    scalar_t v;
+    std::memcpy(&v, &bits, sizeof(v));
+    return v;
+  }
+};
+
+template <>
+struct RadixKey<float> : FloatRadixKey<float, uint32_t> {};
+template <>
+struct RadixKey<double> : FloatRadixKey<double, uint64_t> {};
+
 // ensure we get good values and indices for kthvalue, mode
 // this will always be with the reducing dim as 1-d
 inline void _reduction_with_indices_allocate_or_resize_output(
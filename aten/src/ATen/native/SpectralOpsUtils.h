@@ -4,6 +4,8 @@
 #include <stdexcept>
 #include <sstream>
 
+#include <ATen/ATen.h>
+
 namespace at { namespace native {
 
 // Normalization types used in _fft_with_size
@@ -62,4 +64,12 @@ inline int64_t infer_ft_complex_to_real_onesided_size(int64_t complex_size,
   }
 }
 
+// Fills the redundant half of the output of a real-to-complex transform with
+// onesided=False, i.e., the slices [last_dim_start_slice, size_last_dim) of
+// the last signal dimension, using conjugate symmetry. input is a contiguous
+// batched tensor of the full (twosided) size and is modified inplace.
+void _fft_fill_with_conjugate_symmetry_(Tensor& input,
+                      int64_t signal_ndim, int64_t size_last_dim,
+                      int64_t last_dim_start_slice);
+
 }} // at::native
@@ -2,6 +2,9 @@
 
 #include <ATen/ATen.h>
 #include <ATen/Dispatch.h>
+#include <ATen/NumericUtils.h>
+#include <ATen/Parallel.h>
+#include <c10/util/flat_hash_map.h>
 
 #include <set>
 #include <tuple>
@@ -13,6 +16,23 @@ namespace native{
 
 namespace {
 
+// Spreads the hashes over the partitions of unique_cpu_template. The hash
+// maps within a partition index with the high bits of the product of the
+// hash with the golden ratio, so the partition must not come from those.
+inline uint64_t _unique_partition_hash(uint64_t h) {
+  h ^= h >> 30;
+  h *= 0xbf58476d1ce4e5b9ULL;
+  h ^= h >> 27;
+  h *= 0x94d049bb133111ebULL;
+  return h ^ (h >> 31);
+}
+
+// Inputs are split into one partition per hash range. Every partition is
+// deduplicated by one thread with its own open addressing hash map, which
+// assigns the ids of the unique values, counts them and records the id of
+// every input element in one pass. The partitions' unique values are then
+// concatenated, and the per-partition ids are turned into indices into the
+// output (sorted, if requested).
 template <typename scalar_t>
 std::tuple<Tensor, Tensor, Tensor> unique_cpu_template(
     const Tensor& self,
@@ -22,53 +42,163 @@ std::tuple<Tensor, Tensor, Tensor> unique_cpu_template(
   const Tensor& input = self.contiguous();
   const scalar_t* input_data = input.data_ptr<scalar_t>();
   int64_t numel = input.numel();
-  Tensor output;
   Tensor inverse_indices = at::empty({0}, self.options().dtype(kLong));
   Tensor counts = at::empty({0}, self.options().dtype(kLong));
-
-  std::unordered_set<scalar_t> set(input_data, input_data + numel);
-  output = at::empty({static_cast<int64_t>(set.size())}, input.options());
-  scalar_t *output_data = output.data_ptr<scalar_t>();
-
-  if (sorted) {
-    std::vector<scalar_t> vec(set.begin(), set.end());
-    std::sort(vec.begin(), vec.end());
-    std::copy(vec.begin(), vec.end(), output_data);
-  } else {
-    std::copy(set.begin(), set.end(), output_data);
+  const bool need_ids = return_inverse || return_counts;
+
+  const int64_t num_partitions = numel < at::internal::GRAIN_SIZE
+      ? 1
+      : std::min<int64_t>(
+            4 * at::get_num_threads(), numel / at::internal::GRAIN_SIZE + 1);
+  auto partition_of = [num_partitions](scalar_t value) -> int64_t {
+    return _unique_partition_hash(std::hash<scalar_t>()(value)) % num_partitions;
+  };
+
+  // Positions of the input elements grouped by partition, in input order
+  // within a partition. Not needed with a single partition.
+  std::vector<int64_t> positions;
+  std::vector<int64_t> partition_offsets(num_partitions + 1, 0);
+  partition_offsets[1] = numel;
+  if (num_partitions > 1) {
+    const int64_t num_chunks = num_partitions;
+    const int64_t chunk_size = (numel + num_chunks - 1) / num_chunks;
+    std::vector<int64_t> chunk_counts(num_chunks * num_partitions, 0);
+    at::parallel_for(0, num_chunks, 1, [&](int64_t begin, int64_t end) {
+      for (int64_t c = begin; c < end; c++) {
+        int64_t* count = chunk_counts.data() + c * num_partitions;
+        const int64_t last = std::min(numel, (c + 1) * chunk_size);
+        for (int64_t i = c * chunk_size; i < last; i++) {
+          count[partition_of(input_data[i])]++;
+        }
+      }
+    });
+    int64_t offset = 0;
+    for (int64_t p = 0; p < num_partitions; p++) {
+      partition_offsets[p] = offset;
+      for (int64_t c = 0; c < num_chunks; c++) {
+        int64_t& count = chunk_counts[c * num_partitions + p];
+        const int64_t chunk_count = count;
+        count = offset;
+        offset += chunk_count;
+      }
+    }
+    partition_offsets[num_partitions] = offset;
+    positions.resize(numel);
+    at::parallel_for(0, num_chunks, 1, [&](int64_t begin, int64_t end) {
+      for (int64_t c = begin; c < end; c++) {
+        int64_t* offsets = chunk_counts.data() + c * num_partitions;
+        const int64_t last = std::min(numel, (c + 1) * chunk_size);
+        for (int64_t i = c * chunk_size; i < last; i++) {
+          positions[offsets[partition_of(input_data[i])]++] = i;
+        }
+      }
+    });
   }
+  auto position = [&](int64_t i) {
+    return num_partitions > 1 ? positions[i] : i;
+  };
 
-  if (return_inverse || return_counts) {
+  if (need_ids) {
     inverse_indices.resize_(input.sizes());
-    int64_t* inverse_indices_data = inverse_indices.data_ptr<int64_t>();
-    std::unordered_map<scalar_t, int64_t> inverse_map;
-    inverse_map.reserve(output.numel());
-    for (int64_t i = 0; i < output.numel(); ++i) {
-      inverse_map[output_data[i]] = i;
+  }
+  int64_t* inverse_indices_data =
+      need_ids ? inverse_indices.data_ptr<int64_t>() : nullptr;
+
+  // Unique values and counts of every partition, in the order of their ids.
+  // The ids go into inverse_indices for now.
+  std::vector<std::vector<scalar_t>> partition_values(num_partitions);
+  std::vector<std::vector<int64_t>> partition_counts(num_partitions);
+  at::parallel_for(0, num_partitions, 1, [&](int64_t begin, int64_t end) {
+    for (int64_t p = begin; p < end; p++) {
+      ska::flat_hash_map<scalar_t, int64_t> ids;
+      auto& values = partition_values[p];
+      auto& value_counts = partition_counts[p];
+      for (int64_t i = partition_offsets[p]; i < partition_offsets[p + 1]; i++) {
+        const int64_t pos = position(i);
+        const scalar_t value = input_data[pos];
+        int64_t id = values.size();
+        // Every NaN is unique. They all have the same hash, so they would
+        // make the hash map probe (and grow) forever.
+        if (!_isnan(value)) {
+          id = ids.emplace(value, id).first->second;
+        }
+        if (id == static_cast<int64_t>(values.size())) {
+          values.push_back(value);
+          if (return_counts) {
+            value_counts.push_back(0);
+          }
+        }
+        if (need_ids) {
+          inverse_indices_data[pos] = id;
+        }
+        if (return_counts) {
+          value_counts[id]++;
+        }
+      }
     }
-    for(int64_t i = 0; i < numel; ++i) {
-      inverse_indices_data[i] = inverse_map[input_data[i]];
+  });
+
+  std::vector<int64_t> output_offsets(num_partitions + 1, 0);
+  for (int64_t p = 0; p < num_partitions; p++) {
+    output_offsets[p + 1] = output_offsets[p] + partition_values[p].size();
+  }
+  const int64_t num_unique = output_offsets[num_partitions];
+  Tensor output = at::empty({num_unique}, input.options());
+  scalar_t* output_data = output.data_ptr<scalar_t>();
+  at::parallel_for(0, num_partitions, 1, [&](int64_t begin, int64_t end) {
+    for (int64_t p = begin; p < end; p++) {
+      std::copy(
+          partition_values[p].begin(),
+          partition_values[p].end(),
+          output_data + output_offsets[p]);
     }
-    if (return_counts) {
-      std::unordered_map<scalar_t, int64_t> counts_map;
-      counts_map.reserve(output.numel());
-      for (int64_t i = 0; i < output.numel(); ++i) {
-        counts_map[output_data[i]] = 0;
-      }
-      for(int64_t i = 0; i < numel; i++) {
-        counts_map[input_data[i]] += 1;
+  });
+
+  // rank[j] is the index in the final output of the unique value at j in
+  // the concatenation of the partitions.
+  Tensor rank;
+  const int64_t* rank_data = nullptr;
+  if (sorted && num_unique > 1) {
+    Tensor order;
+    std::tie(output, order) = output.sort();
+    output_data = output.data_ptr<scalar_t>();
+    rank = at::empty_like(order);
+    rank.scatter_(0, order, at::arange(num_unique, order.options()));
+    rank_data = rank.data_ptr<int64_t>();
+  }
+  auto final_index = [&](int64_t p, int64_t id) {
+    const int64_t j = output_offsets[p] + id;
+    return rank_data ? rank_data[j] : j;
+  };
+
+  if (need_ids) {
+    at::parallel_for(0, num_partitions, 1, [&](int64_t begin, int64_t end) {
+      for (int64_t p = begin; p < end; p++) {
+        for (int64_t i = partition_offsets[p]; i < partition_offsets[p + 1]; i++) {
+          const int64_t pos = position(i);
+          inverse_indices_data[pos] = final_index(p, inverse_indices_data[pos]);
+        }
       }
-      counts.resize_(output.sizes());
-      counts.fill_(0);
-      int64_t *counts_data = counts.data_ptr<int64_t>();
-      for(int64_t i = 0; i < output.numel(); i++) {
-        counts_data[i] = counts_map[output_data[i]];
+    });
+  }
+  if (return_counts) {
+    counts.resize_(output.sizes());
+    int64_t* counts_data = counts.data_ptr<int64_t>();
+    at::parallel_for(0, num_partitions, 1, [&](int64_t begin, int64_t end) {
+      for (int64_t p = begin; p < end; p++) {
+        for (size_t id = 0; id < partition_counts[p].size(); id++) {
+          counts_data[final_index(p, id)] = partition_counts[p][id];
+        }
       }
-    }
+    });
   }
   return std::make_tuple(output, inverse_indices, counts);
 }
 
+// The input is split into one chunk per thread. A first pass counts the
+// runs starting in every chunk, which gives every chunk the index of its
+// first run in the output; a second pass writes the output, inverse and
+// run start positions, from which the counts follow.
 template <typename scalar_t>
 std::tuple<Tensor, Tensor, Tensor> unique_consecutive_cpu_template(
     const Tensor& self,
@@ -87,33 +217,66 @@ std::tuple<Tensor, Tensor, Tensor> unique_consecutive_cpu_template(
 
   if (numel > 0) {
     scalar_t *output_data = output.data_ptr<scalar_t>();
-    int64_t *inverse_data = inverse_indices.data_ptr<int64_t>();;
-    int64_t *counts_data = nullptr;
-    *output_data = *input_data;
+    int64_t *inverse_data = inverse_indices.data_ptr<int64_t>();
+    // Element i starts a new run; NaNs never compare equal, so every NaN
+    // starts its own run.
+    auto starts_run = [&](int64_t i) {
+      return i == 0 || input_data[i] != input_data[i - 1];
+    };
+
+    const int64_t num_chunks = std::max<int64_t>(
+        1,
+        std::min<int64_t>(
+            at::get_num_threads(), numel / at::internal::GRAIN_SIZE));
+    const int64_t chunk_size = (numel + num_chunks - 1) / num_chunks;
+    std::vector<int64_t> chunk_runs(num_chunks + 1, 0);
+    at::parallel_for(0, num_chunks, 1, [&](int64_t begin, int64_t end) {
+      for (int64_t c = begin; c < end; c++) {
+        const int64_t last = std::min(numel, (c + 1) * chunk_size);
+        int64_t runs = 0;
+        for (int64_t i = c * chunk_size; i < last; i++) {
+          runs += starts_run(i);
+        }
+        chunk_runs[c + 1] = runs;
+      }
+    });
+    for (int64_t c = 0; c < num_chunks; c++) {
+      chunk_runs[c + 1] += chunk_runs[c];
+    }
+    const int64_t output_size = chunk_runs[num_chunks];
 
+    // Start position of every run, plus numel at the end
+    std::vector<int64_t> run_starts;
     if (return_counts) {
-      counts.resize_({numel});
-      counts_data = counts.data_ptr<int64_t>();
+      run_starts.resize(output_size + 1);
+      run_starts[output_size] = numel;
     }
-    scalar_t *p = output_data;
-    int64_t *q = counts_data;
-    int64_t last = 0;
-    for (int64_t i = 0; i < numel; i++) {
-      if (input_data[i] != *p) {
-        *(++p) = input_data[i];
-        if (return_counts) {
-          *(q++) = i - last;
-          last = i;
+    at::parallel_for(0, num_chunks, 1, [&](int64_t begin, int64_t end) {
+      for (int64_t c = begin; c < end; c++) {
+        const int64_t last = std::min(numel, (c + 1) * chunk_size);
+        int64_t run = chunk_runs[c] - 1;
+        for (int64_t i = c * chunk_size; i < last; i++) {
+          if (starts_run(i)) {
+            output_data[++run] = input_data[i];
+            if (return_counts) {
+              run_starts[run] = i;
+            }
+          }
+          if (return_inverse) {
+            inverse_data[i] = run;
+          }
         }
       }
-      if (return_inverse) {
-        inverse_data[i] = p - output_data;
-      }
-    }
-    int64_t output_size = p - output_data + 1;
+    });
+
     if (return_counts) {
-      *q = numel - last;
       counts.resize_({output_size});
+      int64_t* counts_data = counts.data_ptr<int64_t>();
+      at::parallel_for(0, output_size, at::internal::GRAIN_SIZE, [&](int64_t begin, int64_t end) {
+        for (int64_t k = begin; k < end; k++) {
+          counts_data[k] = run_starts[k + 1] - run_starts[k];
+        }
+      });
     }
     output.resize_({output_size});
   }
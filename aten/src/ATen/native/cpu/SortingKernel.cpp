@@ -8,6 +8,12 @@
 #include <ATen/native/Sorting.h>
 #include <ATen/native/SortingUtils.h>
 
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <type_traits>
+
 namespace at { namespace native {
 
 namespace {
@@ -92,12 +98,248 @@ struct KeyValueCompDesc {
   }
 };
 
+// Slices at least this long are sorted with all threads, as long as there
+// are too few slices to keep the threads busy by sorting one slice each.
+constexpr int64_t PARALLEL_SORT_MIN_SIZE = 1 << 16;
+// Smallest number of elements a thread works on in the parallel sorts.
+constexpr int64_t PARALLEL_SORT_GRAIN_SIZE = 1 << 15;
+
+bool _use_parallel_sort(const Tensor& values, int64_t dim) {
+  const int64_t dim_size = values.size(dim);
+  if (dim_size < PARALLEL_SORT_MIN_SIZE || at::in_parallel_region()) {
+    return false;
+  }
+  const int64_t num_threads = at::get_num_threads();
+  // With that few slices the TensorIterator in _dim_apply runs serially, so
+  // every slice gets the whole pool.
+  return num_threads > 1 && values.numel() / dim_size < num_threads;
+}
+
+int64_t _num_sort_chunks(int64_t n) {
+  return std::max<int64_t>(
+      1,
+      std::min<int64_t>(
+          at::get_num_threads(),
+          (n + PARALLEL_SORT_GRAIN_SIZE - 1) / PARALLEL_SORT_GRAIN_SIZE));
+}
+
+// Stable LSD radix sort of keys with their indices as payload, one byte per
+// pass. Every pass counts the digits of each chunk in parallel, turns the
+// counts into per-chunk offsets and scatters the chunks in parallel. Passes
+// where every key has the same digit are skipped, which is common for
+// integer ids that only use the low bytes. The result ends up in either
+// buffer; a pointer to it is returned through keys and indices.
+template <typename key_t>
+void _parallel_radix_sort(
+    key_t*& keys,
+    int64_t*& indices,
+    key_t* keys_tmp,
+    int64_t* indices_tmp,
+    int64_t n) {
+  constexpr int64_t num_buckets = 256;
+  const int64_t num_chunks = _num_sort_chunks(n);
+  const int64_t chunk_size = (n + num_chunks - 1) / num_chunks;
+  std::vector<int64_t> counts(num_chunks * num_buckets);
+
+  for (size_t shift = 0; shift < sizeof(key_t) * 8; shift += 8) {
+    std::fill(counts.begin(), counts.end(), 0);
+    at::parallel_for(0, num_chunks, 1, [&](int64_t begin, int64_t end) {
+      for (int64_t c = begin; c < end; c++) {
+        int64_t* count = counts.data() + c * num_buckets;
+        const int64_t last = std::min(n, (c + 1) * chunk_size);
+        for (int64_t i = c * chunk_size; i < last; i++) {
+          count[(keys[i] >> shift) & 0xff]++;
+        }
+      }
+    });
+
+    // Offsets go bucket by bucket, chunk by chunk within a bucket, which
+    // keeps the sort stable.
+    int64_t offset = 0;
+    bool trivial = false;
+    for (int64_t b = 0; b < num_buckets; b++) {
+      const int64_t bucket_start = offset;
+      for (int64_t c = 0; c < num_chunks; c++) {
+        int64_t& count = counts[c * num_buckets + b];
+        const int64_t chunk_count = count;
+        count = offset;
+        offset += chunk_count;
+      }
+      if (offset - bucket_start == n) {
+        trivial = true;
+        break;
+      }
+    }
+    if (trivial) {
+      continue;
+    }
+
+    at::parallel_for(0, num_chunks, 1, [&](int64_t begin, int64_t end) {
+      for (int64_t c = begin; c < end; c++) {
+        int64_t* offsets = counts.data() + c * num_buckets;
+        const int64_t last = std::min(n, (c + 1) * chunk_size);
+        for (int64_t i = c * chunk_size; i < last; i++) {
+          const int64_t dst = offsets[(keys[i] >> shift) & 0xff]++;
+          keys_tmp[dst] = keys[i];
+          indices_tmp[dst] = indices[i];
+        }
+      }
+    });
+    std::swap(keys, keys_tmp);
+    std::swap(indices, indices_tmp);
+  }
+}
+
+template <typename scalar_t,
+          typename std::enable_if<RadixKey<scalar_t>::supported, int>::type = 0>
+void _parallel_sort_slice(
+    scalar_t* values,
+    int64_t values_dim_stride,
+    int64_t* indices,
+    int64_t indices_dim_stride,
+    int64_t n,
+    bool descending) {
+  using key_t = typename RadixKey<scalar_t>::key_t;
+  // Descending order is ascending order of the inverted keys; NaNs come
+  // first then, as in the serial sort.
+  const key_t flip = descending ? std::numeric_limits<key_t>::max() : key_t(0);
+  std::vector<key_t> key_buffer(2 * n);
+  std::vector<int64_t> index_buffer(2 * n);
+  key_t* keys = key_buffer.data();
+  int64_t* sorted_indices = index_buffer.data();
+
+  at::parallel_for(0, n, PARALLEL_SORT_GRAIN_SIZE, [&](int64_t begin, int64_t end) {
+    for (int64_t i = begin; i < end; i++) {
+      keys[i] = RadixKey<scalar_t>::to_key(values[i * values_dim_stride]) ^ flip;
+      sorted_indices[i] = i;
+    }
+  });
+
+  _parallel_radix_sort(
+      keys, sorted_indices, key_buffer.data() + n, index_buffer.data() + n, n);
+
+  at::parallel_for(0, n, PARALLEL_SORT_GRAIN_SIZE, [&](int64_t begin, int64_t end) {
+    for (int64_t i = begin; i < end; i++) {
+      values[i * values_dim_stride] = RadixKey<scalar_t>::from_key(keys[i] ^ flip);
+      indices[i * indices_dim_stride] = sorted_indices[i];
+    }
+  });
+}
+
+// Merges the sorted ranges a and b into out, splitting the output evenly
+// between the threads. Every thread finds where its part of the output
+// starts in a and b with a binary search ("merge path").
+template <typename elem_t, typename comp_t>
+void _parallel_merge(
+    const elem_t* a,
+    int64_t a_size,
+    const elem_t* b,
+    int64_t b_size,
+    elem_t* out,
+    const comp_t& comp) {
+  // Number of elements of a among the first k outputs; ties go to a.
+  auto co_rank = [&](int64_t k) {
+    int64_t lo = std::max<int64_t>(0, k - b_size);
+    int64_t hi = std::min(k, a_size);
+    while (lo < hi) {
+      const int64_t i = lo + (hi - lo) / 2;
+      if (!comp(b[k - i - 1], a[i])) {
+        lo = i + 1;
+      } else {
+        hi = i;
+      }
+    }
+    return lo;
+  };
+  at::parallel_for(0, a_size + b_size, PARALLEL_SORT_GRAIN_SIZE,
+    [&](int64_t begin, int64_t end) {
+      const int64_t a_begin = co_rank(begin);
+      const int64_t a_end = co_rank(end);
+      std::merge(
+          a + a_begin, a + a_end,
+          b + (begin - a_begin), b + (end - a_end),
+          out + begin, comp);
+    });
+}
+
+// Stable parallel merge sort for the types without a radix key: the chunks
+// are sorted in parallel and then merged pairwise, each merge using all
+// threads.
+template <typename scalar_t,
+          typename std::enable_if<!RadixKey<scalar_t>::supported, int>::type = 0>
+void _parallel_sort_slice(
+    scalar_t* values,
+    int64_t values_dim_stride,
+    int64_t* indices,
+    int64_t indices_dim_stride,
+    int64_t n,
+    bool descending) {
+  using elem_t = std::pair<scalar_t, int64_t>;
+  auto comp = [descending](const elem_t& x, const elem_t& y) -> bool {
+    // we want NaN to be sorted as top for numpy compatibility
+    return descending
+        ? ((_isnan<scalar_t>(x.first) && !_isnan<scalar_t>(y.first)) || (x.first > y.first))
+        : ((!_isnan<scalar_t>(x.first) && _isnan<scalar_t>(y.first)) || (x.first < y.first));
+  };
+
+  std::vector<elem_t> buffer(n);
+  std::vector<elem_t> buffer_tmp(n);
+  const int64_t num_chunks = _num_sort_chunks(n);
+  const int64_t chunk_size = (n + num_chunks - 1) / num_chunks;
+  at::parallel_for(0, num_chunks, 1, [&](int64_t begin, int64_t end) {
+    for (int64_t c = begin; c < end; c++) {
+      const int64_t first = c * chunk_size;
+      const int64_t last = std::min(n, first + chunk_size);
+      for (int64_t i = first; i < last; i++) {
+        buffer[i] = {values[i * values_dim_stride], i};
+      }
+      std::stable_sort(buffer.begin() + first, buffer.begin() + last, comp);
+    }
+  });
+
+  elem_t* src = buffer.data();
+  elem_t* dst = buffer_tmp.data();
+  for (int64_t width = chunk_size; width < n; width *= 2) {
+    for (int64_t first = 0; first < n; first += 2 * width) {
+      const int64_t mid = std::min(n, first + width);
+      const int64_t last = std::min(n, first + 2 * width);
+      _parallel_merge(
+          src + first, mid - first, src + mid, last - mid, dst + first, comp);
+    }
+    std::swap(src, dst);
+  }
+
+  at::parallel_for(0, n, PARALLEL_SORT_GRAIN_SIZE, [&](int64_t begin, int64_t end) {
+    for (int64_t i = begin; i < end; i++) {
+      values[i * values_dim_stride] = src[i].first;
+      indices[i * indices_dim_stride] = src[i].second;
+    }
+  });
+}
+
 static void sort_kernel(
     Tensor& values,
     Tensor& indices,
     int64_t dim,
     bool descending) {
   dim = maybe_wrap_dim(dim, values.dim());
+  if (_use_parallel_sort(values, dim)) {
+    _dim_apply(
+      values, indices, dim,
+      "sort_cpu", [&](
+        auto* values, int64_t values_dim_stride,
+        auto* indices, int64_t indices_dim_stride,
+        int64_t dim_size
+      ) {
+        _parallel_sort_slice(
+          values, values_dim_stride,
+          indices, indices_dim_stride,
+          dim_size, descending);
+      }
+    );
+    return;
+  }
+
   _fill_indices(indices, dim);
   _dim_apply(
     values, indices, dim,
@@ -127,6 +369,196 @@ static void sort_kernel(
   );
 }
 
+// Slices at least this long are selected on their radix keys below instead
+// of being copied into (value, index) pairs for nth_element/partial_sort.
+constexpr int64_t TOPK_SELECT_MIN_SIZE = 1 << 12;
+// Up to this k a bounded heap is kept while reading the slice once; larger k
+// use a radix select.
+constexpr int64_t TOPK_HEAP_MAX_K = 64;
+
+// The selections pick the k smallest keys, where the keys are the RadixKeys
+// of the values xor flip. Flipping every bit picks the largest values
+// instead, and NaN, having the largest RadixKey, comes first for largest and
+// last otherwise, as in the comparison based path. Ties are broken by index.
+// The slice is split in chunks that are scanned in parallel when there are
+// too few slices to keep the threads busy.
+
+template <typename scalar_t, typename key_t = typename RadixKey<scalar_t>::key_t>
+void _topk_heap_select(
+    const scalar_t* self,
+    int64_t self_dim_stride,
+    int64_t n,
+    int64_t k,
+    key_t flip,
+    int64_t num_chunks,
+    std::vector<std::pair<key_t, int64_t>>& selected) {
+  using elem_t = std::pair<key_t, int64_t>;
+  const int64_t chunk_size = (n + num_chunks - 1) / num_chunks;
+  std::vector<elem_t> heaps(num_chunks * k);
+  std::vector<int64_t> heap_sizes(num_chunks);
+  at::parallel_for(0, num_chunks, 1, [&](int64_t begin, int64_t end) {
+    for (int64_t c = begin; c < end; c++) {
+      // max-heap of the k smallest (key, index) pairs of the chunk
+      elem_t* heap = heaps.data() + c * k;
+      int64_t size = 0;
+      const int64_t last = std::min(n, (c + 1) * chunk_size);
+      for (int64_t i = c * chunk_size; i < last; i++) {
+        const key_t key = RadixKey<scalar_t>::to_key(self[i * self_dim_stride]) ^ flip;
+        if (size < k) {
+          heap[size++] = {key, i};
+          std::push_heap(heap, heap + size);
+        } else if (key < heap[0].first) {
+          std::pop_heap(heap, heap + k);
+          heap[k - 1] = {key, i};
+          std::push_heap(heap, heap + k);
+        }
+      }
+      heap_sizes[c] = size;
+    }
+  });
+
+  selected.clear();
+  for (int64_t c = 0; c < num_chunks; c++) {
+    selected.insert(selected.end(), heaps.begin() + c * k, heaps.begin() + c * k + heap_sizes[c]);
+  }
+  std::nth_element(selected.begin(), selected.begin() + k - 1, selected.end());
+  selected.resize(k);
+}
+
+// MSD radix select: every pass histograms the next byte of the keys that
+// share the bytes found so far, until the bucket holding the k-th smallest
+// key is either fully needed or fully resolved. A last scan then collects
+// the keys below that bucket and as many of its keys as are still needed.
+template <typename scalar_t, typename key_t = typename RadixKey<scalar_t>::key_t>
+void _topk_radix_select(
+    const scalar_t* self,
+    int64_t self_dim_stride,
+    int64_t n,
+    int64_t k,
+    key_t flip,
+    int64_t num_chunks,
+    std::vector<std::pair<key_t, int64_t>>& selected) {
+  constexpr int bits = sizeof(key_t) * 8;
+  constexpr int64_t num_buckets = 256;
+  const int64_t chunk_size = (n + num_chunks - 1) / num_chunks;
+  std::vector<int64_t> counts(num_chunks * num_buckets);
+
+  // The top prefix_bits bits of the selected bucket, and the number of keys
+  // whose top bits are smaller.
+  uint64_t prefix = 0;
+  int prefix_bits = 0;
+  int64_t less = 0;
+  for (int shift = bits - 8; shift >= 0; shift -= 8) {
+    std::fill(counts.begin(), counts.end(), 0);
+    at::parallel_for(0, num_chunks, 1, [&](int64_t begin, int64_t end) {
+      for (int64_t c = begin; c < end; c++) {
+        int64_t* count = counts.data() + c * num_buckets;
+        const int64_t last = std::min(n, (c + 1) * chunk_size);
+        for (int64_t i = c * chunk_size; i < last; i++) {
+          const uint64_t key = RadixKey<scalar_t>::to_key(self[i * self_dim_stride]) ^ flip;
+          if (prefix_bits == 0 || (key >> (shift + 8)) == prefix) {
+            count[(key >> shift) & 0xff]++;
+          }
+        }
+      }
+    });
+
+    int64_t digit = 0;
+    int64_t bucket_count = 0;
+    for (; digit < num_buckets; digit++) {
+      bucket_count = 0;
+      for (int64_t c = 0; c < num_chunks; c++) {
+        bucket_count += counts[c * num_buckets + digit];
+      }
+      if (less + bucket_count >= k) {
+        break;
+      }
+      less += bucket_count;
+    }
+    prefix = (prefix << 8) | digit;
+    prefix_bits += 8;
+    if (less + bucket_count == k) {
+      break;
+    }
+  }
+
+  // Keys of the selected bucket fill the outputs after the smaller ones,
+  // in index order, until k are found.
+  const int key_shift = bits - prefix_bits;
+  const int64_t needed_equal = k - less;
+  std::vector<int64_t> below_offsets(num_chunks + 1, 0);
+  std::vector<int64_t> equal_offsets(num_chunks + 1, 0);
+  at::parallel_for(0, num_chunks, 1, [&](int64_t begin, int64_t end) {
+    for (int64_t c = begin; c < end; c++) {
+      int64_t below = 0;
+      int64_t equal = 0;
+      const int64_t last = std::min(n, (c + 1) * chunk_size);
+      for (int64_t i = c * chunk_size; i < last; i++) {
+        const uint64_t top = uint64_t(RadixKey<scalar_t>::to_key(self[i * self_dim_stride]) ^ flip) >> key_shift;
+        below += top < prefix;
+        equal += top == prefix;
+      }
+      below_offsets[c + 1] = below;
+      equal_offsets[c + 1] = equal;
+    }
+  });
+  std::partial_sum(below_offsets.begin(), below_offsets.end(), below_offsets.begin());
+  std::partial_sum(equal_offsets.begin(), equal_offsets.end(), equal_offsets.begin());
+
+  selected.resize(k);
+  at::parallel_for(0, num_chunks, 1, [&](int64_t begin, int64_t end) {
+    for (int64_t c = begin; c < end; c++) {
+      int64_t below_pos = below_offsets[c];
+      int64_t equal_rank = equal_offsets[c];
+      if (below_pos == below_offsets[c + 1] && equal_rank >= needed_equal) {
+        continue;
+      }
+      const int64_t last = std::min(n, (c + 1) * chunk_size);
+      for (int64_t i = c * chunk_size; i < last; i++) {
+        const key_t key = RadixKey<scalar_t>::to_key(self[i * self_dim_stride]) ^ flip;
+        const uint64_t top = uint64_t(key) >> key_shift;
+        if (top < prefix) {
+          selected[below_pos++] = {key, i};
+        } else if (top == prefix && equal_rank < needed_equal) {
+          selected[less + equal_rank++] = {key, i};
+        }
+      }
+    }
+  });
+}
+
+template <typename scalar_t>
+void _topk_select_slice(
+    const scalar_t* self,
+    int64_t self_dim_stride,
+    int64_t n,
+    scalar_t* values,
+    int64_t values_dim_stride,
+    int64_t* indices,
+    int64_t indices_dim_stride,
+    int64_t k,
+    bool largest,
+    bool sorted) {
+  using key_t = typename RadixKey<scalar_t>::key_t;
+  const key_t flip = largest ? std::numeric_limits<key_t>::max() : key_t(0);
+  const int64_t num_chunks = at::in_parallel_region() ? 1 : _num_sort_chunks(n);
+
+  std::vector<std::pair<key_t, int64_t>> selected;
+  if (k <= TOPK_HEAP_MAX_K) {
+    _topk_heap_select(self, self_dim_stride, n, k, flip, num_chunks, selected);
+  } else {
+    _topk_radix_select(self, self_dim_stride, n, k, flip, num_chunks, selected);
+  }
+  if (sorted) {
+    std::sort(selected.begin(), selected.end());
+  }
+  for (int64_t j = 0; j < k; j++) {
+    const int64_t index = selected[j].second;
+    values[j * values_dim_stride] = self[index * self_dim_stride];
+    indices[j * indices_dim_stride] = index;
+  }
+}
+
 static void topk_kernel(
     Tensor& values,
     Tensor& indices,
@@ -145,6 +577,14 @@ static void topk_kernel(
           auto mode_indices = tl[2].accessor<int64_t, 1>();
 
           auto n = tmp_values.size(0);
+          if (n >= TOPK_SELECT_MIN_SIZE && k > 0) {
+            _topk_select_slice(
+                tl[0].data_ptr<scalar_t>(), tl[0].stride(0), n,
+                tl[1].data_ptr<scalar_t>(), tl[1].stride(0),
+                tl[2].data_ptr<int64_t>(), tl[2].stride(0),
+                k, largest, sorted);
+            return;
+          }
           auto use_partial_sort = k * 64 <= n;
 
           using elem_t = std::pair<scalar_t, int64_t>;
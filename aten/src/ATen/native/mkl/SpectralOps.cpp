@@ -1,46 +1,18 @@
 #include <ATen/ATen.h>
 #include <ATen/NativeFunctions.h>
+#include <ATen/native/BuiltinFFT.h>
 #include <ATen/native/SpectralOpsUtils.h>
 #include <ATen/Config.h>
-
-#if !AT_MKL_ENABLED()
-
-namespace at { namespace native {
-
-Tensor _fft_mkl(const Tensor& input, int64_t signal_ndim,
-                bool complex_input, bool complex_output,
-                bool inverse, IntArrayRef checked_signal_sizes,
-                int64_t normalization, bool onesided,
-                IntArrayRef output_sizes) {
-  AT_ERROR("fft: ATen not compiled with MKL support");
-}
-
-}}
-
-#else // AT_MKL_ENABLED
-
-#include <ATen/ATen.h>
-#include <ATen/Config.h>
 #include <ATen/Dispatch.h>
-#include <ATen/NativeFunctions.h>
 #include <ATen/Parallel.h>
-#include <ATen/Utils.h>
 
-#include <algorithm>
 #include <vector>
-#include <numeric>
-#include <cmath>
-
-#include <mkl_dfti.h>
-#include <ATen/mkl/Exceptions.h>
-#include <ATen/mkl/Descriptors.h>
-#include <ATen/mkl/Limits.h>
-
 
 namespace at { namespace native {
 
-// In real-to-complex transform, MKL FFT only fills half of the values due to
-// conjugate symmetry. See native/SpectralUtils.h for more details.
+// In real-to-complex transform, MKL FFT and the builtin FFT only fill half of
+// the values due to conjugate symmetry. See native/SpectralUtils.h for more
+// details.
 // The following structs are used to fill in the other half with symmetry in
 // case of real-to-complex transform with onesided=False flag.
 // See NOTE [ Fourier Transform Conjugate Symmetry ] in native/SpectralOpsUtils.h.
@@ -124,7 +96,7 @@ static inline void _fft_fill_with_conjugate_symmetry_slice(Tensor& output,
 // input should be a contiguous batched tensor of same size as full (twosided)
 // signals, but only contains half (onesided) of the values.
 // This function modifies inplace.
-static inline void _fft_fill_with_conjugate_symmetry_(Tensor& input,
+void _fft_fill_with_conjugate_symmetry_(Tensor& input,
                       int64_t signal_ndim, int64_t size_last_dim,
                       int64_t last_dim_start_slice) {
   if (last_dim_start_slice >= size_last_dim) {
@@ -144,12 +116,57 @@ static inline void _fft_fill_with_conjugate_symmetry_(Tensor& input,
   });
 }
 
+}} // namespace at::native
+
+#if !AT_MKL_ENABLED()
+
+namespace at { namespace native {
+
+Tensor _fft_mkl(const Tensor& input, int64_t signal_ndim,
+                bool complex_input, bool complex_output,
+                bool inverse, IntArrayRef checked_signal_sizes,
+                int64_t normalization, bool onesided,
+                IntArrayRef output_sizes) {
+  return _fft_builtin(input, signal_ndim, complex_input, complex_output,
+                      inverse, checked_signal_sizes, normalization, onesided,
+                      output_sizes);
+}
+
+}}
+
+#else // AT_MKL_ENABLED
+
+#include <ATen/ATen.h>
+#include <ATen/Config.h>
+#include <ATen/Dispatch.h>
+#include <ATen/NativeFunctions.h>
+#include <ATen/Parallel.h>
+#include <ATen/Utils.h>
+
+#include <algorithm>
+#include <vector>
+#include <numeric>
+#include <cmath>
+
+#include <mkl_dfti.h>
+#include <ATen/mkl/Exceptions.h>
+#include <ATen/mkl/Descriptors.h>
+#include <ATen/mkl/Limits.h>
+
+
+namespace at { namespace native {
+
 // MKL DFTI
 Tensor _fft_mkl(const Tensor& self, int64_t signal_ndim,
                 bool complex_input, bool complex_output,
                 bool inverse, IntArrayRef checked_signal_sizes,
                 int64_t normalization, bool onesided,
                 IntArrayRef output_sizes) {
+  if (!at::globalContext().userEnabledMklFFT()) {
+    return _fft_builtin(self, signal_ndim, complex_input, complex_output,
+                        inverse, checked_signal_sizes, normalization, onesided,
+                        output_sizes);
+  }
   int64_t batch = self.size(0);
   Tensor input = self;
   // real/imag dimension must aligned when viewed as of complex type
@@ -0,0 +1,335 @@
+// Basic functions on sparse CSR tensors
+
+#include <ATen/ATen.h>
+#include <ATen/Dispatch.h>
+#include <ATen/Layout.h>
+#include <ATen/NativeFunctions.h>
+#include <ATen/Parallel.h>
+#include <ATen/SparseCsrTensorImpl.h>
+#include <ATen/SparseCsrTensorUtils.h>
+
+#include <algorithm>
+#include <atomic>
+#include <numeric>
+#include <vector>
+
+namespace at { namespace native {
+
+using namespace at::sparse_csr;
+
+/******************************************************************************
+ * access methods
+ ******************************************************************************/
+
+int64_t _nnz_sparse_csr(const SparseCsrTensor& self) {
+  return get_sparse_csr_impl(self)->nnz();
+}
+
+Tensor crow_indices_sparse_csr(const Tensor& self) {
+  return get_sparse_csr_impl(self)->crow_indices().alias();
+}
+
+Tensor col_indices_sparse_csr(const Tensor& self) {
+  return get_sparse_csr_impl(self)->col_indices().alias();
+}
+
+Tensor values_sparse_csr(const Tensor& self) {
+  return get_sparse_csr_impl(self)->values().alias();
+}
+
+/******************************************************************************
+ * creation methods
+ * See NOTE [ Sparse CSR tensors ] in native_functions.yaml
+ ******************************************************************************/
+
+namespace {
+
+SparseCsrTensor new_sparse_csr(const TensorOptions& options) {
+  AT_ASSERT(options.layout() == kSparseCsr);
+  TORCH_CHECK(options.device().is_cpu(),
+      "sparse CSR tensors are only supported on CPU, but got device ", options.device());
+  return detail::make_tensor<SparseCsrTensorImpl>(
+      DispatchKeySet(DispatchKey::SparseCsrCPU), options.dtype());
+}
+
+// The members of a CSR tensor must not carry AutogradMeta, see
+// new_with_dims_and_tensor_sparse.
+Tensor shallow_copy_for_sparse_csr(const Tensor& tensor) {
+  return Tensor(tensor.unsafeGetTensorImpl()->shallow_copy_and_detach(
+    /*version_counter=*/tensor.unsafeGetTensorImpl()->version_counter(),
+    /*allow_tensor_metadata_change=*/true));
+}
+
+} // namespace
+
+SparseCsrTensor new_with_tensors_sparse_csr(
+    const Tensor& crow_indices,
+    const Tensor& col_indices,
+    const Tensor& values,
+    IntArrayRef size,
+    const TensorOptions& options) {
+  SparseCsrTensor self = new_sparse_csr(options);
+  alias_into_sparse_csr(
+      self,
+      shallow_copy_for_sparse_csr(crow_indices),
+      shallow_copy_for_sparse_csr(col_indices),
+      shallow_copy_for_sparse_csr(values),
+      size);
+  return self;
+}
+
+Tensor empty_sparse_csr(IntArrayRef size, const TensorOptions& options, c10::optional<MemoryFormat> optional_memory_format) {
+  TORCH_CHECK(!options.pinned_memory(), "Only dense CPU tensors can be pinned");
+  TORCH_CHECK(size.size() == 2, "sparse CSR tensors must be 2-dimensional, but got size ", size);
+  auto index_options = options.layout(kStrided).dtype(kLong);
+  return at::_sparse_csr_tensor_unsafe(
+      at::zeros({size[0] + 1}, index_options),
+      at::empty({0}, index_options),
+      at::empty({0}, options.layout(kStrided)),
+      size,
+      options);
+}
+
+void _validate_sparse_csr_tensor_args(const Tensor& crow_indices, const Tensor& col_indices, const Tensor& values, IntArrayRef size) {
+  TORCH_CHECK(size.size() == 2, "sparse CSR tensors must be 2-dimensional, but got size ", size);
+  TORCH_CHECK(crow_indices.layout() == kStrided && col_indices.layout() == kStrided && values.layout() == kStrided,
+      "expected crow_indices, col_indices and values to be strided tensors");
+  TORCH_CHECK(crow_indices.dim() == 1 && col_indices.dim() == 1 && values.dim() == 1,
+      "crow_indices, col_indices and values must be 1-dimensional, but got ",
+      crow_indices.dim(), "-D, ", col_indices.dim(), "-D and ", values.dim(), "-D tensors");
+  TORCH_CHECK(crow_indices.scalar_type() == kInt || crow_indices.scalar_type() == kLong,
+      "crow_indices must be an int32 or int64 tensor, but got ", crow_indices.scalar_type());
+  TORCH_CHECK(col_indices.scalar_type() == crow_indices.scalar_type(),
+      "col_indices and crow_indices must have the same dtype, but got ",
+      col_indices.scalar_type(), " and ", crow_indices.scalar_type());
+  TORCH_CHECK(crow_indices.numel() == size[0] + 1,
+      "crow_indices must have ", size[0] + 1, " elements for ", size[0], " rows, but got ", crow_indices.numel());
+  TORCH_CHECK(col_indices.numel() == values.numel(),
+      "col_indices and values must have the same number of elements, but got ",
+      col_indices.numel(), " and ", values.numel());
+
+  const int64_t rows = size[0];
+  const int64_t cols = size[1];
+  const int64_t nnz = values.numel();
+  auto crow = crow_indices.contiguous();
+  auto col = col_indices.contiguous();
+  AT_DISPATCH_INDEX_TYPES(crow.scalar_type(), "_validate_sparse_csr_tensor_args", [&] {
+    const index_t* crow_data = crow.data_ptr<index_t>();
+    const index_t* col_data = col.data_ptr<index_t>();
+    TORCH_CHECK(crow_data[0] == 0, "crow_indices must start with 0, but got ", crow_data[0]);
+    TORCH_CHECK(crow_data[rows] == nnz,
+        "crow_indices must end with nnz (", nnz, "), but got ", crow_data[rows]);
+    at::parallel_for(0, rows, internal::GRAIN_SIZE, [&](int64_t begin, int64_t end) {
+      for (int64_t i = begin; i < end; i++) {
+        TORCH_CHECK(crow_data[i] <= crow_data[i + 1],
+            "crow_indices must be non-decreasing, but crow_indices[", i, "] = ", crow_data[i],
+            " > crow_indices[", i + 1, "] = ", crow_data[i + 1]);
+      }
+    });
+    at::parallel_for(0, nnz, internal::GRAIN_SIZE, [&](int64_t begin, int64_t end) {
+      for (int64_t p = begin; p < end; p++) {
+        TORCH_CHECK(col_data[p] >= 0 && col_data[p] < cols,
+            "col_indices[", p, "] = ", col_data[p], " is out of bounds for ", cols, " columns");
+      }
+    });
+  });
+}
+
+Tensor sparse_csr_tensor(
+    const Tensor& crow_indices,
+    const Tensor& col_indices,
+    const Tensor& values,
+    IntArrayRef size,
+    const TensorOptions& options) {
+  TORCH_CHECK(!options.has_layout() || options.layout() == kSparseCsr,
+      "expected sparse CSR layout, but got layout ", options.layout());
+  at::native::_validate_sparse_csr_tensor_args(crow_indices, col_indices, values, size);
+  return at::_sparse_csr_tensor_unsafe(
+      crow_indices, col_indices, values, size, values.options().layout(kSparseCsr));
+}
+
+// The number of rows follows from crow_indices, and the number of columns is
+// inferred as the largest column index + 1.
+Tensor sparse_csr_tensor(
+    const Tensor& crow_indices,
+    const Tensor& col_indices,
+    const Tensor& values,
+    const TensorOptions& options) {
+  TORCH_CHECK(crow_indices.dim() == 1 && crow_indices.numel() >= 1,
+      "crow_indices must be a 1-dimensional tensor with at least one element, but got ", crow_indices.sizes());
+  const int64_t cols = col_indices.numel() > 0 ? col_indices.max().item<int64_t>() + 1 : 0;
+  return at::native::sparse_csr_tensor(
+      crow_indices, col_indices, values, {crow_indices.numel() - 1, cols}, options);
+}
+
+/******************************************************************************
+ * conversions
+ ******************************************************************************/
+
+SparseCsrTensor dense_to_sparse_csr(const Tensor& self) {
+  TORCH_CHECK(self.dim() == 2, "to_sparse_csr: expected a 2-D tensor, but got a ", self.dim(), "-D tensor");
+  auto src = self.contiguous();
+  const int64_t rows = src.size(0);
+  const int64_t cols = src.size(1);
+  const int64_t grain_size = std::max<int64_t>(1, internal::GRAIN_SIZE / std::max<int64_t>(cols, 1));
+
+  // Count the nonzeros of each row, then write them out after those of the
+  // previous rows.
+  Tensor crow_indices = at::empty({rows + 1}, self.options().dtype(kLong));
+  Tensor col_indices;
+  Tensor values;
+  AT_DISPATCH_ALL_TYPES_AND_COMPLEX_AND3(kHalf, kBool, kBFloat16, src.scalar_type(), "dense_to_sparse_csr", [&] {
+    const scalar_t* src_data = src.data_ptr<scalar_t>();
+    int64_t* crow_data = crow_indices.data_ptr<int64_t>();
+    crow_data[0] = 0;
+    at::parallel_for(0, rows, grain_size, [&](int64_t begin, int64_t end) {
+      for (int64_t i = begin; i < end; i++) {
+        const scalar_t* row = src_data + i * cols;
+        int64_t count = 0;
+        for (int64_t j = 0; j < cols; j++) {
+          count += row[j] != scalar_t(0);
+        }
+        crow_data[i + 1] = count;
+      }
+    });
+    std::partial_sum(crow_data, crow_data + rows + 1, crow_data);
+
+    const int64_t nnz = crow_data[rows];
+    col_indices = at::empty({nnz}, crow_indices.options());
+    values = at::empty({nnz}, src.options());
+    int64_t* col_data = col_indices.data_ptr<int64_t>();
+    scalar_t* values_data = values.data_ptr<scalar_t>();
+    at::parallel_for(0, rows, grain_size, [&](int64_t begin, int64_t end) {
+      for (int64_t i = begin; i < end; i++) {
+        const scalar_t* row = src_data + i * cols;
+        int64_t p = crow_data[i];
+        for (int64_t j = 0; j < cols; j++) {
+          if (row[j] != scalar_t(0)) {
+            col_data[p] = j;
+            values_data[p] = row[j];
+            p++;
+          }
+        }
+      }
+    });
+  });
+  return at::_sparse_csr_tensor_unsafe(
+      crow_indices, col_indices, values, self.sizes(), values.options().layout(kSparseCsr));
+}
+
+// A coalesced COO tensor is already sorted by row, so only crow_indices has to
+// be computed. Otherwise the entries are bucketed by row with a counting sort,
+// which keeps duplicates (CSR kernels sum them) instead of coalescing.
+SparseCsrTensor sparse_to_sparse_csr(const Tensor& self) {
+  TORCH_CHECK(self.sparse_dim() == 2 && self.dense_dim() == 0,
+      "to_sparse_csr: expected a 2-D sparse tensor with scalar values, but got sparse_dim ",
+      self.sparse_dim(), " and dense_dim ", self.dense_dim());
+  const int64_t rows = self.size(0);
+  const int64_t nnz = self._nnz();
+  auto indices = self._indices().contiguous();
+  const int64_t* row_data = indices.data_ptr<int64_t>();
+
+  Tensor crow_indices = at::zeros({rows + 1}, indices.options());
+  int64_t* crow_data = crow_indices.data_ptr<int64_t>();
+  Tensor col_indices = indices.select(0, 1);
+  Tensor values = self._values();
+
+  if (self.is_coalesced()) {
+    TORCH_CHECK(nnz == 0 || (row_data[0] >= 0 && row_data[nnz - 1] < rows),
+        "to_sparse_csr: row index out of bounds for ", rows, " rows");
+    // Entry p is the last one of its row when the next entry starts a later
+    // row; the rows in between are empty and end at p + 1 as well.
+    at::parallel_for(0, nnz, internal::GRAIN_SIZE, [&](int64_t begin, int64_t end) {
+      for (int64_t p = begin; p < end; p++) {
+        const int64_t next_row = p + 1 == nnz ? rows : row_data[p + 1];
+        for (int64_t r = row_data[p]; r < next_row; r++) {
+          crow_data[r + 1] = p + 1;
+        }
+      }
+    });
+    return at::_sparse_csr_tensor_unsafe(
+        crow_indices, col_indices.clone(), values.clone(), self.sizes(), values.options().layout(kSparseCsr));
+  }
+
+  for (int64_t p = 0; p < nnz; p++) {
+    TORCH_CHECK(row_data[p] >= 0 && row_data[p] < rows,
+        "to_sparse_csr: row index ", row_data[p], " out of bounds for ", rows, " rows");
+    crow_data[row_data[p] + 1]++;
+  }
+  std::partial_sum(crow_data, crow_data + rows + 1, crow_data);
+  Tensor order = at::empty({nnz}, indices.options());
+  int64_t* order_data = order.data_ptr<int64_t>();
+  std::vector<int64_t> next(crow_data, crow_data + rows);
+  for (int64_t p = 0; p < nnz; p++) {
+    order_data[next[row_data[p]]++] = p;
+  }
+  return at::_sparse_csr_tensor_unsafe(
+      crow_indices, col_indices.index_select(0, order), values.index_select(0, order),
+      self.sizes(), values.options().layout(kSparseCsr));
+}
+
+SparseCsrTensor sparse_csr_to_sparse_csr(const SparseCsrTensor& self) {
+  return self;
+}
+
+// The result is marked coalesced when the columns of every row are strictly
+// increasing, as they are for CSR tensors produced by the conversions and
+// by mm.
+Tensor sparse_csr_to_sparse(const SparseCsrTensor& self) {
+  const int64_t rows = self.size(0);
+  const int64_t nnz = self._nnz();
+  auto crow = self.crow_indices().contiguous();
+  auto col = self.col_indices().contiguous();
+  Tensor indices = at::empty({2, nnz}, crow.options().dtype(kLong));
+  int64_t* row_out = indices.data_ptr<int64_t>();
+  int64_t* col_out = row_out + nnz;
+  std::atomic<bool> sorted{true};
+  AT_DISPATCH_INDEX_TYPES(crow.scalar_type(), "sparse_csr_to_sparse", [&] {
+    const index_t* crow_data = crow.data_ptr<index_t>();
+    const index_t* col_data = col.data_ptr<index_t>();
+    at::parallel_for(0, rows, 64, [&](int64_t begin, int64_t end) {
+      bool chunk_sorted = true;
+      for (int64_t i = begin; i < end; i++) {
+        for (int64_t p = crow_data[i]; p < crow_data[i + 1]; p++) {
+          row_out[p] = i;
+          col_out[p] = col_data[p];
+          chunk_sorted = chunk_sorted && (p == crow_data[i] || col_data[p - 1] < col_data[p]);
+        }
+      }
+      if (!chunk_sorted) {
+        sorted = false;
+      }
+    });
+  });
+  Tensor values = self.values().clone();
+  Tensor result = at::_sparse_coo_tensor_unsafe(indices, values, self.sizes(), values.options().layout(kSparse));
+  return result._coalesced_(sorted.load());
+}
+
+Tensor sparse_csr_to_dense(const SparseCsrTensor& self) {
+  const int64_t rows = self.size(0);
+  const int64_t cols = self.size(1);
+  auto crow = self.crow_indices().contiguous();
+  auto col = self.col_indices().contiguous();
+  auto values = self.values().contiguous();
+  Tensor dst = at::zeros(self.sizes(), values.options());
+  AT_DISPATCH_ALL_TYPES_AND_COMPLEX_AND3(kHalf, kBool, kBFloat16, values.scalar_type(), "sparse_csr_to_dense", [&] {
+    AT_DISPATCH_INDEX_TYPES(crow.scalar_type(), "sparse_csr_to_dense", [&] {
+      const index_t* crow_data = crow.data_ptr<index_t>();
+      const index_t* col_data = col.data_ptr<index_t>();
+      const scalar_t* values_data = values.data_ptr<scalar_t>();
+      scalar_t* dst_data = dst.data_ptr<scalar_t>();
+      at::parallel_for(0, rows, 64, [&](int64_t begin, int64_t end) {
+        for (int64_t i = begin; i < end; i++) {
+          scalar_t* row = dst_data + i * cols;
+          for (int64_t p = crow_data[i]; p < crow_data[i + 1]; p++) {
+            row[col_data[p]] += values_data[p];
+          }
+        }
+      });
+    });
+  });
+  return dst;
+}
+
+}} // namespace at::native
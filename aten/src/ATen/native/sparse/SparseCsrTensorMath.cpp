@@ -0,0 +1,382 @@
+#include <ATen/native/sparse/SparseCsrTensorMath.h>
+
+#include <ATen/ATen.h>
+#include <ATen/Dispatch.h>
+#include <ATen/ExpandUtils.h>
+#include <ATen/NativeFunctions.h>
+#include <ATen/Parallel.h>
+#include <ATen/SparseCsrTensorImpl.h>
+#include <ATen/SparseCsrTensorUtils.h>
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <vector>
+
+namespace at { namespace native {
+
+using namespace at::sparse_csr;
+
+namespace {
+
+// Number of output columns updated together by the SpMM kernels. A block of
+// a row of the output stays in L1 while the rows of the dense operand picked
+// by the nonzeros of a row of the sparse operand are streamed through it.
+constexpr int64_t kColumnBlock = 256;
+
+// Rows per task when each of the nnz entries spread over the rows costs
+// work_per_nnz multiply-adds
+int64_t row_grain_size(int64_t nnz, int64_t rows, int64_t work_per_nnz) {
+  const int64_t work_per_row = std::max<int64_t>(1, nnz / std::max<int64_t>(rows, 1) * work_per_nnz);
+  return std::max<int64_t>(1, internal::GRAIN_SIZE / work_per_row);
+}
+
+template <typename scalar_t, typename index_t>
+void addmm_out_csr_dense_worker(
+    int64_t dim_i,
+    int64_t dim_j,
+    const index_t* crow_data,
+    const index_t* col_data,
+    const scalar_t* values_data,
+    const scalar_t* dense_data,
+    scalar_t* r_data,
+    int64_t dim_k,
+    scalar_t alpha) {
+  const int64_t nnz = crow_data[dim_i];
+  at::parallel_for(0, dim_i, row_grain_size(nnz, dim_i, dim_k), [&](int64_t begin, int64_t end) {
+    for (int64_t k0 = 0; k0 < dim_k; k0 += kColumnBlock) {
+      const int64_t block = std::min(kColumnBlock, dim_k - k0);
+      for (int64_t i = begin; i < end; i++) {
+        scalar_t* r_row = r_data + i * dim_k + k0;
+        for (int64_t p = crow_data[i]; p < crow_data[i + 1]; p++) {
+          const int64_t col = col_data[p];
+          TORCH_CHECK(col >= 0 && col < dim_j,
+              "addmm: index out of column bound: ", col, " not between 0 and ", dim_j);
+          const scalar_t val = alpha * values_data[p];
+          const scalar_t* dense_row = dense_data + col * dim_k + k0;
+          for (int64_t k = 0; k < block; k++) {
+            r_row[k] += val * dense_row[k];
+          }
+        }
+      }
+    }
+  });
+}
+
+// r = mm(dense, S) for a strided dense and a CSR S: every row of the result
+// gathers the rows of S picked by the nonzeros of the same row of dense.
+template <typename scalar_t, typename index_t>
+void mm_dense_csr_worker(
+    const Tensor& dense,
+    const index_t* crow_data,
+    const index_t* col_data,
+    const scalar_t* values_data,
+    Tensor& r) {
+  const int64_t dim_i = dense.size(0);
+  const int64_t dim_j = dense.size(1);
+  const int64_t dim_k = r.size(1);
+  const scalar_t* dense_data = dense.data_ptr<scalar_t>();
+  scalar_t* r_data = r.data_ptr<scalar_t>();
+  at::parallel_for(0, dim_i, row_grain_size(dim_j, 1, 1), [&](int64_t begin, int64_t end) {
+    for (int64_t i = begin; i < end; i++) {
+      scalar_t* r_row = r_data + i * dim_k;
+      for (int64_t j = 0; j < dim_j; j++) {
+        const scalar_t a = dense_data[i * dim_j + j];
+        if (a == scalar_t(0)) {
+          continue;
+        }
+        for (int64_t p = crow_data[j]; p < crow_data[j + 1]; p++) {
+          const int64_t col = col_data[p];
+          TORCH_CHECK(col >= 0 && col < dim_k,
+              "mm: index out of column bound: ", col, " not between 0 and ", dim_k);
+          r_row[col] += a * values_data[p];
+        }
+      }
+    }
+  });
+}
+
+// Gustavson's row-by-row product of two CSR matrices. Each task keeps a dense
+// accumulator over the columns of the result: a first pass counts the
+// distinct columns of every row, then the rows are computed in place at
+// their final offsets with their columns sorted.
+template <typename scalar_t, typename index_t>
+Tensor spgemm_worker(const Tensor& a, const Tensor& b) {
+  const int64_t dim_i = a.size(0);
+  const int64_t dim_j = a.size(1);
+  const int64_t dim_k = b.size(1);
+  auto a_crow = a.crow_indices().contiguous();
+  auto a_col = a.col_indices().contiguous();
+  auto a_values = a.values().contiguous();
+  auto b_crow = b.crow_indices().contiguous();
+  auto b_col = b.col_indices().contiguous();
+  auto b_values = b.values().contiguous();
+  const index_t* a_crow_data = a_crow.data_ptr<index_t>();
+  const index_t* a_col_data = a_col.data_ptr<index_t>();
+  const scalar_t* a_values_data = a_values.data_ptr<scalar_t>();
+  const index_t* b_crow_data = b_crow.data_ptr<index_t>();
+  const index_t* b_col_data = b_col.data_ptr<index_t>();
+  const scalar_t* b_values_data = b_values.data_ptr<scalar_t>();
+
+  // Multiply-adds per row of a, to balance the tasks
+  const int64_t grain_size = row_grain_size(
+      a_values.numel(), dim_i, std::max<int64_t>(1, b_values.numel() / std::max<int64_t>(dim_j, 1)));
+
+  Tensor crow = at::empty({dim_i + 1}, a_crow.options());
+  index_t* crow_data = crow.data_ptr<index_t>();
+  std::vector<int64_t> row_nnz(dim_i + 1, 0);
+  at::parallel_for(0, dim_i, grain_size, [&](int64_t begin, int64_t end) {
+    std::vector<int64_t> last_row(dim_k, -1);
+    for (int64_t i = begin; i < end; i++) {
+      int64_t count = 0;
+      for (int64_t p = a_crow_data[i]; p < a_crow_data[i + 1]; p++) {
+        const int64_t j = a_col_data[p];
+        TORCH_CHECK(j >= 0 && j < dim_j,
+            "mm: index out of column bound: ", j, " not between 0 and ", dim_j);
+        for (int64_t q = b_crow_data[j]; q < b_crow_data[j + 1]; q++) {
+          const int64_t k = b_col_data[q];
+          TORCH_CHECK(k >= 0 && k < dim_k,
+              "mm: index out of column bound: ", k, " not between 0 and ", dim_k);
+          if (last_row[k] != i) {
+            last_row[k] = i;
+            count++;
+          }
+        }
+      }
+      row_nnz[i + 1] = count;
+    }
+  });
+  std::partial_sum(row_nnz.begin(), row_nnz.end(), row_nnz.begin());
+  const int64_t nnz = row_nnz[dim_i];
+  TORCH_CHECK(nnz <= std::numeric_limits<index_t>::max(),
+      "mm: the product has ", nnz, " nonzeros, which overflows its ", crow.scalar_type(), " indices");
+  std::copy(row_nnz.begin(), row_nnz.end(), crow_data);
+
+  Tensor col = at::empty({nnz}, a_col.options());
+  Tensor values = at::empty({nnz}, a_values.options());
+  index_t* col_data = col.data_ptr<index_t>();
+  scalar_t* values_data = values.data_ptr<scalar_t>();
+  at::parallel_for(0, dim_i, grain_size, [&](int64_t begin, int64_t end) {
+    std::vector<int64_t> last_row(dim_k, -1);
+    std::vector<scalar_t> accumulator(dim_k);
+    for (int64_t i = begin; i < end; i++) {
+      index_t* row_col = col_data + row_nnz[i];
+      int64_t count = 0;
+      for (int64_t p = a_crow_data[i]; p < a_crow_data[i + 1]; p++) {
+        const int64_t j = a_col_data[p];
+        const scalar_t a_val = a_values_data[p];
+        for (int64_t q = b_crow_data[j]; q < b_crow_data[j + 1]; q++) {
+          const int64_t k = b_col_data[q];
+          if (last_row[k] != i) {
+            last_row[k] = i;
+            accumulator[k] = a_val * b_values_data[q];
+            row_col[count++] = k;
+          } else {
+            accumulator[k] += a_val * b_values_data[q];
+          }
+        }
+      }
+      std::sort(row_col, row_col + count);
+      scalar_t* row_values = values_data + row_nnz[i];
+      for (int64_t p = 0; p < count; p++) {
+        row_values[p] = accumulator[row_col[p]];
+      }
+    }
+  });
+  return at::_sparse_csr_tensor_unsafe(
+      crow, col, values, {dim_i, dim_k}, values.options().layout(kSparseCsr));
+}
+
+} // namespace
+
+// --------------------------------------------------------------------
+// addmm(D1, S, D2, beta, alpha) -> D  [broadcasts]
+//
+// D = beta * D1 + alpha * mm(S, D2)
+// --------------------------------------------------------------------
+
+Tensor& s_addmm_out_csr_dense_cpu(
+    Tensor& r,
+    const Tensor& t,
+    const Tensor& crow_indices,
+    const Tensor& col_indices,
+    const Tensor& values,
+    int64_t dim_j,
+    const Tensor& dense,
+    Scalar beta,
+    Scalar alpha) {
+  TORCH_CHECK(!r.is_cuda(), "addmm: expected 'out' to be CPU tensor, but got CUDA tensor");
+  TORCH_CHECK(!dense.is_cuda(), "addmm: expected 'mat2' to be a CPU tensor, but got a CUDA tensor");
+  TORCH_CHECK(dense.layout() == kStrided, "addmm: expected 'mat2' to be a strided tensor, but got layout ", dense.layout());
+  TORCH_CHECK(dense.dim() == 2, "addmm: matrices expected, got ", dense.dim(), "D tensor");
+  TORCH_CHECK(values.scalar_type() == dense.scalar_type() && values.scalar_type() == r.scalar_type(),
+      "addmm: expected 'mat1', 'mat2' and 'out' to have the same dtype, but got ",
+      values.scalar_type(), ", ", dense.scalar_type(), " and ", r.scalar_type());
+
+  // ixj * jxk = ixk
+  int64_t dim_i = crow_indices.numel() - 1;
+  int64_t dim_k = dense.size(1);
+
+  TORCH_CHECK(dense.size(0) == dim_j,
+      "addmm: Argument #3 (dense): Expected dim 0 size ", dim_j, ", got ", dense.size(0));
+  TORCH_CHECK(t.size(0) == dim_i,
+      "addmm: Argument #1 (t): Expected dim 0 size ", dim_i, ", got ", t.size(0));
+  TORCH_CHECK(t.size(1) == dim_k,
+      "addmm: Argument #1 (t): Expected dim 1 size ", dim_k, ", got ", t.size(1));
+
+  r.resize_({dim_i, dim_k});
+  Tensor out = r.is_contiguous() ? r : at::empty({dim_i, dim_k}, r.options());
+  if (beta.toDouble() == 0) {
+    out.zero_();
+  } else {
+    if (!out.is_same(t)) {
+      out.copy_(t);
+    }
+    if (beta.toDouble() != 1) {
+      out.mul_(beta);
+    }
+  }
+
+  auto crow = crow_indices.contiguous();
+  auto col = col_indices.contiguous();
+  auto values_contig = values.contiguous();
+  auto dense_contig = dense.contiguous();
+  AT_DISPATCH_ALL_TYPES(values.scalar_type(), "addmm_sparse_csr_dense", [&] {
+    AT_DISPATCH_INDEX_TYPES(crow.scalar_type(), "addmm_sparse_csr_dense", [&] {
+      addmm_out_csr_dense_worker<scalar_t, index_t>(
+          dim_i, dim_j, crow.data_ptr<index_t>(), col.data_ptr<index_t>(),
+          values_contig.data_ptr<scalar_t>(), dense_contig.data_ptr<scalar_t>(),
+          out.data_ptr<scalar_t>(), dim_k, alpha.to<scalar_t>());
+    });
+  });
+  if (!out.is_same(r)) {
+    r.copy_(out);
+  }
+  return r;
+}
+
+Tensor& addmm_out_sparse_csr_dense_cpu(
+    Tensor& result,
+    const Tensor& self,
+    const SparseCsrTensor& mat1,
+    const Tensor& mat2,
+    Scalar beta,
+    Scalar alpha) {
+  TORCH_CHECK(mat1.is_sparse_csr(), "addmm: expected 'mat1' to be a sparse CSR tensor, but got layout ", mat1.layout());
+  TORCH_CHECK(self.layout() == kStrided, "addmm: expected 'self' to be a strided tensor, but got layout ", self.layout());
+  Tensor b_self;
+  std::tie(b_self) = expand_size(self, {mat1.size(0), mat2.size(1)}, "addmm_out");
+  return s_addmm_out_csr_dense_cpu(
+      result, b_self, mat1.crow_indices(), mat1.col_indices(), mat1.values(), mat1.size(1), mat2, beta, alpha);
+}
+
+Tensor addmm_sparse_csr_dense_cpu(
+    const Tensor& self,
+    const SparseCsrTensor& mat1,
+    const Tensor& mat2,
+    Scalar beta,
+    Scalar alpha) {
+  Tensor r = at::empty({0}, self.options());
+  return addmm_out_sparse_csr_dense_cpu(r, self, mat1, mat2, beta, alpha);
+}
+
+// --------------------------------------------------------------------
+// mm with a CSR argument: CSR @ dense -> dense, dense @ CSR -> dense,
+// CSR @ CSR -> CSR
+// --------------------------------------------------------------------
+
+Tensor mm_sparse_csr(const Tensor& self, const Tensor& mat2) {
+  TORCH_CHECK(self.dim() == 2 && mat2.dim() == 2,
+      "mm: matrices expected, got ", self.dim(), "D and ", mat2.dim(), "D tensors");
+  TORCH_CHECK(self.size(1) == mat2.size(0),
+      "mm: mat1 and mat2 shapes cannot be multiplied (",
+      self.size(0), "x", self.size(1), " and ", mat2.size(0), "x", mat2.size(1), ")");
+  TORCH_CHECK(self.scalar_type() == mat2.scalar_type(),
+      "mm: expected mat1 and mat2 to have the same dtype, but got ",
+      self.scalar_type(), " and ", mat2.scalar_type());
+
+  if (self.is_sparse_csr() && mat2.is_sparse_csr()) {
+    Tensor a = self;
+    Tensor b = mat2;
+    if (a.crow_indices().scalar_type() != b.crow_indices().scalar_type()) {
+      a = at::_sparse_csr_tensor_unsafe(
+          a.crow_indices().to(kLong), a.col_indices().to(kLong), a.values(), a.sizes(), a.options());
+      b = at::_sparse_csr_tensor_unsafe(
+          b.crow_indices().to(kLong), b.col_indices().to(kLong), b.values(), b.sizes(), b.options());
+    }
+    Tensor result;
+    AT_DISPATCH_ALL_TYPES(self.scalar_type(), "mm_sparse_csr_sparse_csr", [&] {
+      AT_DISPATCH_INDEX_TYPES(a.crow_indices().scalar_type(), "mm_sparse_csr_sparse_csr", [&] {
+        result = spgemm_worker<scalar_t, index_t>(a, b);
+      });
+    });
+    return result;
+  }
+
+  if (self.is_sparse_csr()) {
+    Tensor result = at::empty({self.size(0), mat2.size(1)}, mat2.options());
+    return s_addmm_out_csr_dense_cpu(
+        result, result, self.crow_indices(), self.col_indices(), self.values(), self.size(1), mat2, 0, 1);
+  }
+
+  TORCH_CHECK(self.layout() == kStrided, "mm: expected 'mat1' to be a strided tensor, but got layout ", self.layout());
+  TORCH_CHECK(!self.is_cuda(), "mm: expected 'mat1' to be a CPU tensor, but got a CUDA tensor");
+  auto dense = self.contiguous();
+  auto crow = mat2.crow_indices().contiguous();
+  auto col = mat2.col_indices().contiguous();
+  auto values = mat2.values().contiguous();
+  Tensor result = at::zeros({self.size(0), mat2.size(1)}, self.options());
+  AT_DISPATCH_ALL_TYPES(self.scalar_type(), "mm_dense_sparse_csr", [&] {
+    AT_DISPATCH_INDEX_TYPES(crow.scalar_type(), "mm_dense_sparse_csr", [&] {
+      mm_dense_csr_worker<scalar_t, index_t>(
+          dense, crow.data_ptr<index_t>(), col.data_ptr<index_t>(), values.data_ptr<scalar_t>(), result);
+    });
+  });
+  return result;
+}
+
+// --------------------------------------------------------------------
+// mv(SparseCsrTensor, Tensor)
+// --------------------------------------------------------------------
+
+Tensor mv_sparse_csr(const SparseCsrTensor& self, const Tensor& vec) {
+  TORCH_CHECK(vec.dim() == 1, "mv: expected a 1-D vector, but got a ", vec.dim(), "D tensor");
+  TORCH_CHECK(vec.layout() == kStrided, "mv: expected 'vec' to be a strided tensor, but got layout ", vec.layout());
+  TORCH_CHECK(vec.size(0) == self.size(1),
+      "mv: expected vec of size ", self.size(1), ", but got ", vec.size(0));
+  TORCH_CHECK(self.scalar_type() == vec.scalar_type(),
+      "mv: expected self and vec to have the same dtype, but got ",
+      self.scalar_type(), " and ", vec.scalar_type());
+
+  const int64_t rows = self.size(0);
+  const int64_t cols = self.size(1);
+  auto crow = self.crow_indices().contiguous();
+  auto col = self.col_indices().contiguous();
+  auto values = self.values().contiguous();
+  auto x = vec.contiguous();
+  Tensor result = at::empty({rows}, vec.options());
+  AT_DISPATCH_ALL_TYPES(self.scalar_type(), "mv_sparse_csr", [&] {
+    AT_DISPATCH_INDEX_TYPES(crow.scalar_type(), "mv_sparse_csr", [&] {
+      const index_t* crow_data = crow.data_ptr<index_t>();
+      const index_t* col_data = col.data_ptr<index_t>();
+      const scalar_t* values_data = values.data_ptr<scalar_t>();
+      const scalar_t* x_data = x.data_ptr<scalar_t>();
+      scalar_t* result_data = result.data_ptr<scalar_t>();
+      at::parallel_for(0, rows, row_grain_size(values.numel(), rows, 1), [&](int64_t begin, int64_t end) {
+        for (int64_t i = begin; i < end; i++) {
+          scalar_t sum = 0;
+          for (int64_t p = crow_data[i]; p < crow_data[i + 1]; p++) {
+            const int64_t j = col_data[p];
+            TORCH_CHECK(j >= 0 && j < cols,
+                "mv: index out of column bound: ", j, " not between 0 and ", cols);
+            sum += values_data[p] * x_data[j];
+          }
+          result_data[i] = sum;
+        }
+      });
+    });
+  });
+  return result;
+}
+
+}} // namespace at::native
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <ATen/ATen.h>
+
+namespace at { namespace native {
+
+// r = beta * t + alpha * mm(S, dense), where S is the CSR matrix with dim_j
+// columns given by crow_indices, col_indices and values. Also used by the
+// COO addmm for coalesced inputs.
+TORCH_API Tensor& s_addmm_out_csr_dense_cpu(
+    Tensor& r,
+    const Tensor& t,
+    const Tensor& crow_indices,
+    const Tensor& col_indices,
+    const Tensor& values,
+    int64_t dim_j,
+    const Tensor& dense,
+    Scalar beta,
+    Scalar alpha);
+
+}}
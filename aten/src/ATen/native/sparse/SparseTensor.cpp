@@ -10,6 +10,9 @@
 
 #include <TH/THBlasUtils.h>
 
+#include <atomic>
+#include <numeric>
+
 namespace at { namespace native {
 
 using namespace at::sparse;
@@ -352,6 +355,70 @@ SparseTensor& copy_sparse_(SparseTensor& self, const SparseTensor& src, bool non
   return self._coalesced_(src.is_coalesced());
 }
 
+namespace {
+
+// Checks in parallel whether the flattened indices are already sorted, and
+// if so whether they are also free of duplicates.
+void check_sorted_flat_indices(
+    const int64_t* keys,
+    int64_t nnz,
+    bool& sorted,
+    bool& unique) {
+  std::atomic<bool> unsorted_found{false};
+  std::atomic<bool> duplicate_found{false};
+  at::parallel_for(1, nnz, at::internal::GRAIN_SIZE, [&](int64_t begin, int64_t end) {
+    bool has_duplicate = false;
+    for (int64_t j = begin; j < end; j++) {
+      if (keys[j] < keys[j - 1]) {
+        unsorted_found.store(true, std::memory_order_relaxed);
+        return;
+      }
+      has_duplicate |= keys[j] == keys[j - 1];
+    }
+    if (has_duplicate) {
+      duplicate_found.store(true, std::memory_order_relaxed);
+    }
+  });
+  sorted = !unsorted_found.load();
+  unique = sorted && !duplicate_found.load();
+}
+
+// Returns the positions in the sorted keys where each run of equal keys
+// starts, followed by nnz. Runs are counted per chunk and the chunk counts
+// are prefix summed so that the chunks can write their starts in parallel.
+std::vector<int64_t> segment_starts(const int64_t* keys, int64_t nnz) {
+  const int64_t num_chunks = std::max<int64_t>(
+      1, std::min<int64_t>(at::get_num_threads(), at::divup(nnz, at::internal::GRAIN_SIZE)));
+  const int64_t chunk_size = at::divup(nnz, num_chunks);
+  std::vector<int64_t> chunk_offsets(num_chunks + 1, 0);
+  at::parallel_for(0, num_chunks, 1, [&](int64_t begin, int64_t end) {
+    for (int64_t c = begin; c < end; c++) {
+      int64_t count = 0;
+      for (int64_t j = c * chunk_size; j < std::min(nnz, (c + 1) * chunk_size); j++) {
+        count += (j == 0 || keys[j] != keys[j - 1]);
+      }
+      chunk_offsets[c + 1] = count;
+    }
+  });
+  std::partial_sum(chunk_offsets.begin(), chunk_offsets.end(), chunk_offsets.begin());
+
+  std::vector<int64_t> starts(chunk_offsets[num_chunks] + 1);
+  at::parallel_for(0, num_chunks, 1, [&](int64_t begin, int64_t end) {
+    for (int64_t c = begin; c < end; c++) {
+      int64_t pos = chunk_offsets[c];
+      for (int64_t j = c * chunk_size; j < std::min(nnz, (c + 1) * chunk_size); j++) {
+        if (j == 0 || keys[j] != keys[j - 1]) {
+          starts[pos++] = j;
+        }
+      }
+    }
+  });
+  starts.back() = nnz;
+  return starts;
+}
+
+} // anonymous namespace
+
 SparseTensor coalesce_sparse_cpu(const SparseTensor& self) {
   AT_ASSERT(self.defined());
   TORCH_INTERNAL_ASSERT(at::impl::variable_excluded_from_dispatch());
@@ -374,53 +441,73 @@ SparseTensor coalesce_sparse_cpu(const SparseTensor& self) {
   int64_t dense_dim = self.dense_dim();
   int64_t nnz = self._nnz();
 
-  LongTensor indices_scalar = flatten_indices(indices, self.sizes());
+  LongTensor indices_scalar = flatten_indices(indices, self.sizes()).contiguous();
+
+  bool sorted = false;
+  bool unique = false;
+  check_sorted_flat_indices(indices_scalar.data_ptr<int64_t>(), nnz, sorted, unique);
+  if (unique) {
+    // Already coalesced, only the flag was missing: the result shares the
+    // indices and values of self instead of copying them.
+    SparseTensor dst = new_sparse(self.options());
+    get_sparse_impl(dst)->resize_(sparse_dim, dense_dim, self.sizes());
+    alias_into_sparse(dst, indices, self._values());
+    dst._coalesced_(true);
+    return dst;
+  }
+
+  LongTensor indicesBuffer;
+  LongTensor indicesPermutation;
+  if (sorted) {
+    indicesBuffer = indices_scalar;
+  } else {
+    // Long inputs are sorted with all threads, see sort_kernel.
+    std::tie(indicesBuffer, indicesPermutation) = indices_scalar.sort(0);
+  }
+  const int64_t* keys = indicesBuffer.data_ptr<int64_t>();
+  const int64_t* perm = sorted ? nullptr : indicesPermutation.data_ptr<int64_t>();
+  const std::vector<int64_t> starts = segment_starts(keys, nnz);
+  const int64_t new_nnz = starts.size() - 1;
 
   SparseTensor dst = new_sparse(self.options());
   get_sparse_impl(dst)->resize_(sparse_dim, dense_dim, self.sizes());
-  // TODO: is there a more idiomatic way to do this?
-  LongTensor newIndices = at::empty(indices.sizes(), indices.options());
-  Tensor newValues = at::empty(values.sizes(), values.options());
+  LongTensor newIndices = at::empty({sparse_dim, new_nnz}, indices.options());
+  std::vector<int64_t> new_values_size = values.sizes().vec();
+  new_values_size[0] = new_nnz;
+  Tensor newValues = at::empty(new_values_size, values.options());
   alias_into_sparse(dst, newIndices, newValues);
 
-  LongTensor indicesBuffer;
-  LongTensor indicesPermutation;
-  std::tie(indicesBuffer, indicesPermutation) = indices_scalar.sort(0);
-  // NB: The accessor accesses here rely on self._nnz() > 0 (tested earlier in this function)
+  // Every run of equal indices becomes one output entry, so the runs are
+  // reduced independently of each other, in sorted order.
   auto newIndicesAccessor = newIndices.accessor<int64_t, 2>();
   auto indicesAccessor = indices.accessor<int64_t, 2>();
-  auto indicesPermutationAccessor = indicesPermutation.accessor<int64_t, 1>();
-  auto indicesBufferAccessor = indicesBuffer.accessor<int64_t, 1>();
-
-  int64_t i = -1;
   AT_DISPATCH_ALL_TYPES(
       values.scalar_type(), "coalesce", [&] {
-        int64_t prev = -1;
         int64_t blockSize = values.stride(0);
         scalar_t* values_ptr = values.data_ptr<scalar_t>();
         scalar_t* newValues_ptr = newValues.data_ptr<scalar_t>();
-        for (int64_t j = 0; j < nnz; j++) {
-          int64_t pos = indicesPermutationAccessor[j];
-          int64_t curr = indicesBufferAccessor[j];
-          if (curr == prev) {
-            if (values.numel() > 0) {  // if values is an empty tensor, there are no elements to copy
-              THBlas_axpy<scalar_t>(blockSize, 1, values_ptr + pos * blockSize, 1, newValues_ptr + i * blockSize, 1);
-            }
-          } else {
-            ++i;
+        int64_t grain_size = std::max<int64_t>(1, at::internal::GRAIN_SIZE / std::max<int64_t>(1, blockSize));
+        at::parallel_for(0, new_nnz, grain_size, [&](int64_t begin, int64_t end) {
+          for (int64_t i = begin; i < end; i++) {
+            int64_t first = starts[i];
+            int64_t pos = perm ? perm[first] : first;
             for (int64_t d = 0; d < sparse_dim; d++) {
               newIndicesAccessor[d][i] = indicesAccessor[d][pos];
             }
-            if (values.numel() > 0) {  // if values is an empty tensor, there are no elements to copy
-              THBlas_copy<scalar_t>(blockSize, values_ptr + pos * blockSize, 1, newValues_ptr + i * blockSize, 1);
+            if (values.numel() == 0) {  // if values is an empty tensor, there are no elements to copy
+              continue;
+            }
+            THBlas_copy<scalar_t>(blockSize, values_ptr + pos * blockSize, 1, newValues_ptr + i * blockSize, 1);
+            for (int64_t j = first + 1; j < starts[i + 1]; j++) {
+              pos = perm ? perm[j] : j;
+              THBlas_axpy<scalar_t>(blockSize, 1, values_ptr + pos * blockSize, 1, newValues_ptr + i * blockSize, 1);
             }
           }
-          prev = curr;
-        }
+        });
     });
 
   dst._coalesced_(true);
-  get_sparse_impl(dst)->set_nnz_and_narrow(i + 1);
+  get_sparse_impl(dst)->set_nnz_and_narrow(new_nnz);
 
   return dst;
 }
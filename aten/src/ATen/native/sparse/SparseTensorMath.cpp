@@ -1,4 +1,5 @@
 #include <ATen/native/sparse/SparseTensorMath.h>
+#include <ATen/native/sparse/SparseCsrTensorMath.h>
 
 #include <ATen/ATen.h>
 #include <ATen/Parallel.h>
@@ -868,6 +869,18 @@ Tensor& s_addmm_out_sparse_dense_cpu(
   LongTensor indices = sparse_._indices();
   Tensor values      = sparse_._values();
 
+  // The entries of a coalesced tensor are sorted by row, so with the row
+  // offsets they form a CSR matrix, whose rows are multiplied in parallel.
+  if (sparse_.is_coalesced()) {
+    LongTensor rows = indices.select(0, 0).contiguous();
+    auto rows_accessor = rows.accessor<int64_t, 1>();
+    TORCH_CHECK(rows_accessor[0] >= 0 && rows_accessor[nnz - 1] < dim_i,
+        "addmm: index out of row bound, not between 0 and ", dim_i);
+    LongTensor crow_indices = _to_csr(rows.data_ptr<int64_t>(), dim_i, nnz);
+    return s_addmm_out_csr_dense_cpu(
+        r, t, crow_indices, indices.select(0, 1), values, dim_j, dense, beta, alpha);
+  }
+
   AT_DISPATCH_ALL_TYPES(
       values.scalar_type(), "addmm_sparse_dense", [&] {
         s_addmm_out_sparse_dense_worker<scalar_t>(nnz, dim_i, dim_j, dim_k, r, beta, t, alpha, indices, values, dense);
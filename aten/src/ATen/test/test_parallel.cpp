@@ -4,6 +4,7 @@
 #include <ATen/DLConvertor.h>
 #include <ATen/Parallel.h>
 
+#include <atomic>
 #include <iostream>
 #include <string.h>
 #include <sstream>
@@ -36,6 +37,24 @@ TEST(TestParallel, NestedParallel) {
   });
 }
 
+TEST(TestParallel, NestedParallelFor) {
+  // every (outer, inner) pair is visited exactly once, whether or not the
+  // backend runs nested regions in parallel
+  std::vector<std::atomic<int>> visits(64 * 64);
+  at::parallel_for(0, 64, 1, [&](int64_t begin, int64_t end) {
+    for (auto i = begin; i < end; ++i) {
+      at::parallel_for(0, 64, 1, [&](int64_t inner_begin, int64_t inner_end) {
+        for (auto j = inner_begin; j < inner_end; ++j) {
+          visits[i * 64 + j]++;
+        }
+      });
+    }
+  });
+  for (const auto& v : visits) {
+    ASSERT_EQ(v.load(), 1);
+  }
+}
+
 TEST(TestParallel, Exceptions) {
   // parallel case
   ASSERT_THROW(
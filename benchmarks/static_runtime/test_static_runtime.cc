@@ -1,5 +1,9 @@
 #include <gtest/gtest.h>
+#include <torch/csrc/jit/ir/irparser.h>
+#include <torch/csrc/jit/runtime/static/batching.h>
 #include <torch/csrc/jit/runtime/static/impl.h>
+#include <atomic>
+#include <future>
 #include "deep_wide_pt.h"
 
 TEST(StaticRuntime, TrivialModel) {
@@ -96,3 +100,162 @@ TEST(StaticRuntime, KWargsAPI_2) {
     }
   }
 }
+
+TEST(StaticRuntime, MemoryPlanner) {
+  const int embedding_size = 32;
+  const int num_features = 50;
+  torch::jit::Module mod = getDeepAndWideSciptModel();
+  auto g = torch::jit::PrepareForStaticRuntime(mod);
+  torch::jit::StaticRuntimeOptions opts;
+  opts.enable_memory_planner = false;
+  torch::jit::StaticRuntime runtime(g);
+  torch::jit::StaticRuntime runtime_no_planner(g, opts);
+  EXPECT_FALSE(runtime_no_planner.memory_planner_stats().has_value());
+
+  size_t arena_bytes = 0;
+  for (int batch_size : {8, 1, 32}) {
+    for (int i = 0; i < 3; ++i) {
+      auto ad_emb_packed = torch::randn({batch_size, 1, embedding_size});
+      auto user_emb = torch::randn({batch_size, 1, embedding_size});
+      auto wide = torch::randn({batch_size, num_features});
+
+      std::vector<at::Tensor> input_tensors({ad_emb_packed, user_emb, wide});
+      at::Tensor output_1 = runtime_no_planner.run(input_tensors)[0];
+      at::Tensor output_2 = runtime.run(input_tensors)[0];
+      EXPECT_TRUE(output_1.equal(output_2));
+
+      auto stats = runtime.memory_planner_stats();
+      ASSERT_TRUE(stats.has_value());
+      EXPECT_GT(stats->num_managed_tensors, 0);
+      EXPECT_LE(stats->arena_bytes, stats->total_managed_bytes);
+      EXPECT_GE(stats->arena_bytes, arena_bytes);
+      arena_bytes = stats->arena_bytes;
+    }
+  }
+  // the arena only had to grow for the largest batch size
+  EXPECT_EQ(runtime.memory_planner_stats()->num_replans, 1);
+}
+
+TEST(StaticRuntime, InterOpParallelism) {
+  const int embedding_size = 32;
+  const int num_features = 50;
+  torch::jit::Module mod = getDeepAndWideSciptModel();
+  auto g = torch::jit::PrepareForStaticRuntime(mod);
+  torch::jit::StaticRuntimeOptions opts;
+  opts.enable_inter_op_parallelism = true;
+  torch::jit::StaticRuntime runtime(g, opts);
+
+  for (int batch_size : {1, 8, 32}) {
+    for (int i = 0; i < 2; ++i) {
+      auto ad_emb_packed = torch::randn({batch_size, 1, embedding_size});
+      auto user_emb = torch::randn({batch_size, 1, embedding_size});
+      auto wide = torch::randn({batch_size, num_features});
+
+      // run jit graph executor
+      std::vector<at::IValue> inputs({ad_emb_packed, user_emb, wide});
+      at::Tensor output_1 = mod.forward(inputs).toTensor();
+
+      // run static runtime
+      std::vector<at::Tensor> input_tensors({ad_emb_packed, user_emb, wide});
+      at::Tensor output_2 = runtime.run(input_tensors)[0];
+      EXPECT_TRUE(output_1.equal(output_2));
+    }
+  }
+}
+
+TEST(StaticRuntime, BoxedOutVariants) {
+  // exp and gt have no hand-written functors and run through their out=
+  // overloads; gt produces a bool tensor from float inputs
+  const auto graph_string = R"IR(
+    graph(%a : Tensor, %b : Tensor):
+      %one : int = prim::Constant[value=1]()
+      %c : Tensor = aten::exp(%a)
+      %d : Tensor = aten::sub(%c, %b, %one)
+      %e : Tensor = aten::gt(%d, %b)
+      return (%e))IR";
+  auto graph = std::make_shared<torch::jit::Graph>();
+  torch::jit::parseIR(graph_string, graph.get());
+  torch::jit::StaticRuntime runtime(torch::jit::PrepareForStaticRuntime(graph));
+
+  for (int size : {4, 16, 8}) {
+    for (int i = 0; i < 2; ++i) {
+      auto a = torch::randn({size, size});
+      auto b = torch::randn({size, size});
+      at::Tensor expected = (a.exp() - b).gt(b);
+      at::Tensor output = runtime.run({a, b})[0];
+      EXPECT_EQ(output.scalar_type(), at::kBool);
+      EXPECT_TRUE(expected.equal(output));
+    }
+  }
+}
+
+TEST(StaticRuntime, DynamicBatching) {
+  const int embedding_size = 32;
+  const int num_features = 50;
+  const int max_batch_size = 16;
+  const int num_requests = 20;
+  torch::jit::Module mod = getDeepAndWideSciptModel();
+  auto runtime = std::make_shared<torch::jit::StaticRuntime>(
+      torch::jit::PrepareForStaticRuntime(mod));
+
+  // The first batch blocks in the model until every other request is
+  // queued, so how those requests are grouped does not depend on timing.
+  std::promise<void> first_batch_started;
+  std::promise<void> all_queued;
+  std::shared_future<void> all_queued_future = all_queued.get_future();
+  std::atomic<bool> started{false};
+  torch::jit::DynamicBatcherOptions opts;
+  opts.max_batch_size = max_batch_size;
+  torch::jit::DynamicBatcher batcher(
+      [&](const std::vector<at::Tensor>& inputs) {
+        if (!started.exchange(true)) {
+          first_batch_started.set_value();
+          all_queued_future.wait();
+        }
+        return runtime->run(inputs);
+      },
+      opts);
+
+  auto make_inputs = [&](int batch_size) {
+    return std::vector<at::Tensor>{
+        torch::randn({batch_size, 1, embedding_size}),
+        torch::randn({batch_size, 1, embedding_size}),
+        torch::randn({batch_size, num_features})};
+  };
+  std::vector<std::vector<at::Tensor>> inputs;
+  // A full batch on its own
+  inputs.push_back(make_inputs(max_batch_size));
+  for (int i = 0; i < num_requests; ++i) {
+    inputs.push_back(make_inputs(1 + i % 3));
+  }
+  std::vector<at::Tensor> expected;
+  uint64_t total_rows = 0;
+  for (const auto& request : inputs) {
+    std::vector<at::IValue> args(request.begin(), request.end());
+    expected.push_back(mod.forward(args).toTensor());
+    total_rows += request[0].size(0);
+  }
+
+  std::vector<std::future<std::vector<at::Tensor>>> outputs;
+  outputs.push_back(batcher.enqueue(inputs[0]));
+  first_batch_started.get_future().wait();
+  for (size_t i = 1; i < inputs.size(); ++i) {
+    outputs.push_back(batcher.enqueue(inputs[i]));
+  }
+  all_queued.set_value();
+
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    at::Tensor output = outputs[i].get()[0];
+    EXPECT_EQ(output.size(0), inputs[i][0].size(0));
+    EXPECT_TRUE(expected[i].allclose(output)) << "request " << i;
+  }
+
+  // Requests of 1, 2, 3, 1, 2, 3, ... rows are packed in arrival order,
+  // skipping those that would overflow a batch: 9 requests (16 rows), then
+  // 8 requests (16 rows), then the remaining 3 (7 rows).
+  auto stats = batcher.stats();
+  EXPECT_EQ(stats.num_requests, inputs.size());
+  EXPECT_LT(stats.num_batches, stats.num_requests);
+  EXPECT_EQ(stats.num_batches, 4u);
+  EXPECT_EQ(stats.num_rows, total_rows);
+}
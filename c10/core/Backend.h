@@ -42,6 +42,7 @@ enum class Backend {
   QuantizedCUDA,
   Undefined,
   MkldnnCPU,
+  SparseCsrCPU,
   NumOptions
 };
 
@@ -118,6 +119,8 @@ static inline Backend dispatchKeyToBackend(DispatchKey t) {
     return Backend::SparseHIP;
   } else if (t == DispatchKey::MkldnnCPU) {
     return Backend::MkldnnCPU;
+  } else if (t == DispatchKey::SparseCsrCPU) {
+    return Backend::SparseCsrCPU;
   } else if (t == DispatchKey::QuantizedCPU) {
     return Backend::QuantizedCPU;
   } else if (t == DispatchKey::QuantizedCUDA) {
@@ -151,6 +154,8 @@ static inline DispatchKey backendToDispatchKey(Backend b) {
       return DispatchKey::SparseHIP;
     case Backend::MkldnnCPU:
       return DispatchKey::MkldnnCPU;
+    case Backend::SparseCsrCPU:
+      return DispatchKey::SparseCsrCPU;
     case Backend::Vulkan:
       return DispatchKey::Vulkan;
     case Backend::Metal:
@@ -187,6 +192,7 @@ static inline DeviceType backendToDeviceType(Backend b) {
     case Backend::SparseHIP:
       return DeviceType::HIP;
     case Backend::MkldnnCPU:
+    case Backend::SparseCsrCPU:
     case Backend::QuantizedCPU:
       return DeviceType::CPU;
     case Backend::QuantizedCUDA:
@@ -223,6 +229,8 @@ static inline Backend backendToCPU(Backend b) {
       return Backend::CPU;
     case Backend::MkldnnCPU:
       return Backend::MkldnnCPU;
+    case Backend::SparseCsrCPU:
+      return Backend::SparseCsrCPU;
     case Backend::QuantizedCPU:
       return Backend::QuantizedCPU;
     case Backend::QuantizedCUDA:
@@ -297,6 +305,8 @@ static inline const char* toString(Backend b) {
       return "SparseHIP";
     case Backend::MkldnnCPU:
       return "MkldnnCPU";
+    case Backend::SparseCsrCPU:
+      return "SparseCsrCPU";
     case Backend::Vulkan:
       return "Vulkan";
     case Backend::Metal:
@@ -321,4 +331,13 @@ static inline bool isSparse(Backend b) {
   }
 }
 
+static inline bool isSparseCsr(Backend b) {
+  switch (b) {
+    case Backend::SparseCsrCPU:
+      return true;
+    default:
+      return false;
+  }
+}
+
 } // namespace c10
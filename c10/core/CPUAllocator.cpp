@@ -2,6 +2,18 @@
 #include <c10/core/DeviceType.h>
 #include <c10/mobile/CPUCachingAllocator.h>
 #include <c10/mobile/CPUProfilingAllocator.h>
+#include <c10/util/Backtrace.h>
+#include <c10/util/thread_name.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
+
+#if !defined(_WIN32) && !defined(C10_MOBILE)
+#include <signal.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
 
 // TODO: rename flags to C10
 C10_DEFINE_bool(
@@ -19,6 +31,21 @@ C10_DEFINE_bool(
     false,
     "If set, fill memory with deterministic junk when allocating on CPU");
 
+C10_DEFINE_bool(
+    caffe2_cpu_allocator_record_backtraces,
+    false,
+    "If set together with caffe2_cpu_allocator_track_allocations, record "
+    "the backtrace of every CPU allocation so that "
+    "ProfiledCPUMemoryReporter::report() can show where long-lived "
+    "allocations were made. This makes allocations a lot slower.");
+
+C10_DEFINE_bool(
+    caffe2_cpu_allocator_track_allocations,
+    false,
+    "If set, keep the table of live allocations returned by "
+    "ProfiledCPUMemoryReporter::liveAllocations(). This adds a lock and a "
+    "hash table update to every CPU allocation and free.");
+
 namespace c10 {
 
 void memset_junk(void* data, size_t num) {
@@ -96,11 +123,20 @@ void free_cpu(void* data) {
 #endif
 }
 
+// Every allocation starts with a header of gAlignment bytes holding its size,
+// which the deleter hands to the memory reporter. The pointer handed out
+// keeps the alignment guaranteed by alloc_cpu.
 struct C10_API DefaultCPUAllocator final : at::Allocator {
   DefaultCPUAllocator() {}
   ~DefaultCPUAllocator() override {}
   at::DataPtr allocate(size_t nbytes) const override {
-    void* data = alloc_cpu(nbytes);
+    if (nbytes == 0) {
+      return {
+          nullptr, nullptr, &ReportAndDelete, at::Device(at::DeviceType::CPU)};
+    }
+    void* base = alloc_cpu(kHeaderBytes + nbytes);
+    *static_cast<size_t*>(base) = nbytes;
+    void* data = static_cast<uint8_t*>(base) + kHeaderBytes;
     profiledCPUMemoryReporter().New(data, nbytes);
     return {data, data, &ReportAndDelete, at::Device(at::DeviceType::CPU)};
   }
@@ -109,18 +145,23 @@ struct C10_API DefaultCPUAllocator final : at::Allocator {
     if (!ptr) {
       return;
     }
-    profiledCPUMemoryReporter().Delete(ptr);
-    free_cpu(ptr);
+    void* base = static_cast<uint8_t*>(ptr) - kHeaderBytes;
+    profiledCPUMemoryReporter().Delete(ptr, *static_cast<size_t*>(base));
+    free_cpu(base);
   }
 
   at::DeleterFnPtr raw_deleter() const override {
     return &ReportAndDelete;
   }
+
+ private:
+  static constexpr size_t kHeaderBytes = gAlignment;
 };
 
 ProfiledCPUMemoryReporter& profiledCPUMemoryReporter() {
-  static ProfiledCPUMemoryReporter reporter_;
-  return reporter_;
+  // Leaked on purpose: tensors may still be freed during static destruction.
+  static ProfiledCPUMemoryReporter* reporter_ = new ProfiledCPUMemoryReporter();
+  return *reporter_;
 }
 
 // QNNPACK AND XNNPACK may out-of-bound access the input and / or output
@@ -258,51 +299,460 @@ REGISTER_ALLOCATOR(DeviceType::CPU, &g_cpu_alloc);
 
 #endif /* C10_Mobile */
 
+struct CPUMemoryThreadCounters {
+  CPUMemoryThreadCounters() {
+    for (auto& count : size_histogram) {
+      count.store(0, std::memory_order_relaxed);
+    }
+  }
+
+  // Only the owning thread writes the counters, so they are bumped with a
+  // plain load and store instead of a locked read-modify-write.
+  static void add(std::atomic<uint64_t>& counter, uint64_t value) {
+    counter.store(
+        counter.load(std::memory_order_relaxed) + value,
+        std::memory_order_relaxed);
+  }
+
+  const std::thread::id thread_id = std::this_thread::get_id();
+  std::atomic<uint64_t> num_allocs{0};
+  std::atomic<uint64_t> num_frees{0};
+  std::atomic<uint64_t> total_allocated_bytes{0};
+  std::atomic<uint64_t> total_freed_bytes{0};
+  std::array<std::atomic<uint64_t>, CPUMemoryStats::kNumSizeBuckets>
+      size_histogram;
+};
+
+// The counters of the live threads of one reporter, and the sum of the
+// counters of its threads that have exited. Shared between the reporter and
+// the threads, so that either may go away first.
+struct CPUMemoryThreadRegistry {
+  // Called when the thread owning counters exits
+  void retire(CPUMemoryThreadCounters* counters) {
+    std::lock_guard<std::mutex> guard(mutex);
+    exited.num_allocs += counters->num_allocs.load(std::memory_order_relaxed);
+    exited.num_frees += counters->num_frees.load(std::memory_order_relaxed);
+    exited.total_allocated_bytes +=
+        counters->total_allocated_bytes.load(std::memory_order_relaxed);
+    exited.total_freed_bytes +=
+        counters->total_freed_bytes.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < CPUMemoryStats::kNumSizeBuckets; i++) {
+      exited_histogram[i] +=
+          counters->size_histogram[i].load(std::memory_order_relaxed);
+    }
+    threads.erase(std::find_if(
+        threads.begin(),
+        threads.end(),
+        [&](const std::shared_ptr<CPUMemoryThreadCounters>& entry) {
+          return entry.get() == counters;
+        }));
+  }
+
+  std::mutex mutex;
+  std::vector<std::shared_ptr<CPUMemoryThreadCounters>> threads;
+  // The thread_id is left default constructed
+  CPUMemoryThreadStats exited;
+  std::array<uint64_t, CPUMemoryStats::kNumSizeBuckets> exited_histogram{};
+};
+
+namespace {
+
+std::atomic<uint64_t> next_reporter_id{0};
+
+struct ThreadCountersCache {
+  uint64_t reporter_id = std::numeric_limits<uint64_t>::max();
+  CPUMemoryThreadCounters* counters = nullptr;
+};
+
+// Trivially destructible, so that it can still be read while the thread-local
+// objects of an exiting thread are destroyed.
+thread_local ThreadCountersCache thread_counters_cache;
+thread_local bool thread_counters_retired = false;
+
+// Owns the counters of this thread, one per reporter, and retires them when
+// the thread exits.
+struct ThreadCountersHolder {
+  struct Entry {
+    uint64_t reporter_id;
+    std::shared_ptr<CPUMemoryThreadRegistry> registry;
+    std::shared_ptr<CPUMemoryThreadCounters> counters;
+  };
+
+  ~ThreadCountersHolder() {
+    thread_counters_retired = true;
+    thread_counters_cache = ThreadCountersCache();
+    for (auto& entry : entries) {
+      entry.registry->retire(entry.counters.get());
+    }
+  }
+
+  std::vector<Entry> entries;
+};
+
+thread_local ThreadCountersHolder thread_counters_holder;
+
+void updatePeak(std::atomic<size_t>& peak, size_t value) {
+  size_t current = peak.load(std::memory_order_relaxed);
+  while (value > current &&
+         !peak.compare_exchange_weak(
+             current, value, std::memory_order_relaxed)) {
+  }
+}
+
+std::string formatBytes(size_t nbytes) {
+  static const char* units[] = {"B", "KB", "MB", "GB", "TB"};
+  double value = nbytes;
+  size_t unit = 0;
+  while (value >= 1024 && unit + 1 < sizeof(units) / sizeof(units[0])) {
+    value /= 1024;
+    unit++;
+  }
+  std::ostringstream ss;
+  ss.precision(unit == 0 ? 0 : 2);
+  ss << std::fixed << value << " " << units[unit];
+  return ss.str();
+}
+
+} // namespace
+
+constexpr size_t CPUMemoryStats::kNumSizeBuckets;
+
+size_t CPUMemoryStats::sizeBucket(size_t nbytes) {
+  size_t bucket = 0;
+  size_t limit = 64;
+  while (nbytes > limit && bucket + 1 < kNumSizeBuckets) {
+    limit *= 2;
+    bucket++;
+  }
+  return bucket;
+}
+
+ProfiledCPUMemoryReporter::ProfiledCPUMemoryReporter()
+    : id_(next_reporter_id++),
+      threads_(std::make_shared<CPUMemoryThreadRegistry>()) {}
+
+ProfiledCPUMemoryReporter::~ProfiledCPUMemoryReporter() = default;
+
+CPUMemoryThreadCounters* ProfiledCPUMemoryReporter::threadCounters() {
+  auto& cache = thread_counters_cache;
+  if (C10_LIKELY(cache.reporter_id == id_)) {
+    return cache.counters;
+  }
+  if (thread_counters_retired) {
+    return nullptr;
+  }
+  auto& entries = thread_counters_holder.entries;
+  // Forget the counters of reporters that have been destroyed
+  entries.erase(
+      std::remove_if(
+          entries.begin(),
+          entries.end(),
+          [](const ThreadCountersHolder::Entry& entry) {
+            return entry.registry.use_count() == 1;
+          }),
+      entries.end());
+  auto it = std::find_if(
+      entries.begin(),
+      entries.end(),
+      [&](const ThreadCountersHolder::Entry& entry) {
+        return entry.reporter_id == id_;
+      });
+  if (it == entries.end()) {
+    auto counters = std::make_shared<CPUMemoryThreadCounters>();
+    {
+      std::lock_guard<std::mutex> guard(threads_->mutex);
+      threads_->threads.push_back(counters);
+    }
+    entries.push_back({id_, threads_, std::move(counters)});
+    it = entries.end() - 1;
+  }
+  cache.reporter_id = id_;
+  cache.counters = it->counters.get();
+  return cache.counters;
+}
+
 void ProfiledCPUMemoryReporter::New(void* ptr, size_t nbytes) {
   if (nbytes == 0) {
     return;
   }
-  auto profile_memory = memoryProfilingEnabled();
-  size_t allocated = 0;
-  if (FLAGS_caffe2_report_cpu_memory_usage || profile_memory) {
-    std::lock_guard<std::mutex> guard(mutex_);
-    size_table_[ptr] = nbytes;
-    allocated_ += nbytes;
-    allocated = allocated_;
+  size_t allocated =
+      allocated_.fetch_add(nbytes, std::memory_order_relaxed) + nbytes;
+  updatePeak(peak_allocated_, allocated);
+
+  const size_t bucket = CPUMemoryStats::sizeBucket(nbytes);
+  if (auto* counters = threadCounters()) {
+    CPUMemoryThreadCounters::add(counters->num_allocs, 1);
+    CPUMemoryThreadCounters::add(counters->total_allocated_bytes, nbytes);
+    CPUMemoryThreadCounters::add(counters->size_histogram[bucket], 1);
+  } else {
+    std::lock_guard<std::mutex> guard(threads_->mutex);
+    threads_->exited.num_allocs++;
+    threads_->exited.total_allocated_bytes += nbytes;
+    threads_->exited_histogram[bucket]++;
+  }
+
+  if (FLAGS_caffe2_cpu_allocator_track_allocations) {
+    Allocation allocation;
+    allocation.nbytes = nbytes;
+    allocation.thread_id = std::this_thread::get_id();
+    allocation.time = std::chrono::steady_clock::now();
+    if (FLAGS_caffe2_cpu_allocator_record_backtraces) {
+      allocation.backtrace = get_backtrace(/*frames_to_skip=*/1);
+    }
+    auto& shard = shardFor(ptr);
+    std::lock_guard<std::mutex> guard(shard.mutex);
+    if (shard.table.emplace(ptr, std::move(allocation)).second) {
+      num_tracked_.fetch_add(1, std::memory_order_relaxed);
+    }
   }
+
   if (FLAGS_caffe2_report_cpu_memory_usage) {
     LOG(INFO) << "C10 alloc " << nbytes << " bytes, total alloc " << allocated
               << " bytes.";
   }
-  if (profile_memory) {
+  if (memoryProfilingEnabled()) {
     reportMemoryUsageToProfiler(ptr, nbytes, c10::Device(c10::DeviceType::CPU));
   }
 }
 
-void ProfiledCPUMemoryReporter::Delete(void* ptr) {
-  size_t nbytes = 0;
-  auto profile_memory = memoryProfilingEnabled();
-  size_t allocated = 0;
-  if (FLAGS_caffe2_report_cpu_memory_usage || profile_memory) {
-    std::lock_guard<std::mutex> guard(mutex_);
-    auto it = size_table_.find(ptr);
-    if (it != size_table_.end()) {
-      allocated_ -= it->second;
-      allocated = allocated_;
-      nbytes = it->second;
-      size_table_.erase(it);
-    }
-  }
+void ProfiledCPUMemoryReporter::Delete(void* ptr, size_t nbytes) {
   if (nbytes == 0) {
     return;
   }
+  size_t allocated =
+      allocated_.fetch_sub(nbytes, std::memory_order_relaxed) - nbytes;
+
+  if (auto* counters = threadCounters()) {
+    CPUMemoryThreadCounters::add(counters->num_frees, 1);
+    CPUMemoryThreadCounters::add(counters->total_freed_bytes, nbytes);
+  } else {
+    std::lock_guard<std::mutex> guard(threads_->mutex);
+    threads_->exited.num_frees++;
+    threads_->exited.total_freed_bytes += nbytes;
+  }
+
+  // The table may still hold allocations made before tracking was turned off
+  if (num_tracked_.load(std::memory_order_relaxed) > 0) {
+    auto& shard = shardFor(ptr);
+    std::lock_guard<std::mutex> guard(shard.mutex);
+    if (shard.table.erase(ptr) > 0) {
+      num_tracked_.fetch_sub(1, std::memory_order_relaxed);
+    }
+  }
+
   if (FLAGS_caffe2_report_cpu_memory_usage) {
     LOG(INFO) << "C10 deleted " << nbytes << " bytes, total alloc "
               << allocated << " bytes.";
   }
-  if (profile_memory) {
+  if (memoryProfilingEnabled()) {
     reportMemoryUsageToProfiler(ptr, -nbytes, c10::Device(c10::DeviceType::CPU));
   }
 }
 
+CPUMemoryStats ProfiledCPUMemoryReporter::stats() const {
+  CPUMemoryStats result;
+  {
+    std::lock_guard<std::mutex> guard(threads_->mutex);
+    for (const auto& counters : threads_->threads) {
+      CPUMemoryThreadStats thread;
+      thread.thread_id = counters->thread_id;
+      thread.num_allocs = counters->num_allocs.load(std::memory_order_relaxed);
+      thread.num_frees = counters->num_frees.load(std::memory_order_relaxed);
+      thread.total_allocated_bytes =
+          counters->total_allocated_bytes.load(std::memory_order_relaxed);
+      thread.total_freed_bytes =
+          counters->total_freed_bytes.load(std::memory_order_relaxed);
+      for (size_t i = 0; i < CPUMemoryStats::kNumSizeBuckets; i++) {
+        result.size_histogram[i] +=
+            counters->size_histogram[i].load(std::memory_order_relaxed);
+      }
+      result.threads.push_back(thread);
+    }
+    const CPUMemoryThreadStats& exited = threads_->exited;
+    if (exited.num_allocs > 0 || exited.num_frees > 0) {
+      for (size_t i = 0; i < CPUMemoryStats::kNumSizeBuckets; i++) {
+        result.size_histogram[i] += threads_->exited_histogram[i];
+      }
+      result.threads.push_back(exited);
+    }
+  }
+  for (const auto& thread : result.threads) {
+    result.num_allocs += thread.num_allocs;
+    result.num_frees += thread.num_frees;
+    result.total_allocated_bytes += thread.total_allocated_bytes;
+  }
+  result.allocated_bytes = allocated_.load(std::memory_order_relaxed);
+  result.peak_allocated_bytes = peak_allocated_.load(std::memory_order_relaxed);
+  return result;
+}
+
+void ProfiledCPUMemoryReporter::resetPeakStats() {
+  peak_allocated_.store(
+      allocated_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+std::vector<CPUMemoryAllocationRecord> ProfiledCPUMemoryReporter::
+    liveAllocations(std::chrono::milliseconds min_age, size_t max_records)
+        const {
+  const auto now = std::chrono::steady_clock::now();
+  std::vector<CPUMemoryAllocationRecord> records;
+  for (const auto& shard : shards_) {
+    std::lock_guard<std::mutex> guard(shard.mutex);
+    for (const auto& entry : shard.table) {
+      const Allocation& allocation = entry.second;
+      if (now - allocation.time < min_age) {
+        continue;
+      }
+      CPUMemoryAllocationRecord record;
+      record.ptr = entry.first;
+      record.nbytes = allocation.nbytes;
+      record.thread_id = allocation.thread_id;
+      record.age = now - allocation.time;
+      records.push_back(std::move(record));
+    }
+  }
+  auto larger = [](const CPUMemoryAllocationRecord& a,
+                   const CPUMemoryAllocationRecord& b) {
+    return a.nbytes != b.nbytes ? a.nbytes > b.nbytes : a.age > b.age;
+  };
+  if (records.size() > max_records) {
+    std::partial_sort(
+        records.begin(), records.begin() + max_records, records.end(), larger);
+    records.resize(max_records);
+  } else {
+    std::sort(records.begin(), records.end(), larger);
+  }
+  // Backtraces are only copied for the records that are returned. An
+  // allocation freed in the meantime keeps an empty backtrace.
+  for (auto& record : records) {
+    auto& shard = const_cast<ProfiledCPUMemoryReporter*>(this)->shardFor(
+        record.ptr);
+    std::lock_guard<std::mutex> guard(shard.mutex);
+    auto it = shard.table.find(record.ptr);
+    if (it != shard.table.end()) {
+      record.backtrace = it->second.backtrace;
+    }
+  }
+  return records;
+}
+
+std::string ProfiledCPUMemoryReporter::report(
+    std::chrono::milliseconds min_age,
+    size_t max_records) const {
+  const CPUMemoryStats s = stats();
+  std::ostringstream ss;
+  ss << "C10 CPU memory: " << formatBytes(s.allocated_bytes) << " in "
+     << s.num_allocs - s.num_frees << " live allocations, peak "
+     << formatBytes(s.peak_allocated_bytes) << ", "
+     << formatBytes(s.total_allocated_bytes) << " allocated in total by "
+     << s.num_allocs << " allocations and " << s.num_frees << " frees\n";
+
+  ss << "Allocation sizes:\n";
+  size_t limit = 64;
+  for (size_t i = 0; i < CPUMemoryStats::kNumSizeBuckets; i++, limit *= 2) {
+    if (s.size_histogram[i] == 0) {
+      continue;
+    }
+    if (i + 1 < CPUMemoryStats::kNumSizeBuckets) {
+      ss << "  <= " << formatBytes(limit);
+    } else {
+      ss << "   > " << formatBytes(limit / 2);
+    }
+    ss << ": " << s.size_histogram[i] << "\n";
+  }
+
+  ss << "Threads:\n";
+  for (const auto& thread : s.threads) {
+    ss << "  " << thread.thread_id << ": " << thread.num_allocs
+       << " allocations (" << formatBytes(thread.total_allocated_bytes)
+       << "), " << thread.num_frees << " frees ("
+       << formatBytes(thread.total_freed_bytes) << ")\n";
+  }
+
+  const auto records = liveAllocations(min_age, max_records);
+  ss << "Largest allocations alive for at least " << min_age.count()
+     << " ms:\n";
+  for (const auto& record : records) {
+    ss << "  " << record.ptr << ": " << formatBytes(record.nbytes)
+       << ", allocated "
+       << std::chrono::duration_cast<std::chrono::milliseconds>(record.age)
+              .count()
+       << " ms ago by thread " << record.thread_id << "\n";
+    if (!record.backtrace.empty()) {
+      ss << record.backtrace << "\n";
+    }
+  }
+  return ss.str();
+}
+
+#if !defined(_WIN32) && !defined(C10_MOBILE)
+namespace {
+
+int report_pipe[2] = {-1, -1};
+std::atomic<int64_t> report_min_age_ms{0};
+
+void reportSignalHandler(int /*signum*/) {
+  // write() is async-signal-safe; the actual report is produced by the
+  // reporting thread.
+  const char byte = 0;
+  auto saved_errno = errno;
+  auto written = write(report_pipe[1], &byte, 1);
+  (void)written;
+  errno = saved_errno;
+}
+
+void reportLoop() {
+  c10::setThreadName("CPUMemReport");
+  char byte;
+  while (true) {
+    auto n = read(report_pipe[0], &byte, 1);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return;
+    }
+    const std::string report = profiledCPUMemoryReporter().report(
+        std::chrono::milliseconds(report_min_age_ms.load()));
+    fputs(report.c_str(), stderr);
+    fflush(stderr);
+  }
+}
+
+} // namespace
+
+void dumpCPUMemoryReportOnSignal(int signum, std::chrono::milliseconds min_age) {
+  static std::once_flag start_thread;
+  std::call_once(start_thread, []() {
+    // The report would be empty otherwise
+    FLAGS_caffe2_cpu_allocator_track_allocations = true;
+    TORCH_CHECK(
+        pipe(report_pipe) == 0,
+        "dumpCPUMemoryReportOnSignal: pipe() failed: ",
+        strerror(errno));
+    std::thread(reportLoop).detach();
+  });
+  report_min_age_ms = min_age.count();
+
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = reportSignalHandler;
+  sigemptyset(&action.sa_mask);
+  action.sa_flags = SA_RESTART;
+  TORCH_CHECK(
+      sigaction(signum, &action, nullptr) == 0,
+      "dumpCPUMemoryReportOnSignal: sigaction(",
+      signum,
+      ") failed: ",
+      strerror(errno));
+}
+#else
+void dumpCPUMemoryReportOnSignal(
+    int /*signum*/,
+    std::chrono::milliseconds /*min_age*/) {
+  TORCH_CHECK(
+      false, "dumpCPUMemoryReportOnSignal is only supported on POSIX systems");
+}
+#endif
+
 } // namespace c10
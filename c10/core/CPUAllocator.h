@@ -1,7 +1,16 @@
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <cstring>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 
 #include <c10/core/Allocator.h>
 #include <c10/util/Logging.h>
@@ -11,6 +20,8 @@
 C10_DECLARE_bool(caffe2_report_cpu_memory_usage);
 C10_DECLARE_bool(caffe2_cpu_allocator_do_zero_fill);
 C10_DECLARE_bool(caffe2_cpu_allocator_do_junk_fill);
+C10_DECLARE_bool(caffe2_cpu_allocator_record_backtraces);
+C10_DECLARE_bool(caffe2_cpu_allocator_track_allocations);
 
 namespace c10 {
 
@@ -37,22 +48,139 @@ C10_API void memset_junk(void* data, size_t num);
 C10_API void* alloc_cpu(size_t nbytes);
 C10_API void free_cpu(void* data);
 
-// A simple struct that is used to report C10's memory allocation and
-// deallocation status to the profiler
+struct C10_API CPUMemoryThreadStats {
+  std::thread::id thread_id;
+  uint64_t num_allocs = 0;
+  uint64_t num_frees = 0;
+  // Bytes allocated by this thread over its lifetime
+  size_t total_allocated_bytes = 0;
+  // Bytes freed by this thread over its lifetime, including memory allocated
+  // by other threads
+  size_t total_freed_bytes = 0;
+};
+
+struct C10_API CPUMemoryStats {
+  // Bucket 0 counts allocations of up to 64 bytes, bucket i > 0 allocations
+  // of (2^(i+5), 2^(i+6)] bytes and the last bucket everything larger.
+  static constexpr size_t kNumSizeBuckets = 32;
+
+  uint64_t num_allocs = 0;
+  uint64_t num_frees = 0;
+  // Bytes allocated and not freed yet
+  size_t allocated_bytes = 0;
+  // High-water mark of allocated_bytes since start or resetPeakStats()
+  size_t peak_allocated_bytes = 0;
+  size_t total_allocated_bytes = 0;
+  std::array<uint64_t, kNumSizeBuckets> size_histogram{};
+  // One entry per live thread that allocated or freed memory, followed by
+  // one entry with a default constructed thread_id that sums up the threads
+  // that have exited
+  std::vector<CPUMemoryThreadStats> threads;
+
+  static size_t sizeBucket(size_t nbytes);
+};
+
+// A live allocation, as reported by liveAllocations()
+struct C10_API CPUMemoryAllocationRecord {
+  void* ptr = nullptr;
+  size_t nbytes = 0;
+  std::thread::id thread_id;
+  std::chrono::steady_clock::duration age{};
+  // Empty unless FLAGS_caffe2_cpu_allocator_record_backtraces was set when
+  // the allocation was made
+  std::string backtrace;
+};
+
+struct CPUMemoryThreadCounters;
+struct CPUMemoryThreadRegistry;
+
+// Keeps track of the allocations made by the C10 CPU allocators. It reports
+// them to the profiler when memory profiling is enabled, logs them when
+// FLAGS_caffe2_report_cpu_memory_usage is set and always maintains the
+// statistics returned by stats().
+//
+// The counters are kept per thread; only the total of allocated bytes and
+// its high-water mark are shared between threads. The table of live
+// allocations behind liveAllocations() costs a lock and a hash table update
+// per allocation, so it is only kept while
+// FLAGS_caffe2_cpu_allocator_track_allocations is set. It is sharded by
+// address so that threads allocating concurrently rarely take the same lock.
 class C10_API ProfiledCPUMemoryReporter {
  public:
-  ProfiledCPUMemoryReporter() {}
+  ProfiledCPUMemoryReporter();
+  ~ProfiledCPUMemoryReporter();
   void New(void* ptr, size_t nbytes);
-  void Delete(void* ptr);
+  // nbytes must be the size that was passed to New() for ptr
+  void Delete(void* ptr, size_t nbytes);
+
+  CPUMemoryStats stats() const;
+  void resetPeakStats();
+
+  // Allocations that have been alive for at least min_age, largest first.
+  // Allocations that live much longer than the requests of a server are the
+  // usual suspects when its RSS keeps growing.
+  std::vector<CPUMemoryAllocationRecord> liveAllocations(
+      std::chrono::milliseconds min_age = std::chrono::milliseconds(0),
+      size_t max_records = std::numeric_limits<size_t>::max()) const;
+
+  // Human readable summary of stats() followed by the max_records largest
+  // allocations that have been alive for at least min_age.
+  std::string report(
+      std::chrono::milliseconds min_age = std::chrono::milliseconds(0),
+      size_t max_records = 20) const;
 
  private:
-  std::mutex mutex_;
-  std::unordered_map<void*, size_t> size_table_;
-  size_t allocated_ = 0;
+  static constexpr size_t kNumShards = 64;
+
+  struct Allocation {
+    size_t nbytes;
+    std::thread::id thread_id;
+    std::chrono::steady_clock::time_point time;
+    std::string backtrace;
+  };
+
+  // Padded to a multiple of the cache line size to keep the hot parts of
+  // neighbouring shards apart. Not alignas(64): an over-aligned member would
+  // make new ProfiledCPUMemoryReporter depend on C++17 aligned new.
+  struct Shard {
+    mutable std::mutex mutex;
+    std::unordered_map<void*, Allocation> table;
+    char padding[64 -
+                 (sizeof(std::mutex) +
+                  sizeof(std::unordered_map<void*, Allocation>)) %
+                     64];
+  };
+
+  Shard& shardFor(void* ptr) {
+    auto bits = reinterpret_cast<uintptr_t>(ptr);
+    // Allocations are at least 16 byte aligned
+    return shards_[((bits >> 4) ^ (bits >> 12)) % kNumShards];
+  }
+  // nullptr once the thread-local state of an exiting thread is gone
+  CPUMemoryThreadCounters* threadCounters();
+
+  // Identifies this reporter in the thread-local counter caches
+  const uint64_t id_;
+  std::array<Shard, kNumShards> shards_;
+  // Allocations in shards_
+  std::atomic<size_t> num_tracked_{0};
+  std::atomic<size_t> allocated_{0};
+  std::atomic<size_t> peak_allocated_{0};
+
+  // Shared with the threads holding counters, which may outlive the reporter
+  const std::shared_ptr<CPUMemoryThreadRegistry> threads_;
 };
 
 C10_API ProfiledCPUMemoryReporter& profiledCPUMemoryReporter();
 
+// Makes the process write profiledCPUMemoryReporter().report() to stderr
+// whenever it receives the signal signum, e.g. SIGUSR2. The report is written
+// by a background thread, not by the signal handler. Only supported on POSIX
+// systems.
+C10_API void dumpCPUMemoryReportOnSignal(
+    int signum,
+    std::chrono::milliseconds min_age = std::chrono::milliseconds(0));
+
 // Get the CPU Allocator.
 C10_API at::Allocator* GetCPUAllocator();
 // Sets the CPU allocator to the given allocator: the caller gives away the
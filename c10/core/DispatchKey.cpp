@@ -52,6 +52,8 @@ const char* toString(DispatchKey t) {
       return "SparseCUDA";
     case DispatchKey::SparseHIP:
       return "SparseHIP";
+    case DispatchKey::SparseCsrCPU:
+      return "SparseCsrCPU";
 
     case DispatchKey::PrivateUse1:
       return "PrivateUse1";
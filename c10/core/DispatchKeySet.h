@@ -218,6 +218,7 @@ constexpr DispatchKeySet autogradother_backends = DispatchKeySet({
   DispatchKey::SparseCPU,
   DispatchKey::SparseCUDA,
   DispatchKey::SparseHIP,
+  DispatchKey::SparseCsrCPU,
 });
 
 // true if t is a backend dispatch key
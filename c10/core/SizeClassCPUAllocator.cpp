@@ -0,0 +1,413 @@
+#include <c10/core/SizeClassCPUAllocator.h>
+
+#include <algorithm>
+#include <memory>
+
+#include <c10/util/SmallVector.h>
+#include <c10/util/llvmMathExtras.h>
+
+namespace c10 {
+
+namespace {
+
+// Every block starts with a header of gAlignment bytes, so the pointer handed
+// out keeps the alignment guaranteed by alloc_cpu.
+struct BlockHeader {
+  SizeClassCPUAllocator* owner;
+  // Bytes accounted for this block: the size class, or the requested size
+  // for uncached blocks.
+  uint64_t nbytes;
+  // Size passed to allocate(), as reported to the memory reporter
+  uint64_t requested_bytes;
+  uint32_t size_class;
+  uint32_t magic;
+};
+
+constexpr uint32_t kBlockMagic = 0x5c1a55e5;
+constexpr size_t kHeaderBytes = gAlignment;
+static_assert(
+    sizeof(BlockHeader) <= kHeaderBytes,
+    "BlockHeader must fit in the alignment padding");
+
+inline BlockHeader* headerOf(void* base) {
+  return reinterpret_cast<BlockHeader*>(base);
+}
+
+inline void* dataOf(void* base) {
+  return static_cast<uint8_t*>(base) + kHeaderBytes;
+}
+
+inline void* baseOf(void* data) {
+  return static_cast<uint8_t*>(data) - kHeaderBytes;
+}
+
+// Protects the registration of thread caches with their allocator. It is
+// shared by all allocator instances and leaked, because thread caches can be
+// torn down during static destruction.
+std::mutex& threadCacheRegistryMutex() {
+  static std::mutex* mutex = new std::mutex();
+  return *mutex;
+}
+
+} // namespace
+
+// Blocks freed by one thread for one allocator. Only the owning thread touches
+// the blocks; the registry mutex only guards attachment to the allocator.
+struct SizeClassThreadCache {
+  SizeClassCPUAllocator* owner;
+  std::vector<void*> blocks[SizeClassCPUAllocator::kNumSizeClasses];
+  size_t cached_bytes = 0;
+
+  explicit SizeClassThreadCache(SizeClassCPUAllocator* allocator)
+      : owner(allocator) {}
+
+  // Hands every cached block back to the owner's global arena.
+  void flush() {
+    for (size_t index = 0; index < SizeClassCPUAllocator::kNumSizeClasses;
+         ++index) {
+      for (void* base : blocks[index]) {
+        owner->cached_bytes_ -= SizeClassCPUAllocator::sizeClassBytes(index);
+        if (!owner->pushGlobal(base, index)) {
+          owner->releaseBlock(base);
+        }
+      }
+      blocks[index].clear();
+    }
+    cached_bytes = 0;
+  }
+
+  // Called with the registry mutex held when the thread exits.
+  void detach() {
+    if (owner == nullptr) {
+      // The allocator was destroyed and already drained this cache.
+      return;
+    }
+    auto& registered = owner->thread_caches_;
+    registered.erase(
+        std::remove(registered.begin(), registered.end(), this),
+        registered.end());
+    flush();
+  }
+};
+
+namespace {
+
+// Owns the thread caches of the current thread, one per allocator it used.
+struct ThreadCacheSet {
+  c10::SmallVector<std::unique_ptr<SizeClassThreadCache>, 2> caches;
+  SizeClassThreadCache* last = nullptr;
+
+  ~ThreadCacheSet();
+};
+
+thread_local ThreadCacheSet thread_caches;
+// Set once thread_caches is destroyed; blocks freed by thread_local
+// destructors that run afterwards go straight to the global arena.
+thread_local bool thread_caches_destroyed = false;
+
+ThreadCacheSet::~ThreadCacheSet() {
+  std::lock_guard<std::mutex> guard(threadCacheRegistryMutex());
+  for (auto& cache : caches) {
+    cache->detach();
+  }
+  last = nullptr;
+  thread_caches_destroyed = true;
+}
+
+} // namespace
+
+SizeClassThreadCache* SizeClassCPUAllocator::threadCache() {
+  if (C10_UNLIKELY(thread_caches_destroyed)) {
+    return nullptr;
+  }
+  auto& set = thread_caches;
+  if (C10_LIKELY(set.last != nullptr && set.last->owner == this)) {
+    return set.last;
+  }
+  for (auto& cache : set.caches) {
+    if (cache->owner == this) {
+      set.last = cache.get();
+      return set.last;
+    }
+  }
+  set.caches.emplace_back(new SizeClassThreadCache(this));
+  set.last = set.caches.back().get();
+  std::lock_guard<std::mutex> guard(threadCacheRegistryMutex());
+  thread_caches_.push_back(set.last);
+  return set.last;
+}
+
+size_t SizeClassCPUAllocator::sizeClassIndex(size_t nbytes) {
+  if (nbytes <= (size_t(1) << kMinClassShift)) {
+    return 0;
+  }
+  // nbytes lies in (2^shift, 2^(shift + 1)], which is split into
+  // kSubClassesPerDoubling classes of 2^(shift - 2) bytes each.
+  const size_t shift = llvm::Log2_64(nbytes - 1);
+  const size_t step_shift = shift - 2;
+  const size_t sub =
+      (nbytes - (size_t(1) << shift) + (size_t(1) << step_shift) - 1) >>
+      step_shift;
+  return (shift - kMinClassShift) * kSubClassesPerDoubling + sub;
+}
+
+size_t SizeClassCPUAllocator::sizeClassBytes(size_t index) {
+  if (index == 0) {
+    return size_t(1) << kMinClassShift;
+  }
+  const size_t shift = (index - 1) / kSubClassesPerDoubling + kMinClassShift;
+  const size_t sub = (index - 1) % kSubClassesPerDoubling + 1;
+  return (size_t(1) << shift) + sub * (size_t(1) << (shift - 2));
+}
+
+SizeClassCPUAllocator::SizeClassCPUAllocator(
+    const SizeClassCPUAllocatorOptions& options) {
+  setOptions(options);
+}
+
+SizeClassCPUAllocator::~SizeClassCPUAllocator() {
+  {
+    // Destroying an allocator while other threads still use it is not
+    // supported, so their caches can be drained from here.
+    std::lock_guard<std::mutex> guard(threadCacheRegistryMutex());
+    for (auto* cache : thread_caches_) {
+      cache->flush();
+      cache->owner = nullptr;
+    }
+    thread_caches_.clear();
+  }
+  trimGlobal(0);
+}
+
+void SizeClassCPUAllocator::setOptions(
+    const SizeClassCPUAllocatorOptions& options) {
+  TORCH_CHECK(
+      options.trim_target_fraction >= 0 && options.trim_target_fraction <= 1,
+      "trim_target_fraction must be in [0, 1], got ",
+      options.trim_target_fraction);
+  TORCH_CHECK(
+      options.max_cached_block_size <=
+          sizeClassBytes(kNumSizeClasses - 1),
+      "max_cached_block_size must not exceed ",
+      sizeClassBytes(kNumSizeClasses - 1),
+      " bytes, got ",
+      options.max_cached_block_size);
+  options_ = options;
+}
+
+void SizeClassCPUAllocator::updatePeak(
+    std::atomic<size_t>& peak,
+    size_t value) {
+  size_t current = peak.load(std::memory_order_relaxed);
+  while (value > current &&
+         !peak.compare_exchange_weak(
+             current, value, std::memory_order_relaxed)) {
+  }
+}
+
+void* SizeClassCPUAllocator::allocateBlock(size_t nbytes) {
+  num_allocs_.fetch_add(1, std::memory_order_relaxed);
+  if (nbytes > options_.max_cached_block_size) {
+    cache_misses_.fetch_add(1, std::memory_order_relaxed);
+    void* base = alloc_cpu(kHeaderBytes + nbytes);
+    *headerOf(base) = {this, nbytes, nbytes, kUncachedClass, kBlockMagic};
+    updatePeak(peak_allocated_bytes_, allocated_bytes_ += nbytes);
+    return base;
+  }
+
+  const size_t index = sizeClassIndex(nbytes);
+  const size_t class_bytes = sizeClassBytes(index);
+  void* base = nullptr;
+
+  auto* cache = threadCache();
+  if (cache != nullptr && !cache->blocks[index].empty()) {
+    base = cache->blocks[index].back();
+    cache->blocks[index].pop_back();
+    cache->cached_bytes -= class_bytes;
+    thread_cache_hits_.fetch_add(1, std::memory_order_relaxed);
+  } else {
+    auto& bucket = buckets_[index];
+    std::lock_guard<std::mutex> guard(bucket.mutex);
+    if (!bucket.blocks.empty()) {
+      base = bucket.blocks.back();
+      bucket.blocks.pop_back();
+      global_cache_hits_.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  if (base != nullptr) {
+    cached_bytes_ -= class_bytes;
+    if (FLAGS_caffe2_cpu_allocator_do_zero_fill) {
+      memset(dataOf(base), 0, nbytes);
+    } else if (FLAGS_caffe2_cpu_allocator_do_junk_fill) {
+      memset_junk(dataOf(base), nbytes);
+    }
+  } else {
+    cache_misses_.fetch_add(1, std::memory_order_relaxed);
+    try {
+      base = alloc_cpu(kHeaderBytes + class_bytes);
+    } catch (c10::Error&) {
+      // Give the cached memory back to the system and try once more.
+      emptyCache();
+      base = alloc_cpu(kHeaderBytes + class_bytes);
+    }
+    *headerOf(base) = {
+        this, class_bytes, 0, static_cast<uint32_t>(index), kBlockMagic};
+  }
+  updatePeak(peak_allocated_bytes_, allocated_bytes_ += class_bytes);
+  return base;
+}
+
+bool SizeClassCPUAllocator::pushGlobal(void* base, size_t index) {
+  const size_t class_bytes = sizeClassBytes(index);
+  const size_t cap = options_.max_cached_bytes;
+  if (cached_bytes_.load(std::memory_order_relaxed) + class_bytes > cap) {
+    if (options_.trim_policy == SizeClassTrimPolicy::ReleaseFreed) {
+      return false;
+    }
+    trimGlobal(static_cast<size_t>(cap * options_.trim_target_fraction));
+    if (cached_bytes_.load(std::memory_order_relaxed) + class_bytes > cap) {
+      return false;
+    }
+  }
+  auto& bucket = buckets_[index];
+  {
+    std::lock_guard<std::mutex> guard(bucket.mutex);
+    bucket.blocks.push_back(base);
+  }
+  updatePeak(peak_cached_bytes_, cached_bytes_ += class_bytes);
+  return true;
+}
+
+void SizeClassCPUAllocator::releaseBlock(void* base) {
+  num_released_blocks_.fetch_add(1, std::memory_order_relaxed);
+  free_cpu(base);
+}
+
+void SizeClassCPUAllocator::trimGlobal(size_t target_bytes) {
+  for (size_t index = kNumSizeClasses; index-- > 0;) {
+    if (cached_bytes_.load(std::memory_order_relaxed) <= target_bytes) {
+      return;
+    }
+    auto& bucket = buckets_[index];
+    std::vector<void*> released;
+    {
+      std::lock_guard<std::mutex> guard(bucket.mutex);
+      if (bucket.blocks.empty()) {
+        continue;
+      }
+      const size_t class_bytes = sizeClassBytes(index);
+      while (!bucket.blocks.empty() &&
+             cached_bytes_.load(std::memory_order_relaxed) > target_bytes) {
+        released.push_back(bucket.blocks.back());
+        bucket.blocks.pop_back();
+        cached_bytes_ -= class_bytes;
+      }
+    }
+    for (void* base : released) {
+      releaseBlock(base);
+    }
+  }
+}
+
+void SizeClassCPUAllocator::freeBlock(void* base, uint32_t index) {
+  num_frees_.fetch_add(1, std::memory_order_relaxed);
+  if (index == kUncachedClass) {
+    allocated_bytes_ -= headerOf(base)->nbytes;
+    free_cpu(base);
+    return;
+  }
+  const size_t class_bytes = sizeClassBytes(index);
+  allocated_bytes_ -= class_bytes;
+
+  if (class_bytes <= options_.max_thread_cached_block_size) {
+    auto* cache = threadCache();
+    if (cache != nullptr &&
+        cache->cached_bytes + class_bytes <= options_.max_thread_cached_bytes &&
+        cached_bytes_.load(std::memory_order_relaxed) + class_bytes <=
+            options_.max_cached_bytes) {
+      cache->blocks[index].push_back(base);
+      cache->cached_bytes += class_bytes;
+      updatePeak(peak_cached_bytes_, cached_bytes_ += class_bytes);
+      return;
+    }
+  }
+  if (!pushGlobal(base, index)) {
+    releaseBlock(base);
+  }
+}
+
+void SizeClassCPUAllocator::Delete(void* ptr) {
+  if (!ptr) {
+    return;
+  }
+  void* base = baseOf(ptr);
+  auto* header = headerOf(base);
+  TORCH_INTERNAL_ASSERT(
+      header->magic == kBlockMagic,
+      "SizeClassCPUAllocator: freeing a pointer it did not allocate");
+  profiledCPUMemoryReporter().Delete(ptr, header->requested_bytes);
+  header->owner->freeBlock(base, header->size_class);
+}
+
+at::DataPtr SizeClassCPUAllocator::allocate(size_t nbytes) const {
+  if (nbytes == 0) {
+    return {nullptr, nullptr, &Delete, at::Device(at::DeviceType::CPU)};
+  }
+  // The caches are logically mutable state; allocate() is const in the
+  // Allocator interface.
+  void* base = const_cast<SizeClassCPUAllocator*>(this)->allocateBlock(nbytes);
+  headerOf(base)->requested_bytes = nbytes;
+  void* data = dataOf(base);
+  profiledCPUMemoryReporter().New(data, nbytes);
+  return {data, data, &Delete, at::Device(at::DeviceType::CPU)};
+}
+
+at::DeleterFnPtr SizeClassCPUAllocator::raw_deleter() const {
+  return &Delete;
+}
+
+SizeClassCPUAllocatorStats SizeClassCPUAllocator::stats() const {
+  SizeClassCPUAllocatorStats result;
+  result.num_allocs = num_allocs_.load(std::memory_order_relaxed);
+  result.num_frees = num_frees_.load(std::memory_order_relaxed);
+  result.thread_cache_hits = thread_cache_hits_.load(std::memory_order_relaxed);
+  result.global_cache_hits = global_cache_hits_.load(std::memory_order_relaxed);
+  result.cache_misses = cache_misses_.load(std::memory_order_relaxed);
+  result.num_released_blocks =
+      num_released_blocks_.load(std::memory_order_relaxed);
+  result.allocated_bytes = allocated_bytes_.load(std::memory_order_relaxed);
+  result.peak_allocated_bytes =
+      peak_allocated_bytes_.load(std::memory_order_relaxed);
+  result.cached_bytes = cached_bytes_.load(std::memory_order_relaxed);
+  result.peak_cached_bytes = peak_cached_bytes_.load(std::memory_order_relaxed);
+  return result;
+}
+
+void SizeClassCPUAllocator::resetPeakStats() {
+  peak_allocated_bytes_ = allocated_bytes_.load();
+  peak_cached_bytes_ = cached_bytes_.load();
+}
+
+void SizeClassCPUAllocator::emptyCache() {
+  auto* cache = threadCache();
+  if (cache != nullptr) {
+    cache->flush();
+  }
+  trimGlobal(0);
+}
+
+SizeClassCPUAllocator* GetSizeClassCPUAllocator() {
+  static auto* allocator = new SizeClassCPUAllocator();
+  return allocator;
+}
+
+void EnableSizeClassCPUAllocator(
+    const SizeClassCPUAllocatorOptions& options,
+    uint8_t priority) {
+  auto* allocator = GetSizeClassCPUAllocator();
+  allocator->setOptions(options);
+  SetCPUAllocator(allocator, priority);
+}
+
+} // namespace c10
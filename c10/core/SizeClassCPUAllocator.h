@@ -0,0 +1,171 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include <c10/core/CPUAllocator.h>
+
+/*
+ * SizeClassCPUAllocator:
+ * Why?
+ *    DefaultCPUAllocator calls posix_memalign/free for every tensor. Server
+ *    workloads that run many requests concurrently end up page-faulting
+ *    freshly mapped activations and contending on the libc allocator locks.
+ *    Unlike the mobile CPUCachingAllocator, this allocator is thread-safe,
+ *    does not need a scoped guard and can be installed process-wide.
+ * How?
+ *    Requests are rounded up to one of a fixed set of size classes (four
+ *    classes per power of two, starting at 64 bytes). Freed blocks are kept
+ *    in a per-thread cache first and spill into a global arena that has one
+ *    lock per size class. Allocation looks in the thread cache, then in the
+ *    global arena, and only then goes to alloc_cpu.
+ *    Every block carries a small header in front of the pointer handed out,
+ *    so data pointer and context stay identical and raw_allocate /
+ *    raw_deallocate keep working.
+ * Cons
+ *    Memory held in the caches is not returned to the system until the cap
+ *    is hit or emptyCache() is called, so RSS is higher than with the
+ *    default allocator.
+ *
+ * Usage:
+ *    Call once during initialization, before any tensor is allocated:
+ *      c10::SizeClassCPUAllocatorOptions options;
+ *      options.max_cached_bytes = 4ull << 30;
+ *      c10::EnableSizeClassCPUAllocator(options);
+ */
+
+namespace c10 {
+
+enum class SizeClassTrimPolicy : uint8_t {
+  // When a free would exceed max_cached_bytes, release only that block.
+  ReleaseFreed,
+  // When a free would exceed max_cached_bytes, release cached blocks from
+  // the global arena, largest size class first, until the cached bytes drop
+  // below trim_target_fraction * max_cached_bytes.
+  ReleaseLargest,
+};
+
+struct SizeClassCPUAllocatorOptions {
+  // Upper bound on the bytes held by all caches (global arena and threads).
+  size_t max_cached_bytes = size_t(1) << 30;
+  // Upper bound on the bytes held by a single thread cache. Blocks freed
+  // beyond it are handed over to the global arena.
+  size_t max_thread_cached_bytes = size_t(32) << 20;
+  // Requests larger than this are served by alloc_cpu and never cached.
+  size_t max_cached_block_size = size_t(256) << 20;
+  // Blocks larger than this skip the thread cache and go straight to the
+  // global arena, so large activations can be reused across threads.
+  size_t max_thread_cached_block_size = size_t(1) << 20;
+  SizeClassTrimPolicy trim_policy = SizeClassTrimPolicy::ReleaseLargest;
+  double trim_target_fraction = 0.75;
+};
+
+struct SizeClassCPUAllocatorStats {
+  uint64_t num_allocs = 0;
+  uint64_t num_frees = 0;
+  // Allocations served from the calling thread's cache.
+  uint64_t thread_cache_hits = 0;
+  // Allocations served from the global arena.
+  uint64_t global_cache_hits = 0;
+  // Allocations that had to go to alloc_cpu.
+  uint64_t cache_misses = 0;
+  // Blocks returned to the system because of the cap or emptyCache().
+  uint64_t num_released_blocks = 0;
+  // Bytes handed out and not yet freed, rounded up to the size class.
+  size_t allocated_bytes = 0;
+  size_t peak_allocated_bytes = 0;
+  // Bytes held by the caches.
+  size_t cached_bytes = 0;
+  size_t peak_cached_bytes = 0;
+};
+
+struct SizeClassThreadCache;
+
+class C10_API SizeClassCPUAllocator final : public at::Allocator {
+ public:
+  // Size classes go from 64 bytes to 2^kMaxClassShift bytes.
+  static constexpr size_t kMinClassShift = 6;
+  static constexpr size_t kMaxClassShift = 40;
+  static constexpr size_t kSubClassesPerDoubling = 4;
+  static constexpr size_t kNumSizeClasses =
+      (kMaxClassShift - kMinClassShift) * kSubClassesPerDoubling + 1;
+  // Size class of allocations that bypass the caches.
+  static constexpr uint32_t kUncachedClass = static_cast<uint32_t>(-1);
+
+  SizeClassCPUAllocator() = default;
+  explicit SizeClassCPUAllocator(const SizeClassCPUAllocatorOptions& options);
+  ~SizeClassCPUAllocator() override;
+
+  at::DataPtr allocate(size_t nbytes) const override;
+  at::DeleterFnPtr raw_deleter() const override;
+
+  // Not thread-safe: must be called before the allocator is in use.
+  void setOptions(const SizeClassCPUAllocatorOptions& options);
+  const SizeClassCPUAllocatorOptions& options() const {
+    return options_;
+  }
+
+  SizeClassCPUAllocatorStats stats() const;
+  void resetPeakStats();
+
+  // Returns every block held by the global arena and by the calling thread's
+  // cache to the system. Blocks cached by other threads are released when
+  // those threads exit or call emptyCache() themselves.
+  void emptyCache();
+
+  // Size class helpers, exposed for testing.
+  static size_t sizeClassIndex(size_t nbytes);
+  static size_t sizeClassBytes(size_t index);
+
+ private:
+  friend struct SizeClassThreadCache;
+
+  struct SizeClassBucket {
+    std::mutex mutex;
+    std::vector<void*> blocks;
+  };
+
+  SizeClassThreadCache* threadCache();
+  void* allocateBlock(size_t nbytes);
+  void freeBlock(void* base, uint32_t index);
+  bool pushGlobal(void* base, size_t index);
+  void releaseBlock(void* base);
+  void trimGlobal(size_t target_bytes);
+  void updatePeak(std::atomic<size_t>& peak, size_t value);
+
+  static void Delete(void* ptr);
+
+  SizeClassCPUAllocatorOptions options_;
+  SizeClassBucket buckets_[kNumSizeClasses];
+  // Thread caches holding blocks of this allocator. Guarded by a process-wide
+  // registry mutex, since thread caches may outlive the allocator.
+  std::vector<SizeClassThreadCache*> thread_caches_;
+
+  std::atomic<uint64_t> num_allocs_{0};
+  std::atomic<uint64_t> num_frees_{0};
+  std::atomic<uint64_t> thread_cache_hits_{0};
+  std::atomic<uint64_t> global_cache_hits_{0};
+  std::atomic<uint64_t> cache_misses_{0};
+  std::atomic<uint64_t> num_released_blocks_{0};
+  std::atomic<size_t> allocated_bytes_{0};
+  std::atomic<size_t> peak_allocated_bytes_{0};
+  std::atomic<size_t> cached_bytes_{0};
+  std::atomic<size_t> peak_cached_bytes_{0};
+};
+
+// Get the process-wide SizeClassCPUAllocator. It is never destroyed, so
+// blocks freed during static destruction are still handled correctly.
+C10_API SizeClassCPUAllocator* GetSizeClassCPUAllocator();
+
+// Configures the process-wide SizeClassCPUAllocator and installs it as the
+// CPU allocator through SetCPUAllocator. Like SetCPUAllocator, this is not
+// thread-safe and should only be called during initialization.
+C10_API void EnableSizeClassCPUAllocator(
+    const SizeClassCPUAllocatorOptions& options =
+        SizeClassCPUAllocatorOptions(),
+    uint8_t priority = 0);
+
+} // namespace c10
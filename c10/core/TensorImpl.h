@@ -437,6 +437,11 @@ struct C10_API TensorImpl : public c10::intrusive_ptr_target {
            key_set_.has(DispatchKey::SparseHIP);
   }
 
+  bool is_sparse_csr() const {
+    // NB: This method is not virtual and avoid dispatches for performance reasons.
+    return key_set_.has(DispatchKey::SparseCsrCPU);
+  }
+
   bool is_quantized() const {
     // NB: This method is not virtual and avoid dispatches for performance reasons.
     return key_set_.has(DispatchKey::QuantizedCPU) ||
@@ -501,6 +506,8 @@ struct C10_API TensorImpl : public c10::intrusive_ptr_target {
     // NB: This method is not virtual and avoid dispatches for perf.
     if (is_sparse()) {
       return kSparse;
+    } else if (is_sparse_csr()) {
+      return kSparseCsr;
     } else if (is_mkldnn()) {
       return kMkldnn;
     } else {
@@ -1,16 +1,36 @@
 #include <c10/core/thread_pool.h>
 
+#include <c10/util/Flags.h>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || \
+    defined(_M_IX86)
+#include <immintrin.h>
+#define C10_THREAD_POOL_PAUSE() _mm_pause()
+#else
+#define C10_THREAD_POOL_PAUSE()
+#endif
+
+C10_DEFINE_int(
+    caffe2_thread_pool_spin_iterations,
+    1024,
+    "Number of times an idle c10::ThreadPool worker polls for new tasks "
+    "before it goes to sleep. 0 makes idle workers sleep right away.");
+
 namespace c10 {
 
+constexpr std::size_t ThreadPool::kQueueCapacity;
+
 ThreadPool::ThreadPool(
       int pool_size,
       int numa_node_id,
       std::function<void()> init_thread)
-    : threads_(pool_size < 0 ? defaultNumThreads() : pool_size),
+    : tasks_(kQueueCapacity),
+      num_overflow_tasks_(0),
+      threads_(pool_size < 0 ? defaultNumThreads() : pool_size),
       running_(true),
-      complete_(true),
+      pending_(0),
       available_(threads_.size()),
-      total_(threads_.size()),
+      num_sleeping_(0),
       numa_node_id_(numa_node_id) {
   for (std::size_t i = 0; i < threads_.size(); ++i) {
     threads_[i] = std::thread([this, i, init_thread](){
@@ -43,7 +63,7 @@ size_t ThreadPool::size() const {
 }
 
 size_t ThreadPool::numAvailable() const {
-  return available_;
+  return available_.load();
 }
 
 bool ThreadPool::inThreadPool() const {
@@ -59,75 +79,101 @@ void ThreadPool::run(std::function<void()> func) {
   if (threads_.size() == 0) {
     throw std::runtime_error("No threads to run a task");
   }
-  std::unique_lock<std::mutex> lock(mutex_);
+  enqueue(task_element_t(std::move(func)));
+}
+
+void ThreadPool::enqueue(task_element_t&& task) {
+  ++pending_;
+  if (!tasks_.try_push(std::move(task))) {
+    std::lock_guard<std::mutex> guard(overflow_mutex_);
+    overflow_tasks_.push(std::move(task));
+    ++num_overflow_tasks_;
+  }
+  // Pairs with the fence in main_loop: either a parking worker sees the new
+  // task, or we see that it's parked and wake it up.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (num_sleeping_.load(std::memory_order_relaxed) > 0) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    condition_.notify_one();
+  }
+}
 
-  // Set task and signal condition variable so that a worker thread will
-  // wake up and use the task.
-  tasks_.emplace(std::move(func));
-  complete_ = false;
-  condition_.notify_one();
+bool ThreadPool::try_dequeue(task_element_t& task) {
+  if (tasks_.try_pop(task)) {
+    return true;
+  }
+  if (num_overflow_tasks_.load() == 0) {
+    return false;
+  }
+  std::lock_guard<std::mutex> guard(overflow_mutex_);
+  if (overflow_tasks_.empty()) {
+    return false;
+  }
+  task = std::move(overflow_tasks_.front());
+  overflow_tasks_.pop();
+  --num_overflow_tasks_;
+  return true;
 }
 
 void ThreadPool::waitWorkComplete() {
   std::unique_lock<std::mutex> lock(mutex_);
-  while (!complete_) {
-    completed_.wait(lock);
-  }
+  completed_.wait(lock, [this]() { return pending_.load() == 0; });
 }
 
 void ThreadPool::main_loop(std::size_t index) {
-  std::unique_lock<std::mutex> lock(mutex_);
+  const int spin_iterations = FLAGS_caffe2_thread_pool_spin_iterations;
   while (running_) {
-    // Wait on condition variable while the task is empty and
-    // the pool is still running.
-    while (tasks_.empty() && running_) {
-      condition_.wait(lock);
+    // The task is a local of the loop body so that it's destructed right
+    // after running. This is useful in the event that the function contains
+    // shared_ptr arguments bound via bind.
+    task_element_t tasks;
+    bool found = try_dequeue(tasks);
+    for (int i = 0; !found && i < spin_iterations && running_; ++i) {
+      if ((i + 1) % 64 == 0) {
+        std::this_thread::yield();
+      } else {
+        C10_THREAD_POOL_PAUSE();
+      }
+      found = try_dequeue(tasks);
+    }
+
+    if (!found) {
+      std::unique_lock<std::mutex> lock(mutex_);
+      ++num_sleeping_;
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      // Wait on condition variable while there is no task and the pool is
+      // still running.
+      while (running_ && !(found = try_dequeue(tasks))) {
+        condition_.wait(lock);
+      }
+      --num_sleeping_;
     }
     // If pool is no longer running, break out of loop.
     if (!running_) {
       break;
     }
 
-    // Copy task locally and remove from the queue.  This is
-    // done within its own scope so that the task object is
-    // destructed immediately after running the task.  This is
-    // useful in the event that the function contains
-    // shared_ptr arguments bound via bind.
-    {
-      task_element_t tasks = std::move(tasks_.front());
-      tasks_.pop();
-      // Decrement count, indicating thread is no longer available.
-      --available_;
-
-      lock.unlock();
-
-      // Run the task.
-      try {
-        if (tasks.run_with_id) {
-          tasks.with_id(index);
-        } else {
-          tasks.no_id();
-        }
-      } catch (const std::exception& e) {
-        LOG(ERROR) << "Exception in thread pool task: " << e.what();
-      } catch (...) {
-        LOG(ERROR) << "Exception in thread pool task: unknown";
-      }
-
-      // Update status of empty, maybe
-      // Need to recover the lock first
-      lock.lock();
+    // Decrement count, indicating thread is no longer available.
+    --available_;
 
-      // Increment count, indicating thread is available.
-      ++available_;
-      if (tasks_.empty() && available_ == total_) {
-        complete_ = true;
-        completed_.notify_one();
+    // Run the task.
+    try {
+      if (tasks.run_with_id) {
+        tasks.with_id(index);
+      } else {
+        tasks.no_id();
       }
+    } catch (const std::exception& e) {
+      LOG(ERROR) << "Exception in thread pool task: " << e.what();
+    } catch (...) {
+      LOG(ERROR) << "Exception in thread pool task: unknown";
+    }
 
-      // Deliberately hold the lock on the backedge, so this thread has an
-      // opportunity to acquire a new task before another thread acquires
-      // the lock.
+    // Increment count, indicating thread is available.
+    ++available_;
+    if (--pending_ == 0) {
+      std::lock_guard<std::mutex> guard(mutex_);
+      completed_.notify_all();
     }
   } // while running_
 }
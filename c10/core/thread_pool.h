@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <condition_variable>
 #include <functional>
 #include <mutex>
@@ -7,6 +8,7 @@
 #include <thread>
 #include <utility>
 
+#include <c10/util/MPMCQueue.h>
 #include <c10/util/Optional.h>
 #include <c10/util/intrusive_ptr.h>
 #include <c10/util/numa.h>
@@ -42,28 +44,43 @@ class C10_API TaskThreadPoolBase {
   }
 };
 
+// ThreadPool hands tasks to its workers through a bounded lock-free queue, so
+// submitting a task doesn't take a lock while the workers are busy. Tasks
+// that don't fit into the queue go to an unbounded, mutex-protected overflow
+// queue instead. A worker that runs out of tasks spins for a while
+// (--caffe2_thread_pool_spin_iterations) before it parks on a condition
+// variable; submitters only touch the mutex when a worker is parked.
 class C10_API ThreadPool : public c10::TaskThreadPoolBase {
  protected:
   struct task_element_t {
     bool run_with_id;
-    const std::function<void()> no_id;
-    const std::function<void(std::size_t)> with_id;
+    std::function<void()> no_id;
+    std::function<void(std::size_t)> with_id;
 
+    task_element_t() : run_with_id(false), no_id(nullptr), with_id(nullptr) {}
     explicit task_element_t(std::function<void()> f)
       : run_with_id(false), no_id(std::move(f)), with_id(nullptr) {}
     explicit task_element_t(std::function<void(std::size_t)> f)
       : run_with_id(true), no_id(nullptr), with_id(std::move(f)) {}
   };
 
-  std::queue<task_element_t> tasks_;
+  static constexpr std::size_t kQueueCapacity = 4096;
+
+  MPMCQueue<task_element_t> tasks_;
+  // Tasks submitted while tasks_ was full
+  std::queue<task_element_t> overflow_tasks_;
+  std::mutex overflow_mutex_;
+  std::atomic<std::size_t> num_overflow_tasks_;
   std::vector<std::thread> threads_;
+  // Guards parking and waking up workers and waitWorkComplete
   std::mutex mutex_;
   std::condition_variable condition_;
   std::condition_variable completed_;
   std::atomic_bool running_;
-  bool complete_;
-  std::size_t available_;
-  std::size_t total_;
+  // Tasks submitted but not finished yet
+  std::atomic<std::size_t> pending_;
+  std::atomic<std::size_t> available_;
+  std::atomic<std::size_t> num_sleeping_;
   int numa_node_id_;
 
  public:
@@ -86,19 +103,17 @@ class C10_API ThreadPool : public c10::TaskThreadPoolBase {
 
   template <typename Task>
   void runTaskWithID(Task task) {
-    std::unique_lock<std::mutex> lock(mutex_);
-
-    // Set task and signal condition variable so that a worker thread will
-    // wake up and use the task.
-    tasks_.emplace(static_cast<std::function<void(std::size_t)>>(task));
-    complete_ = false;
-    condition_.notify_one();
+    enqueue(task_element_t(static_cast<std::function<void(std::size_t)>>(task)));
   }
 
   /// @brief Wait for queue to be empty
   void waitWorkComplete();
 
  private:
+  void enqueue(task_element_t&& task);
+
+  bool try_dequeue(task_element_t& task);
+
   // @brief Entry point for pool threads.
   void main_loop(std::size_t index);
 };
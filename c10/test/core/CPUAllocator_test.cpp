@@ -0,0 +1,164 @@
+#include <gtest/gtest.h>
+
+#include <thread>
+
+#include <c10/core/CPUAllocator.h>
+
+using namespace c10;
+
+namespace {
+void* fakePtr(uintptr_t i) {
+  return reinterpret_cast<void*>(i * gAlignment);
+}
+
+class ProfiledCPUMemoryReporterTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    saved_ = FLAGS_caffe2_cpu_allocator_track_allocations;
+    FLAGS_caffe2_cpu_allocator_track_allocations = true;
+  }
+  void TearDown() override {
+    FLAGS_caffe2_cpu_allocator_track_allocations = saved_;
+  }
+
+ private:
+  bool saved_ = false;
+};
+} // namespace
+
+TEST_F(ProfiledCPUMemoryReporterTest, SizeBuckets) {
+  ASSERT_EQ(CPUMemoryStats::sizeBucket(1), 0);
+  ASSERT_EQ(CPUMemoryStats::sizeBucket(64), 0);
+  ASSERT_EQ(CPUMemoryStats::sizeBucket(65), 1);
+  ASSERT_EQ(CPUMemoryStats::sizeBucket(128), 1);
+  ASSERT_EQ(CPUMemoryStats::sizeBucket(4096), 6);
+  ASSERT_EQ(
+      CPUMemoryStats::sizeBucket(std::numeric_limits<size_t>::max()),
+      CPUMemoryStats::kNumSizeBuckets - 1);
+}
+
+TEST_F(ProfiledCPUMemoryReporterTest, Stats) {
+  ProfiledCPUMemoryReporter reporter;
+  reporter.New(fakePtr(1), 100);
+  reporter.New(fakePtr(2), 4000);
+  reporter.Delete(fakePtr(1), 100);
+
+  auto stats = reporter.stats();
+  ASSERT_EQ(stats.num_allocs, 2);
+  ASSERT_EQ(stats.num_frees, 1);
+  ASSERT_EQ(stats.allocated_bytes, 4000);
+  ASSERT_EQ(stats.peak_allocated_bytes, 4100);
+  ASSERT_EQ(stats.total_allocated_bytes, 4100);
+  ASSERT_EQ(stats.size_histogram[1], 1);
+  ASSERT_EQ(stats.size_histogram[6], 1);
+  ASSERT_EQ(stats.threads.size(), 1);
+  ASSERT_EQ(stats.threads[0].thread_id, std::this_thread::get_id());
+  ASSERT_EQ(stats.threads[0].total_freed_bytes, 100);
+
+  reporter.resetPeakStats();
+  ASSERT_EQ(reporter.stats().peak_allocated_bytes, 4000);
+  reporter.Delete(fakePtr(2), 4000);
+  ASSERT_EQ(reporter.stats().allocated_bytes, 0);
+}
+
+TEST_F(ProfiledCPUMemoryReporterTest, PerThreadCounters) {
+  ProfiledCPUMemoryReporter reporter;
+  reporter.New(fakePtr(2), 20);
+  std::thread other([&]() {
+    reporter.New(fakePtr(1), 10);
+    ASSERT_EQ(reporter.stats().threads.size(), 2);
+  });
+  other.join();
+  reporter.Delete(fakePtr(1), 10);
+
+  // The counters of the exited thread moved to the entry after the live ones
+  auto stats = reporter.stats();
+  ASSERT_EQ(stats.threads.size(), 2);
+  ASSERT_EQ(stats.threads[0].thread_id, std::this_thread::get_id());
+  ASSERT_EQ(stats.threads[0].num_allocs, 1);
+  ASSERT_EQ(stats.threads[0].num_frees, 1);
+  ASSERT_EQ(stats.threads[1].thread_id, std::thread::id());
+  ASSERT_EQ(stats.threads[1].num_allocs, 1);
+  ASSERT_EQ(stats.threads[1].num_frees, 0);
+  ASSERT_EQ(stats.num_allocs, 2);
+  ASSERT_EQ(stats.size_histogram[0], 2);
+}
+
+TEST_F(ProfiledCPUMemoryReporterTest, ExitedThreadsAreFolded) {
+  ProfiledCPUMemoryReporter reporter;
+  for (int i = 0; i < 10; i++) {
+    std::thread([&]() {
+      reporter.New(fakePtr(1), 10);
+      reporter.Delete(fakePtr(1), 10);
+    }).join();
+  }
+
+  auto stats = reporter.stats();
+  ASSERT_EQ(stats.threads.size(), 1);
+  ASSERT_EQ(stats.threads[0].thread_id, std::thread::id());
+  ASSERT_EQ(stats.threads[0].num_allocs, 10);
+  ASSERT_EQ(stats.threads[0].num_frees, 10);
+  ASSERT_EQ(stats.threads[0].total_freed_bytes, 100);
+  ASSERT_EQ(stats.allocated_bytes, 0);
+  ASSERT_EQ(stats.peak_allocated_bytes, 10);
+}
+
+TEST_F(ProfiledCPUMemoryReporterTest, LiveAllocations) {
+  ProfiledCPUMemoryReporter reporter;
+  reporter.New(fakePtr(1), 10);
+  reporter.New(fakePtr(2), 30);
+  reporter.New(fakePtr(3), 20);
+
+  auto records = reporter.liveAllocations(std::chrono::milliseconds(0), 2);
+  ASSERT_EQ(records.size(), 2);
+  ASSERT_EQ(records[0].ptr, fakePtr(2));
+  ASSERT_EQ(records[1].ptr, fakePtr(3));
+  ASSERT_TRUE(records[0].backtrace.empty());
+  ASSERT_TRUE(
+      reporter.liveAllocations(std::chrono::milliseconds(60 * 1000)).empty());
+
+  std::string report = reporter.report();
+  ASSERT_NE(report.find("3 live allocations"), std::string::npos);
+}
+
+TEST_F(ProfiledCPUMemoryReporterTest, DefaultAllocatorReports) {
+  auto before = profiledCPUMemoryReporter().stats();
+  {
+    auto ptr = GetDefaultCPUAllocator()->allocate(1000);
+    auto during = profiledCPUMemoryReporter().stats();
+    ASSERT_EQ(during.num_allocs, before.num_allocs + 1);
+    ASSERT_GE(during.allocated_bytes, 1000);
+  }
+  auto after = profiledCPUMemoryReporter().stats();
+  ASSERT_EQ(after.num_frees, before.num_frees + 1);
+}
+
+TEST(ProfiledCPUMemoryReporterUntrackedTest, CountersWithoutTable) {
+  ASSERT_FALSE(FLAGS_caffe2_cpu_allocator_track_allocations);
+  ProfiledCPUMemoryReporter reporter;
+  reporter.New(fakePtr(1), 100);
+  ASSERT_TRUE(reporter.liveAllocations().empty());
+  reporter.Delete(fakePtr(1), 100);
+
+  auto stats = reporter.stats();
+  ASSERT_EQ(stats.num_allocs, 1);
+  ASSERT_EQ(stats.num_frees, 1);
+  ASSERT_EQ(stats.allocated_bytes, 0);
+  ASSERT_EQ(stats.peak_allocated_bytes, 100);
+  ASSERT_EQ(stats.size_histogram[1], 1);
+  ASSERT_EQ(stats.threads.size(), 1);
+}
+
+TEST(ProfiledCPUMemoryReporterUntrackedTest, DefaultAllocatorReportsSize) {
+  auto before = profiledCPUMemoryReporter().stats();
+  {
+    auto ptr = GetDefaultCPUAllocator()->allocate(1000);
+    ASSERT_EQ(reinterpret_cast<uintptr_t>(ptr.get()) % gAlignment, 0);
+    ASSERT_EQ(ptr.get(), ptr.get_context());
+  }
+  auto after = profiledCPUMemoryReporter().stats();
+  ASSERT_EQ(after.num_allocs, before.num_allocs + 1);
+  ASSERT_EQ(after.num_frees, before.num_frees + 1);
+  // The free reported the size of the allocation
+  ASSERT_EQ(after.allocated_bytes, before.allocated_bytes);
+}
@@ -0,0 +1,162 @@
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+#include <c10/core/SizeClassCPUAllocator.h>
+
+using namespace c10;
+
+TEST(SizeClassCPUAllocatorTest, SizeClasses) {
+  ASSERT_EQ(SizeClassCPUAllocator::sizeClassIndex(1), 0);
+  ASSERT_EQ(SizeClassCPUAllocator::sizeClassIndex(64), 0);
+  ASSERT_EQ(SizeClassCPUAllocator::sizeClassIndex(65), 1);
+  ASSERT_EQ(SizeClassCPUAllocator::sizeClassBytes(1), 80);
+  ASSERT_EQ(SizeClassCPUAllocator::sizeClassBytes(4), 128);
+  ASSERT_EQ(SizeClassCPUAllocator::sizeClassBytes(5), 160);
+  size_t prev = 0;
+  for (size_t index = 0; index < SizeClassCPUAllocator::kNumSizeClasses;
+       ++index) {
+    const size_t bytes = SizeClassCPUAllocator::sizeClassBytes(index);
+    ASSERT_GT(bytes, prev);
+    ASSERT_EQ(SizeClassCPUAllocator::sizeClassIndex(bytes), index);
+    ASSERT_EQ(SizeClassCPUAllocator::sizeClassIndex(prev + 1), index);
+    prev = bytes;
+  }
+}
+
+TEST(SizeClassCPUAllocatorTest, ReusesFreedBlocks) {
+  SizeClassCPUAllocator allocator;
+  void* first = nullptr;
+  {
+    auto ptr = allocator.allocate(1000);
+    first = ptr.get();
+    ASSERT_EQ(reinterpret_cast<uintptr_t>(first) % gAlignment, 0);
+    ASSERT_EQ(ptr.get(), ptr.get_context());
+  }
+  // 1000 and 1020 bytes fall into the same size class.
+  auto ptr = allocator.allocate(1020);
+  ASSERT_EQ(ptr.get(), first);
+  auto stats = allocator.stats();
+  ASSERT_EQ(stats.num_allocs, 2);
+  ASSERT_EQ(stats.num_frees, 1);
+  ASSERT_EQ(stats.thread_cache_hits, 1);
+  ASSERT_EQ(stats.cache_misses, 1);
+  ASSERT_EQ(stats.allocated_bytes, 1024);
+  ASSERT_EQ(stats.cached_bytes, 0);
+}
+
+TEST(SizeClassCPUAllocatorTest, RawInterface) {
+  SizeClassCPUAllocator allocator;
+  void* ptr = allocator.raw_allocate(4096);
+  ASSERT_NE(ptr, nullptr);
+  allocator.raw_deallocate(ptr);
+  ASSERT_EQ(allocator.stats().cached_bytes, 4096);
+}
+
+TEST(SizeClassCPUAllocatorTest, SharesLargeBlocksAcrossThreads) {
+  SizeClassCPUAllocatorOptions options;
+  options.max_thread_cached_block_size = 1024;
+  SizeClassCPUAllocator allocator(options);
+  void* freed = nullptr;
+  std::thread producer([&]() {
+    auto ptr = allocator.allocate(1 << 16);
+    freed = ptr.get();
+  });
+  producer.join();
+  auto ptr = allocator.allocate(1 << 16);
+  ASSERT_EQ(ptr.get(), freed);
+  ASSERT_EQ(allocator.stats().global_cache_hits, 1);
+}
+
+TEST(SizeClassCPUAllocatorTest, ThreadExitFlushesCache) {
+  SizeClassCPUAllocator allocator;
+  std::thread worker([&]() { allocator.allocate(256); });
+  worker.join();
+  auto stats = allocator.stats();
+  ASSERT_EQ(stats.cached_bytes, 256);
+  auto ptr = allocator.allocate(256);
+  ASSERT_EQ(allocator.stats().global_cache_hits, 1);
+}
+
+TEST(SizeClassCPUAllocatorTest, RespectsCap) {
+  SizeClassCPUAllocatorOptions options;
+  options.max_cached_bytes = 4096;
+  options.trim_policy = SizeClassTrimPolicy::ReleaseFreed;
+  SizeClassCPUAllocator allocator(options);
+  {
+    std::vector<DataPtr> ptrs;
+    for (int i = 0; i < 8; ++i) {
+      ptrs.push_back(allocator.allocate(1024));
+    }
+  }
+  auto stats = allocator.stats();
+  ASSERT_EQ(stats.cached_bytes, 4096);
+  ASSERT_EQ(stats.num_released_blocks, 4);
+  ASSERT_EQ(stats.allocated_bytes, 0);
+  ASSERT_EQ(stats.peak_allocated_bytes, 8 * 1024);
+}
+
+TEST(SizeClassCPUAllocatorTest, TrimsLargestFirst) {
+  SizeClassCPUAllocatorOptions options;
+  options.max_cached_bytes = 1 << 20;
+  options.max_thread_cached_block_size = 0;
+  options.trim_policy = SizeClassTrimPolicy::ReleaseLargest;
+  options.trim_target_fraction = 0.5;
+  SizeClassCPUAllocator allocator(options);
+  auto live = allocator.allocate(1 << 19);
+  allocator.allocate(1 << 19);
+  allocator.allocate(1 << 10);
+  ASSERT_EQ(allocator.stats().cached_bytes, (1 << 19) + (1 << 10));
+  // Caching this block exceeds the cap, so the cached 512KB block is
+  // released to get below half of the cap.
+  live.clear();
+  auto stats = allocator.stats();
+  ASSERT_EQ(stats.num_released_blocks, 1);
+  ASSERT_EQ(stats.cached_bytes, (1 << 19) + (1 << 10));
+}
+
+TEST(SizeClassCPUAllocatorTest, BypassesCacheForHugeBlocks) {
+  SizeClassCPUAllocatorOptions options;
+  options.max_cached_block_size = 1 << 12;
+  SizeClassCPUAllocator allocator(options);
+  allocator.allocate((1 << 12) + 1);
+  auto stats = allocator.stats();
+  ASSERT_EQ(stats.cached_bytes, 0);
+  ASSERT_EQ(stats.allocated_bytes, 0);
+  ASSERT_EQ(stats.peak_allocated_bytes, (1 << 12) + 1);
+}
+
+TEST(SizeClassCPUAllocatorTest, EmptyCache) {
+  SizeClassCPUAllocator allocator;
+  allocator.allocate(100);
+  allocator.allocate(1 << 21);
+  ASSERT_GT(allocator.stats().cached_bytes, 0);
+  allocator.emptyCache();
+  auto stats = allocator.stats();
+  ASSERT_EQ(stats.cached_bytes, 0);
+  ASSERT_EQ(stats.num_released_blocks, 2);
+}
+
+TEST(SizeClassCPUAllocatorTest, ConcurrentAllocations) {
+  SizeClassCPUAllocator allocator;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 8; ++t) {
+    threads.emplace_back([&allocator, t]() {
+      std::vector<DataPtr> live;
+      for (int i = 0; i < 1000; ++i) {
+        live.push_back(allocator.allocate(64 + (i * 37 + t) % 5000));
+        if (live.size() > 16) {
+          live.erase(live.begin());
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  auto stats = allocator.stats();
+  ASSERT_EQ(stats.num_allocs, 8000);
+  ASSERT_EQ(stats.num_frees, 8000);
+  ASSERT_EQ(stats.allocated_bytes, 0);
+}
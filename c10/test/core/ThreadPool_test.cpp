@@ -0,0 +1,60 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+
+#include <c10/core/thread_pool.h>
+
+using namespace c10;
+
+TEST(ThreadPoolTest, RunsAllTasks) {
+  ThreadPool pool(4);
+  std::atomic<int> count{0};
+  // More tasks than fit into the lock-free queue
+  const int num_tasks = 3 * 4096;
+  for (int i = 0; i < num_tasks; ++i) {
+    pool.run([&count]() { ++count; });
+  }
+  pool.waitWorkComplete();
+  ASSERT_EQ(count.load(), num_tasks);
+  ASSERT_EQ(pool.numAvailable(), 4);
+}
+
+TEST(ThreadPoolTest, RunTaskWithID) {
+  ThreadPool pool(3);
+  std::atomic<int> bad_ids{0};
+  std::atomic<int> count{0};
+  for (int i = 0; i < 100; ++i) {
+    pool.runTaskWithID([&](std::size_t id) {
+      if (id >= 3) {
+        ++bad_ids;
+      }
+      ++count;
+    });
+  }
+  pool.waitWorkComplete();
+  ASSERT_EQ(count.load(), 100);
+  ASSERT_EQ(bad_ids.load(), 0);
+}
+
+TEST(ThreadPoolTest, WakesUpParkedWorkers) {
+  ThreadPool pool(2);
+  std::atomic<int> count{0};
+  for (int round = 0; round < 5; ++round) {
+    // Give the workers time to stop spinning and park.
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    pool.run([&count]() { ++count; });
+    pool.waitWorkComplete();
+    ASSERT_EQ(count.load(), round + 1);
+  }
+}
+
+TEST(ThreadPoolTest, SurvivesThrowingTasks) {
+  ThreadPool pool(2);
+  std::atomic<int> count{0};
+  for (int i = 0; i < 10; ++i) {
+    pool.run([]() { throw std::runtime_error("expected"); });
+    pool.run([&count]() { ++count; });
+  }
+  pool.waitWorkComplete();
+  ASSERT_EQ(count.load(), 10);
+}
@@ -0,0 +1,82 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <c10/util/MPMCQueue.h>
+
+using c10::MPMCQueue;
+
+TEST(MPMCQueueTest, FifoAndCapacity) {
+  MPMCQueue<int> queue(5);
+  ASSERT_EQ(queue.capacity(), 8);
+  for (int i = 0; i < 8; ++i) {
+    ASSERT_TRUE(queue.try_emplace(i));
+  }
+  ASSERT_FALSE(queue.try_emplace(8));
+  ASSERT_EQ(queue.size_approx(), 8);
+  int value = -1;
+  for (int i = 0; i < 8; ++i) {
+    ASSERT_TRUE(queue.try_pop(value));
+    ASSERT_EQ(value, i);
+  }
+  ASSERT_FALSE(queue.try_pop(value));
+  ASSERT_EQ(queue.size_approx(), 0);
+}
+
+TEST(MPMCQueueTest, FailedPushKeepsValue) {
+  MPMCQueue<std::unique_ptr<int>> queue(1);
+  ASSERT_TRUE(queue.try_push(std::make_unique<int>(1)));
+  ASSERT_TRUE(queue.try_push(std::make_unique<int>(2)));
+  auto value = std::make_unique<int>(3);
+  ASSERT_FALSE(queue.try_push(std::move(value)));
+  ASSERT_NE(value, nullptr);
+}
+
+TEST(MPMCQueueTest, DestroysRemainingElements) {
+  auto counted = std::make_shared<int>(0);
+  {
+    MPMCQueue<std::shared_ptr<int>> queue(4);
+    queue.try_emplace(counted);
+    queue.try_emplace(counted);
+    ASSERT_EQ(counted.use_count(), 3);
+  }
+  ASSERT_EQ(counted.use_count(), 1);
+}
+
+TEST(MPMCQueueTest, ManyProducersAndConsumers) {
+  constexpr int kThreads = 4;
+  constexpr int kPerThread = 20000;
+  MPMCQueue<int> queue(64);
+  std::atomic<int64_t> sum{0};
+  std::atomic<int> popped{0};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&, t]() {
+      for (int i = 0; i < kPerThread; ++i) {
+        while (!queue.try_emplace(t * kPerThread + i)) {
+          std::this_thread::yield();
+        }
+      }
+    });
+    threads.emplace_back([&]() {
+      int value;
+      while (popped.load() < kThreads * kPerThread) {
+        if (queue.try_pop(value)) {
+          sum += value;
+          ++popped;
+        } else {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  const int64_t n = kThreads * kPerThread;
+  ASSERT_EQ(popped.load(), n);
+  ASSERT_EQ(sum.load(), n * (n - 1) / 2);
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include <c10/util/Exception.h>
+
+namespace c10 {
+
+/**
+ * MPMCQueue is a bounded lock-free queue for any number of producers and
+ * consumers (D. Vyukov's bounded MPMC queue).
+ *
+ * Every cell carries a sequence number that tells producers and consumers
+ * whose turn it is, so a push or pop only needs one compare-and-swap on the
+ * shared position plus the store of the cell's sequence number. Neither
+ * operation ever blocks: try_emplace fails when the queue is full and
+ * try_pop fails when it is empty. Elements come out in the order their
+ * pushes reserved cells.
+ */
+template <typename T>
+class MPMCQueue {
+ public:
+  // The capacity is rounded up to a power of two.
+  explicit MPMCQueue(size_t capacity) {
+    TORCH_CHECK(capacity > 0, "MPMCQueue capacity must be positive");
+    size_t rounded = 2;
+    while (rounded < capacity) {
+      rounded *= 2;
+    }
+    mask_ = rounded - 1;
+    cells_.reset(new Cell[rounded]);
+    for (size_t i = 0; i < rounded; ++i) {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  ~MPMCQueue() {
+    T value;
+    while (try_pop(value)) {
+    }
+  }
+
+  MPMCQueue(const MPMCQueue&) = delete;
+  MPMCQueue& operator=(const MPMCQueue&) = delete;
+
+  size_t capacity() const {
+    return mask_ + 1;
+  }
+
+  // Constructs an element in place. Returns false, without touching args,
+  // if the queue is full.
+  template <typename... Args>
+  bool try_emplace(Args&&... args) {
+    size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    Cell* cell;
+    while (true) {
+      cell = &cells_[pos & mask_];
+      size_t seq = cell->sequence.load(std::memory_order_acquire);
+      auto diff = static_cast<std::ptrdiff_t>(seq - pos);
+      if (diff == 0) {
+        if (enqueue_pos_.compare_exchange_weak(
+                pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    new (&cell->storage) T(std::forward<Args>(args)...);
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool try_push(T&& value) {
+    return try_emplace(std::move(value));
+  }
+
+  // Moves the oldest element into out. Returns false if the queue is empty.
+  bool try_pop(T& out) {
+    size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+    Cell* cell;
+    while (true) {
+      cell = &cells_[pos & mask_];
+      size_t seq = cell->sequence.load(std::memory_order_acquire);
+      auto diff = static_cast<std::ptrdiff_t>(seq - (pos + 1));
+      if (diff == 0) {
+        if (dequeue_pos_.compare_exchange_weak(
+                pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = dequeue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    T* value = reinterpret_cast<T*>(&cell->storage);
+    out = std::move(*value);
+    value->~T();
+    cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Only a snapshot: other threads may push or pop at any time.
+  size_t size_approx() const {
+    size_t enqueued = enqueue_pos_.load(std::memory_order_relaxed);
+    size_t dequeued = dequeue_pos_.load(std::memory_order_relaxed);
+    return enqueued > dequeued ? enqueued - dequeued : 0;
+  }
+
+ private:
+  struct Cell {
+    std::atomic<size_t> sequence;
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+  };
+
+  static constexpr size_t kCacheLineSize = 64;
+
+  std::unique_ptr<Cell[]> cells_;
+  size_t mask_;
+  // Producers and consumers update different cache lines. Padding rather
+  // than alignas, so that classes holding a queue can still be allocated
+  // with plain operator new.
+  char pad0_[kCacheLineSize];
+  std::atomic<size_t> enqueue_pos_{0};
+  char pad1_[kCacheLineSize - sizeof(std::atomic<size_t>)];
+  std::atomic<size_t> dequeue_pos_{0};
+  char pad2_[kCacheLineSize - sizeof(std::atomic<size_t>)];
+};
+
+} // namespace c10
@@ -1,10 +1,16 @@
 #include <c10/util/numa.h>
 
 C10_DEFINE_bool(caffe2_cpu_numa_enabled, false, "Use NUMA whenever possible.");
+C10_DEFINE_bool(
+    caffe2_cpu_numa_pin_threads,
+    false,
+    "If set together with caffe2_cpu_numa_enabled, partition the intra-op "
+    "thread pool per NUMA node and pin its threads.");
 
 #if defined(__linux__) && defined(C10_USE_NUMA) && !defined(C10_MOBILE)
 #include <numa.h>
 #include <numaif.h>
+#include <sched.h>
 #include <unistd.h>
 #define C10_ENABLE_NUMA
 #endif
@@ -15,6 +21,11 @@ C10_DEFINE_bool(caffe2_cpu_numa_enabled, false, "Use NUMA whenever possible.");
 namespace c10 {
 
 #ifdef C10_ENABLE_NUMA
+namespace {
+// NUMA node the current thread was pinned to, -1 if it is not pinned.
+thread_local int pinned_numa_node = -1;
+} // namespace
+
 bool IsNUMAEnabled() {
   return FLAGS_caffe2_cpu_numa_enabled && numa_available() >= 0;
 }
@@ -99,10 +110,66 @@ int GetCurrentNUMANode() {
     return -1;
   }
 
+  if (pinned_numa_node >= 0) {
+    return pinned_numa_node;
+  }
   auto n = numa_node_of_cpu(sched_getcpu());
   return n;
 }
 
+std::vector<int> GetNUMANodeCPUs(int numa_node_id) {
+  std::vector<int> cpus;
+  if (numa_node_id < 0 || !IsNUMAEnabled()) {
+    return cpus;
+  }
+
+  auto bm = numa_allocate_cpumask();
+  TORCH_CHECK(
+      numa_node_to_cpus(numa_node_id, bm) == 0,
+      "Unable to get CPUs of NUMA node ",
+      numa_node_id,
+      ", errno:",
+      errno);
+  for (unsigned int cpu = 0; cpu < bm->size; ++cpu) {
+    if (numa_bitmask_isbitset(bm, cpu)) {
+      cpus.push_back(static_cast<int>(cpu));
+    }
+  }
+  numa_free_cpumask(bm);
+  return cpus;
+}
+
+void NUMAPinCurrentThread(int numa_node_id, int cpu_index) {
+  if (numa_node_id < 0) {
+    return;
+  }
+  if (!IsNUMAEnabled()) {
+    return;
+  }
+
+  auto cpus = GetNUMANodeCPUs(numa_node_id);
+  TORCH_CHECK(!cpus.empty(), "NUMA node ", numa_node_id, " has no CPUs");
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  if (cpu_index >= 0) {
+    CPU_SET(cpus[cpu_index % cpus.size()], &cpu_set);
+  } else {
+    for (int cpu : cpus) {
+      CPU_SET(cpu, &cpu_set);
+    }
+  }
+  TORCH_CHECK(
+      sched_setaffinity(0, sizeof(cpu_set), &cpu_set) == 0,
+      "Unable to pin thread to NUMA node ",
+      numa_node_id,
+      ", errno:",
+      errno);
+  // Prefer rather than bind, so allocations can still fall back to other
+  // nodes when the local one is full.
+  numa_set_preferred(numa_node_id);
+  pinned_numa_node = numa_node_id;
+}
+
 #else // C10_ENABLE_NUMA
 
 bool IsNUMAEnabled() {
@@ -127,6 +194,13 @@ int GetCurrentNUMANode() {
   return -1;
 }
 
+std::vector<int> GetNUMANodeCPUs(int numa_node_id) {
+  return {};
+}
+
+void NUMAPinCurrentThread(int numa_node_id, int cpu_index) {
+}
+
 #endif // C10_NUMA_ENABLED
 
 } // namespace c10
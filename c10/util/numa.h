@@ -3,7 +3,10 @@
 #include <c10/util/Logging.h>
 #include <c10/util/Optional.h>
 
+#include <vector>
+
 C10_DECLARE_bool(caffe2_cpu_numa_enabled);
+C10_DECLARE_bool(caffe2_cpu_numa_pin_threads);
 
 namespace c10 {
 
@@ -33,8 +36,21 @@ C10_API int GetNumNUMANodes();
 C10_API void NUMAMove(void* ptr, size_t size, int numa_node_id);
 
 /**
- * Get the current NUMA node id
+ * Get the current NUMA node id. For threads pinned with NUMAPinCurrentThread
+ * this is the node they were pinned to.
  */
 C10_API int GetCurrentNUMANode();
 
+/**
+ * Get the ids of the CPUs that belong to a given NUMA node
+ */
+C10_API std::vector<int> GetNUMANodeCPUs(int numa_node_id);
+
+/**
+ * Pin the calling thread to a given NUMA node and prefer allocating its
+ * memory there. If `cpu_index` is non-negative, the thread is pinned to the
+ * (cpu_index % number of CPUs)-th CPU of the node instead of the whole node.
+ */
+C10_API void NUMAPinCurrentThread(int numa_node_id, int cpu_index = -1);
+
 } // namespace c10
@@ -1,13 +1,52 @@
 #include "miniz.h"
+#include <algorithm>
 #include <iostream>
+#include <vector>
+
+#include <ATen/Parallel.h>
 
 #include "caffe2/serialize/crc_alt.h"
 
+#if defined(USE_EXTERNAL_MZCRC)
+namespace {
+
+// Buffers of at least two slices are checksummed one slice per task on the
+// intra-op thread pool, and the partial CRCs are folded with crc32_combine.
+// The fold costs O(log(slice)) per slice, noise next to a slice's checksum.
+constexpr size_t kCrcSliceSize = 4 << 20;
+
+uint32_t crc32_parallel(const void* data, size_t length, uint32_t previousCrc32) {
+  const auto* ptr = static_cast<const uint8_t*>(data);
+  const size_t nslices = (length + kCrcSliceSize - 1) / kCrcSliceSize;
+  if (nslices < 2 || at::in_parallel_region() || at::get_num_threads() == 1) {
+    return crc32_fast(data, length, previousCrc32);
+  }
+  std::vector<uint32_t> partial(nslices);
+  at::parallel_for(0, nslices, 1, [&](int64_t begin, int64_t end) {
+    for (int64_t i = begin; i < end; ++i) {
+      size_t offset = i * kCrcSliceSize;
+      partial[i] = crc32_fast(
+          ptr + offset,
+          std::min(kCrcSliceSize, length - offset),
+          i == 0 ? previousCrc32 : 0);
+    }
+  });
+  uint32_t crc = partial[0];
+  for (size_t i = 1; i < nslices; ++i) {
+    size_t offset = i * kCrcSliceSize;
+    crc = crc32_combine(crc, partial[i], std::min(kCrcSliceSize, length - offset));
+  }
+  return crc;
+}
+
+} // namespace
+#endif
+
 extern "C" {
 // See: miniz.h
-#if defined(USE_EXTERNAL_MZCRC) 
+#if defined(USE_EXTERNAL_MZCRC)
 mz_ulong mz_crc32(mz_ulong crc, const mz_uint8* ptr, size_t buf_len) {
-  auto z = crc32_fast(ptr, buf_len, crc);
+  auto z = crc32_parallel(ptr, buf_len, crc);
   return z;
 };
 #endif
@@ -91,6 +91,9 @@ void PyTorchStreamReader::init() {
   ar_->m_pIO_opaque = this;
   ar_->m_pRead = istream_read_func;
 
+  // readers that can alias their storage return a valid (empty) view here
+  can_alias_ = static_cast<bool>(in_->alias(0, 0));
+
   mz_zip_reader_init(ar_.get(), size, 0);
   valid("reading zip archive");
 
@@ -184,6 +187,7 @@ size_t getPadding(
 }
 
 bool PyTorchStreamReader::hasRecord(const std::string& name) {
+  std::lock_guard<std::mutex> guard(reader_lock_);
   std::string ss = archive_name_plus_slash_ + name;
   mz_zip_reader_locate_file(ar_.get(), ss.c_str(), nullptr, 0);
   bool result = ar_->m_last_error != MZ_ZIP_FILE_NOT_FOUND;
@@ -195,6 +199,7 @@ bool PyTorchStreamReader::hasRecord(const std::string& name) {
 }
 
 std::vector<std::string> PyTorchStreamReader::getAllRecords() {
+  std::lock_guard<std::mutex> guard(reader_lock_);
   mz_uint num_files = mz_zip_reader_get_num_files(ar_.get());
   std::vector<std::string> out;
   char buf[MZ_ZIP_MAX_ARCHIVE_FILENAME_SIZE];
@@ -227,10 +232,22 @@ size_t PyTorchStreamReader::getRecordID(const std::string& name) {
 
 // return dataptr, size
 std::tuple<at::DataPtr, size_t> PyTorchStreamReader::getRecord(const std::string& name) {
+  std::lock_guard<std::mutex> guard(reader_lock_);
   size_t key = getRecordID(name);
   mz_zip_archive_file_stat stat;
   mz_zip_reader_file_stat(ar_.get(), key, &stat);
   valid("retrieving file meta-data for ", name.c_str());
+  // stored (uncompressed) records are laid out verbatim in the archive, so a
+  // reader backed by a mapping can hand them out without a copy
+  if (can_alias_ && stat.m_method == 0) {
+    size_t offset = getDataOffset(stat.m_local_header_ofs);
+    if (offset % detail::kFieldAlignment == 0) {
+      at::DataPtr alias = in_->alias(offset, stat.m_uncomp_size);
+      if (alias) {
+        return std::make_tuple(std::move(alias), stat.m_uncomp_size);
+      }
+    }
+  }
   at::DataPtr retval = c10::GetCPUAllocator()->allocate(stat.m_uncomp_size);
   mz_zip_reader_extract_to_mem(ar_.get(), key, retval.get(), stat.m_uncomp_size, 0);
   valid("reading file ", name.c_str());
@@ -243,18 +260,23 @@ static int64_t read_le_16(uint8_t* buf) {
 }
 
 size_t PyTorchStreamReader::getRecordOffset(const std::string& name) {
+  std::lock_guard<std::mutex> guard(reader_lock_);
   mz_zip_archive_file_stat stat;
   mz_zip_reader_file_stat(ar_.get(), getRecordID(name), &stat);
   valid("retrieving file meta-data for ", name.c_str());
+  return getDataOffset(stat.m_local_header_ofs);
+}
+
+size_t PyTorchStreamReader::getDataOffset(uint64_t local_header_ofs) {
   uint8_t local_header[MZ_ZIP_LOCAL_DIR_HEADER_SIZE];
   in_->read(
-      stat.m_local_header_ofs,
+      local_header_ofs,
       local_header,
       MZ_ZIP_LOCAL_DIR_HEADER_SIZE,
       "reading file header");
   size_t filename_len = read_le_16(local_header + MZ_ZIP_LDH_FILENAME_LEN_OFS);
   size_t extra_len = read_le_16(local_header + MZ_ZIP_LDH_EXTRA_LEN_OFS);
-  return stat.m_local_header_ofs + MZ_ZIP_LOCAL_DIR_HEADER_SIZE + filename_len + extra_len;
+  return local_header_ofs + MZ_ZIP_LOCAL_DIR_HEADER_SIZE + filename_len + extra_len;
 }
 
 
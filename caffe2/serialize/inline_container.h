@@ -5,6 +5,7 @@
 #include <cstring>
 #include <fstream>
 #include <istream>
+#include <mutex>
 #include <ostream>
 
 #include <c10/core/Allocator.h>
@@ -152,13 +153,16 @@ static_assert(kProducedBytecodeVersion >= kProducedFileFormatVersion,
 // handle an updated operator.
 constexpr uint64_t kMinSupportedBytecodeVersion = 0x3L;
 
+// All methods may be called concurrently, e.g. to prefetch records on another
+// thread; accesses to the archive are serialized internally.
 class CAFFE2_API PyTorchStreamReader final {
  public:
   explicit PyTorchStreamReader(const std::string& file_name);
   explicit PyTorchStreamReader(std::istream* in);
   explicit PyTorchStreamReader(std::unique_ptr<ReadAdapterInterface> in);
 
-  // return dataptr, size
+  // return dataptr, size. Uncompressed records alias the underlying storage
+  // when the read adapter supports it (see MmapFileAdapter).
   std::tuple<at::DataPtr, size_t> getRecord(const std::string& name);
   size_t getRecordOffset(const std::string& name);
   bool hasRecord(const std::string& name);
@@ -174,6 +178,7 @@ class CAFFE2_API PyTorchStreamReader final {
   size_t read(uint64_t pos, char* buf, size_t n);
   void valid(const char* what, const char* info = "");
   size_t getRecordID(const std::string& name);
+  size_t getDataOffset(uint64_t local_header_ofs);
 
   friend size_t
   istream_read_func(void* pOpaque, uint64_t file_ofs, void* pBuf, size_t n);
@@ -182,6 +187,8 @@ class CAFFE2_API PyTorchStreamReader final {
   std::string archive_name_plus_slash_;
   std::unique_ptr<ReadAdapterInterface> in_;
   int64_t version_;
+  bool can_alias_ = false;
+  std::mutex reader_lock_;
 };
 
 class CAFFE2_API PyTorchStreamWriter final {
@@ -1,10 +1,14 @@
 #include <cstdio>
 #include <string>
 #include <array>
+#include <thread>
+#include <vector>
 
 #include <gtest/gtest.h>
 
 #include "caffe2/serialize/inline_container.h"
+#include "caffe2/serialize/mmap_adapter.h"
+#include "miniz.h"
 
 namespace caffe2 {
 namespace serialize {
@@ -63,6 +67,128 @@ TEST(PyTorchStreamWriterAndReader, SaveAndLoad) {
   ASSERT_EQ(memcmp(the_file.c_str() + off2, data2.data(), data2.size()), 0);
 }
 
+TEST(PyTorchStreamWriterAndReader, MmapAliasesRecords) {
+  std::ostringstream oss;
+  PyTorchStreamWriter writer([&](const void* b, size_t n) -> size_t {
+    oss.write(static_cast<const char*>(b), n);
+    return oss ? n : 0;
+  });
+  std::array<char, 200> data1;
+  for (int i = 0; i < data1.size(); ++i) {
+    data1[i] = i;
+  }
+  writer.writeRecord("key1", data1.data(), data1.size());
+  writer.writeRecord("key2", data1.data(), data1.size(), /*compress=*/true);
+  writer.writeEndOfFile();
+
+  std::string the_file = oss.str();
+  std::ofstream foo("output_mmap.zip", std::ios::binary);
+  foo.write(the_file.c_str(), the_file.size());
+  foo.close();
+
+  at::DataPtr data_ptr;
+  int64_t size;
+  {
+    auto adapter = std::make_unique<MmapFileAdapter>("output_mmap.zip");
+    ASSERT_EQ(adapter->size(), the_file.size());
+    const char* base = static_cast<const char*>(adapter->alias(0, 0).get());
+    PyTorchStreamReader reader(std::move(adapter));
+
+    // stored records point into the mapping
+    std::tie(data_ptr, size) = reader.getRecord("key1");
+    ASSERT_EQ(size, data1.size());
+    ASSERT_EQ(
+        static_cast<const char*>(data_ptr.get()),
+        base + reader.getRecordOffset("key1"));
+
+    // compressed records are still copied out
+    at::DataPtr compressed;
+    std::tie(compressed, size) = reader.getRecord("key2");
+    ASSERT_EQ(size, data1.size());
+    ASSERT_EQ(memcmp(compressed.get(), data1.data(), data1.size()), 0);
+  }
+  // the alias keeps the mapping alive after the reader is gone, and writes
+  // through it do not reach the file
+  ASSERT_EQ(memcmp(data_ptr.get(), data1.data(), data1.size()), 0);
+  static_cast<char*>(data_ptr.get())[0] = 42;
+  PyTorchStreamReader reader("output_mmap.zip");
+  at::DataPtr reread;
+  std::tie(reread, size) = reader.getRecord("key1");
+  ASSERT_EQ(memcmp(reread.get(), data1.data(), data1.size()), 0);
+
+  std::ofstream("empty_mmap.zip").close();
+  ASSERT_THROW(MmapFileAdapter("empty_mmap.zip"), c10::Error);
+}
+
+TEST(PyTorchStreamWriterAndReader, ConcurrentGetRecord) {
+  std::ostringstream oss;
+  PyTorchStreamWriter writer([&](const void* b, size_t n) -> size_t {
+    oss.write(static_cast<const char*>(b), n);
+    return oss ? n : 0;
+  });
+  // large enough for the writer to checksum it in slices
+  std::vector<char> data(9 << 20);
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = i * 7;
+  }
+  constexpr int kNumRecords = 8;
+  for (int i = 0; i < kNumRecords; ++i) {
+    writer.writeRecord(
+        "data/" + c10::to_string(i), data.data(), data.size() - i);
+  }
+  writer.writeEndOfFile();
+
+  std::istringstream iss(oss.str());
+  PyTorchStreamReader reader(&iss);
+  std::vector<std::thread> threads;
+  std::vector<int> ok(kNumRecords, 0);
+  for (int i = 0; i < kNumRecords; ++i) {
+    threads.emplace_back([&, i]() {
+      at::DataPtr data_ptr;
+      size_t size;
+      std::tie(data_ptr, size) = reader.getRecord("data/" + c10::to_string(i));
+      ok[i] = size == data.size() - i &&
+          memcmp(data_ptr.get(), data.data(), size) == 0;
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (int i = 0; i < kNumRecords; ++i) {
+    ASSERT_TRUE(ok[i]);
+  }
+}
+
+// The zip CRC-32, one bit at a time
+uint32_t crc32Reference(const uint8_t* data, size_t n, uint32_t crc) {
+  crc = ~crc;
+  for (size_t i = 0; i < n; ++i) {
+    crc ^= data[i];
+    for (int k = 0; k < 8; ++k) {
+      crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+    }
+  }
+  return ~crc;
+}
+
+TEST(PyTorchStreamWriterAndReader, SlicedCrc32) {
+  // mz_crc32 checksums long buffers in slices on several threads and folds
+  // the results. The reader does not verify checksums, so a wrong fold
+  // would only show up in other zip tools.
+  std::vector<uint8_t> data((9 << 20) + 12345);
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = static_cast<uint8_t>((i * 2654435761u) >> 13);
+  }
+  for (size_t size : {data.size(), size_t(8 << 20), size_t(100)}) {
+    ASSERT_EQ(
+        mz_crc32(MZ_CRC32_INIT, data.data(), size),
+        crc32Reference(data.data(), size, 0));
+  }
+  ASSERT_EQ(
+      mz_crc32(0x12345678, data.data(), data.size()),
+      crc32Reference(data.data(), data.size(), 0x12345678));
+}
+
 } // namespace
 } // namespace serialize
 } // namespace caffe2
@@ -0,0 +1,70 @@
+#include "caffe2/serialize/mmap_adapter.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#include <TH/THAllocator.h>
+#include <c10/util/Exception.h>
+
+namespace caffe2 {
+namespace serialize {
+
+namespace {
+
+struct MappedRegion {
+  std::shared_ptr<at::DataPtr> mapping;
+};
+
+void deleteMappedRegion(void* ctx) {
+  delete static_cast<MappedRegion*>(ctx);
+}
+
+} // namespace
+
+MmapFileAdapter::MmapFileAdapter(const std::string& file_name) : size_(0) {
+  size_t file_size = 0;
+  {
+    std::ifstream file(file_name, std::ifstream::binary | std::ifstream::ate);
+    if (!file) {
+      AT_ERROR("open file failed, file path: ", file_name);
+    }
+    file_size = static_cast<size_t>(file.tellg());
+  }
+  // THMapAllocator maps nothing when asked for zero bytes
+  TORCH_CHECK(file_size > 0, "cannot mmap empty file: ", file_name);
+  // flags == 0 opens the file read-only and maps it MAP_PRIVATE
+  mapping_ = std::make_shared<at::DataPtr>(THMapAllocator::makeDataPtr(
+      file_name.c_str(), /*flags=*/0, file_size, &size_));
+  TORCH_CHECK(
+      mapping_->get() != nullptr && size_ == file_size,
+      "failed to mmap file: ", file_name);
+}
+
+size_t MmapFileAdapter::size() const {
+  return size_;
+}
+
+size_t MmapFileAdapter::read(uint64_t pos, void* buf, size_t n, const char* what)
+    const {
+  TORCH_CHECK(pos <= size_, "unexpected pos ", pos, " while ", what);
+  n = std::min<size_t>(n, size_ - pos);
+  memcpy(buf, static_cast<const char*>(mapping_->get()) + pos, n);
+  return n;
+}
+
+at::DataPtr MmapFileAdapter::alias(uint64_t pos, size_t n) const {
+  TORCH_CHECK(
+      pos <= size_ && n <= size_ - pos,
+      "record at ", pos, " of size ", n, " is out of the mapped file");
+  return at::DataPtr(
+      static_cast<char*>(mapping_->get()) + pos,
+      new MappedRegion{mapping_},
+      &deleteMappedRegion,
+      at::kCPU);
+}
+
+MmapFileAdapter::~MmapFileAdapter() {}
+
+} // namespace serialize
+} // namespace caffe2
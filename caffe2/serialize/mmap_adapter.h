@@ -0,0 +1,36 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "c10/core/Allocator.h"
+#include "c10/macros/Macros.h"
+#include "caffe2/serialize/read_adapter_interface.h"
+
+namespace caffe2 {
+namespace serialize {
+
+// Maps the whole file into memory once. Reads are served from the mapping
+// and records can be aliased without a copy, so tensors loaded through this
+// adapter point straight into the page cache. The mapping is private
+// (copy-on-write): writes to a loaded tensor never reach the file, and pages
+// that are only read are shared between all processes mapping the same file.
+class CAFFE2_API MmapFileAdapter final : public ReadAdapterInterface {
+ public:
+  C10_DISABLE_COPY_AND_ASSIGN(MmapFileAdapter);
+  explicit MmapFileAdapter(const std::string& file_name);
+  size_t size() const override;
+  size_t read(uint64_t pos, void* buf, size_t n, const char* what = "")
+      const override;
+  at::DataPtr alias(uint64_t pos, size_t n) const override;
+  ~MmapFileAdapter();
+
+ private:
+  // shared with every DataPtr handed out by alias(), the file stays mapped
+  // until the adapter and all of them are gone
+  std::shared_ptr<at::DataPtr> mapping_;
+  size_t size_;
+};
+
+} // namespace serialize
+} // namespace caffe2
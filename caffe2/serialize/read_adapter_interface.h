@@ -3,6 +3,7 @@
 #include <cstddef>
 #include <cstdint>
 
+#include "c10/core/Allocator.h"
 #include "c10/macros/Macros.h"
 
 namespace caffe2 {
@@ -16,6 +17,9 @@ class CAFFE2_API ReadAdapterInterface {
   virtual size_t size() const = 0;
   virtual size_t read(uint64_t pos, void* buf, size_t n, const char* what = "")
       const = 0;
+  // returns a DataPtr that aliases n bytes at pos without copying, or an
+  // empty DataPtr if the reader cannot hand out views of its storage
+  virtual at::DataPtr alias(uint64_t pos, size_t n) const;
   virtual ~ReadAdapterInterface();
 };
 
@@ -485,6 +485,51 @@ TEST(DataTest, StackTransformWorksForTensorExample) {
   ASSERT_TRUE(second.data.allclose(torch::eye(4).slice(/*dim=*/0, 2, 4)));
 }
 
+TEST(DataTest, StackTransformRecyclesBuffers) {
+  auto d = datasets::TensorDataset(torch::eye(4))
+               .map(transforms::Stack<TensorExample>(
+                   transforms::StackOptions().buffers(2)));
+
+  TensorExample first = d.get_batch({0, 1});
+  TensorExample second = d.get_batch({2, 3});
+  ASSERT_TRUE(first.data.allclose(torch::eye(4).slice(/*dim=*/0, 0, 2)));
+  ASSERT_TRUE(second.data.allclose(torch::eye(4).slice(/*dim=*/0, 2, 4)));
+  ASSERT_NE(first.data.data_ptr(), second.data.data_ptr());
+
+  // Both buffers are in use, so the next batch gets a fresh allocation.
+  TensorExample third = d.get_batch({1, 2});
+  ASSERT_NE(third.data.data_ptr(), first.data.data_ptr());
+  ASSERT_NE(third.data.data_ptr(), second.data.data_ptr());
+
+  // Once consumed, a buffer is reused, also for smaller batches.
+  void* const recycled = first.data.data_ptr();
+  first = TensorExample(torch::Tensor());
+  TensorExample last = d.get_batch({3});
+  ASSERT_EQ(last.data.data_ptr(), recycled);
+  ASSERT_EQ(last.data.sizes(), torch::IntArrayRef({1, 4}));
+  ASSERT_TRUE(last.data.allclose(torch::eye(4).slice(/*dim=*/0, 3, 4)));
+  ASSERT_TRUE(second.data.allclose(torch::eye(4).slice(/*dim=*/0, 2, 4)));
+}
+
+TEST(DataLoaderTest, StackIntoBuffersWithManyWorkers) {
+  const size_t kSize = 64;
+  auto data = torch::arange(kSize * 3, torch::kFloat32).view({kSize, 3});
+  auto data_loader =
+      torch::data::make_data_loader<torch::data::samplers::SequentialSampler>(
+          datasets::TensorDataset(data).map(transforms::Stack<TensorExample>(
+              transforms::StackOptions().buffers(6))),
+          DataLoaderOptions().batch_size(4).workers(4));
+
+  for (size_t epoch = 0; epoch < 2; ++epoch) {
+    std::vector<torch::Tensor> batches;
+    for (auto& batch : *data_loader) {
+      batches.push_back(batch.data.clone());
+    }
+    ASSERT_EQ(batches.size(), kSize / 4);
+    ASSERT_TRUE(torch::cat(batches).equal(data));
+  }
+}
+
 // Template classes cannot be nested in functions.
 template <typename Target>
 struct T : transforms::TensorTransform<Target> {
@@ -688,6 +733,48 @@ TEST(DataTest, QueueClearEmptiesTheQueue) {
   ASSERT_THROWS_WITH(queue.pop(1 * kMillisecond), "Timeout");
 }
 
+TEST(DataTest, LockFreeQueueOverflowsInsteadOfBlocking) {
+  torch::data::detail::Queue<int> queue(/*lock_free_capacity=*/2);
+  for (int i = 0; i < 5; ++i) {
+    queue.push(i);
+  }
+  std::vector<int> popped;
+  for (int i = 0; i < 4; ++i) {
+    popped.push_back(queue.pop());
+  }
+  std::sort(popped.begin(), popped.end());
+  ASSERT_EQ(popped, std::vector<int>({0, 1, 2, 3}));
+  ASSERT_EQ(queue.clear(), 1);
+  ASSERT_EQ(queue.wait_stats().waits, 0u);
+  ASSERT_THROWS_WITH(queue.pop(1 * kMillisecond), "Timeout");
+  ASSERT_EQ(queue.wait_stats().waits, 1u);
+}
+
+TEST(DataTest, LockFreeQueuePushAndPopFromDifferentThreads) {
+  using torch::data::detail::Queue;
+  Queue<int> queue(/*lock_free_capacity=*/4);
+  const int kValues = 1000;
+  std::thread producer([&queue] {
+    std::this_thread::sleep_for(20 * kMillisecond);
+    for (int i = 0; i < kValues; ++i) {
+      queue.push(i);
+    }
+  });
+  // Values that overflowed the lock-free ring may come out of order
+  std::vector<int> popped;
+  for (int i = 0; i < kValues; ++i) {
+    popped.push_back(queue.pop());
+  }
+  producer.join();
+  std::sort(popped.begin(), popped.end());
+  for (int i = 0; i < kValues; ++i) {
+    ASSERT_EQ(popped[i], i);
+  }
+  const auto stats = queue.wait_stats();
+  ASSERT_GE(stats.waits, 1u);
+  ASSERT_GE(stats.wait_time, 10 * kMillisecond);
+}
+
 TEST(DataTest, DataShuttleCanPushAndPopJob) {
   torch::data::detail::DataShuttle<int, int> shuttle;
   shuttle.push_job(1);
@@ -736,6 +823,24 @@ TEST(DataTest, DataShuttlePopResultTimesOut) {
   ASSERT_THROWS_WITH(shuttle.pop_result(10 * kMillisecond), "Timeout");
 }
 
+TEST(DataTest, DataShuttlePopsResultsPushedTogetherOneByOne) {
+  torch::data::detail::DataShuttle<int, int> shuttle;
+  shuttle.push_job(1);
+  shuttle.push_job(2);
+  shuttle.push_job(3);
+  ASSERT_EQ(shuttle.try_pop_job().value(), 1);
+  ASSERT_EQ(shuttle.try_pop_job().value(), 2);
+  shuttle.push_results({1, 2});
+  ASSERT_EQ(shuttle.pop_result().value(), 1);
+  ASSERT_EQ(shuttle.in_flight_jobs(), 2);
+  ASSERT_EQ(shuttle.pop_result().value(), 2);
+  ASSERT_EQ(shuttle.pop_job(), 3);
+  ASSERT_FALSE(shuttle.try_pop_job().has_value());
+  shuttle.push_result(3);
+  ASSERT_EQ(shuttle.pop_result().value(), 3);
+  ASSERT_FALSE(shuttle.pop_result().has_value());
+}
+
 struct UncopyableDataset : datasets::Dataset<UncopyableDataset, int> {
   UncopyableDataset(const std::string& /* unused */) {}
 
@@ -1407,6 +1512,41 @@ TEST(DataLoaderTest, EnforcesOrderingAmongThreadsWhenConfigured) {
   ASSERT_EQ(expected, output);
 }
 
+TEST(DataLoaderTest, LockFreeQueuesWithBatchedResults) {
+  struct SlowDataset : datasets::BatchDataset<SlowDataset, size_t> {
+    size_t get_batch(torch::ArrayRef<size_t> indices) override {
+      std::this_thread::sleep_for(kMillisecond);
+      return indices.front();
+    }
+    torch::optional<size_t> size() const override {
+      return 100;
+    }
+  };
+
+  auto data_loader = torch::data::make_data_loader(
+      SlowDataset{},
+      torch::data::samplers::SequentialSampler(100),
+      DataLoaderOptions()
+          .batch_size(1)
+          .workers(4)
+          .lock_free_queues(true)
+          .results_per_push(3));
+  for (size_t epoch = 0; epoch < 2; ++epoch) {
+    std::vector<size_t> output;
+    for (size_t value : *data_loader) {
+      output.push_back(value);
+    }
+    std::vector<size_t> expected(100);
+    std::iota(expected.begin(), expected.end(), size_t(0));
+    ASSERT_EQ(expected, output);
+  }
+
+  // The main thread has to wait for the first batch of every epoch.
+  const auto stats = data_loader->wait_stats();
+  ASSERT_GE(stats.results.waits, 2u);
+  ASSERT_GT(stats.results.wait_time.count(), 0);
+}
+
 TEST(DataLoaderTest, Reset) {
   DummyDataset dataset;
   auto data_loader =
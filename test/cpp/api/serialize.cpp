@@ -8,6 +8,8 @@
 #include <test/cpp/api/support.h>
 
 #include <cstdio>
+#include <fstream>
+#include <iterator>
 #include <memory>
 #include <sstream>
 #include <string>
@@ -886,6 +888,86 @@ TEST(SerializeTest, VectorOfTensors) {
   }
 }
 
+TEST(SerializeTest, Sharded) {
+  torch::manual_seed(0);
+  auto tempfile = c10::make_tempfile();
+  // save_sharded reads the manifest if one already exists at the path
+  const std::string path = tempfile.name;
+  std::remove(path.c_str());
+  auto exists = [&](const std::string& suffix) {
+    return std::ifstream(path + suffix).good();
+  };
+
+  torch::OrderedDict<std::string, torch::Tensor> tensors;
+  tensors.insert("a", torch::randn({3, 4}));
+  tensors.insert("b", torch::arange(10).view({2, 5}).t());
+  tensors.insert("c", torch::ones({}, torch::kHalf));
+  tensors.insert("d", torch::empty({0, 3}));
+  tensors.insert("e", torch::randn({50, 50}).requires_grad_());
+
+  auto check = [&]() {
+    auto loaded = torch::serialize::load_sharded(path);
+    ASSERT_EQ(loaded.keys(), tensors.keys());
+    for (const auto& item : tensors) {
+      const auto& tensor = loaded[item.key()];
+      ASSERT_EQ(tensor.dtype(), item.value().dtype());
+      ASSERT_EQ(tensor.sizes(), item.value().sizes());
+      ASSERT_FALSE(tensor.requires_grad());
+      ASSERT_TRUE(torch::equal(tensor, item.value()));
+    }
+  };
+
+  torch::serialize::save_sharded(tensors, path, /*num_shards=*/2);
+  ASSERT_TRUE(exists(".1.0"));
+  ASSERT_TRUE(exists(".1.1"));
+  check();
+
+  // dtypes are stored by name, unknown names are rejected
+  {
+    std::ifstream in(path, std::ios::binary);
+    std::string manifest(
+        (std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    auto pos = manifest.find("Half");
+    ASSERT_NE(pos, std::string::npos);
+    manifest.replace(pos, 4, "Halg");
+    std::ofstream(path + ".bad", std::ios::binary) << manifest;
+    ASSERT_THROWS_WITH(
+        torch::serialize::load_sharded(path + ".bad"), "unknown dtype Halg");
+    std::remove((path + ".bad").c_str());
+  }
+
+  // only the changed tensor is rewritten, the first shards stay referenced
+  {
+    torch::NoGradGuard no_grad;
+    tensors["e"].add_(1);
+  }
+  torch::serialize::save_sharded(tensors, path, /*num_shards=*/2);
+  ASSERT_TRUE(exists(".2.0"));
+  ASSERT_FALSE(exists(".2.1"));
+  ASSERT_TRUE(exists(".1.0"));
+  ASSERT_TRUE(exists(".1.1"));
+  check();
+
+  // a full save drops every earlier shard
+  tensors["a"] = torch::randn({4});
+  torch::serialize::save_sharded(
+      tensors, path, torch::serialize::ShardedSaveOptions(3).incremental(false));
+  ASSERT_TRUE(exists(".3.2"));
+  ASSERT_FALSE(exists(".1.0"));
+  ASSERT_FALSE(exists(".1.1"));
+  ASSERT_FALSE(exists(".2.0"));
+  check();
+
+  ASSERT_THROWS_WITH(
+      torch::serialize::save_sharded(tensors, path, /*num_shards=*/0),
+      "num_shards must be positive");
+
+  tensors.clear();
+  torch::serialize::save_sharded(tensors, path);
+  ASSERT_FALSE(exists(".3.0"));
+  check();
+}
+
 TEST(SerializeTest, IValue) {
   c10::IValue ivalue(1);
   auto tempfile = c10::make_tempfile();
@@ -60,6 +60,7 @@ TESTS = [
     'test_vulkan',
     'test_quantization',
     'test_sparse',
+    'test_sparse_csr',
     'test_spectral_ops',
     'test_serialization',
     'test_show_pickle',
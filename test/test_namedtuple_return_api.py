@@ -12,7 +12,7 @@ aten_native_yaml = os.path.join(path, '../aten/src/ATen/native/native_functions.
 all_operators_with_namedtuple_return = {
     'max', 'min', 'median', 'nanmedian', 'mode', 'kthvalue', 'svd', 'symeig', 'eig',
     'qr', 'geqrf', 'solve', 'slogdet', 'sort', 'topk', 'lstsq',
-    'triangular_solve', 'cummax', 'cummin'
+    'triangular_solve', 'cummax', 'cummin', 'cdist_topk'
 }
 
 
@@ -76,7 +76,12 @@ class TestNamedTupleAPI(unittest.TestCase):
                     for i, name in enumerate(op.names):
                         self.assertIs(getattr(ret, name), ret[i])
 
-        all_covered_operators = set([x for y in operators for x in y.operators])
+        # function-only operators
+        ret = torch.cdist_topk(a, a, 2)
+        for i, name in enumerate(('values', 'indices')):
+            self.assertIs(getattr(ret, name), ret[i])
+
+        all_covered_operators = set([x for y in operators for x in y.operators] + ['cdist_topk'])
 
         self.assertEqual(all_operators_with_namedtuple_return, all_covered_operators, textwrap.dedent('''
         The set of covered operators does not match the `all_operators_with_namedtuple_return` of
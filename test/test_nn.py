@@ -11976,6 +11976,116 @@ class TestNNDeviceType(NNTestCase):
         self.assertEqual(output_non_contig, output_contig)
 
 
+    @onlyCPU
+    @dtypes(torch.half, torch.bfloat16, torch.float, torch.double)
+    def test_embedding_bag_dtypes_and_index_types(self, device, dtype):
+        num_weights, D = 100, 37
+        weight = torch.randn(num_weights, D, device=device).to(dtype)
+        # Includes empty bags, in the middle and at the end
+        lengths = [3, 0, 5, 1, 7, 0]
+        input = torch.randint(num_weights, (sum(lengths),), device=device)
+        offsets = torch.tensor([0] + lengths[:-1], device=device).cumsum(0)
+        per_sample_weights = torch.randn(input.numel(), device=device).to(dtype)
+        if dtype in (torch.half, torch.bfloat16):
+            atol, rtol = 2e-2, 2e-2
+        else:
+            atol, rtol = None, None
+
+        for index_dtype, mode, include_last_offset in product(
+                (torch.int, torch.long), ('sum', 'mean', 'max'), (False, True)):
+            offsets_ = torch.cat([offsets, offsets.new_tensor([input.numel()])]) if include_last_offset else offsets
+            psw = per_sample_weights if mode == 'sum' else None
+            expected = self._embedding_bag_reference_impl(
+                input, weight.double(), offsets_, mode,
+                psw.double() if psw is not None else None, include_last_offset)
+            actual = F.embedding_bag(
+                input.to(index_dtype), weight, offsets_.to(index_dtype), mode=mode,
+                per_sample_weights=psw, include_last_offset=include_last_offset)
+            self.assertEqual(actual.dtype, dtype)
+            self.assertEqual(actual.double(), expected, atol=atol, rtol=rtol)
+
+            if dtype in (torch.float, torch.double):
+                grads = []
+                for indices_dtype in (index_dtype, torch.long):
+                    w = weight.clone().requires_grad_()
+                    F.embedding_bag(
+                        input.to(indices_dtype), w, offsets_.to(indices_dtype), mode=mode,
+                        per_sample_weights=psw, include_last_offset=include_last_offset).sum().backward()
+                    grads.append(w.grad)
+                self.assertEqual(grads[0], grads[1])
+
+            # 2D input, where the offsets are implied
+            input_2d = input[:12].view(4, 3)
+            expected = F.embedding_bag(input_2d, weight.double(), mode=mode)
+            actual = F.embedding_bag(input_2d.to(index_dtype), weight, mode=mode)
+            self.assertEqual(actual.double(), expected, atol=atol, rtol=rtol)
+
+    @onlyCPU
+    @dtypes(torch.float, torch.double)
+    def test_embedding_bag_sparse_optimizer_update(self, device, dtype):
+        num_weights, D = 50, 19
+        lr, eps, weight_decay = 0.1, 1e-10, 0.01
+        # Repeats indices within and across bags
+        input = torch.tensor([3, 7, 3, 49, 0, 7, 7, 12, 3, 0], device=device)
+        offsets = torch.tensor([0, 3, 3, 6], device=device)
+        per_sample_weights = torch.randn(input.numel(), device=device, dtype=dtype)
+        grad = torch.randn(offsets.numel(), D, device=device, dtype=dtype)
+        weight = torch.randn(num_weights, D, device=device, dtype=dtype)
+
+        for index_dtype, mode, use_psw in product((torch.int, torch.long), ('sum', 'mean'), (False, True)):
+            if use_psw and mode != 'sum':
+                continue
+            psw = per_sample_weights if use_psw else None
+            w = weight.clone().requires_grad_()
+            F.embedding_bag(input, w, offsets, mode=mode, per_sample_weights=psw).backward(grad)
+            dense_grad = w.grad
+            mode_enum = 0 if mode == 'sum' else 1
+            indices, offsets_ = input.to(index_dtype), offsets.to(index_dtype)
+
+            actual = weight.clone()
+            torch._embedding_bag_sparse_sgd_(actual, grad, indices, offsets_, mode_enum, psw, False, lr)
+            self.assertEqual(actual, weight - lr * dense_grad)
+
+            rows = input.unique()
+            g = dense_grad[rows] + weight_decay * weight[rows]
+            state_sum = torch.rand(num_weights, D, device=device, dtype=dtype)
+            expected_state_sum = state_sum.clone()
+            expected_state_sum[rows] += g * g
+            expected = weight.clone()
+            expected[rows] -= lr * g / (expected_state_sum[rows].sqrt() + eps)
+            actual = weight.clone()
+            torch._embedding_bag_sparse_adagrad_(
+                actual, state_sum, grad, indices, offsets_, mode_enum, psw, False, lr, eps, weight_decay)
+            self.assertEqual(actual, expected)
+            self.assertEqual(state_sum, expected_state_sum)
+
+            # Rowwise Adagrad keeps one accumulator per row
+            state_sum = torch.rand(num_weights, device=device, dtype=dtype)
+            expected_state_sum = state_sum.clone()
+            expected_state_sum[rows] += (g * g).mean(1)
+            expected = weight.clone()
+            expected[rows] -= lr * g / (expected_state_sum[rows].sqrt() + eps).unsqueeze(1)
+            actual = weight.clone()
+            torch._embedding_bag_sparse_adagrad_(
+                actual, state_sum, grad, indices, offsets_, mode_enum, psw, False, lr, eps, weight_decay)
+            self.assertEqual(actual, expected)
+            self.assertEqual(state_sum, expected_state_sum)
+
+        # Invalid indices and offsets are rejected before anything is updated
+        bad_input = input.clone()
+        bad_input[-1] = num_weights
+        actual = weight.clone()
+        with self.assertRaisesRegex(RuntimeError, "out of range"):
+            torch._embedding_bag_sparse_sgd_(actual, grad, bad_input, offsets, 0, None, False, lr)
+        self.assertEqual(actual, weight)
+        for bad_offsets, msg in (([1, 3, 3, 6], "start at 0"),
+                                 ([0, 3, 2, 6], "non-decreasing"),
+                                 ([0, 3, 3, 11], "out of range")):
+            with self.assertRaisesRegex(RuntimeError, msg):
+                torch._embedding_bag_sparse_sgd_(
+                    actual, grad, input, torch.tensor(bad_offsets, device=device), 0, None, False, lr)
+        self.assertEqual(actual, weight)
+
     @onlyCUDA
     @skipCUDAIfNotRocm
     def test_embedding_bag_bfloat16(self, device):
@@ -746,6 +746,44 @@ class TestSerialization(TestCase, SerializationMixin):
             torch.save(model, path)
             torch.load(path)
 
+    @unittest.skipIf(IS_WINDOWS, "torch.save with filename will open file twice, not supported in Windows.")
+    def test_serialization_mmap(self):
+        data = {'a': torch.randn(5, 7), 'b': torch.arange(100), 'c': [torch.ones(3, dtype=torch.half)]}
+        data['view'] = data['a'][1:3]
+
+        with tempfile.NamedTemporaryFile() as f:
+            torch.save(data, f.name)
+            result = torch.load(f.name, mmap=True)
+            self.assertEqual(result, data)
+            self.assertEqual(result['view'].storage().data_ptr(), result['a'].storage().data_ptr())
+            if sys.platform.startswith('linux'):
+                # the storages point into a mapping of the checkpoint itself
+                with open('/proc/self/maps') as maps:
+                    ranges = [[int(x, 16) for x in line.split()[0].split('-')]
+                              for line in maps if line.rstrip().endswith(os.path.realpath(f.name))]
+                for key in ('a', 'b'):
+                    ptr = result[key].storage().data_ptr()
+                    self.assertTrue(any(lo <= ptr < hi for lo, hi in ranges))
+            self.assertEqual(torch.load(pathlib.Path(f.name), mmap=True), data)
+
+            # writes stay private to the process that made them
+            result['a'].zero_()
+            self.assertEqual(torch.load(f.name), data)
+
+            with self.assertRaisesRegex(ValueError, "file name"):
+                with open(f.name, 'rb') as opened:
+                    torch.load(opened, mmap=True)
+
+        with tempfile.NamedTemporaryFile() as f:
+            torch.serialization.save(data, f.name, _use_new_zipfile_serialization=False)
+            with self.assertRaisesRegex(RuntimeError, "zipfile format"):
+                torch.load(f.name, mmap=True)
+
+        with tempfile.NamedTemporaryFile() as f:
+            torch.jit.save(torch.jit.script(torch.nn.Linear(2, 2)), f.name)
+            with self.assertRaisesRegex(RuntimeError, "TorchScript"):
+                torch.load(f.name, mmap=True)
+
     def run(self, *args, **kwargs):
         with serialization_method(use_zip=True):
             return super(TestSerialization, self).run(*args, **kwargs)
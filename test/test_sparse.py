@@ -199,6 +199,39 @@ class TestSparse(TestCase):
             t, _, _ = self._gen_sparse(len(sparse_size), nnz, sparse_size + dense_size)
             self.safeCoalesce(t)  # this tests correctness
 
+    @cpu_only
+    def test_coalesce_sorted_and_large(self):
+        # sorted without duplicates: the result shares indices and values
+        # with the input, which is left as it was
+        i = self.index_tensor([[0, 0, 1, 2], [1, 3, 0, 2]])
+        v = self.value_tensor([[1, 2], [3, 4], [5, 6], [7, 8]])
+        x = self.sparse_tensor(i, v, torch.Size([3, 4, 2]))
+        if not x.is_coalesced():
+            y = x.coalesce()
+            self.assertFalse(x.is_coalesced())
+            self.assertTrue(y.is_coalesced())
+            self.assertIsNot(y, x)
+            self.assertEqual(y._values().data_ptr(), x._values().data_ptr())
+            self.assertEqual(y.to_dense(), x.to_dense())
+
+        # sorted with duplicates: no sort, runs are summed in order
+        i = self.index_tensor([[0, 0, 1, 1, 1]])
+        v = self.value_tensor([1, 2, 3, 4, 5])
+        y = self.sparse_tensor(i, v, torch.Size([2])).coalesce()
+        self.assertEqual(y._indices(), self.index_tensor([[0, 1]]))
+        self.assertEqual(y._values(), self.value_tensor([3, 12]))
+
+        # long enough to be sorted and reduced with several threads
+        nnz = 200000
+        i = torch.randint(0, 300, (2, nnz))
+        v = torch.randn(nnz, 3)
+        x = self.sparse_tensor(i, v, torch.Size([300, 300, 3]))
+        y = x.coalesce()
+        self.assertTrue(y.is_coalesced())
+        flat = y._indices()[0] * 300 + y._indices()[1]
+        self.assertTrue(bool((flat[1:] > flat[:-1]).all()))
+        self.assertEqual(y.to_dense(), torch.zeros(300, 300, 3).index_put_((i[0], i[1]), v, accumulate=True))
+
     def test_ctor_size_checks(self):
         indices = self.index_tensor([
             [0, 0, 0],
@@ -0,0 +1,178 @@
+import torch
+
+import itertools
+from torch.testing._internal.common_utils import TestCase, run_tests, load_tests
+from torch.testing._internal.common_device_type import \
+    (instantiate_device_type_tests, onlyCPU, dtypes)
+
+# load_tests from torch.testing._internal.common_utils is used to automatically filter tests for
+# sharding on sandcastle. This line silences flake warnings
+load_tests = load_tests
+
+
+class TestSparseCSR(TestCase):
+
+    def _random_dense(self, rows, cols, density, dtype, device):
+        x = torch.randn(rows, cols, device=device).to(dtype)
+        mask = torch.rand(rows, cols, device=device) < density
+        return x * mask
+
+    @onlyCPU
+    @dtypes(torch.double)
+    def test_csr_layout(self, device, dtype):
+        self.assertEqual(str(torch.sparse_csr), 'torch.sparse_csr')
+        self.assertEqual(type(torch.sparse_csr), torch.layout)
+
+    @onlyCPU
+    @dtypes(torch.double, torch.float)
+    def test_sparse_csr_constructor(self, device, dtype):
+        for index_dtype in [torch.int32, torch.int64]:
+            crow_indices = torch.tensor([0, 2, 4], dtype=index_dtype)
+            col_indices = torch.tensor([0, 1, 0, 1], dtype=index_dtype)
+            values = torch.tensor([1, 2, 3, 4], dtype=dtype)
+
+            sparse = torch.sparse_csr_tensor(crow_indices, col_indices, values, size=(2, 10), dtype=dtype)
+            self.assertEqual(sparse.layout, torch.sparse_csr)
+            self.assertEqual((2, 10), sparse.shape)
+            self.assertEqual(4, sparse._nnz())
+            self.assertEqual(crow_indices, sparse.crow_indices())
+            self.assertEqual(col_indices, sparse.col_indices())
+            self.assertEqual(values, sparse.values())
+            self.assertEqual(index_dtype, sparse.crow_indices().dtype)
+
+            # shape inference
+            sparse = torch.sparse_csr_tensor(crow_indices, col_indices, values, dtype=dtype)
+            self.assertEqual((2, 2), sparse.shape)
+
+    @onlyCPU
+    @dtypes(torch.double)
+    def test_sparse_csr_constructor_validation(self, device, dtype):
+        values = torch.tensor([1, 2, 3, 4], dtype=dtype)
+
+        with self.assertRaisesRegex(RuntimeError, "crow_indices"):
+            torch.sparse_csr_tensor(torch.tensor([1, 2, 4]), torch.tensor([0, 1, 0, 1]), values, size=(2, 2))
+
+        with self.assertRaisesRegex(RuntimeError, "crow_indices"):
+            torch.sparse_csr_tensor(torch.tensor([0, 2, 3]), torch.tensor([0, 1, 0, 1]), values, size=(2, 2))
+
+        with self.assertRaisesRegex(RuntimeError, "crow_indices"):
+            torch.sparse_csr_tensor(torch.tensor([0, 3, 2, 4]), torch.tensor([0, 1, 0, 1]), values, size=(3, 2))
+
+        with self.assertRaisesRegex(RuntimeError, "col_indices"):
+            torch.sparse_csr_tensor(torch.tensor([0, 2, 4]), torch.tensor([0, 1, 0, 2]), values, size=(2, 2))
+
+        with self.assertRaisesRegex(RuntimeError, "same dtype"):
+            torch.sparse_csr_tensor(torch.tensor([0, 2, 4], dtype=torch.int32),
+                                    torch.tensor([0, 1, 0, 1]), values, size=(2, 2))
+
+    @onlyCPU
+    @dtypes(torch.double, torch.float, torch.int64)
+    def test_dense_to_from_sparse_csr(self, device, dtype):
+        dense = torch.tensor([[4, 5, 0], [0, 0, 0], [1, 0, 0]], dtype=dtype, device=device)
+        sparse = dense.to_sparse_csr()
+
+        self.assertEqual(torch.tensor([0, 2, 2, 3]), sparse.crow_indices())
+        self.assertEqual(torch.tensor([0, 1, 0]), sparse.col_indices())
+        self.assertEqual(torch.tensor([4, 5, 1], dtype=dtype), sparse.values())
+        self.assertEqual(dense, sparse.to_dense())
+        self.assertIs(sparse, sparse.to_sparse_csr())
+
+        for rows, cols in [(0, 5), (5, 0), (7, 13), (100, 50)]:
+            dense = self._random_dense(rows, cols, 0.3, dtype, device)
+            self.assertEqual(dense, dense.to_sparse_csr().to_dense())
+
+    @onlyCPU
+    @dtypes(torch.double)
+    def test_coo_to_from_sparse_csr(self, device, dtype):
+        for coalesced in [True, False]:
+            i = torch.tensor([[2, 0, 2, 1, 0], [1, 3, 1, 0, 3]])
+            v = torch.tensor([1, 2, 3, 4, 5], dtype=dtype)
+            coo = torch.sparse_coo_tensor(i, v, (3, 4))
+            if coalesced:
+                coo = coo.coalesce()
+
+            csr = coo.to_sparse_csr()
+            self.assertEqual(coo.to_dense(), csr.to_dense())
+            # rows 0 and 2 each hold one entry twice before coalescing
+            expected_crow = [0, 1, 2, 3] if coalesced else [0, 2, 3, 5]
+            self.assertEqual(torch.tensor(expected_crow), csr.crow_indices())
+            # duplicates are kept rather than summed during conversion
+            self.assertEqual(3 if coalesced else 5, csr._nnz())
+
+            back = csr.to_sparse()
+            self.assertEqual(coo.to_dense(), back.to_dense())
+            self.assertEqual(coalesced, back.is_coalesced())
+
+    @onlyCPU
+    @dtypes(torch.double, torch.float)
+    def test_csr_matvec(self, device, dtype):
+        for index_dtype in [torch.int32, torch.int64]:
+            dense = self._random_dense(20, 30, 0.2, dtype, device)
+            csr = torch.sparse_csr_tensor(*self._csr_parts(dense, index_dtype), size=dense.shape)
+            vec = torch.randn(30, dtype=dtype, device=device)
+            self.assertEqual(dense.matmul(vec), csr.matmul(vec))
+            self.assertEqual(dense.mv(vec), torch.mv(csr, vec))
+
+    @onlyCPU
+    @dtypes(torch.double, torch.float)
+    def test_csr_mm(self, device, dtype):
+        for (m, k, n), index_dtype in itertools.product([(10, 20, 5), (1, 300, 600), (50, 0, 3)],
+                                                        [torch.int32, torch.int64]):
+            dense = self._random_dense(m, k, 0.2, dtype, device)
+            csr = torch.sparse_csr_tensor(*self._csr_parts(dense, index_dtype), size=dense.shape)
+            y = torch.randn(k, n, dtype=dtype, device=device)
+            t = torch.randn(m, n, dtype=dtype, device=device)
+
+            self.assertEqual(dense.mm(y), torch.mm(csr, y))
+            self.assertEqual(torch.addmm(t, dense, y, beta=0.5, alpha=2),
+                             torch.addmm(t, csr, y, beta=0.5, alpha=2))
+            self.assertEqual(torch.addmm(t, dense, y, beta=0), torch.addmm(t, csr, y, beta=0))
+
+            out = torch.empty(n, m, dtype=dtype, device=device).t()
+            torch.addmm(t, csr, y, out=out)
+            self.assertEqual(torch.addmm(t, dense, y), out)
+
+            # dense @ CSR
+            x = torch.randn(n, m, dtype=dtype, device=device)
+            self.assertEqual(x.mm(dense), torch.mm(x, csr))
+
+    @onlyCPU
+    @dtypes(torch.double, torch.float)
+    def test_csr_spgemm(self, device, dtype):
+        for index_dtypes in [(torch.int64, torch.int64), (torch.int32, torch.int32), (torch.int32, torch.int64)]:
+            a = self._random_dense(30, 40, 0.1, dtype, device)
+            b = self._random_dense(40, 25, 0.1, dtype, device)
+            a_csr = torch.sparse_csr_tensor(*self._csr_parts(a, index_dtypes[0]), size=a.shape)
+            b_csr = torch.sparse_csr_tensor(*self._csr_parts(b, index_dtypes[1]), size=b.shape)
+
+            c = torch.mm(a_csr, b_csr)
+            self.assertEqual(torch.sparse_csr, c.layout)
+            self.assertEqual(a.mm(b), c.to_dense())
+            for row in range(c.shape[0]):
+                cols = c.col_indices()[c.crow_indices()[row]:c.crow_indices()[row + 1]]
+                self.assertTrue(bool((cols[1:] > cols[:-1]).all()))
+
+    @onlyCPU
+    @dtypes(torch.double)
+    def test_coo_addmm_matches_dense(self, device, dtype):
+        # coalesced COO inputs go through the CSR kernel
+        for coalesced in [True, False]:
+            dense = self._random_dense(40, 30, 0.2, dtype, device)
+            coo = dense.to_sparse()
+            if not coalesced:
+                coo = torch.sparse_coo_tensor(torch.cat([coo._indices(), coo._indices()], 1),
+                                              torch.cat([coo._values(), coo._values()]) / 2, coo.shape)
+            y = torch.randn(30, 7, dtype=dtype, device=device)
+            t = torch.randn(40, 7, dtype=dtype, device=device)
+            self.assertEqual(torch.addmm(t, dense, y, beta=2, alpha=0.5),
+                             torch.addmm(t, coo, y, beta=2, alpha=0.5))
+
+    def _csr_parts(self, dense, index_dtype):
+        csr = dense.to_sparse_csr()
+        return (csr.crow_indices().to(index_dtype), csr.col_indices().to(index_dtype), csr.values())
+
+
+instantiate_device_type_tests(TestSparseCSR, globals())
+
+if __name__ == '__main__':
+    run_tests()
@@ -9,7 +9,7 @@ from torch.testing._internal.common_utils import \
     (TestCase, run_tests, TEST_WITH_SLOW, TEST_NUMPY, TEST_LIBROSA, slowAwareTest)
 from torch.testing._internal.common_device_type import \
     (instantiate_device_type_tests, dtypes, onlyOnCPUAndCUDA, precisionOverride,
-     skipCPUIfNoMkl, skipCUDAIfRocm, deviceCountAtLeast, onlyCUDA)
+     skipCPUIfNoMkl, skipCUDAIfRocm, deviceCountAtLeast, onlyCUDA, onlyCPU)
 from torch.autograd.gradcheck import gradgradcheck
 
 from distutils.version import LooseVersion
@@ -96,6 +96,16 @@ def _stft_reference(x, hop_length, window):
     return X
 
 
+@contextmanager
+def _mkl_fft_disabled():
+    prev = torch._C._get_mkl_fft_enabled()
+    torch._C._set_mkl_fft_enabled(False)
+    try:
+        yield
+    finally:
+        torch._C._set_mkl_fft_enabled(prev)
+
+
 # Tests of functions related to Fourier analysis in the torch.fft namespace
 class TestFFT(TestCase):
     exact_dtype = True
@@ -408,6 +418,44 @@ class TestFFT(TestCase):
                     actual = fn(input, s, dim, norm)
                     self.assertEqual(actual, expected, exact_dtype=exact_dtype)
 
+    # The builtin FFT is used on CPU when MKL is unavailable or disabled
+    @onlyCPU
+    @unittest.skipIf(not TEST_NUMPY, 'NumPy not found')
+    @precisionOverride({torch.complex64: 1e-4, torch.float: 1e-4})
+    @dtypes(torch.float, torch.double, torch.complex64, torch.complex128)
+    def test_fft_builtin_numpy(self, device, dtype):
+        exact_dtype = dtype in (torch.double, torch.complex128)
+        # Includes lengths made of radix 2, 4 and odd-radix passes, and prime
+        # lengths large enough to use Bluestein's algorithm
+        sizes = (1, 2, 7, 12, 45, 64, 67, 100, 127, 256, 1000)
+        fft_functions = ['fft', 'ifft', 'irfft', 'hfft']
+        if not dtype.is_complex:
+            fft_functions += ['rfft', 'ihfft']
+
+        with _mkl_fft_disabled():
+            for n in sizes:
+                input = torch.randn(3, n, device=device, dtype=dtype)
+                for fname in fft_functions:
+                    if fname in ('irfft', 'hfft') and n == 1:
+                        continue
+                    torch_fn = getattr(torch.fft, fname)
+                    numpy_fn = getattr(np.fft, fname)
+                    expected = numpy_fn(input.cpu().numpy(), axis=-1, norm="ortho")
+                    actual = torch_fn(input, dim=-1, norm="ortho")
+                    self.assertEqual(actual, expected, exact_dtype=exact_dtype)
+
+            for shape, dim in (((4, 6, 9), None), ((5, 8, 7), (0, 2)), ((2, 3, 10, 67), (1, 2, 3))):
+                input = torch.randn(*shape, device=device, dtype=dtype)
+                fftn_functions = ['fftn', 'ifftn', 'irfftn']
+                if not dtype.is_complex:
+                    fftn_functions += ['rfftn']
+                for fname in fftn_functions:
+                    torch_fn = getattr(torch.fft, fname)
+                    numpy_fn = getattr(np.fft, fname)
+                    expected = numpy_fn(input.cpu().numpy(), axes=dim)
+                    actual = torch_fn(input, dim=dim)
+                    self.assertEqual(actual, expected, exact_dtype=exact_dtype)
+
     @skipCUDAIfRocm
     @skipCPUIfNoMkl
     @onlyOnCPUAndCUDA
@@ -1,3 +1,5 @@
+import json
+
 import numpy as np
 import torch
 from torch import nn
@@ -154,6 +156,18 @@ class TestStaticRuntime(TestCase):
         metrics = attention_a.benchmark_individual_ops(
             [src, src, src, src_mask], {}, 10, 10
         )
+        num_nodes = len(metrics.time_per_node)
+        self.assertEqual(len(metrics.bytes_per_node), num_nodes)
+        self.assertEqual(len(metrics.input_shapes_per_node), num_nodes)
+        self.assertEqual(
+            sum(metrics.instances_per_node_type.values()), num_nodes)
+        self.assertEqual(
+            set(metrics.allocations_per_node_type.keys()),
+            set(metrics.time_per_node_type.keys()))
+        report = json.loads(metrics.to_json())
+        self.assertEqual(len(report["nodes"]), num_nodes)
+        trace = json.loads(metrics.to_chrome_trace())
+        self.assertEqual(len(trace["traceEvents"]), num_nodes)
 
     def test_mlp(self):
         # Arguments taken from benchmark script, ./bench/dlrm_s_benchmark.sh
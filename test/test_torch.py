@@ -10536,6 +10536,41 @@ class TestTorchDeviceType(TestCase):
         check(torch.median, [[nan, nan], [1, 2]], [1], [[nan, 1]])
         check(torch.nanmedian, [[nan, nan], [1, 2]], [1], [[nan, 1.]])
 
+    # Long slices are selected with all threads on CPU
+    @dtypes(torch.int, torch.long, torch.float, torch.double)
+    def test_median_large_slice(self, device, dtype):
+        n = (1 << 17) + 1
+        t = torch.randint(-1000, 1000, (2, n), device=device).to(dtype)
+        if dtype.is_floating_point:
+            t = t / 8
+            t[1, ::1001] = float('nan')
+        for op in [torch.median, torch.nanmedian]:
+            values, indices = op(t, 1)
+            self.assertEqual(values, t.gather(1, indices.unsqueeze(1)).squeeze(1))
+            for i in range(2):
+                row = t[i]
+                num_nan = int(row.isnan().sum())
+                if op == torch.median and num_nan > 0:
+                    self.assertTrue(values[i].isnan())
+                    continue
+                k = (n - num_nan - 1) // 2
+                self.assertEqual(values[i], row.sort()[0][k])
+                self.assertEqual(op(row), row.sort()[0][k])
+
+    @dtypes(torch.float, torch.double)
+    @unittest.skipIf(not TEST_NUMPY, "Numpy not found")
+    def test_quantile_large_slice(self, device, dtype):
+        n = (1 << 17) + 3
+        a = torch.randn(3, n, dtype=dtype, device=device)
+        a[1, ::997] = float('nan')
+        q = torch.tensor([0.5, 0.9, 0.99, 0., 1.], dtype=dtype, device=device)
+        for op, keepdim in product(['quantile', 'nanquantile'], [True, False]):
+            torch_op = getattr(torch, op)
+            numpy_op = getattr(np, op)
+            for dim in [None, 1]:
+                result = torch_op(a, q, dim, keepdim)
+                expected = numpy_op(a.cpu().numpy(), q.cpu().numpy(), dim, keepdims=keepdim)
+                self.assertEqual(result.cpu(), torch.from_numpy(np.array(expected)).type(result.type()))
 
     @onlyOnCPUAndCUDA
     @dtypes(torch.float, torch.double)
@@ -11671,6 +11706,35 @@ class TestTorchDeviceType(TestCase):
             self.assertTrue(y.is_contiguous())
             self.assertEqual(expected, actual)
 
+    @onlyCPU
+    def test_cdist_topk(self, device):
+        for p, (r1, r2, k) in product([2, 1, 0.5, float('inf')], [(5, 7, 3), (130, 1100, 10), (3, 4, 4), (3, 4, 0)]):
+            x = torch.randn(r1, 6, dtype=torch.double, device=device)
+            y = torch.randn(r2, 6, dtype=torch.double, device=device)
+            values, indices = torch.cdist_topk(x, y, k, p=p)
+            expected = self._brute_cdist(x, y, p=p).topk(k, largest=False)
+            self.assertEqual(expected.values, values)
+            self.assertEqual(values, self._brute_cdist(x, y, p=p).gather(-1, indices))
+
+        values, indices = torch.cdist_topk(torch.randn(0, 6, device=device), torch.randn(4, 6, device=device), 2)
+        self.assertEqual((0, 2), values.shape)
+        self.assertEqual((0, 2), indices.shape)
+
+        # broadcast batch dimensions
+        x = torch.randn(2, 1, 70, 3, dtype=torch.double, device=device)
+        y = torch.randn(3, 600, 3, dtype=torch.double, device=device)
+        values, indices = torch.cdist_topk(x, y, 5)
+        self.assertEqual((2, 3, 70, 5), values.shape)
+        self.assertEqual(self._brute_cdist(x, y, p=2).topk(5, largest=False).values, values)
+
+        # ties are ordered by index
+        x = torch.zeros(2, 3, device=device)
+        y = torch.zeros(4, 3, device=device)
+        self.assertEqual(torch.arange(4, device=device).expand(2, 4), torch.cdist_topk(x, y, 4).indices)
+
+        with self.assertRaisesRegex(RuntimeError, "must be between 0"):
+            torch.cdist_topk(x, y, 5)
+
     def test_multinomial_constraints(self, device):
         x = torch.empty(1, 2, 3, dtype=torch.double, device=device)
         self.assertRaisesRegex(
@@ -14865,6 +14929,50 @@ class TestTorchDeviceType(TestCase):
         self.assertEqual(sort_topk, topk[0])      # check values
         self.assertEqual(sort_topk, a[topk[1]])   # check indices
 
+    # Long 1-D sorts take the parallel radix / merge sort path on CPU
+    @dtypes(torch.bool, torch.uint8, torch.int8, torch.int32, torch.int64,
+            torch.half, torch.float, torch.double)
+    def test_sort_large_slice(self, device, dtype):
+        n = (1 << 17) + 7
+        if dtype == torch.bool:
+            x = torch.randint(0, 2, (n,), device=device).to(dtype)
+        elif dtype.is_floating_point:
+            x = torch.randint(-1000, 1000, (n,), device=device).to(dtype) / 8
+            x[::1001] = float('nan')
+        else:
+            x = torch.randint(-100 if dtype.is_signed else 0, 100, (n,), device=device, dtype=dtype)
+        for descending in (False, True):
+            for t in (x, torch.stack((x, x), 1)[:, 0]):
+                values, indices = t.sort(descending=descending)
+                expected = torch.from_numpy(np.sort(t.cpu().float().numpy())).to(dtype)
+                if descending:
+                    expected = expected.flip(0)
+                self.assertEqual(values.cpu(), expected)
+                self.assertEqual(t[indices], values)
+                self.assertEqual(indices.sort()[0].cpu(), torch.arange(n))
+
+    # Long slices take the heap (small k) or radix select (large k) path on CPU
+    @dtypes(torch.uint8, torch.int8, torch.int32, torch.int64, torch.float, torch.double)
+    def test_topk_large_slice(self, device, dtype):
+        n = (1 << 17) + 7
+        if dtype.is_floating_point:
+            x = torch.randint(-1000, 1000, (n,), device=device).to(dtype) / 8
+            x[::1001] = float('nan')
+        else:
+            x = torch.randint(-100 if dtype.is_signed else 0, 100, (n,), device=device, dtype=dtype)
+        for k, largest in product([1, 10, 64, 65, 1000, n], [True, False]):
+            for t in (x, torch.stack((x, x), 1)[:, 0], torch.stack((x, x.flip(0)))):
+                values, indices = t.topk(k, largest=largest)
+                expected = t.sort(descending=largest)[0][..., :k]
+                self.assertEqual(values, expected)
+                self.assertEqual(t.gather(-1, indices), values)
+                sorted_indices = indices.sort()[0]
+                self.assertTrue(bool((sorted_indices[..., 1:] > sorted_indices[..., :-1]).all()))
+
+                values, indices = t.topk(k, largest=largest, sorted=False)
+                self.assertEqual(values.sort(descending=largest)[0], expected)
+                self.assertEqual(t.gather(-1, indices), values)
+
     @dtypesIfCUDA(*torch.testing.get_all_fp_dtypes())
     @dtypes(torch.float, torch.double)
     def test_topk_nonfinite(self, device, dtype):
@@ -15399,6 +15507,24 @@ class TestTorchDeviceType(TestCase):
             self._test_unique_with_expects(device, dtype, f, x, expected_unique, expected_inverse, expected_counts, (3, 3))
             self._test_unique_scalar_empty(dtype, device, f)
 
+    # Large enough for the CPU kernels to split the input between threads
+    @unittest.skipIf(not TEST_NUMPY, "Numpy not found")
+    @dtypes(torch.uint8, torch.int32, torch.int64, torch.float)
+    def test_unique_large(self, device, dtype):
+        x = torch.randint(0, 100 if dtype == torch.uint8 else 5000, (200003,), device=device).to(dtype)
+        for y in (x, x.sort()[0]):
+            expected = np.unique(y.cpu().numpy(), return_inverse=True, return_counts=True)
+            unique, inverse, counts = torch.unique(y, sorted=True, return_inverse=True, return_counts=True)
+            self.assertEqual(unique.cpu(), torch.from_numpy(expected[0]))
+            self.assertEqual(inverse.cpu(), torch.from_numpy(expected[1]))
+            self.assertEqual(counts.cpu(), torch.from_numpy(expected[2]))
+
+            unique, inverse, counts = torch.unique_consecutive(y, return_inverse=True, return_counts=True)
+            self.assertEqual(unique[inverse], y)
+            self.assertEqual(counts.sum().item(), y.numel())
+            self.assertTrue((unique[1:] != unique[:-1]).all())
+            self.assertEqual(counts.cumsum(0)[:-1], (y[1:] != y[:-1]).nonzero().view(-1) + 1)
+
     @dtypesIfCUDA(torch.half, torch.float, torch.double)
     @dtypes(torch.float, torch.double)
     def test_erfinv(self, device, dtype):
@@ -901,6 +901,19 @@ Returns :attr:`self` if :attr:`self` is a coalesced tensor.
   Throws an error if :attr:`self` is not a sparse COO tensor.
 """)
 
+add_docstr_all('col_indices',
+               r"""
+col_indices() -> Tensor
+
+Return the column indices tensor of a sparse CSR tensor, with one entry per
+stored value.
+
+.. warning::
+  Throws an error if :attr:`self` is not a sparse CSR tensor.
+
+See also :meth:`Tensor.crow_indices` and :meth:`Tensor.values`.
+""")
+
 add_docstr_all('contiguous',
                r"""
 contiguous(memory_format=torch.contiguous_format) -> Tensor
@@ -988,6 +1001,19 @@ count_nonzero(dim=None) -> Tensor
 See :func:`torch.count_nonzero`
 """)
 
+add_docstr_all('crow_indices',
+               r"""
+crow_indices() -> Tensor
+
+Return the compressed row indices tensor of a sparse CSR tensor: the values
+of row ``i`` are stored at positions ``crow_indices[i]`` to
+``crow_indices[i + 1] - 1`` of :meth:`Tensor.col_indices` and
+:meth:`Tensor.values`.
+
+.. warning::
+  Throws an error if :attr:`self` is not a sparse CSR tensor.
+""")
+
 add_docstr_all('cross',
                r"""
 cross(other, dim=-1) -> Tensor
@@ -1577,16 +1603,17 @@ add_docstr_all('values',
                r"""
 values() -> Tensor
 
-Return the values tensor of a :ref:`sparse COO tensor <sparse-coo-docs>`.
+Return the values tensor of a :ref:`sparse COO tensor <sparse-coo-docs>`
+or of a sparse CSR tensor.
 
 .. warning::
-  Throws an error if :attr:`self` is not a sparse COO tensor.
+  Throws an error if :attr:`self` is not a sparse COO or CSR tensor.
 
 See also :meth:`Tensor.indices`.
 
 .. note::
-  This method can only be called on a coalesced sparse tensor. See
-  :meth:`Tensor.coalesce` for details.
+  For sparse COO tensors, this method can only be called on a coalesced
+  sparse tensor. See :meth:`Tensor.coalesce` for details.
 """)
 
 add_docstr_all('gt', r"""
@@ -3781,6 +3808,24 @@ Example::
            size=(3, 3), nnz=1, layout=torch.sparse_coo)
 """)
 
+add_docstr_all('to_sparse_csr',
+               r"""
+to_sparse_csr() -> Tensor
+Returns a copy of a 2-D strided or sparse COO tensor in compressed sparse row
+layout, ``torch.sparse_csr``. Returns :attr:`self` if it already is a sparse
+CSR tensor. A sparse COO tensor does not need to be coalesced: its duplicate
+entries are kept and summed by the CSR operations.
+
+Example::
+
+    >>> d = torch.tensor([[0, 0, 0], [9, 0, 10], [0, 0, 0]])
+    >>> d.to_sparse_csr()
+    tensor(crow_indices=tensor([0, 0, 2, 2]),
+           col_indices=tensor([0, 2]),
+           values=tensor([ 9, 10]),
+           size=(3, 3), nnz=2, layout=torch.sparse_csr)
+""")
+
 add_docstr_all('to_mkldnn',
                r"""
 to_mkldnn() -> Tensor
@@ -1415,6 +1415,48 @@ Example::
              -0.5790,  0.1497]])
 """.format(**common_args))
 
+add_docstr(torch.cdist_topk,
+           r"""
+cdist_topk(x1, x2, k, p=2.0) -> (Tensor, Tensor)
+
+For every row vector of :attr:`x1`, returns the :attr:`k` nearest row vectors
+of :attr:`x2` in p-norm distance, which is ``torch.cdist(x1, x2, p).topk(k,
+largest=False)`` without materializing the full distance matrix.
+
+The distances are computed tile by tile and merged into bounded per-row heaps,
+so the extra memory is proportional to the number of rows of :attr:`x1` times
+:attr:`k`. For ``p = 2`` the tiles are computed with matrix multiplications, as
+``torch.cdist`` does for large inputs.
+
+A namedtuple of `(values, indices)` is returned, where the `values` are the
+distances sorted in ascending order and the `indices` are the rows of
+:attr:`x2` they belong to. Equal distances are ordered by index.
+
+.. note::
+    Only CPU tensors are supported, and the result is not differentiable. Use
+    the returned indices to gather the rows of :attr:`x2` and recompute the
+    distances if gradients are needed.
+
+Args:
+    x1 (Tensor): input tensor of shape :math:`B \times P \times M`.
+    x2 (Tensor): input tensor of shape :math:`B \times R \times M`.
+    k (int): the number of neighbours, at most :math:`R`.
+    p (float, optional): p value for the p-norm distance, :math:`\in [0, \infty]`.
+
+Example::
+
+    >>> a = torch.tensor([[0.9041,  0.0196], [-0.3108, -2.4423], [-0.4821,  1.059]])
+    >>> b = torch.tensor([[-2.1763, -0.4713], [-0.6986,  1.3702]])
+    >>> torch.cdist_topk(a, b, 1)
+    torch.return_types.cdist_topk(
+    values=tensor([[2.0959],
+            [2.7138],
+            [0.3791]]),
+    indices=tensor([[1],
+            [0],
+            [1]]))
+""")
+
 add_docstr(torch.ceil,
            r"""
 ceil(input, *, out=None) -> Tensor
@@ -7028,6 +7070,47 @@ Example::
             [3, 2, 1, 0]])
 """.format(**common_args))
 
+add_docstr(torch.sparse_csr_tensor,
+           r"""
+sparse_csr_tensor(crow_indices, col_indices, values, size=None, *, dtype=None, device=None, requires_grad=False) -> Tensor
+
+Constructs a 2-D sparse tensor in compressed sparse row (CSR) format with
+specified values at the given :attr:`crow_indices` and :attr:`col_indices`.
+The values of row ``i`` are ``values[crow_indices[i]:crow_indices[i + 1]]``
+and are located at columns ``col_indices[crow_indices[i]:crow_indices[i + 1]]``.
+
+Args:
+    crow_indices (array_like): One-dimensional tensor of size ``rows + 1``.
+        ``crow_indices[0]`` must be 0, the last element must be the number of
+        non-zeros and the sequence must be non-decreasing.
+    col_indices (array_like): Column coordinates of each element in
+        :attr:`values`. Must have the same dtype as :attr:`crow_indices`,
+        which may be either ``torch.int32`` or ``torch.int64``.
+    values (array_like): Initial values for the tensor. Can be a list, tuple,
+        NumPy ``ndarray``, scalar, and other types.
+    size (list, tuple, or :class:`torch.Size`, optional): Size of the sparse tensor. If not
+        provided, the number of rows is inferred from :attr:`crow_indices` and the
+        number of columns is the minimum size big enough to hold all non-zero elements.
+
+Keyword args:
+    dtype (:class:`torch.dtype`, optional): the desired data type of returned tensor.
+        Default: if None, infers data type from :attr:`values`.
+    device (:class:`torch.device`, optional): the desired device of returned tensor.
+        Only CPU tensors are currently supported.
+    {requires_grad}
+
+Example::
+
+    >>> crow_indices = torch.tensor([0, 2, 4])
+    >>> col_indices = torch.tensor([0, 1, 0, 1])
+    >>> values = torch.tensor([1, 2, 3, 4])
+    >>> torch.sparse_csr_tensor(crow_indices, col_indices, values, dtype=torch.double)
+    tensor(crow_indices=tensor([0, 2, 4]),
+           col_indices=tensor([0, 1, 0, 1]),
+           values=tensor([1., 2., 3., 4.]),
+           size=(2, 2), nnz=4, dtype=torch.float64, layout=torch.sparse_csr)
+""".format(**factory_common_args))
+
 add_docstr(torch.sparse_coo_tensor,
            r"""
 sparse_coo_tensor(indices, values, size=None, *, dtype=None, device=None, requires_grad=False) -> Tensor
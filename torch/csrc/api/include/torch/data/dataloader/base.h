@@ -37,6 +37,9 @@ class DataLoaderBase {
       std::unique_ptr<Dataset> main_thread_dataset = nullptr)
       : options_(std::move(options)),
         main_thread_dataset_(std::move(main_thread_dataset)),
+        shuttle_(
+            options_.lock_free_queues ? options_.max_jobs + options_.workers
+                                      : 0),
         sequencer_(new_sequencer()) {}
 
   virtual ~DataLoaderBase() {
@@ -96,6 +99,27 @@ class DataLoaderBase {
     return options_;
   }
 
+  /// Counters for the time spent waiting on the queues between the main
+  /// thread and the worker threads.
+  struct WaitStats {
+    /// Waits of the main thread for batches. These mean that training is
+    /// starved by data loading, i.e. by the dataset or the I/O behind it.
+    detail::QueueWaitStats results;
+    /// Waits of worker threads for jobs. These mean that workers are idle
+    /// because batches are produced faster than they are consumed, or
+    /// because an epoch has ended.
+    detail::QueueWaitStats jobs;
+  };
+
+  /// Returns the wait-time counters accumulated since the DataLoader was
+  /// constructed. They stay zero if there are no worker threads.
+  WaitStats wait_stats() const {
+    WaitStats stats;
+    stats.results = shuttle_.result_wait_stats();
+    stats.jobs = shuttle_.job_wait_stats();
+    return stats;
+  }
+
  protected:
   /// Simple mix-in to give something a sequence number.
   struct Sequenced {
@@ -178,18 +202,41 @@ class DataLoaderBase {
     return nullopt;
   }
 
-  /// The function that worker threads run.
+  /// The function that worker threads run. Results are pushed in groups of
+  /// up to `results_per_push`, but a worker pushes whatever results it holds
+  /// before it waits for a new job, so no result waits on a future job.
   void worker_thread(Dataset& dataset) {
+    std::vector<Result> results;
     while (true) {
-      auto job = shuttle_.pop_job();
-      if (job.quit) {
+      optional<Job> job;
+      if (!results.empty()) {
+        job = shuttle_.try_pop_job();
+      }
+      if (!job) {
+        if (!results.empty()) {
+          shuttle_.push_results(std::move(results));
+          results.clear();
+        }
+        job = shuttle_.pop_job();
+      }
+      if (job->quit) {
         break;
       }
+      optional<Result> result;
       try {
-        auto batch = dataset.get_batch(std::move(*job.batch_request));
-        shuttle_.push_result({std::move(batch), job.sequence_number});
+        auto batch = dataset.get_batch(std::move(*job->batch_request));
+        result.emplace(std::move(batch), job->sequence_number);
       } catch (...) {
-        shuttle_.push_result({std::current_exception(), job.sequence_number});
+        result.emplace(std::current_exception(), job->sequence_number);
+      }
+      if (options_.results_per_push <= 1) {
+        shuttle_.push_result(std::move(*result));
+        continue;
+      }
+      results.push_back(std::move(*result));
+      if (results.size() >= options_.results_per_push) {
+        shuttle_.push_results(std::move(results));
+        results.clear();
       }
     }
   }
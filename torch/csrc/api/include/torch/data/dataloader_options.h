@@ -37,6 +37,19 @@ struct DataLoaderOptions {
   /// Whether to omit the last batch if it contains less than `batch_size`
   /// examples.
   TORCH_ARG(bool, drop_last) = false;
+
+  /// Whether to pass jobs and results between the main thread and worker
+  /// threads through bounded lock-free queues instead of mutex-guarded ones.
+  /// A thread that finds its queue empty spins briefly before it sleeps, which
+  /// costs some CPU time but avoids lock contention when many workers produce
+  /// small batches.
+  TORCH_ARG(bool, lock_free_queues) = false;
+
+  /// The maximum number of finished batches a worker thread hands to the main
+  /// thread in one queue operation. A worker only holds on to finished batches
+  /// while more jobs are waiting for it, so larger values reduce queue traffic
+  /// at the cost of some latency, but never stall the main thread for long.
+  TORCH_ARG(size_t, results_per_push) = 1;
 };
 
 /// Like `DataLoaderOptions`, but without any unconfigured state.
@@ -52,7 +65,9 @@ struct FullDataLoaderOptions {
         max_jobs(options.max_jobs().value_or(2 * workers)),
         timeout(options.timeout()),
         enforce_ordering(options.enforce_ordering()),
-        drop_last(options.drop_last()) {}
+        drop_last(options.drop_last()),
+        lock_free_queues(options.lock_free_queues()),
+        results_per_push(options.results_per_push()) {}
 
   size_t batch_size;
   size_t workers;
@@ -60,6 +75,8 @@ struct FullDataLoaderOptions {
   optional<std::chrono::milliseconds> timeout;
   bool enforce_ordering;
   bool drop_last;
+  bool lock_free_queues;
+  size_t results_per_push;
 };
 } // namespace data
 } // namespace torch
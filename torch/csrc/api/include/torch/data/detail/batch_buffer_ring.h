@@ -0,0 +1,99 @@
+#pragma once
+
+#include <torch/types.h>
+
+#include <c10/util/Exception.h>
+
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+namespace torch {
+namespace data {
+namespace detail {
+
+/// A fixed set of batch tensors that collations write into instead of
+/// allocating a new tensor for every batch.
+///
+/// A buffer is handed out as a view of its storage. It is free again once
+/// every tensor sharing that storage has been destroyed, i.e. once the batch
+/// that was collated into it has been consumed. Buffers are visited in round
+/// robin order, so a consumer that releases batches in the order it received
+/// them will find the next buffer free on the first try. If all buffers are in
+/// use, a fresh tensor is allocated instead of waiting, so that a consumer
+/// holding on to batches can never block the workers producing them.
+///
+/// All methods are thread safe: copies of a collation that live in different
+/// worker threads share one ring.
+class BatchBufferRing {
+ public:
+  /// Creates a ring of `capacity` buffers. Buffers are allocated lazily, when
+  /// the first batch of a given shape arrives. If `pin_memory` is true, buffers
+  /// for CPU batches are allocated in page-locked memory, from which they can
+  /// be copied to CUDA devices asynchronously. Note that the ring cannot see
+  /// such copies: a batch must stay alive (or the stream be synchronized)
+  /// until a `non_blocking` copy out of it has completed.
+  BatchBufferRing(size_t capacity, bool pin_memory)
+      : buffers_(capacity), pin_memory_(pin_memory) {
+    TORCH_CHECK(capacity > 0, "BatchBufferRing needs at least one buffer");
+  }
+
+  /// Returns a tensor of the given `sizes` and `options` that no consumer is
+  /// using. Batches smaller than a free buffer (such as the last batch of an
+  /// epoch) are served from a prefix of that buffer.
+  Tensor acquire(IntArrayRef sizes, TensorOptions options) {
+    TORCH_CHECK(!sizes.empty(), "Batch buffers need a batch dimension");
+    if (pin_memory_ && options.device().is_cpu()) {
+      options = options.pinned_memory(true);
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < buffers_.size(); ++i) {
+      const size_t slot = (next_ + i) % buffers_.size();
+      Tensor& buffer = buffers_[slot];
+      if (buffer.defined() && buffer.storage().use_count() > 1) {
+        continue;
+      }
+      if (!fits(buffer, sizes, options)) {
+        buffer = torch::empty(sizes, options);
+      }
+      next_ = slot + 1;
+      // Narrowing (even to the full size) creates a separate view, so that
+      // nothing the consumer does to its tensor can reach the buffer itself.
+      return buffer.narrow(/*dim=*/0, /*start=*/0, sizes[0]);
+    }
+    return torch::empty(sizes, options);
+  }
+
+  /// Stacks `tensors` along a new first dimension into a free buffer.
+  Tensor stack(TensorList tensors) {
+    TORCH_CHECK(!tensors.empty(), "stack expects a non-empty TensorList");
+    std::vector<int64_t> sizes;
+    sizes.reserve(tensors[0].dim() + 1);
+    sizes.push_back(static_cast<int64_t>(tensors.size()));
+    sizes.insert(
+        sizes.end(), tensors[0].sizes().begin(), tensors[0].sizes().end());
+    Tensor batch = acquire(sizes, tensors[0].options());
+    torch::stack_out(batch, tensors);
+    return batch;
+  }
+
+ private:
+  static bool fits(
+      const Tensor& buffer,
+      IntArrayRef sizes,
+      const TensorOptions& options) {
+    return buffer.defined() && buffer.dtype() == options.dtype() &&
+        buffer.device() == options.device() &&
+        buffer.dim() == static_cast<int64_t>(sizes.size()) &&
+        buffer.size(0) >= sizes[0] &&
+        buffer.sizes().slice(1) == sizes.slice(1);
+  }
+
+  std::mutex mutex_;
+  std::vector<Tensor> buffers_;
+  size_t next_ = 0;
+  const bool pin_memory_;
+};
+} // namespace detail
+} // namespace data
+} // namespace torch
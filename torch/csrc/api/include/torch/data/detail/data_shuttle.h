@@ -7,7 +7,9 @@
 #include <c10/util/Optional.h>
 
 #include <chrono>
+#include <deque>
 #include <utility>
+#include <vector>
 
 namespace torch {
 namespace data {
@@ -22,9 +24,17 @@ namespace detail {
 /// dequeues a result is the count of in-flight jobs decremented. When the main
 /// thread attempts to dequeue a job but no jobs are in-flight, that means the
 /// epoch is complete and `pop_result` returns an empty optional.
+///
+/// Workers may hand over several results in one queue operation with
+/// `push_results`, which the main thread then pops one by one.
 template <typename Job, typename Result>
 class DataShuttle {
  public:
+  /// Creates the shuttle's queues, which are lock-free if
+  /// `lock_free_capacity` is non-zero (see `Queue`).
+  explicit DataShuttle(size_t lock_free_capacity = 0)
+      : new_jobs_(lock_free_capacity), results_(lock_free_capacity) {}
+
   /// Pushes a new job. Called by the main thread.
   void push_job(Job job) {
     new_jobs_.push(std::move(job));
@@ -33,7 +43,17 @@ class DataShuttle {
 
   /// Pushes the result of a job. Called by worker threads.
   void push_result(Result result) {
-    results_.push(std::move(result));
+    ResultGroup group;
+    group.result = std::move(result);
+    results_.push(std::move(group));
+  }
+
+  /// Pushes the results of several jobs at once. Called by worker threads.
+  void push_results(std::vector<Result> results) {
+    AT_ASSERT(!results.empty());
+    ResultGroup group;
+    group.results = std::move(results);
+    results_.push(std::move(group));
   }
 
   /// Returns the next job, blocking until there is one available. Called by
@@ -42,12 +62,36 @@ class DataShuttle {
     return new_jobs_.pop();
   }
 
+  /// Returns the next job if one is available right away. Called by worker
+  /// threads.
+  optional<Job> try_pop_job() {
+    Job job;
+    if (new_jobs_.try_pop(job)) {
+      return job;
+    }
+    return nullopt;
+  }
+
   /// Returns the result of a job, or nullopt if all jobs were exhausted. Called
   /// by the main thread.
   optional<Result> pop_result(
       optional<std::chrono::milliseconds> timeout = nullopt) {
     if (in_flight_jobs_ > 0) {
-      auto result = results_.pop(timeout);
+      optional<Result> result;
+      if (popped_results_.empty()) {
+        ResultGroup group = results_.pop(timeout);
+        if (group.result) {
+          result = std::move(group.result);
+        } else {
+          for (auto& grouped : group.results) {
+            popped_results_.push_back(std::move(grouped));
+          }
+        }
+      }
+      if (!result) {
+        result = std::move(popped_results_.front());
+        popped_results_.pop_front();
+      }
       --in_flight_jobs_;
       return result;
     }
@@ -72,14 +116,34 @@ class DataShuttle {
     return in_flight_jobs_;
   }
 
+  /// Returns how long worker threads waited for new jobs.
+  QueueWaitStats job_wait_stats() const {
+    return new_jobs_.wait_stats();
+  }
+
+  /// Returns how long the main thread waited for results.
+  QueueWaitStats result_wait_stats() const {
+    return results_.wait_stats();
+  }
+
  private:
+  /// What a worker pushes in one queue operation: either a single `result`,
+  /// which needs no allocation, or several `results` pushed together.
+  struct ResultGroup {
+    optional<Result> result;
+    std::vector<Result> results;
+  };
+
   /// The queue for jobs that are not yet in flight.
   Queue<Job> new_jobs_;
   /// The number of in-flight jobs.
   /// NOTE: Not atomic because only manipulated by the main thread.
   size_t in_flight_jobs_ = 0;
   /// The queue for results of finished jobs.
-  Queue<Result> results_;
+  Queue<ResultGroup> results_;
+  /// Results that were pushed together with one that was already popped.
+  /// NOTE: Only accessed by the main thread.
+  std::deque<Result> popped_results_;
 };
 
 } // namespace detail
@@ -1,24 +1,47 @@
 #pragma once
 
+#include <torch/csrc/utils/memory.h>
 #include <torch/types.h>
 
 #include <c10/util/Exception.h>
+#include <c10/util/MPMCQueue.h>
 
+#include <atomic>
 #include <chrono>
 #include <condition_variable>
 #include <cstddef>
+#include <cstdint>
 #include <mutex>
 #include <queue>
+#include <thread>
 
 namespace torch {
 namespace data {
 namespace detail {
 
-/// A basic locked, blocking MPMC queue.
+/// Counters for the time threads spent blocked in `Queue::pop()` because the
+/// queue was empty.
+struct QueueWaitStats {
+  /// The number of pops that found the queue empty and had to wait.
+  uint64_t waits = 0;
+  /// The total time spent waiting in those pops.
+  std::chrono::nanoseconds wait_time{0};
+};
+
+/// A blocking MPMC queue.
 ///
-/// Every `push` and `pop` is guarded by a mutex. A condition variable is used
-/// to communicate insertion of new elements, such that waiting threads will be
-/// woken up if they are currently waiting inside a call to `pop()`.
+/// By default, every `push` and `pop` is guarded by a mutex. A condition
+/// variable is used to communicate insertion of new elements, such that
+/// waiting threads will be woken up if they are currently waiting inside a
+/// call to `pop()`.
+///
+/// If constructed with a non-zero `lock_free_capacity`, elements are instead
+/// passed through a bounded lock-free `c10::MPMCQueue`, and a pop that finds
+/// the queue empty spins for a while before it sleeps on the condition
+/// variable. Producers only take the mutex when a consumer is asleep. Pushes
+/// that find the bounded queue full go to a mutex-guarded overflow queue, so
+/// the capacity is a performance hint, not a limit; elements that overflowed
+/// may be popped out of order.
 ///
 /// Note that this data structure is written specifically for use with the
 /// `DataLoader`. Its behavior is tailored to this use case and may not be
@@ -26,38 +49,86 @@ namespace detail {
 template <typename T>
 class Queue {
  public:
+  explicit Queue(size_t lock_free_capacity = 0) {
+    if (lock_free_capacity > 0) {
+      lock_free_queue_ =
+          torch::make_unique<c10::MPMCQueue<T>>(lock_free_capacity);
+    }
+  }
+
   /// Pushes a new value to the back of the `Queue` and notifies one thread on
   /// the waiting side about this event.
   void push(T value) {
-    {
+    if (lock_free_queue_ && lock_free_queue_->try_push(std::move(value))) {
+      // Pairs with the fence in `pop()`: either a consumer that is about to
+      // sleep sees the new element, or we see that it sleeps and wake it up.
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (num_sleeping_.load(std::memory_order_relaxed) == 0) {
+        return;
+      }
+      std::lock_guard<std::mutex> lock(mutex_);
+    } else {
       std::lock_guard<std::mutex> lock(mutex_);
       queue_.push(std::move(value));
+      ++queue_size_;
     }
     cv_.notify_one();
   }
 
+  /// Pops the front element into `value` if there is one, without blocking.
+  bool try_pop(T& value) {
+    if (lock_free_queue_ && lock_free_queue_->try_pop(value)) {
+      return true;
+    }
+    if (queue_size_.load() == 0) {
+      return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    return pop_locked(value);
+  }
+
   /// Blocks until at least one element is ready to be popped from the front of
   /// the queue. An optional `timeout` in seconds can be used to limit the time
   /// spent waiting for an element. If the wait times out, an exception is
   /// raised.
   T pop(optional<std::chrono::milliseconds> timeout = nullopt) {
-    std::unique_lock<std::mutex> lock(mutex_);
-    if (timeout) {
-      if (!cv_.wait_for(
-              lock, *timeout, [this] { return !this->queue_.empty(); })) {
-        // clang-format off
-        AT_ERROR(
-            "Timeout in DataLoader queue while waiting for next batch"
-            " (timeout was ", timeout->count(), " ms)");
-        // clang-format on
+    T value;
+    if (try_pop(value)) {
+      return value;
+    }
+    const auto start = std::chrono::steady_clock::now();
+    bool found = false;
+    for (int i = 0; !found && lock_free_queue_ && i < kSpinIterations; ++i) {
+      std::this_thread::yield();
+      found = try_pop(value);
+    }
+    if (!found) {
+      std::unique_lock<std::mutex> lock(mutex_);
+      ++num_sleeping_;
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      const auto ready = [&] {
+        return pop_locked(value) ||
+            (lock_free_queue_ && lock_free_queue_->try_pop(value));
+      };
+      if (timeout) {
+        found = cv_.wait_until(lock, start + *timeout, ready);
+      } else {
+        cv_.wait(lock, ready);
+        found = true;
       }
-    } else {
-      cv_.wait(lock, [this] { return !this->queue_.empty(); });
+      --num_sleeping_;
+    }
+    const auto waited = std::chrono::steady_clock::now() - start;
+    ++waits_;
+    wait_nanos_ +=
+        std::chrono::duration_cast<std::chrono::nanoseconds>(waited).count();
+    if (!found) {
+      // clang-format off
+      AT_ERROR(
+          "Timeout in DataLoader queue while waiting for next batch"
+          " (timeout was ", timeout->count(), " ms)");
+      // clang-format on
     }
-    AT_ASSERT(!queue_.empty());
-    T value = queue_.front();
-    queue_.pop();
-    lock.unlock();
     return value;
   }
 
@@ -66,18 +137,52 @@ class Queue {
   /// is assumed to be used to drain the queue during shutdown of a
   /// `DataLoader`.
   size_t clear() {
+    size_t size = 0;
+    T value;
+    while (lock_free_queue_ && lock_free_queue_->try_pop(value)) {
+      ++size;
+    }
     std::lock_guard<std::mutex> lock(this->mutex_);
-    const auto size = queue_.size();
-    while (!queue_.empty()) {
-      queue_.pop();
+    while (pop_locked(value)) {
+      ++size;
     }
     return size;
   }
 
+  /// Returns the wait-time counters accumulated since construction.
+  QueueWaitStats wait_stats() const {
+    QueueWaitStats stats;
+    stats.waits = waits_.load();
+    stats.wait_time = std::chrono::nanoseconds(wait_nanos_.load());
+    return stats;
+  }
+
  private:
+  /// The number of times `pop()` polls the lock-free queue before it sleeps.
+  static constexpr int kSpinIterations = 64;
+
+  /// Pops from the mutex-guarded queue. Requires `mutex_` to be held.
+  bool pop_locked(T& value) {
+    if (queue_.empty()) {
+      return false;
+    }
+    value = std::move(queue_.front());
+    queue_.pop();
+    --queue_size_;
+    return true;
+  }
+
+  /// Only set in lock-free mode.
+  std::unique_ptr<c10::MPMCQueue<T>> lock_free_queue_;
+  /// All elements in locked mode, overflow elements in lock-free mode.
   std::queue<T> queue_;
+  /// The size of `queue_`, readable without taking the mutex.
+  std::atomic<size_t> queue_size_{0};
   std::mutex mutex_;
   std::condition_variable cv_;
+  std::atomic<size_t> num_sleeping_{0};
+  std::atomic<uint64_t> waits_{0};
+  std::atomic<int64_t> wait_nanos_{0};
 };
 } // namespace detail
 } // namespace data
@@ -1,9 +1,13 @@
 #pragma once
 
+#include <torch/arg.h>
+#include <torch/data/detail/batch_buffer_ring.h>
 #include <torch/data/example.h>
 #include <torch/data/transforms/collate.h>
 #include <torch/types.h>
 
+#include <cstddef>
+#include <memory>
 #include <utility>
 #include <vector>
 
@@ -11,13 +15,62 @@ namespace torch {
 namespace data {
 namespace transforms {
 
+/// Options for the `Stack` collation.
+struct StackOptions {
+  /// The number of preallocated batches to collate into, per stacked tensor.
+  /// If zero, every batch is stacked into a newly allocated tensor. Otherwise
+  /// batches are written into a ring of reusable buffers, and a buffer is
+  /// reused once the batch that was collated into it has been destroyed. The
+  /// ring should be larger than the number of batches alive at once, i.e. the
+  /// `max_jobs` of the `DataLoader` plus the batches the training loop holds
+  /// on to; when it runs out, batches are allocated as usual.
+  TORCH_ARG(size_t, buffers) = 0;
+
+  /// Whether to allocate the buffers in pinned (page-locked) memory, from
+  /// which they can be copied to CUDA devices asynchronously. Requires
+  /// `buffers` to be non-zero, and a build with CUDA.
+  TORCH_ARG(bool, pin_memory) = false;
+};
+
+namespace detail {
+inline std::shared_ptr<data::detail::BatchBufferRing> make_buffer_ring(
+    const StackOptions& options) {
+  TORCH_CHECK(
+      options.buffers() > 0 || !options.pin_memory(),
+      "Stack can only pin memory when collating into preallocated buffers");
+  if (options.buffers() == 0) {
+    return nullptr;
+  }
+  return std::make_shared<data::detail::BatchBufferRing>(
+      options.buffers(), options.pin_memory());
+}
+
+inline Tensor stack(
+    const std::shared_ptr<data::detail::BatchBufferRing>& ring,
+    TensorList tensors) {
+  return ring ? ring->stack(tensors) : torch::stack(tensors);
+}
+} // namespace detail
+
 template <typename T = Example<>>
 struct Stack;
 
 /// A `Collation` for `Example<Tensor, Tensor>` types that stacks all data
 /// tensors into one tensor, and all target (label) tensors into one tensor.
+///
+/// \rst
+/// .. code-block:: cpp
+///
+///   auto dataset = datasets::MNIST("path/to/mnist")
+///     .map(transforms::Stack<>(
+///         transforms::StackOptions().buffers(8).pin_memory(true)));
+/// \endrst
 template <>
 struct Stack<Example<>> : public Collation<Example<>> {
+  explicit Stack(const StackOptions& options = {})
+      : data_buffers_(detail::make_buffer_ring(options)),
+        target_buffers_(detail::make_buffer_ring(options)) {}
+
   Example<> apply_batch(std::vector<Example<>> examples) override {
     std::vector<torch::Tensor> data, targets;
     data.reserve(examples.size());
@@ -26,8 +79,14 @@ struct Stack<Example<>> : public Collation<Example<>> {
       data.push_back(std::move(example.data));
       targets.push_back(std::move(example.target));
     }
-    return {torch::stack(data), torch::stack(targets)};
+    return {detail::stack(data_buffers_, data),
+            detail::stack(target_buffers_, targets)};
   }
+
+ private:
+  // Shared by all copies of the collation, e.g. in different worker threads.
+  std::shared_ptr<data::detail::BatchBufferRing> data_buffers_;
+  std::shared_ptr<data::detail::BatchBufferRing> target_buffers_;
 };
 
 /// A `Collation` for `Example<Tensor, NoTarget>` types that stacks all data
@@ -35,14 +94,20 @@ struct Stack<Example<>> : public Collation<Example<>> {
 template <>
 struct Stack<TensorExample>
     : public Collation<Example<Tensor, example::NoTarget>> {
+  explicit Stack(const StackOptions& options = {})
+      : data_buffers_(detail::make_buffer_ring(options)) {}
+
   TensorExample apply_batch(std::vector<TensorExample> examples) override {
     std::vector<torch::Tensor> data;
     data.reserve(examples.size());
     for (auto& example : examples) {
       data.push_back(std::move(example.data));
     }
-    return torch::stack(data);
+    return detail::stack(data_buffers_, data);
   }
+
+ private:
+  std::shared_ptr<data::detail::BatchBufferRing> data_buffers_;
 };
 } // namespace transforms
 } // namespace data
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <torch/arg.h>
+#include <torch/csrc/WindowsTorchApiMacro.h>
+#include <torch/ordered_dict.h>
+#include <torch/types.h>
+
+#include <cstdint>
+#include <string>
+
+namespace torch {
+namespace serialize {
+
+/// Options for `save_sharded`.
+struct TORCH_API ShardedSaveOptions {
+  /* implicit */ ShardedSaveOptions(int64_t num_shards = 8);
+
+  /// The maximum number of files the tensors written by one save are spread
+  /// over. Tensors are balanced across the shards by size, and the shards are
+  /// written concurrently.
+  TORCH_ARG(int64_t, num_shards);
+
+  /// If a checkpoint already exists at the target path, only write the
+  /// tensors whose dtype, shape or content hash changed since that
+  /// checkpoint. Unchanged tensors keep pointing at the shards they were
+  /// written to before.
+  TORCH_ARG(bool, incremental) = true;
+};
+
+/// Saves `tensors` as a sharded checkpoint. `path` names the manifest, a
+/// small pickle that records for every tensor its dtype, shape, content hash
+/// and the shard it lives in. Shards are zip archives next to the manifest,
+/// named `<path>.<generation>.<shard>`; a checkpoint can be moved as long as
+/// its files stay together. The manifest is replaced atomically once all
+/// shards are written, after which shards that are no longer referenced are
+/// deleted.
+///
+/// Tensors are saved as dense, contiguous CPU data; `load_sharded` returns
+/// them on the CPU and without `requires_grad`.
+///
+/// \rst
+/// .. code-block:: cpp
+///
+///   torch::nn::Linear model(3, 4);
+///   torch::serialize::save_sharded(model->named_parameters(), "model.ckpt");
+///   // ...train, then rewrite only the parameters that changed
+///   torch::serialize::save_sharded(model->named_parameters(), "model.ckpt");
+///
+///   auto params = torch::serialize::load_sharded("model.ckpt");
+/// \endrst
+TORCH_API void save_sharded(
+    const OrderedDict<std::string, Tensor>& tensors,
+    const std::string& path,
+    const ShardedSaveOptions& options = {});
+
+/// Loads a checkpoint written by `save_sharded`, reading its shards
+/// concurrently. Tensors are returned in the order they were saved in.
+TORCH_API OrderedDict<std::string, Tensor> load_sharded(
+    const std::string& path);
+
+} // namespace serialize
+} // namespace torch
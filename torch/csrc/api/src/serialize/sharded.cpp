@@ -0,0 +1,377 @@
+#include <torch/serialize/sharded.h>
+
+#include <torch/csrc/jit/serialization/pickle.h>
+
+#include <ATen/Parallel.h>
+#include <c10/util/Exception.h>
+#include <caffe2/serialize/inline_container.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <numeric>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace torch {
+namespace serialize {
+
+ShardedSaveOptions::ShardedSaveOptions(int64_t num_shards)
+    : num_shards_(num_shards) {}
+
+namespace {
+
+constexpr int64_t kManifestVersion = 1;
+
+// Tensors are hashed in slices of this many bytes, one slice per task.
+constexpr size_t kHashSliceSize = 1 << 20;
+constexpr uint64_t kHashMul = 0x9e3779b97f4a7c15ULL;
+
+// Finalizer of MurmurHash3, a cheap full-avalanche 64-bit mix.
+inline uint64_t fmix64(uint64_t x) {
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdULL;
+  x ^= x >> 33;
+  x *= 0xc4ceb9fe1a85ec53ULL;
+  x ^= x >> 33;
+  return x;
+}
+
+uint64_t hash_slice(const char* data, size_t n) {
+  uint64_t h = fmix64(n);
+  size_t i = 0;
+  for (; i + sizeof(uint64_t) <= n; i += sizeof(uint64_t)) {
+    uint64_t word;
+    std::memcpy(&word, data + i, sizeof(uint64_t));
+    h = (h ^ fmix64(word)) * kHashMul;
+  }
+  uint64_t tail = 0;
+  std::memcpy(&tail, data + i, n - i);
+  return fmix64(h ^ tail);
+}
+
+// 64-bit hash of the bytes of a contiguous tensor. Incremental saves skip a
+// tensor when this, its dtype and its shape all match the last checkpoint.
+int64_t content_hash(const Tensor& tensor) {
+  const size_t nbytes = tensor.numel() * tensor.element_size();
+  if (nbytes == 0) {
+    return 0;
+  }
+  const char* data = static_cast<const char*>(tensor.data_ptr());
+  const size_t nslices = (nbytes + kHashSliceSize - 1) / kHashSliceSize;
+  std::vector<uint64_t> partial(nslices);
+  at::parallel_for(0, nslices, 1, [&](int64_t begin, int64_t end) {
+    for (int64_t i = begin; i < end; ++i) {
+      size_t offset = i * kHashSliceSize;
+      partial[i] = hash_slice(
+          data + offset, std::min(kHashSliceSize, nbytes - offset));
+    }
+  });
+  uint64_t h = fmix64(nbytes);
+  for (uint64_t p : partial) {
+    h = fmix64((h ^ p) * kHashMul);
+  }
+  return static_cast<int64_t>(h);
+}
+
+struct ManifestEntry {
+  std::string name;
+  // shard file, relative to the directory of the manifest
+  std::string shard;
+  std::string record;
+  at::ScalarType dtype;
+  std::vector<int64_t> sizes;
+  int64_t hash;
+
+  size_t nbytes() const {
+    return std::accumulate(
+               sizes.begin(), sizes.end(), int64_t(1), std::multiplies<>()) *
+        c10::elementSize(dtype);
+  }
+};
+
+struct Manifest {
+  int64_t generation = 0;
+  std::vector<ManifestEntry> entries;
+};
+
+std::string dirname(const std::string& path) {
+  auto pos = path.find_last_of("/\\");
+  return pos == std::string::npos ? "" : path.substr(0, pos + 1);
+}
+
+std::string basename(const std::string& path) {
+  auto pos = path.find_last_of("/\\");
+  return pos == std::string::npos ? path : path.substr(pos + 1);
+}
+
+bool file_exists(const std::string& path) {
+  return std::ifstream(path).good();
+}
+
+// The manifest stores dtypes by name, the ScalarType ordinals are not stable
+// across releases.
+at::ScalarType dtype_from_name(
+    const std::string& name,
+    const std::string& path) {
+  c10::optional<at::ScalarType> dtype;
+#define CHECK_SCALAR(_, scalar_name) \
+  if (name == #scalar_name) {        \
+    dtype = c10::k##scalar_name;     \
+  }
+  AT_FORALL_SCALAR_TYPES_WITH_COMPLEX_AND_QINTS(CHECK_SCALAR)
+#undef CHECK_SCALAR
+  TORCH_CHECK(
+      dtype.has_value(), "load_sharded: ", path, " has unknown dtype ", name);
+  return *dtype;
+}
+
+Manifest read_manifest(const std::string& path) {
+  std::ifstream in(path, std::ios::binary);
+  TORCH_CHECK(in, "load_sharded: could not open manifest ", path);
+  std::vector<char> bytes(
+      (std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  auto dict = jit::pickle_load(bytes).toGenericDict();
+  TORCH_CHECK(
+      dict.at("version").toInt() <= kManifestVersion,
+      "load_sharded: ",
+      path,
+      " has manifest version ",
+      dict.at("version").toInt(),
+      ", but the maximum supported version is ",
+      kManifestVersion);
+
+  Manifest manifest;
+  manifest.generation = dict.at("generation").toInt();
+  for (const IValue& item : dict.at("tensors").toList()) {
+    const auto& elements = item.toTuple()->elements();
+    ManifestEntry entry;
+    entry.name = elements.at(0).toStringRef();
+    entry.shard = elements.at(1).toStringRef();
+    entry.record = elements.at(2).toStringRef();
+    entry.dtype = dtype_from_name(elements.at(3).toStringRef(), path);
+    entry.sizes = elements.at(4).toIntVector();
+    entry.hash = elements.at(5).toInt();
+    manifest.entries.push_back(std::move(entry));
+  }
+  return manifest;
+}
+
+// Writes to a temporary file first so that a crash mid-save leaves the last
+// complete checkpoint in place.
+void write_manifest(const Manifest& manifest, const std::string& path) {
+  c10::impl::GenericList tensors(c10::AnyType::get());
+  for (const auto& entry : manifest.entries) {
+    tensors.push_back(c10::ivalue::Tuple::create(
+        {entry.name,
+         entry.shard,
+         entry.record,
+         std::string(c10::toString(entry.dtype)),
+         entry.sizes,
+         entry.hash}));
+  }
+  c10::impl::GenericDict dict(c10::StringType::get(), c10::AnyType::get());
+  dict.insert("version", kManifestVersion);
+  dict.insert("generation", manifest.generation);
+  dict.insert("tensors", std::move(tensors));
+  std::vector<char> bytes = jit::pickle_save(dict);
+
+  std::string tmp_path = path + ".tmp";
+  {
+    std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+    out.write(bytes.data(), bytes.size());
+    TORCH_CHECK(out, "save_sharded: could not write ", tmp_path);
+  }
+  if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+    // rename does not replace an existing file on Windows
+    std::remove(path.c_str());
+    TORCH_CHECK(
+        std::rename(tmp_path.c_str(), path.c_str()) == 0,
+        "save_sharded: could not move ",
+        tmp_path,
+        " to ",
+        path);
+  }
+}
+
+} // namespace
+
+void save_sharded(
+    const OrderedDict<std::string, Tensor>& tensors,
+    const std::string& path,
+    const ShardedSaveOptions& options) {
+  TORCH_CHECK(
+      options.num_shards() > 0,
+      "save_sharded: num_shards must be positive, got ",
+      options.num_shards());
+  const std::string dir = dirname(path);
+
+  Manifest previous;
+  if (file_exists(path)) {
+    previous = read_manifest(path);
+  }
+  std::unordered_map<std::string, const ManifestEntry*> reusable;
+  if (options.incremental()) {
+    for (const auto& entry : previous.entries) {
+      reusable.emplace(entry.name, &entry);
+    }
+  }
+  std::unordered_map<std::string, bool> shard_present;
+  auto is_present = [&](const std::string& shard) {
+    auto it = shard_present.find(shard);
+    if (it == shard_present.end()) {
+      it = shard_present.emplace(shard, file_exists(dir + shard)).first;
+    }
+    return it->second;
+  };
+
+  Manifest manifest;
+  manifest.generation = previous.generation + 1;
+  // tensors that have to be written, and their entries in the manifest
+  std::vector<Tensor> pending;
+  std::vector<size_t> pending_entries;
+  for (const auto& item : tensors) {
+    const Tensor& tensor = item.value();
+    TORCH_CHECK(
+        tensor.layout() == kStrided && !tensor.is_quantized(),
+        "save_sharded: only dense tensors are supported, but '",
+        item.key(),
+        "' is ",
+        tensor.toString());
+    Tensor data = tensor.detach().to(kCPU).contiguous();
+    ManifestEntry entry;
+    entry.name = item.key();
+    entry.dtype = data.scalar_type();
+    entry.sizes = data.sizes().vec();
+    entry.hash = content_hash(data);
+
+    auto it = reusable.find(entry.name);
+    if (it != reusable.end() && it->second->dtype == entry.dtype &&
+        it->second->sizes == entry.sizes && it->second->hash == entry.hash &&
+        is_present(it->second->shard)) {
+      entry.shard = it->second->shard;
+      entry.record = it->second->record;
+    } else {
+      pending.push_back(std::move(data));
+      pending_entries.push_back(manifest.entries.size());
+    }
+    manifest.entries.push_back(std::move(entry));
+  }
+
+  // Balance the shards by size: largest tensors first, each into the shard
+  // with the fewest bytes so far.
+  const size_t num_shards =
+      std::min<size_t>(options.num_shards(), pending.size());
+  std::vector<size_t> order(pending.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return pending[a].nbytes() > pending[b].nbytes();
+  });
+  std::vector<std::vector<size_t>> shards(num_shards);
+  std::vector<size_t> shard_bytes(num_shards, 0);
+  for (size_t i : order) {
+    size_t shard =
+        std::min_element(shard_bytes.begin(), shard_bytes.end()) -
+        shard_bytes.begin();
+    shards[shard].push_back(i);
+    shard_bytes[shard] += pending[i].nbytes();
+  }
+
+  const std::string prefix =
+      basename(path) + "." + c10::to_string(manifest.generation) + ".";
+  for (size_t shard = 0; shard < num_shards; ++shard) {
+    std::sort(shards[shard].begin(), shards[shard].end());
+    for (size_t j = 0; j < shards[shard].size(); ++j) {
+      auto& entry = manifest.entries[pending_entries[shards[shard][j]]];
+      entry.shard = prefix + c10::to_string(shard);
+      entry.record = c10::to_string(j);
+    }
+  }
+
+  at::parallel_for(0, num_shards, 1, [&](int64_t begin, int64_t end) {
+    for (int64_t shard = begin; shard < end; ++shard) {
+      caffe2::serialize::PyTorchStreamWriter writer(
+          dir + prefix + c10::to_string(shard));
+      for (size_t j = 0; j < shards[shard].size(); ++j) {
+        const Tensor& data = pending[shards[shard][j]];
+        writer.writeRecord(c10::to_string(j), data.data_ptr(), data.nbytes());
+      }
+      writer.writeEndOfFile();
+    }
+  });
+
+  write_manifest(manifest, path);
+
+  std::unordered_set<std::string> live;
+  for (const auto& entry : manifest.entries) {
+    live.insert(entry.shard);
+  }
+  for (const auto& entry : previous.entries) {
+    if (!live.count(entry.shard)) {
+      live.insert(entry.shard);
+      std::remove((dir + entry.shard).c_str());
+    }
+  }
+}
+
+OrderedDict<std::string, Tensor> load_sharded(const std::string& path) {
+  const std::string dir = dirname(path);
+  Manifest manifest = read_manifest(path);
+
+  std::vector<std::string> shard_names;
+  std::unordered_map<std::string, std::vector<size_t>> shard_entries;
+  for (size_t i = 0; i < manifest.entries.size(); ++i) {
+    const auto& shard = manifest.entries[i].shard;
+    auto& entries = shard_entries[shard];
+    if (entries.empty()) {
+      shard_names.push_back(shard);
+    }
+    entries.push_back(i);
+  }
+
+  std::vector<Tensor> loaded(manifest.entries.size());
+  at::parallel_for(0, shard_names.size(), 1, [&](int64_t begin, int64_t end) {
+    for (int64_t shard = begin; shard < end; ++shard) {
+      caffe2::serialize::PyTorchStreamReader reader(dir + shard_names[shard]);
+      for (size_t i : shard_entries.at(shard_names[shard])) {
+        const auto& entry = manifest.entries[i];
+        at::DataPtr data;
+        size_t size;
+        std::tie(data, size) = reader.getRecord(entry.record);
+        TORCH_CHECK(
+            size == entry.nbytes(),
+            "load_sharded: record for '",
+            entry.name,
+            "' in ",
+            entry.shard,
+            " has ",
+            size,
+            " bytes, expected ",
+            entry.nbytes());
+        at::Storage storage(
+            c10::Storage::use_byte_size_t(),
+            size,
+            std::move(data),
+            /*allocator=*/nullptr,
+            /*resizable=*/false);
+        loaded[i] = at::empty({0}, at::dtype(entry.dtype))
+                        .set_(storage)
+                        .view(entry.sizes);
+      }
+    }
+  });
+
+  OrderedDict<std::string, Tensor> result;
+  result.reserve(loaded.size());
+  for (size_t i = 0; i < loaded.size(); ++i) {
+    result.insert(manifest.entries[i].name, std::move(loaded[i]));
+  }
+  return result;
+}
+
+} // namespace serialize
+} // namespace torch
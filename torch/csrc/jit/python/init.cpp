@@ -86,6 +86,7 @@
 
 #include <c10/macros/Export.h>
 #include <caffe2/serialize/inline_container.h>
+#include <caffe2/serialize/mmap_adapter.h>
 
 #include <ATen/core/function_schema.h>
 
@@ -919,6 +920,13 @@ void initJITBindings(PyObject* module) {
 
   py::class_<PyTorchStreamReader>(m, "PyTorchFileReader")
       .def(py::init<std::string>())
+      .def(py::init([](const std::string& file_name, bool mmap) {
+        if (!mmap) {
+          return std::make_unique<PyTorchStreamReader>(file_name);
+        }
+        return std::make_unique<PyTorchStreamReader>(
+            std::make_unique<caffe2::serialize::MmapFileAdapter>(file_name));
+      }))
       .def(py::init([](const py::object& buffer) {
         auto adapter = std::make_unique<BufferAdapter>(std::move(buffer));
         return std::make_unique<PyTorchStreamReader>(std::move(adapter));
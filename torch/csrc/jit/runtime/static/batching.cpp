@@ -0,0 +1,220 @@
+#include <torch/csrc/jit/runtime/static/batching.h>
+
+#include <ATen/core/grad_mode.h>
+#include <c10/util/thread_name.h>
+
+namespace torch {
+namespace jit {
+
+namespace {
+std::vector<at::Tensor> RunModule(
+    torch::jit::Module& module,
+    const std::vector<at::Tensor>& inputs) {
+  std::vector<IValue> stack{inputs.begin(), inputs.end()};
+  IValue output = module.forward(std::move(stack));
+  std::vector<at::Tensor> outputs;
+  if (output.isTuple()) {
+    for (const auto& el : output.toTuple()->elements()) {
+      outputs.emplace_back(el.toTensor());
+    }
+  } else {
+    outputs.emplace_back(output.toTensor());
+  }
+  return outputs;
+}
+} // namespace
+
+DynamicBatcher::DynamicBatcher(RunFn run, const DynamicBatcherOptions& opts)
+    : run_(std::move(run)), opts_(opts) {
+  TORCH_CHECK(opts_.max_batch_size > 0, "max_batch_size must be positive");
+  TORCH_CHECK(opts_.batch_dim >= 0, "batch_dim must be non-negative");
+  thread_ = std::thread([this]() { main_loop(); });
+}
+
+DynamicBatcher::DynamicBatcher(
+    std::shared_ptr<StaticRuntime> runtime,
+    const DynamicBatcherOptions& opts)
+    : DynamicBatcher(
+          [runtime](const std::vector<at::Tensor>& inputs) {
+            return runtime->run(inputs);
+          },
+          opts) {
+  TORCH_CHECK(runtime != nullptr, "runtime cannot be nullptr");
+}
+
+DynamicBatcher::DynamicBatcher(
+    const torch::jit::Module& module,
+    const DynamicBatcherOptions& opts)
+    : DynamicBatcher(
+          [module](const std::vector<at::Tensor>& inputs) mutable {
+            return RunModule(module, inputs);
+          },
+          opts) {}
+
+DynamicBatcher::~DynamicBatcher() {
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    stopping_ = true;
+  }
+  cv_.notify_all();
+  thread_.join();
+}
+
+std::future<std::vector<at::Tensor>> DynamicBatcher::enqueue(
+    std::vector<at::Tensor> inputs) {
+  TORCH_CHECK(!inputs.empty(), "DynamicBatcher requests need inputs");
+  const int64_t batch_dim = opts_.batch_dim;
+  for (const auto& input : inputs) {
+    TORCH_CHECK(
+        input.dim() > batch_dim,
+        "DynamicBatcher inputs need a batch dim ",
+        batch_dim,
+        ", got an input with ",
+        input.dim(),
+        " dims");
+    TORCH_CHECK(
+        input.size(batch_dim) == inputs[0].size(batch_dim),
+        "All inputs of a DynamicBatcher request need the same batch size");
+  }
+
+  auto request = std::make_unique<Request>();
+  request->num_rows = inputs[0].size(batch_dim);
+  request->inputs = std::move(inputs);
+  request->arrival = std::chrono::steady_clock::now();
+  auto future = request->promise.get_future();
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    TORCH_CHECK(!stopping_, "DynamicBatcher is shutting down");
+    queued_rows_ += request->num_rows;
+    queue_.push_back(std::move(request));
+  }
+  cv_.notify_one();
+  return future;
+}
+
+DynamicBatcherStats DynamicBatcher::stats() const {
+  std::lock_guard<std::mutex> guard(mutex_);
+  return stats_;
+}
+
+bool DynamicBatcher::compatible(const Request& a, const Request& b) const {
+  if (a.inputs.size() != b.inputs.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < a.inputs.size(); i++) {
+    const at::Tensor& x = a.inputs[i];
+    const at::Tensor& y = b.inputs[i];
+    if (x.dim() != y.dim() || x.scalar_type() != y.scalar_type() ||
+        x.device() != y.device()) {
+      return false;
+    }
+    for (int64_t d = 0; d < x.dim(); d++) {
+      if (d != opts_.batch_dim && x.size(d) != y.size(d)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+void DynamicBatcher::main_loop() {
+  c10::setThreadName("DynamicBatcher");
+  at::NoGradGuard no_grad;
+  while (true) {
+    std::vector<std::unique_ptr<Request>> batch;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cv_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+      if (queue_.empty()) {
+        return;
+      }
+      const auto deadline = queue_.front()->arrival + opts_.max_latency;
+      while (!stopping_ && queued_rows_ < opts_.max_batch_size &&
+             cv_.wait_until(lock, deadline) != std::cv_status::timeout) {
+      }
+
+      // The oldest request always runs; the others join it in arrival order
+      // as long as they fit.
+      int64_t rows = 0;
+      for (auto it = queue_.begin(); it != queue_.end();) {
+        Request& request = **it;
+        if (!batch.empty() &&
+            (rows + request.num_rows > opts_.max_batch_size ||
+             !compatible(*batch.front(), request))) {
+          ++it;
+          continue;
+        }
+        rows += request.num_rows;
+        queued_rows_ -= request.num_rows;
+        batch.push_back(std::move(*it));
+        it = queue_.erase(it);
+      }
+
+      const auto now = std::chrono::steady_clock::now();
+      stats_.num_requests += batch.size();
+      stats_.num_batches++;
+      stats_.num_rows += rows;
+      for (const auto& request : batch) {
+        stats_.total_queue_ms +=
+            std::chrono::duration<double, std::milli>(now - request->arrival)
+                .count();
+      }
+    }
+    run_batch(batch);
+  }
+}
+
+void DynamicBatcher::run_batch(std::vector<std::unique_ptr<Request>>& batch) {
+  const int64_t batch_dim = opts_.batch_dim;
+  try {
+    if (batch.size() == 1) {
+      batch[0]->promise.set_value(run_(batch[0]->inputs));
+      return;
+    }
+
+    std::vector<at::Tensor> inputs;
+    const size_t num_inputs = batch[0]->inputs.size();
+    for (size_t i = 0; i < num_inputs; i++) {
+      std::vector<at::Tensor> parts;
+      parts.reserve(batch.size());
+      for (const auto& request : batch) {
+        parts.push_back(request->inputs[i]);
+      }
+      inputs.push_back(at::cat(parts, batch_dim));
+    }
+    const int64_t rows = inputs[0].size(batch_dim);
+
+    std::vector<at::Tensor> outputs = run_(inputs);
+    for (const auto& output : outputs) {
+      TORCH_CHECK(
+          output.dim() > batch_dim && output.size(batch_dim) == rows,
+          "DynamicBatcher expects every output to have the batch size ",
+          rows,
+          " of the inputs along dim ",
+          batch_dim);
+    }
+
+    int64_t offset = 0;
+    for (auto& request : batch) {
+      std::vector<at::Tensor> slices;
+      slices.reserve(outputs.size());
+      for (const auto& output : outputs) {
+        slices.push_back(output.narrow(batch_dim, offset, request->num_rows));
+      }
+      offset += request->num_rows;
+      request->promise.set_value(std::move(slices));
+    }
+  } catch (...) {
+    auto eptr = std::current_exception();
+    for (auto& request : batch) {
+      try {
+        request->promise.set_exception(eptr);
+      } catch (const std::future_error&) {
+        // the request already got its result
+      }
+    }
+  }
+}
+
+} // namespace jit
+} // namespace torch
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <torch/csrc/jit/runtime/static/impl.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
+
+namespace torch {
+namespace jit {
+
+struct TORCH_API DynamicBatcherOptions {
+  // Largest number of rows (summed over the batch dim of the requests) a
+  // batch is allowed to have. A single larger request runs on its own.
+  int64_t max_batch_size{64};
+  // How long the oldest request in the queue waits for others to join its
+  // batch before the batch runs anyway
+  std::chrono::microseconds max_latency{1000};
+  // Dimension along which the inputs are concatenated and the outputs split
+  int64_t batch_dim{0};
+};
+
+struct TORCH_API DynamicBatcherStats {
+  uint64_t num_requests{0};
+  uint64_t num_batches{0};
+  // Sum of the rows of all batches
+  uint64_t num_rows{0};
+  // Sum over all requests of the time from enqueue() until its batch ran
+  double total_queue_ms{0};
+};
+
+/// DynamicBatcher serves many small concurrent requests with a single model
+/// instance by coalescing them into larger batches.
+///
+/// Requests from any number of threads are queued. A background thread takes
+/// the oldest request and waits until either enough rows are queued to fill
+/// max_batch_size or max_latency has passed since that request arrived. It
+/// then concatenates the inputs of all queued requests with the same
+/// non-batch shapes along batch_dim, runs the model once and hands every
+/// request its slice of each output (a view into the batched output).
+/// Requests with other shapes stay queued for a later batch.
+///
+/// Every output of the model must have the batch size of its inputs along
+/// batch_dim.
+/// @code
+///   auto runtime = std::make_shared<StaticRuntime>(PrepareForStaticRuntime(m));
+///   DynamicBatcher batcher(runtime, opts);
+///   // on any thread
+///   std::vector<at::Tensor> outputs = batcher.run(inputs);
+/// @endcode
+class TORCH_API DynamicBatcher {
+ public:
+  using RunFn =
+      std::function<std::vector<at::Tensor>(const std::vector<at::Tensor>&)>;
+
+  // run is only ever called from the batcher's thread
+  DynamicBatcher(RunFn run, const DynamicBatcherOptions& opts);
+  DynamicBatcher(
+      std::shared_ptr<StaticRuntime> runtime,
+      const DynamicBatcherOptions& opts);
+  DynamicBatcher(
+      const torch::jit::Module& module,
+      const DynamicBatcherOptions& opts);
+
+  // Runs the requests still queued, then stops the batcher's thread
+  ~DynamicBatcher();
+
+  DynamicBatcher(const DynamicBatcher&) = delete;
+  DynamicBatcher& operator=(const DynamicBatcher&) = delete;
+
+  std::future<std::vector<at::Tensor>> enqueue(std::vector<at::Tensor> inputs);
+
+  // Blocks until the batch containing the request has run
+  std::vector<at::Tensor> run(std::vector<at::Tensor> inputs) {
+    return enqueue(std::move(inputs)).get();
+  }
+
+  DynamicBatcherStats stats() const;
+
+ private:
+  struct Request {
+    std::vector<at::Tensor> inputs;
+    int64_t num_rows;
+    std::chrono::steady_clock::time_point arrival;
+    std::promise<std::vector<at::Tensor>> promise;
+  };
+
+  void main_loop();
+  bool compatible(const Request& a, const Request& b) const;
+  void run_batch(std::vector<std::unique_ptr<Request>>& batch);
+
+  const RunFn run_;
+  const DynamicBatcherOptions opts_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<std::unique_ptr<Request>> queue_;
+  // Rows of all queued requests
+  int64_t queued_rows_{0};
+  bool stopping_{false};
+  DynamicBatcherStats stats_;
+
+  std::thread thread_;
+};
+
+} // namespace jit
+} // namespace torch
@@ -1,7 +1,10 @@
 #include <torch/csrc/jit/runtime/static/impl.h>
+#include <ATen/Parallel.h>
 #include <ATen/core/interned_strings.h>
+#include <c10/core/CPUAllocator.h>
 #include <caffe2/core/scope_guard.h>
 #include <caffe2/core/timer.h>
+#include <torch/csrc/jit/ir/alias_analysis.h>
 #include <torch/csrc/jit/passes/canonicalize.h>
 #include <torch/csrc/jit/passes/freeze_module.h>
 #include <torch/csrc/jit/passes/remove_mutation.h>
@@ -9,6 +12,12 @@
 #include <torch/csrc/jit/runtime/static/ops.h>
 #include <torch/csrc/jit/runtime/vararg_functions.h>
 
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <numeric>
+#include <sstream>
+
 namespace torch {
 namespace jit {
 namespace {
@@ -91,8 +100,91 @@ void DeduceInternalBlobs(
     }
   }
 }
+// For every node, the earlier nodes it has to wait for: the producers of its
+// inputs and, for nodes that mutate or have side effects, all earlier nodes.
+// Nodes after such a node wait for it as well.
+std::vector<std::vector<size_t>> BuildNodeDependencies(
+    const std::vector<ProcessedNode>& nodes,
+    const AliasDb& alias_db) {
+  std::unordered_map<const Value*, size_t> producer;
+  std::vector<std::vector<size_t>> deps(nodes.size());
+  c10::optional<size_t> last_barrier;
+  std::vector<size_t> since_last_barrier;
+  for (size_t i = 0; i < nodes.size(); i++) {
+    Node* node = nodes[i].get_node();
+    std::unordered_set<size_t> node_deps;
+    for (const Value* input : node->inputs()) {
+      auto it = producer.find(input);
+      if (it != producer.end()) {
+        node_deps.insert(it->second);
+      }
+    }
+    if (last_barrier) {
+      node_deps.insert(*last_barrier);
+    }
+    if (node->hasSideEffects() || alias_db.isMutable(node) ||
+        alias_db.hasWriters(node)) {
+      node_deps.insert(since_last_barrier.begin(), since_last_barrier.end());
+      last_barrier = i;
+      since_last_barrier.clear();
+    } else {
+      since_last_barrier.push_back(i);
+    }
+    deps[i] = {node_deps.begin(), node_deps.end()};
+    std::sort(deps[i].begin(), deps[i].end());
+    for (const Value* output : node->outputs()) {
+      producer[output] = i;
+    }
+  }
+  return deps;
+}
+
+std::string JsonString(const std::string& s) {
+  std::string out = "\"";
+  for (char c : s) {
+    if (c == '"' || c == '\\') {
+      out += '\\';
+    }
+    out += c;
+  }
+  return out + "\"";
+}
+
+std::string JsonShapes(const std::vector<std::vector<int64_t>>& shapes) {
+  std::ostringstream ss;
+  ss << "[";
+  for (size_t i = 0; i < shapes.size(); i++) {
+    ss << (i ? ", " : "") << "[";
+    for (size_t j = 0; j < shapes[i].size(); j++) {
+      ss << (j ? ", " : "") << shapes[i][j];
+    }
+    ss << "]";
+  }
+  ss << "]";
+  return ss.str();
+}
 } // namespace
 
+// State of one run of the nodes on the inter-op thread pool. It is shared
+// with the helper tasks, which may only start after the run is over.
+struct ParallelRunState {
+  ParallelRunState(size_t num_nodes, size_t max_helpers)
+      : num_nodes(num_nodes), max_helpers(max_helpers) {}
+
+  const size_t num_nodes;
+  const size_t max_helpers;
+  std::mutex mutex;
+  std::condition_variable cv;
+  // Nodes whose dependencies have finished
+  std::deque<size_t> ready;
+  std::vector<size_t> num_pending_deps;
+  size_t num_finished = 0;
+  size_t num_running = 0;
+  // Helper tasks launched and not yet exited
+  size_t num_helpers = 0;
+  std::exception_ptr eptr;
+};
+
 void InferenceModule::init() {
   OptimizeGraph(graph);
   CheckGraphEligibility(graph);
@@ -158,6 +250,39 @@ StaticRuntime::StaticRuntime(
           opts.enable_out_variant);
     }
   }
+
+  std::unordered_set<size_t> graph_outputs{
+      module_->output_regs.begin(), module_->output_regs.end()};
+  for (const auto& pnode : nodes_) {
+    for (size_t reg : pnode.output_regs()) {
+      if (graph_outputs.count(reg)) {
+        node_output_regs_.push_back(reg);
+      }
+    }
+  }
+
+  const bool use_planner = opts.enable_out_variant &&
+      opts.cleanup_activations && opts.enable_memory_planner;
+  if (!use_planner && !opts.enable_inter_op_parallelism) {
+    return;
+  }
+  AliasDb alias_db(module_->graph);
+  std::vector<std::vector<size_t>> node_deps;
+  if (opts.enable_inter_op_parallelism) {
+    node_deps = BuildNodeDependencies(nodes_, alias_db);
+    node_num_deps_.resize(nodes_.size());
+    node_successors_.resize(nodes_.size());
+    for (size_t i = 0; i < nodes_.size(); i++) {
+      node_num_deps_[i] = node_deps[i].size();
+      for (size_t dep : node_deps[i]) {
+        node_successors_[dep].push_back(i);
+      }
+    }
+  }
+  if (use_planner) {
+    planner_ =
+        std::make_unique<MemoryPlanner>(*module_, nodes_, alias_db, node_deps);
+  }
 }
 
 std::vector<at::Tensor> StaticRuntime::run(
@@ -186,17 +311,7 @@ std::vector<at::Tensor> StaticRuntime::run(
 c10::IValue StaticRuntime::run(
     const std::vector<c10::IValue>& args,
     const std::unordered_map<std::string, c10::IValue>& kwargs) const {
-  caffe2::MakeGuard([&] {
-    if (opts_.cleanup_activations) {
-      for (size_t i : module_->internals) {
-        if (reg_[i].isTensor()) {
-          // Temporary solution
-          auto t = reg_[i].toTensor();
-          reg_[i] = at::empty({0}, t.options());
-        }
-      }
-    }
-  });
+  auto cleanup = caffe2::MakeGuard([&] { cleanup_after_run(); });
   std::vector<IValue> stack(args);
   if (!kwargs.empty()) {
     // This is not ideal
@@ -210,13 +325,108 @@ c10::IValue StaticRuntime::run(
     Input(i) = stack[i];
   }
 
-  for (const auto& n : nodes_) {
-    n.run(reg_);
+  if (planner_) {
+    planner_->allocate(reg_);
+  }
+  if (opts_.enable_inter_op_parallelism) {
+    run_nodes_in_parallel();
+  } else {
+    for (const auto& n : nodes_) {
+      n.run(reg_);
+    }
   }
 
   return Output(0);
 }
 
+void StaticRuntime::cleanup_after_run() const {
+  if (planner_) {
+    planner_->deallocate(reg_);
+  }
+  // The caller owns the outputs now, out variants must not write into them
+  // in the next run
+  for (size_t i : node_output_regs_) {
+    reg_[i] = IValue();
+  }
+  if (opts_.cleanup_activations) {
+    for (size_t i : module_->internals) {
+      if (reg_[i].isTensor() && !(planner_ && planner_->is_managed(i))) {
+        // Temporary solution
+        auto t = reg_[i].toTensor();
+        reg_[i] = at::empty({0}, t.options());
+      }
+    }
+  }
+}
+
+void StaticRuntime::run_nodes_in_parallel() const {
+  auto state = std::make_shared<ParallelRunState>(
+      nodes_.size(), at::get_num_interop_threads());
+  state->num_pending_deps = node_num_deps_;
+  for (size_t i = 0; i < nodes_.size(); i++) {
+    if (node_num_deps_[i] == 0) {
+      state->ready.push_back(i);
+    }
+  }
+  run_ready_nodes(state, /*is_caller=*/true);
+  if (state->eptr) {
+    std::rethrow_exception(state->eptr);
+  }
+}
+
+// Runs ready nodes until all nodes have finished. Helpers return as soon as
+// nothing is ready and must not touch the runtime once the run is over; the
+// calling thread waits for the nodes still running instead.
+void StaticRuntime::run_ready_nodes(
+    const std::shared_ptr<ParallelRunState>& state,
+    bool is_caller) const {
+  std::unique_lock<std::mutex> lock(state->mutex);
+  while (state->num_finished < state->num_nodes &&
+         !(state->eptr && state->num_running == 0)) {
+    if (state->ready.empty() || state->eptr) {
+      if (!is_caller) {
+        break;
+      }
+      state->cv.wait(lock);
+      continue;
+    }
+    size_t i = state->ready.front();
+    state->ready.pop_front();
+    state->num_running++;
+    lock.unlock();
+    std::exception_ptr eptr;
+    try {
+      nodes_[i].run(reg_);
+    } catch (...) {
+      eptr = std::current_exception();
+    }
+    lock.lock();
+    state->num_running--;
+    state->num_finished++;
+    if (eptr) {
+      if (!state->eptr) {
+        state->eptr = eptr;
+      }
+    } else {
+      for (size_t succ : node_successors_[i]) {
+        if (--state->num_pending_deps[succ] == 0) {
+          state->ready.push_back(succ);
+        }
+      }
+    }
+    // this thread takes the next ready node, helpers take the others
+    while (!state->eptr && state->num_helpers + 1 < state->ready.size() &&
+           state->num_helpers < state->max_helpers) {
+      state->num_helpers++;
+      at::launch([this, state]() { run_ready_nodes(state, false); });
+    }
+    state->cv.notify_all();
+  }
+  if (!is_caller) {
+    state->num_helpers--;
+  }
+}
+
 void StaticRuntime::benchmark(
     const std::vector<c10::IValue>& args,
     const std::unordered_map<std::string, c10::IValue>& kwargs,
@@ -233,7 +443,10 @@ void StaticRuntime::benchmark(
   for (size_t i = 0; i < nodes_.size(); i++) {
     const Node* node = nodes_[i].get_node();
     std::cout << "Node #" << i << ": " << results.time_per_node[i]
-              << " ms/iter, ";
+              << " ms/iter, " << results.allocations_per_node[i]
+              << " allocs/iter (" << results.bytes_per_node[i] << " bytes), "
+              << (results.out_variant_per_node[i] ? "out variant, "
+                                                  : "fallback, ");
     node->print(std::cout, 0, nullptr, false);
   }
 
@@ -249,12 +462,23 @@ void StaticRuntime::benchmark(
     const std::string& kind = p.first;
     const double ms = p.second;
     std::cout << std::setw(15) << ms << " ms. " << std::setw(10)
-              << results.percent_per_node_type[kind] << "%. " << kind << " ("
-              << results.instances_per_node_type[kind] << " nodes)"
-              << std::endl;
+              << results.percent_per_node_type[kind] << "%. " << std::setw(10)
+              << results.allocations_per_node_type[kind] << " allocs. "
+              << kind << " (" << results.instances_per_node_type[kind]
+              << " nodes, " << results.fallback_instances_per_node_type[kind]
+              << " without out variant)" << std::endl;
   }
   std::cout << std::setw(15) << results.total_time << " ms. in Total"
             << std::endl;
+
+  if (planner_) {
+    const MemoryPlannerStats& stats = planner_->stats();
+    std::cout << "Memory planner: " << stats.num_managed_tensors
+              << " managed tensors, " << stats.total_managed_bytes
+              << " bytes without reuse, " << stats.arena_bytes
+              << " bytes arena, " << stats.num_replans << " replans"
+              << std::endl;
+  }
 }
 
 float StaticRuntime::benchmark_model(
@@ -285,6 +509,11 @@ StaticRuntime::IndividualMetrics StaticRuntime::benchmark_individual_ops(
   IndividualMetrics results;
   results.total_time = 0.0;
   results.time_per_node.resize(nodes_.size(), 0);
+  results.kind_per_node.resize(nodes_.size());
+  results.bytes_per_node.resize(nodes_.size(), 0);
+  results.allocations_per_node.resize(nodes_.size(), 0);
+  results.out_variant_per_node.resize(nodes_.size(), false);
+  results.input_shapes_per_node.resize(nodes_.size());
 
   // setup time
   caffe2::Timer timer;
@@ -309,21 +538,52 @@ StaticRuntime::IndividualMetrics StaticRuntime::benchmark_individual_ops(
 
   // main runs
   for (int i = 0; i < main_runs; i++) {
+    for (size_t j = 0; j < stack.size(); j++) {
+      Input(j) = stack[j];
+    }
+    if (planner_) {
+      planner_->allocate(reg_);
+    }
     for (size_t j = 0; j < nodes_.size(); j++) {
+      // The process-wide counters also see the allocations of the intra-op
+      // threads the node runs on, which thread-local profiler state would not
+      const auto before = c10::profiledCPUMemoryReporter().stats();
       timer.Start();
       nodes_[j].run(reg_);
       float millis = timer.MilliSeconds();
+      const auto after = c10::profiledCPUMemoryReporter().stats();
       results.time_per_node[j] += millis;
+      results.bytes_per_node[j] +=
+          after.total_allocated_bytes - before.total_allocated_bytes;
+      results.allocations_per_node[j] += after.num_allocs - before.num_allocs;
+      if (i == main_runs - 1) {
+        for (size_t k = 0; k < nodes_[j].get_node()->inputs().size(); k++) {
+          const IValue& input = nodes_[j].Input(k, reg_);
+          results.input_shapes_per_node[j].emplace_back(
+              input.isTensor() ? input.toTensor().sizes().vec()
+                               : std::vector<int64_t>());
+        }
+      }
     }
+    cleanup_after_run();
   }
 
   // post processing
   for (size_t i = 0; i < nodes_.size(); i++) {
     const Node* node = nodes_[i].get_node();
     std::string kind = std::string(node->kind().toQualString());
+    results.kind_per_node[i] = kind;
+    results.out_variant_per_node[i] = nodes_[i].has_out_variant();
     results.time_per_node[i] /= static_cast<float>(main_runs);
+    results.bytes_per_node[i] /= main_runs;
+    results.allocations_per_node[i] /= main_runs;
     results.time_per_node_type[kind] += results.time_per_node[i];
+    results.bytes_per_node_type[kind] += results.bytes_per_node[i];
+    results.allocations_per_node_type[kind] += results.allocations_per_node[i];
     results.instances_per_node_type[kind]++;
+    // make sure every kind has an entry
+    results.fallback_instances_per_node_type[kind] +=
+        results.out_variant_per_node[i] ? 0 : 1;
     results.total_time += results.time_per_node[i];
   }
   for (const auto& p : results.time_per_node_type) {
@@ -333,6 +593,66 @@ StaticRuntime::IndividualMetrics StaticRuntime::benchmark_individual_ops(
   return results;
 }
 
+std::string StaticRuntime::IndividualMetrics::to_json() const {
+  std::ostringstream ss;
+  ss << "{\"setup_time_ms\": " << setup_time
+     << ", \"total_time_ms\": " << total_time << ", \"nodes\": [";
+  for (size_t i = 0; i < time_per_node.size(); i++) {
+    ss << (i ? ", " : "") << "{\"kind\": " << JsonString(kind_per_node[i])
+       << ", \"time_ms\": " << time_per_node[i]
+       << ", \"bytes\": " << bytes_per_node[i]
+       << ", \"allocations\": " << allocations_per_node[i]
+       << ", \"out_variant\": "
+       << (out_variant_per_node[i] ? "true" : "false")
+       << ", \"input_shapes\": " << JsonShapes(input_shapes_per_node[i])
+       << "}";
+  }
+  ss << "], \"node_types\": {";
+  bool first = true;
+  for (const auto& p : time_per_node_type) {
+    const std::string& kind = p.first;
+    ss << (first ? "" : ", ") << JsonString(kind) << ": {\"time_ms\": "
+       << p.second << ", \"percent\": " << percent_per_node_type.at(kind)
+       << ", \"instances\": " << instances_per_node_type.at(kind)
+       << ", \"fallback_instances\": "
+       << fallback_instances_per_node_type.at(kind)
+       << ", \"bytes\": " << bytes_per_node_type.at(kind)
+       << ", \"allocations\": " << allocations_per_node_type.at(kind) << "}";
+    first = false;
+  }
+  ss << "}}";
+  return ss.str();
+}
+
+std::string StaticRuntime::IndividualMetrics::to_chrome_trace() const {
+  std::ostringstream ss;
+  ss << "{\"traceEvents\": [";
+  double ts_us = 0;
+  for (size_t i = 0; i < time_per_node.size(); i++) {
+    const double dur_us = time_per_node[i] * 1000.0;
+    ss << (i ? ", " : "") << "{\"name\": " << JsonString(kind_per_node[i])
+       << ", \"ph\": \"X\", \"pid\": 0, \"tid\": 0, \"ts\": " << ts_us
+       << ", \"dur\": " << dur_us << ", \"args\": {\"node\": " << i
+       << ", \"bytes\": " << bytes_per_node[i]
+       << ", \"allocations\": " << allocations_per_node[i]
+       << ", \"out_variant\": "
+       << (out_variant_per_node[i] ? "true" : "false")
+       << ", \"input_shapes\": " << JsonShapes(input_shapes_per_node[i])
+       << "}}";
+    ts_us += dur_us;
+  }
+  ss << "], \"displayTimeUnit\": \"ms\"}";
+  return ss.str();
+}
+
+c10::optional<MemoryPlannerStats> StaticRuntime::memory_planner_stats()
+    const {
+  if (!planner_) {
+    return c10::nullopt;
+  }
+  return planner_->stats();
+}
+
 ProcessedNode::ProcessedNode(
     Node* node,
     std::vector<size_t>&& input_regs,
@@ -349,7 +669,10 @@ ProcessedNode::ProcessedNode(
     op_ = op.getOperation(node);
   }
   if (enable_out_variants && canRunOutOfPlace(node)) {
-    fn_ = getOutOfPlaceOperation(node);
+    auto fn = getOutOfPlaceOperation(node);
+    if (fn) {
+      fn_ = std::move(fn);
+    }
   }
 }
 
@@ -396,5 +719,200 @@ void ProcessedNode::run(std::vector<IValue>& reg) const {
   }
 }
 
+MemoryPlanner::MemoryPlanner(
+    const InferenceModule& module,
+    const std::vector<ProcessedNode>& nodes,
+    const AliasDb& alias_db,
+    const std::vector<std::vector<size_t>>& node_deps)
+    : is_managed_(module.value_to_reg.size(), false) {
+  std::unordered_set<size_t> internals{
+      module.internals.begin(), module.internals.end()};
+  const auto graph_outputs = module.graph->outputs();
+
+  // Every value a node produces, with the nodes that use it. Uses outside of
+  // the nodes (i.e. graph outputs) are recorded as nodes.size().
+  std::vector<std::pair<Value*, std::vector<size_t>>> value_users;
+  std::unordered_map<const Node*, size_t> node_index;
+  for (size_t i = 0; i < nodes.size(); i++) {
+    node_index[nodes[i].get_node()] = i;
+  }
+  for (size_t i = 0; i < nodes.size(); i++) {
+    for (Value* output : nodes[i].get_node()->outputs()) {
+      std::vector<size_t> users;
+      for (const Use& use : output->uses()) {
+        auto it = node_index.find(use.user);
+        users.push_back(it == node_index.end() ? nodes.size() : it->second);
+      }
+      value_users.emplace_back(output, std::move(users));
+    }
+  }
+
+  // For each managed tensor, the node that produces it and every node that
+  // may access its storage
+  std::vector<size_t> defs;
+  std::vector<std::vector<size_t>> users;
+  for (size_t i = 0; i < nodes.size(); i++) {
+    const ProcessedNode& pnode = nodes[i];
+    Node* node = pnode.get_node();
+    if (!pnode.has_out_variant() || !outputsOwnStorage(node)) {
+      continue;
+    }
+    for (size_t j = 0; j < node->outputs().size(); j++) {
+      Value* output = node->output(j);
+      size_t reg = pnode.output_regs()[j];
+      if (internals.count(reg) == 0 ||
+          alias_db.mayContainAlias(output, graph_outputs)) {
+        continue;
+      }
+      // The storage stays alive as long as any value that may alias it, e.g.
+      // the view returned by a transpose or a list holding the tensor.
+      std::vector<size_t> tensor_users{i};
+      for (const auto& p : value_users) {
+        if (alias_db.mayContainAlias(p.first, output)) {
+          tensor_users.insert(
+              tensor_users.end(), p.second.begin(), p.second.end());
+        }
+      }
+      managed_.push_back({reg, 0, 0});
+      defs.push_back(i);
+      users.push_back(std::move(tensor_users));
+      is_managed_[reg] = true;
+    }
+  }
+  stats_.num_managed_tensors = managed_.size();
+
+  // Node i finishes before node j starts. Without dependencies the nodes run
+  // in order, otherwise i has to be an ancestor of j.
+  std::vector<std::vector<bool>> ancestors;
+  if (!node_deps.empty()) {
+    ancestors.resize(nodes.size(), std::vector<bool>(nodes.size(), false));
+    for (size_t j = 0; j < nodes.size(); j++) {
+      for (size_t dep : node_deps[j]) {
+        ancestors[j][dep] = true;
+        for (size_t k = 0; k < dep; k++) {
+          if (ancestors[dep][k]) {
+            ancestors[j][k] = true;
+          }
+        }
+      }
+    }
+  }
+  auto happens_before = [&](size_t i, size_t j) {
+    if (i >= nodes.size()) {
+      return false;
+    }
+    return node_deps.empty() ? i < j : static_cast<bool>(ancestors[j][i]);
+  };
+  // Storage a is dead once every node accessing it finished before the node
+  // producing b starts
+  auto dead_before = [&](size_t a, size_t b) {
+    return std::all_of(users[a].begin(), users[a].end(), [&](size_t u) {
+      return happens_before(u, defs[b]);
+    });
+  };
+  const size_t num_managed = managed_.size();
+  conflicts_.resize(num_managed * num_managed, false);
+  for (size_t a = 0; a < num_managed; a++) {
+    for (size_t b = a + 1; b < num_managed; b++) {
+      bool conflict = !dead_before(a, b) && !dead_before(b, a);
+      conflicts_[a * num_managed + b] = conflict;
+      conflicts_[b * num_managed + a] = conflict;
+    }
+  }
+}
+
+void MemoryPlanner::allocate(std::vector<IValue>& reg) {
+  if (!planned_) {
+    return;
+  }
+  auto* base = static_cast<uint8_t*>(arena_.get());
+  for (const auto& m : managed_) {
+    if (!reg[m.reg].isTensor()) {
+      continue;
+    }
+    c10::StorageImpl* storage =
+        reg[m.reg].toTensor().storage().unsafeGetStorageImpl();
+    void* ptr = base + m.offset;
+    storage->set_data_ptr(
+        at::DataPtr(ptr, ptr, &c10::NoDelete, storage->device()));
+    storage->set_nbytes(m.size);
+  }
+}
+
+void MemoryPlanner::deallocate(std::vector<IValue>& reg) {
+  bool needs_plan = !planned_;
+  for (auto& m : managed_) {
+    if (!reg[m.reg].isTensor()) {
+      continue;
+    }
+    c10::StorageImpl* storage =
+        reg[m.reg].toTensor().storage().unsafeGetStorageImpl();
+    // the op allocated a larger buffer than the slot it was given
+    size_t size = (storage->nbytes() + c10::gAlignment - 1) / c10::gAlignment *
+        c10::gAlignment;
+    if (size > m.size) {
+      m.size = size;
+      needs_plan = true;
+    }
+    // Frees the buffer if it was not carved out of the arena. The tensor keeps
+    // its sizes, allocate() hands it a large enough slot before the next run.
+    storage->set_data_ptr(
+        at::DataPtr(nullptr, nullptr, &c10::NoDelete, storage->device()));
+    storage->set_nbytes(0);
+  }
+  if (needs_plan) {
+    plan();
+  }
+}
+
+void MemoryPlanner::plan() {
+  // Greedy first fit, largest tensors first: each tensor goes to the lowest
+  // offset that does not overlap any already placed tensor that may be alive
+  // at the same time.
+  const size_t num_managed = managed_.size();
+  std::vector<size_t> order(num_managed);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return managed_[a].size > managed_[b].size;
+  });
+
+  std::vector<size_t> placed;
+  size_t arena_bytes = 0;
+  size_t total_bytes = 0;
+  for (size_t idx : order) {
+    ManagedTensor& m = managed_[idx];
+    total_bytes += m.size;
+    std::vector<std::pair<size_t, size_t>> taken;
+    for (size_t other_idx : placed) {
+      if (conflicts_[idx * num_managed + other_idx]) {
+        const ManagedTensor& other = managed_[other_idx];
+        taken.emplace_back(other.offset, other.offset + other.size);
+      }
+    }
+    std::sort(taken.begin(), taken.end());
+    size_t offset = 0;
+    for (const auto& range : taken) {
+      if (range.first >= offset + m.size) {
+        break;
+      }
+      offset = std::max(offset, range.second);
+    }
+    m.offset = offset;
+    arena_bytes = std::max(arena_bytes, offset + m.size);
+    placed.push_back(idx);
+  }
+
+  // the arena only grows, so a replan never invalidates a larger arena
+  if (arena_bytes > stats_.arena_bytes) {
+    arena_ = c10::GetCPUAllocator()->allocate(arena_bytes);
+    stats_.arena_bytes = arena_bytes;
+  }
+  stats_.total_managed_bytes = total_bytes;
+  if (planned_) {
+    stats_.num_replans++;
+  }
+  planned_ = true;
+}
+
 } // namespace jit
 } // namespace torch
@@ -13,6 +13,15 @@ namespace jit {
 struct TORCH_API StaticRuntimeOptions {
   bool cleanup_activations{true};
   bool enable_out_variant{true};
+  // Place the outputs of out-variant ops in one arena that is reused across
+  // runs, with buffers of values that are never alive at the same time
+  // sharing memory. Only takes effect together with enable_out_variant and
+  // cleanup_activations.
+  bool enable_memory_planner{true};
+  // Run nodes that do not depend on each other concurrently on the inter-op
+  // thread pool (see at::launch), e.g. the independent towers of a
+  // recommendation model. The calling thread takes part in running the nodes.
+  bool enable_inter_op_parallelism{false};
 };
 
 /// Static runime supports two execution modes.
@@ -83,7 +92,24 @@ inline TORCH_API std::shared_ptr<InferenceModule> PrepareForStaticRuntime(
   return std::make_shared<InferenceModule>(g);
 }
 
+class AliasDb;
 class ProcessedNode;
+class MemoryPlanner;
+struct ParallelRunState;
+
+struct TORCH_API MemoryPlannerStats {
+  // Number of tensors whose storage lives in the arena
+  size_t num_managed_tensors{0};
+  // Sum of the sizes of all managed tensors, i.e. the bytes that would be
+  // allocated per run without buffer reuse
+  size_t total_managed_bytes{0};
+  // Size of the arena, i.e. the peak memory of the managed tensors
+  size_t arena_bytes{0};
+  // Number of times the arena layout was recomputed because a managed tensor
+  // outgrew its slot
+  size_t num_replans{0};
+};
+
 class TORCH_API StaticRuntime {
  public:
   // InferenceModule m is created by PrepareForStaticRuntime
@@ -116,13 +142,34 @@ class TORCH_API StaticRuntime {
       const int warmup_runs,
       const int main_runs) const;
 
-  struct IndividualMetrics {
+  struct TORCH_API IndividualMetrics {
     float setup_time;
     float total_time;
     std::vector<float> time_per_node;
+    std::vector<std::string> kind_per_node;
+    // CPU allocations made while running each node, averaged over the runs.
+    // Read from the process-wide counters of profiledCPUMemoryReporter(), so
+    // they include the node's intra-op threads, but also any other thread
+    // allocating at the same time.
+    std::vector<double> bytes_per_node;
+    std::vector<double> allocations_per_node;
+    // Whether each node ran through its out variant or the boxed operator
+    std::vector<bool> out_variant_per_node;
+    // Sizes of each node's inputs in the last run, empty for non-tensors
+    std::vector<std::vector<std::vector<int64_t>>> input_shapes_per_node;
     std::unordered_map<std::string, float> time_per_node_type;
     std::unordered_map<std::string, float> percent_per_node_type;
     std::unordered_map<std::string, int> instances_per_node_type;
+    std::unordered_map<std::string, double> bytes_per_node_type;
+    std::unordered_map<std::string, double> allocations_per_node_type;
+    // Number of nodes of each kind that ran through the boxed operator
+    std::unordered_map<std::string, int> fallback_instances_per_node_type;
+
+    // Per-node and per-kind results as a JSON object, for tracking in CI
+    std::string to_json() const;
+    // The nodes of one average run laid out back to back, in the Chrome
+    // trace event format (chrome://tracing)
+    std::string to_chrome_trace() const;
   };
 
   IndividualMetrics benchmark_individual_ops(
@@ -131,6 +178,9 @@ class TORCH_API StaticRuntime {
       const int warmup_runs,
       const int main_runs) const;
 
+  // Returns nullopt if the memory planner is disabled
+  c10::optional<MemoryPlannerStats> memory_planner_stats() const;
+
  private:
   // Static runtime states
   std::shared_ptr<InferenceModule> module_;
@@ -139,6 +189,21 @@ class TORCH_API StaticRuntime {
   mutable std::vector<IValue> reg_;
   // The nodes we need to run
   std::vector<ProcessedNode> nodes_;
+  // Registers of the graph outputs that are produced by nodes
+  std::vector<size_t> node_output_regs_;
+  // Owns the memory of the intermediates produced by out-variant ops
+  std::unique_ptr<MemoryPlanner> planner_;
+  // Only set with enable_inter_op_parallelism: for every node, the number of
+  // nodes it waits for and the nodes waiting for it
+  std::vector<size_t> node_num_deps_;
+  std::vector<std::vector<size_t>> node_successors_;
+
+  // Releases the activations and outputs of the last run
+  void cleanup_after_run() const;
+  void run_nodes_in_parallel() const;
+  void run_ready_nodes(
+      const std::shared_ptr<ParallelRunState>& state,
+      bool is_caller) const;
 
   // Input is readwrite
   IValue& Input(size_t i) const {
@@ -166,6 +231,14 @@ class ProcessedNode {
     return node_;
   }
 
+  bool has_out_variant() const {
+    return fn_.has_value();
+  }
+
+  const std::vector<size_t>& output_regs() const {
+    return output_regs_;
+  }
+
   // Input is readonly
   const IValue& Input(size_t i, std::vector<IValue>& reg) const {
     DCHECK(i < input_regs_.size());
@@ -188,5 +261,59 @@ class ProcessedNode {
   std::vector<size_t> output_regs_;
 };
 
+/// MemoryPlanner assigns the storages of the tensors produced by out-variant
+/// ops to offsets in a single arena that is reused across runs.
+///
+/// The sizes are only known after a run, so the first run allocates through
+/// the CPU allocator as usual. Afterwards each managed tensor gets a slot that
+/// is as large as the largest storage it has needed so far, and tensors whose
+/// lifetimes (including the lifetimes of their aliases) do not overlap share
+/// memory. If a tensor outgrows its slot, the op resizes it through the CPU
+/// allocator for that run and the arena is replanned afterwards.
+class MemoryPlanner {
+ public:
+  // node_deps holds the nodes each node waits for when the nodes may run
+  // concurrently, and is empty when they run one after another
+  MemoryPlanner(
+      const InferenceModule& module,
+      const std::vector<ProcessedNode>& nodes,
+      const AliasDb& alias_db,
+      const std::vector<std::vector<size_t>>& node_deps);
+
+  // Points the storages of the managed tensors into the arena. Must be called
+  // before running the nodes.
+  void allocate(std::vector<IValue>& reg);
+  // Records the sizes of the managed storages and detaches them from the
+  // arena. Must be called after running the nodes.
+  void deallocate(std::vector<IValue>& reg);
+
+  bool is_managed(size_t reg) const {
+    return reg < is_managed_.size() && is_managed_[reg];
+  }
+
+  const MemoryPlannerStats& stats() const {
+    return stats_;
+  }
+
+ private:
+  struct ManagedTensor {
+    size_t reg;
+    // Slot size in bytes, a multiple of the alignment
+    size_t size;
+    size_t offset;
+  };
+
+  void plan();
+
+  std::vector<ManagedTensor> managed_;
+  // conflicts_[a * managed_.size() + b] is set if managed tensors a and b may
+  // be alive at the same time
+  std::vector<bool> conflicts_;
+  std::vector<bool> is_managed_;
+  at::DataPtr arena_;
+  bool planned_{false};
+  MemoryPlannerStats stats_;
+};
+
 } // namespace jit
 } // namespace torch
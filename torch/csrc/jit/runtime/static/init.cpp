@@ -21,7 +21,40 @@ void initStaticRuntimeBindings(PyObject* module) {
           &StaticRuntime::IndividualMetrics::percent_per_node_type)
       .def_readonly(
           "instances_per_node_type",
-          &StaticRuntime::IndividualMetrics::instances_per_node_type);
+          &StaticRuntime::IndividualMetrics::instances_per_node_type)
+      .def_readonly(
+          "kind_per_node", &StaticRuntime::IndividualMetrics::kind_per_node)
+      .def_readonly(
+          "bytes_per_node", &StaticRuntime::IndividualMetrics::bytes_per_node)
+      .def_readonly(
+          "allocations_per_node",
+          &StaticRuntime::IndividualMetrics::allocations_per_node)
+      .def_readonly(
+          "out_variant_per_node",
+          &StaticRuntime::IndividualMetrics::out_variant_per_node)
+      .def_readonly(
+          "input_shapes_per_node",
+          &StaticRuntime::IndividualMetrics::input_shapes_per_node)
+      .def_readonly(
+          "bytes_per_node_type",
+          &StaticRuntime::IndividualMetrics::bytes_per_node_type)
+      .def_readonly(
+          "allocations_per_node_type",
+          &StaticRuntime::IndividualMetrics::allocations_per_node_type)
+      .def_readonly(
+          "fallback_instances_per_node_type",
+          &StaticRuntime::IndividualMetrics::fallback_instances_per_node_type)
+      .def("to_json", &StaticRuntime::IndividualMetrics::to_json)
+      .def(
+          "to_chrome_trace",
+          &StaticRuntime::IndividualMetrics::to_chrome_trace);
+  py::class_<MemoryPlannerStats>(static_runtime, "MemoryPlannerStats")
+      .def_readonly(
+          "num_managed_tensors", &MemoryPlannerStats::num_managed_tensors)
+      .def_readonly(
+          "total_managed_bytes", &MemoryPlannerStats::total_managed_bytes)
+      .def_readonly("arena_bytes", &MemoryPlannerStats::arena_bytes)
+      .def_readonly("num_replans", &MemoryPlannerStats::num_replans);
   static_runtime
       .def(
           "run",
@@ -62,7 +95,14 @@ void initStaticRuntimeBindings(PyObject* module) {
                 kwargs.begin(), kwargs.end()};
             return self.benchmark_individual_ops(
                 arg_ivalues, kwarg_ivalues, warmup_runs, main_runs);
-          });
+          })
+      .def("memory_planner_stats", [](StaticRuntime& self) -> py::object {
+        auto stats = self.memory_planner_stats();
+        if (!stats) {
+          return py::none();
+        }
+        return py::cast(*stats);
+      });
   m.def(
        "_jit_to_static_runtime",
        [](std::shared_ptr<torch::jit::Graph> g) {
@@ -1,121 +1,303 @@
 #include <torch/csrc/jit/runtime/static/ops.h>
 #include <ATen/NativeFunctions.h>
 #include <torch/csrc/jit/ir/ir.h>
+#include <torch/csrc/jit/runtime/operator.h>
 
 namespace torch {
 namespace jit {
 
-bool canRunOutOfPlace(Node* n) {
-  static std::unordered_set<std::string> out_of_place_nodes{"aten::add",
-                                                            "aten::mul",
-                                                            "aten::addmm",
-                                                            "aten::bmm",
-                                                            "aten::sigmoid",
-                                                            "aten::cat",
-                                                            "aten::transpose",
-                                                            "aten::flatten"};
-  auto str = std::string(n->kind().toQualString());
-  return out_of_place_nodes.count(str) > 0;
+C10_DEFINE_REGISTRY(SROperatorRegistry, SROperatorFunctor);
+
+namespace {
+at::Tensor create_empty_from(const at::Tensor& t) {
+  return at::empty({0}, t.options());
+}
+
+c10::optional<at::Scalar> to_optional_scalar(const IValue& v) {
+  if (v.isNone()) {
+    return c10::nullopt;
+  }
+  return v.toScalar();
 }
 
-std::function<void(const ProcessedNode*, std::vector<IValue>&)>
-getOutOfPlaceOperation(Node* n) {
-  auto create_empty_from = [](const at::Tensor& t) {
-    return at::empty({0}, t.options());
+// Finds the out= overload of the op n runs, i.e. the overload whose schema is
+// the schema of n followed by a keyword-only `Tensor(a!) out` argument.
+std::shared_ptr<Operator> findOutOverload(Node* n) {
+  const FunctionSchema* schema = n->maybeSchema();
+  if (!schema || schema->is_mutable() || schema->is_vararg() ||
+      schema->returns().size() != 1 ||
+      schema->returns()[0].alias_info() != nullptr ||
+      !schema->returns()[0].type()->isSubtypeOf(TensorType::get())) {
+    return nullptr;
+  }
+  const auto& args = schema->arguments();
+  for (const auto& op : getAllOperatorsFor(n->kind())) {
+    if (!op->isC10Op()) {
+      continue;
+    }
+    const auto& out_args = op->schema().arguments();
+    if (out_args.size() != args.size() + 1) {
+      continue;
+    }
+    const Argument& out_arg = out_args.back();
+    if (!out_arg.kwarg_only() || !out_arg.alias_info() ||
+        !out_arg.alias_info()->isWrite()) {
+      continue;
+    }
+    bool same_args = true;
+    for (size_t i = 0; i < args.size() && same_args; i++) {
+      same_args = args[i].name() == out_args[i].name() &&
+          *args[i].type() == *out_args[i].type();
+    }
+    if (same_args) {
+      return op;
+    }
+  }
+  return nullptr;
+}
+
+// Runs n through the boxed out= overload of its op. The first run calls the
+// functional op, so the output gets the dtype and layout the op picks.
+SROperator getBoxedOutOperation(Node* n) {
+  auto out_op = findOutOverload(n);
+  if (!out_op) {
+    return SROperator();
+  }
+  Operation op = n->getOperation();
+  Operation op_out = out_op->getOperation();
+  return [op, op_out](const ProcessedNode* p_node, std::vector<IValue>& reg) {
+    std::vector<IValue> stack;
+    const size_t size = p_node->get_node()->inputs().size();
+    stack.reserve(size + 1);
+    for (size_t i = 0; i < size; i++) {
+      stack.emplace_back(p_node->Input(i, reg));
+    }
+    if (p_node->Output(0, reg).isNone()) {
+      op(&stack);
+      p_node->Output(0, reg) = std::move(stack[0]);
+      return;
+    }
+    stack.emplace_back(p_node->Output(0, reg));
+    op_out(&stack);
   };
+}
+} // namespace
 
-  if (n->kind() == c10::Symbol::fromQualString("aten::add")) {
-    return [=](const ProcessedNode* p_node, std::vector<IValue>& reg) {
-      auto in0_t = p_node->Input(0, reg).toTensor();
-      auto in1_t = p_node->Input(1, reg).toTensor();
-      auto in2_s = p_node->Input(2, reg).toScalar();
-      if (p_node->Output(0, reg).isNone()) {
-        p_node->Output(0, reg) = create_empty_from(in0_t);
-      }
-      auto out_t = p_node->Output(0, reg).toTensor();
-      at::native::add_out(out_t, in0_t, in1_t, in2_s);
-    };
-  } else if (n->kind() == c10::Symbol::fromQualString("aten::mul")) {
-    return [=](const ProcessedNode* p_node, std::vector<IValue>& reg) {
-      auto in0_t = p_node->Input(0, reg).toTensor();
-      auto in1_t = p_node->Input(1, reg).toTensor();
-      if (p_node->Output(0, reg).isNone()) {
-        p_node->Output(0, reg) = create_empty_from(in0_t);
-      }
-      auto out_t = p_node->Output(0, reg).toTensor();
-      at::native::mul_out(out_t, in0_t, in1_t);
-    };
-  } else if (n->kind() == c10::Symbol::fromQualString("aten::addmm")) {
-    return [=](const ProcessedNode* p_node, std::vector<IValue>& reg) {
-      auto in0_t = p_node->Input(0, reg).toTensor();
-      auto in1_t = p_node->Input(1, reg).toTensor();
-      auto in2_t = p_node->Input(2, reg).toTensor();
-      auto in3_s = p_node->Input(3, reg).toScalar();
-      auto in4_s = p_node->Input(4, reg).toScalar();
-      if (p_node->Output(0, reg).isNone()) {
-        p_node->Output(0, reg) = create_empty_from(in0_t);
-      }
-      auto out_t = p_node->Output(0, reg).toTensor();
-      at::native::addmm_cpu_out(out_t, in0_t, in1_t, in2_t, in3_s, in4_s);
-    };
-  } else if (n->kind() == c10::Symbol::fromQualString("aten::clamp")) {
-    return [=](const ProcessedNode* p_node, std::vector<IValue>& reg) {
-      auto in0_t = p_node->Input(0, reg).toTensor();
-      auto in1_s = p_node->Input(1, reg).toScalar();
-      auto in2_s = p_node->Input(2, reg).toScalar();
-      if (p_node->Output(0, reg).isNone()) {
-        p_node->Output(0, reg) = create_empty_from(in0_t);
-      }
-      auto out_t = p_node->Output(0, reg).toTensor();
-      at::native::clamp_out(out_t, in0_t, in1_s, in2_s);
-    };
-  } else if (n->kind() == c10::Symbol::fromQualString("aten::bmm")) {
-    return [=](const ProcessedNode* p_node, std::vector<IValue>& reg) {
-      auto in0_t = p_node->Input(0, reg).toTensor();
-      auto in1_t = p_node->Input(1, reg).toTensor();
-      if (p_node->Output(0, reg).isNone()) {
-        p_node->Output(0, reg) = create_empty_from(in0_t);
-      }
-      auto out_t = p_node->Output(0, reg).toTensor();
-      at::native::bmm_out_cpu(out_t, in0_t, in1_t);
-    };
-  } else if (n->kind() == c10::Symbol::fromQualString("aten::cat")) {
-    return [=](const ProcessedNode* p_node, std::vector<IValue>& reg) {
-      auto in0_tl = p_node->Input(0, reg).toTensorVector();
-      auto in1_i = p_node->Input(1, reg).toInt();
-      if (p_node->Output(0, reg).isNone()) {
-        p_node->Output(0, reg) = create_empty_from(in0_tl[0]);
-      }
-      auto out_t = p_node->Output(0, reg).toTensor();
-      at::native::_cat_out_cpu(out_t, in0_tl, in1_i);
-    };
-  } else if (n->kind() == c10::Symbol::fromQualString("aten::sigmoid")) {
-    return [=](const ProcessedNode* p_node, std::vector<IValue>& reg) {
-      auto in0_t = p_node->Input(0, reg).toTensor();
-      if (p_node->Output(0, reg).isNone()) {
-        p_node->Output(0, reg) = create_empty_from(in0_t);
-      }
-      auto out_t = p_node->Output(0, reg).toTensor();
-      at::native::sigmoid_out(out_t, in0_t);
-    };
-  } else if (n->kind() == c10::Symbol::fromQualString("aten::transpose")) {
-    return [=](const ProcessedNode* p_node, std::vector<IValue>& reg) {
-      auto in0_t = p_node->Input(0, reg).toTensor();
-      auto in1_i = p_node->Input(1, reg).toInt();
-      auto in2_i = p_node->Input(2, reg).toInt();
-      p_node->Output(0, reg) = at::native::transpose(in0_t, in1_i, in2_i);
-    };
-  } else if (n->kind() == c10::Symbol::fromQualString("aten::flatten")) {
-    return [=](const ProcessedNode* p_node, std::vector<IValue>& reg) {
-      auto in0_t = p_node->Input(0, reg).toTensor();
-      auto in1_i = p_node->Input(1, reg).toInt();
-      auto in2_i = p_node->Input(2, reg).toInt();
-      p_node->Output(0, reg) = at::native::flatten(in0_t, in1_i, in2_i);
-    };
+bool canRunOutOfPlace(Node* n) {
+  auto op_name = std::string(n->kind().toQualString());
+  return SROperatorRegistry()->Has(op_name) || findOutOverload(n) != nullptr;
+}
+
+bool outputsOwnStorage(Node* n) {
+  auto op_name = std::string(n->kind().toQualString());
+  if (SROperatorRegistry()->Has(op_name)) {
+    return SROperatorRegistry()->Create(op_name)->OutputsOwnStorage();
   }
+  return findOutOverload(n) != nullptr;
+}
 
-  return [](const ProcessedNode*, std::vector<IValue>&) { TORCH_CHECK(0); };
+SROperator getOutOfPlaceOperation(Node* n) {
+  auto op_name = std::string(n->kind().toQualString());
+  if (SROperatorRegistry()->Has(op_name)) {
+    return SROperatorRegistry()->Create(op_name)->Generate(n);
+  }
+  return getBoxedOutOperation(n);
 }
 
+REGISTER_OPERATOR_FUNCTOR(aten::add, aten_add, [](Node* n) -> SROperator {
+  if (!n->matches(
+          "aten::add.Tensor(Tensor self, Tensor other, *, Scalar alpha=1) -> Tensor")) {
+    return getBoxedOutOperation(n);
+  }
+  return [](const ProcessedNode* p_node, std::vector<IValue>& reg) {
+    auto in0_t = p_node->Input(0, reg).toTensor();
+    auto in1_t = p_node->Input(1, reg).toTensor();
+    auto in2_s = p_node->Input(2, reg).toScalar();
+    if (p_node->Output(0, reg).isNone()) {
+      p_node->Output(0, reg) = create_empty_from(in0_t);
+    }
+    auto out_t = p_node->Output(0, reg).toTensor();
+    at::native::add_out(out_t, in0_t, in1_t, in2_s);
+  };
+});
+
+REGISTER_OPERATOR_FUNCTOR(aten::sub, aten_sub, [](Node* n) -> SROperator {
+  if (!n->matches(
+          "aten::sub.Tensor(Tensor self, Tensor other, *, Scalar alpha=1) -> Tensor")) {
+    return getBoxedOutOperation(n);
+  }
+  return [](const ProcessedNode* p_node, std::vector<IValue>& reg) {
+    auto in0_t = p_node->Input(0, reg).toTensor();
+    auto in1_t = p_node->Input(1, reg).toTensor();
+    auto in2_s = p_node->Input(2, reg).toScalar();
+    if (p_node->Output(0, reg).isNone()) {
+      p_node->Output(0, reg) = create_empty_from(in0_t);
+    }
+    auto out_t = p_node->Output(0, reg).toTensor();
+    at::native::sub_out(out_t, in0_t, in1_t, in2_s);
+  };
+});
+
+REGISTER_OPERATOR_FUNCTOR(aten::mul, aten_mul, [](Node* n) -> SROperator {
+  if (!n->matches("aten::mul.Tensor(Tensor self, Tensor other) -> Tensor")) {
+    return getBoxedOutOperation(n);
+  }
+  return [](const ProcessedNode* p_node, std::vector<IValue>& reg) {
+    auto in0_t = p_node->Input(0, reg).toTensor();
+    auto in1_t = p_node->Input(1, reg).toTensor();
+    if (p_node->Output(0, reg).isNone()) {
+      p_node->Output(0, reg) = create_empty_from(in0_t);
+    }
+    auto out_t = p_node->Output(0, reg).toTensor();
+    at::native::mul_out(out_t, in0_t, in1_t);
+  };
+});
+
+REGISTER_OPERATOR_FUNCTOR(aten::addmm, aten_addmm, [](Node* n) -> SROperator {
+  if (!n->matches(
+          "aten::addmm(Tensor self, Tensor mat1, Tensor mat2, *, Scalar beta=1, Scalar alpha=1) -> Tensor")) {
+    return getBoxedOutOperation(n);
+  }
+  return [](const ProcessedNode* p_node, std::vector<IValue>& reg) {
+    auto in0_t = p_node->Input(0, reg).toTensor();
+    auto in1_t = p_node->Input(1, reg).toTensor();
+    auto in2_t = p_node->Input(2, reg).toTensor();
+    auto in3_s = p_node->Input(3, reg).toScalar();
+    auto in4_s = p_node->Input(4, reg).toScalar();
+    if (p_node->Output(0, reg).isNone()) {
+      p_node->Output(0, reg) = create_empty_from(in0_t);
+    }
+    auto out_t = p_node->Output(0, reg).toTensor();
+    at::native::addmm_cpu_out(out_t, in0_t, in1_t, in2_t, in3_s, in4_s);
+  };
+});
+
+REGISTER_OPERATOR_FUNCTOR(aten::mm, aten_mm, [](Node* n) -> SROperator {
+  if (!n->matches("aten::mm(Tensor self, Tensor mat2) -> Tensor")) {
+    return getBoxedOutOperation(n);
+  }
+  return [](const ProcessedNode* p_node, std::vector<IValue>& reg) {
+    auto in0_t = p_node->Input(0, reg).toTensor();
+    auto in1_t = p_node->Input(1, reg).toTensor();
+    if (p_node->Output(0, reg).isNone()) {
+      p_node->Output(0, reg) = create_empty_from(in0_t);
+    }
+    auto out_t = p_node->Output(0, reg).toTensor();
+    at::native::mm_cpu_out(out_t, in0_t, in1_t);
+  };
+});
+
+REGISTER_OPERATOR_FUNCTOR(aten::clamp, aten_clamp, [](Node* n) -> SROperator {
+  if (!n->matches(
+          "aten::clamp(Tensor self, Scalar? min=None, Scalar? max=None) -> Tensor")) {
+    return getBoxedOutOperation(n);
+  }
+  return [](const ProcessedNode* p_node, std::vector<IValue>& reg) {
+    auto in0_t = p_node->Input(0, reg).toTensor();
+    auto in1_s = to_optional_scalar(p_node->Input(1, reg));
+    auto in2_s = to_optional_scalar(p_node->Input(2, reg));
+    if (p_node->Output(0, reg).isNone()) {
+      p_node->Output(0, reg) = create_empty_from(in0_t);
+    }
+    auto out_t = p_node->Output(0, reg).toTensor();
+    at::native::clamp_out(out_t, in0_t, in1_s, in2_s);
+  };
+});
+
+REGISTER_OPERATOR_FUNCTOR(aten::bmm, aten_bmm, [](Node* n) -> SROperator {
+  if (!n->matches("aten::bmm(Tensor self, Tensor mat2) -> Tensor")) {
+    return getBoxedOutOperation(n);
+  }
+  return [](const ProcessedNode* p_node, std::vector<IValue>& reg) {
+    auto in0_t = p_node->Input(0, reg).toTensor();
+    auto in1_t = p_node->Input(1, reg).toTensor();
+    if (p_node->Output(0, reg).isNone()) {
+      p_node->Output(0, reg) = create_empty_from(in0_t);
+    }
+    auto out_t = p_node->Output(0, reg).toTensor();
+    at::native::bmm_out_cpu(out_t, in0_t, in1_t);
+  };
+});
+
+REGISTER_OPERATOR_FUNCTOR(aten::cat, aten_cat, [](Node* n) -> SROperator {
+  if (!n->matches("aten::cat(Tensor[] tensors, int dim=0) -> Tensor")) {
+    return getBoxedOutOperation(n);
+  }
+  return [](const ProcessedNode* p_node, std::vector<IValue>& reg) {
+    auto in0_tl = p_node->Input(0, reg).toTensorVector();
+    auto in1_i = p_node->Input(1, reg).toInt();
+    if (p_node->Output(0, reg).isNone()) {
+      p_node->Output(0, reg) = create_empty_from(in0_tl[0]);
+    }
+    auto out_t = p_node->Output(0, reg).toTensor();
+    at::native::_cat_out_cpu(out_t, in0_tl, in1_i);
+  };
+});
+
+REGISTER_OPERATOR_FUNCTOR(aten::sigmoid, aten_sigmoid, [](Node* n) -> SROperator {
+  return [](const ProcessedNode* p_node, std::vector<IValue>& reg) {
+    auto in0_t = p_node->Input(0, reg).toTensor();
+    if (p_node->Output(0, reg).isNone()) {
+      p_node->Output(0, reg) = create_empty_from(in0_t);
+    }
+    auto out_t = p_node->Output(0, reg).toTensor();
+    at::native::sigmoid_out(out_t, in0_t);
+  };
+});
+
+REGISTER_OPERATOR_FUNCTOR(aten::tanh, aten_tanh, [](Node* n) -> SROperator {
+  return [](const ProcessedNode* p_node, std::vector<IValue>& reg) {
+    auto in0_t = p_node->Input(0, reg).toTensor();
+    if (p_node->Output(0, reg).isNone()) {
+      p_node->Output(0, reg) = create_empty_from(in0_t);
+    }
+    auto out_t = p_node->Output(0, reg).toTensor();
+    at::native::tanh_out(out_t, in0_t);
+  };
+});
+
+REGISTER_OPERATOR_FUNCTOR(aten::relu, aten_relu, [](Node* n) -> SROperator {
+  return [](const ProcessedNode* p_node, std::vector<IValue>& reg) {
+    auto in0_t = p_node->Input(0, reg).toTensor();
+    if (p_node->Output(0, reg).isNone()) {
+      p_node->Output(0, reg) = create_empty_from(in0_t);
+    }
+    auto out_t = p_node->Output(0, reg).toTensor();
+    at::native::threshold_out(out_t, in0_t, 0, 0);
+  };
+});
+
+REGISTER_VIEW_OPERATOR_FUNCTOR(
+    aten::transpose,
+    aten_transpose,
+    [](Node* n) -> SROperator {
+      if (!n->matches(
+              "aten::transpose.int(Tensor(a) self, int dim0, int dim1) -> Tensor(a)")) {
+        return SROperator();
+      }
+      return [](const ProcessedNode* p_node, std::vector<IValue>& reg) {
+        auto in0_t = p_node->Input(0, reg).toTensor();
+        auto in1_i = p_node->Input(1, reg).toInt();
+        auto in2_i = p_node->Input(2, reg).toInt();
+        p_node->Output(0, reg) = at::native::transpose(in0_t, in1_i, in2_i);
+      };
+    });
+
+REGISTER_VIEW_OPERATOR_FUNCTOR(
+    aten::flatten,
+    aten_flatten,
+    [](Node* n) -> SROperator {
+      if (!n->matches(
+              "aten::flatten.using_ints(Tensor(a) self, int start_dim=0, int end_dim=-1) -> Tensor(a)")) {
+        return SROperator();
+      }
+      return [](const ProcessedNode* p_node, std::vector<IValue>& reg) {
+        auto in0_t = p_node->Input(0, reg).toTensor();
+        auto in1_i = p_node->Input(1, reg).toInt();
+        auto in2_i = p_node->Input(2, reg).toInt();
+        p_node->Output(0, reg) = at::native::flatten(in0_t, in1_i, in2_i);
+      };
+    });
+
 } // namespace jit
 } // namespace torch
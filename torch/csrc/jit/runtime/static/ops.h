@@ -1,14 +1,67 @@
 #pragma once
 
+#include <c10/util/Registry.h>
 #include <torch/csrc/jit/ir/ir.h>
 #include <torch/csrc/jit/runtime/static/impl.h>
 
 namespace torch {
 namespace jit {
 
+using SROperator = std::function<void(const ProcessedNode*, std::vector<IValue>&)>;
+using SROpFunctor = SROperator (*)(Node* n);
+
+struct SROperatorFunctor {
+  // Returns the functor that runs n, or an empty SROperator if n has to run
+  // through its boxed operator, e.g. for overloads the functor does not handle
+  virtual SROperator Generate(Node*) {
+    return SROperator();
+  }
+  // Whether the functor writes into outputs that own their storage, as
+  // opposed to returning views of its inputs
+  virtual bool OutputsOwnStorage() const {
+    return true;
+  }
+  virtual ~SROperatorFunctor() = default;
+};
+
+C10_DECLARE_REGISTRY(SROperatorRegistry, SROperatorFunctor);
+
+// Registers an out variant for the op `name` (e.g. aten::add) with the static
+// runtime. `id` must be unique among the registrations of the translation
+// unit, and the last argument is an SROpFunctor, typically a captureless
+// lambda. Ops from custom operator libraries are registered the same way,
+// from within namespace torch::jit.
+#define REGISTER_OPERATOR_FUNCTOR(name, id, ...)             \
+  struct SROperatorFunctor_##id : public SROperatorFunctor { \
+    const SROpFunctor fn = __VA_ARGS__;                      \
+    SROperator Generate(Node* n) override {                  \
+      return fn(n);                                          \
+    }                                                        \
+  };                                                         \
+  C10_REGISTER_CLASS(SROperatorRegistry, name, SROperatorFunctor_##id);
+
+// Same as REGISTER_OPERATOR_FUNCTOR, for functors that return views of their
+// inputs. Their outputs are never placed in the memory planner's arena.
+#define REGISTER_VIEW_OPERATOR_FUNCTOR(name, id, ...)        \
+  struct SROperatorFunctor_##id : public SROperatorFunctor { \
+    const SROpFunctor fn = __VA_ARGS__;                      \
+    SROperator Generate(Node* n) override {                  \
+      return fn(n);                                          \
+    }                                                        \
+    bool OutputsOwnStorage() const override {                \
+      return false;                                          \
+    }                                                        \
+  };                                                         \
+  C10_REGISTER_CLASS(SROperatorRegistry, name, SROperatorFunctor_##id);
+
+// Whether n has an out variant: a registered functor or, for ops without
+// one, an out= overload in the operator registry
 bool canRunOutOfPlace(Node* n);
-std::function<void(const ProcessedNode*, std::vector<IValue>&)>
-getOutOfPlaceOperation(Node* n);
+// Whether the out variant of n writes into output tensors that own their
+// storage, as opposed to returning views of its inputs
+bool outputsOwnStorage(Node* n);
+// Returns an empty SROperator if n has no out variant after all
+SROperator getOutOfPlaceOperation(Node* n);
 
 #define SUPPORTED_OPS(F) \
   F(aten::__getitem__)   \
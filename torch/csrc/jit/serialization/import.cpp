@@ -17,13 +17,19 @@
 #include <caffe2/serialize/file_adapter.h>
 #include <caffe2/serialize/inline_container.h>
 #include <caffe2/serialize/istream_adapter.h>
+#include <caffe2/serialize/mmap_adapter.h>
 
 #include <ATen/ATen.h>
 #include <fmt/format.h>
 
+#include <algorithm>
+#include <condition_variable>
 #include <fstream>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 namespace torch {
@@ -31,6 +37,7 @@ namespace jit {
 
 using caffe2::serialize::FileAdapter;
 using caffe2::serialize::IStreamAdapter;
+using caffe2::serialize::MmapFileAdapter;
 using caffe2::serialize::PyTorchStreamReader;
 using caffe2::serialize::ReadAdapterInterface;
 
@@ -56,6 +63,107 @@ void postSetStateValidate(const IValue& v) {
   }
 }
 
+namespace {
+
+// Reads the tensor records of an archive in file order on a background thread,
+// so that I/O overlaps with unpickling. At most kPrefetchWindowBytes of
+// records are held ahead of the unpickler; the thread waits for it to take
+// records before reading further, so e.g. loading to CUDA never stages the
+// whole checkpoint in host memory. A record the unpickler asks for that the
+// prefetcher does not hold and is not reading right now (already handed
+// out, not reached yet, or the prefetch failed) is read directly, which also
+// surfaces any read error on the calling thread.
+constexpr size_t kPrefetchWindowBytes = 64 << 20;
+
+class RecordPrefetcher final {
+ public:
+  RecordPrefetcher(
+      PyTorchStreamReader& reader,
+      std::vector<std::string> names)
+      : reader_(reader), pending_(names.begin(), names.end()) {
+    thread_ = std::thread(
+        [this, names = std::move(names)]() { prefetch(names); });
+  }
+
+  ~RecordPrefetcher() {
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      stopped_ = true;
+    }
+    space_cv_.notify_all();
+    thread_.join();
+  }
+
+  at::DataPtr get(const std::string& name) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      ready_cv_.wait(lock, [&] { return reading_ != name; });
+      auto it = ready_.find(name);
+      if (it != ready_.end()) {
+        at::DataPtr data = std::move(it->second.first);
+        ready_bytes_ -= it->second.second;
+        ready_.erase(it);
+        space_cv_.notify_one();
+        return data;
+      }
+      // Claim the record so that the prefetcher skips it
+      pending_.erase(name);
+    }
+    return std::get<0>(reader_.getRecord(name));
+  }
+
+ private:
+  void prefetch(const std::vector<std::string>& names) {
+    for (const auto& name : names) {
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        space_cv_.wait(lock, [&] {
+          return stopped_ || ready_bytes_ < kPrefetchWindowBytes;
+        });
+        if (stopped_) {
+          break;
+        }
+        if (!pending_.erase(name)) {
+          continue;
+        }
+        reading_ = name;
+      }
+      at::DataPtr data;
+      size_t size = 0;
+      try {
+        std::tie(data, size) = reader_.getRecord(name);
+      } catch (...) {
+        break;
+      }
+      std::lock_guard<std::mutex> guard(mutex_);
+      reading_.clear();
+      ready_bytes_ += size;
+      ready_.emplace(name, std::make_pair(std::move(data), size));
+      ready_cv_.notify_all();
+    }
+    std::lock_guard<std::mutex> guard(mutex_);
+    reading_.clear();
+    ready_cv_.notify_all();
+  }
+
+  PyTorchStreamReader& reader_;
+  std::mutex mutex_;
+  // Signals that a record was read, or that prefetching ended
+  std::condition_variable ready_cv_;
+  // Signals that the unpickler took a record, or that loading ended
+  std::condition_variable space_cv_;
+  // Records the prefetcher has not read yet and the unpickler not claimed
+  std::unordered_set<std::string> pending_;
+  // The record being read by the prefetcher, empty if none
+  std::string reading_;
+  std::unordered_map<std::string, std::pair<at::DataPtr, size_t>> ready_;
+  size_t ready_bytes_ = 0;
+  bool stopped_ = false;
+  std::thread thread_;
+};
+
+} // namespace
+
 IValue readArchiveAndTensors(
     const std::string& archive_name,
     c10::optional<TypeResolver> type_resolver,
@@ -82,8 +190,31 @@ IValue readArchiveAndTensors(
   };
 
   std::string archive_name_plus_slash = archive_name + "/";
+  std::vector<std::pair<size_t, std::string>> records;
+  for (auto& record : stream_reader.getAllRecords()) {
+    if (record.compare(
+            0, archive_name_plus_slash.size(), archive_name_plus_slash) == 0) {
+      size_t offset = stream_reader.getRecordOffset(record);
+      records.emplace_back(offset, std::move(record));
+    }
+  }
+  std::unique_ptr<RecordPrefetcher> prefetcher;
+  if (records.size() > 1) {
+    std::sort(records.begin(), records.end());
+    std::vector<std::string> names;
+    names.reserve(records.size());
+    for (auto& record : records) {
+      names.push_back(std::move(record.second));
+    }
+    prefetcher = std::make_unique<RecordPrefetcher>(
+        stream_reader, std::move(names));
+  }
+
   auto read_record = [&](const std::string& name) {
     std::string ss = archive_name_plus_slash + name;
+    if (prefetcher) {
+      return prefetcher->get(ss);
+    }
     return std::get<0>(stream_reader.getRecord(ss));
   };
 
@@ -316,8 +447,14 @@ Module load(
 Module load(
     const std::string& filename,
     c10::optional<at::Device> device,
-    ExtraFilesMap& extra_files) {
-  std::unique_ptr<FileAdapter> rai = std::make_unique<FileAdapter>(filename);
+    ExtraFilesMap& extra_files,
+    bool mmap) {
+  std::unique_ptr<ReadAdapterInterface> rai;
+  if (mmap) {
+    rai = std::make_unique<MmapFileAdapter>(filename);
+  } else {
+    rai = std::make_unique<FileAdapter>(filename);
+  }
   auto module = load(std::move(rai), device, extra_files);
   return module;
 }
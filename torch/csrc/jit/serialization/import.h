@@ -50,10 +50,14 @@ TORCH_API Module load(
 /// The file stored at the location given in `filename` must contain a
 /// serialized `Module`, exported either via `ScriptModule.save()` in
 /// Python or `torch::jit::ExportModule` in C++.
+///
+/// With `mmap` set, the file is mapped copy-on-write instead of read, and
+/// uncompressed CPU tensors alias the mapping rather than owning a copy.
 TORCH_API Module load(
     const std::string& filename,
     c10::optional<c10::Device> device = c10::nullopt,
-    ExtraFilesMap& extra_files = default_extra_files);
+    ExtraFilesMap& extra_files = default_extra_files,
+    bool mmap = false);
 
 /// Loads a serialized `Module` from the given `rai`.
 ///
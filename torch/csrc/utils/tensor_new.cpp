@@ -690,6 +690,38 @@ void _validate_sparse_coo_tensor_args(c10::DispatchKey dispatch_key, at::ScalarT
   at::native::_validate_sparse_coo_tensor_args(indices, values, r.intlist(2));
 }
 
+Tensor sparse_csr_tensor_ctor(c10::DispatchKey dispatch_key, at::ScalarType scalar_type, PyObject* args, PyObject* kwargs) {
+  static PythonArgParser parser({
+    "sparse_csr_tensor(PyObject* crow_indices, PyObject* col_indices, PyObject* values, *, ScalarType dtype=None, Device? device=None, bool requires_grad=False)",
+    "sparse_csr_tensor(PyObject* crow_indices, PyObject* col_indices, PyObject* values, IntArrayRef size, *, ScalarType dtype=None, Device? device=None, bool requires_grad=False)",
+  });
+
+  ParsedArgs<7> parsed_args;
+  auto r = parser.parse(args, kwargs, parsed_args);
+  // The size, when given, shifts the keyword arguments by one
+  const int kw = r.idx == 0 ? 3 : 4;
+  bool type_inference = r.isNone(kw);
+  const auto inferred_dispatch_key = denseTypeIdWithDefault(r, kw + 1, dispatch_key);
+  const auto inferred_scalar_type = r.scalartypeWithDefault(kw, scalar_type);
+  at::OptionalDeviceGuard device_guard(r.deviceOptional(kw + 1));
+  // if no dtype provided, infer type based on value type.
+  Tensor values = internal_new_from_data(inferred_dispatch_key, inferred_scalar_type, r.deviceOptional(kw + 1), r.pyobject(2),
+                                         /*copy_variables=*/false, /*copy_numpy=*/true,
+                                         /*type_inference=*/type_inference);
+  // The indices keep their int32 or int64 dtype, and lists become int64
+  Tensor crow_indices = internal_new_from_data(legacyExtractDispatchKey(values.key_set()), kLong, r.deviceOptional(kw + 1), r.pyobject(0),
+                                               /*copy_variables=*/false, /*copy_numpy=*/true,
+                                               /*type_inference=*/true);
+  Tensor col_indices = internal_new_from_data(legacyExtractDispatchKey(values.key_set()), kLong, r.deviceOptional(kw + 1), r.pyobject(1),
+                                              /*copy_variables=*/false, /*copy_numpy=*/true,
+                                              /*type_inference=*/true);
+  auto options = values.options().layout(at::kSparseCsr);
+  if (r.idx == 0) {
+    return at::sparse_csr_tensor(crow_indices, col_indices, values, options).set_requires_grad(r.toBool(kw + 2));
+  }
+  return at::sparse_csr_tensor(crow_indices, col_indices, values, r.intlist(3), options).set_requires_grad(r.toBool(kw + 2));
+}
+
 Tensor tensor_ctor(c10::DispatchKey dispatch_key, at::ScalarType scalar_type, PyObject* args, PyObject* kwargs) {
   static PythonArgParser parser({
     "tensor(PyObject* data, *, ScalarType dtype=None, Device? device=None, bool pin_memory=False, bool requires_grad=False, DimnameList? names=None)",
@@ -1846,6 +1846,7 @@ def embedding_bag(input, weight, offsets=None, max_norm=None, norm_type=2,
             and number of columns equal to the embedding size
         offsets (LongTensor, optional): Only used when :attr:`input` is 1D. :attr:`offsets` determines
                              the starting index position of each bag (sequence) in :attr:`input`.
+                             On CPU, :attr:`input` and :attr:`offsets` can also both be IntTensors.
         max_norm (float, optional): If given, each embedding vector with norm larger than :attr:`max_norm`
                                     is renormalized to have norm :attr:`max_norm`.
                                     Note: this will modify :attr:`weight` in-place.
@@ -1940,7 +1941,7 @@ def embedding_bag(input, weight, offsets=None, max_norm=None, norm_type=2,
                              " fixed length sequences. However, found "
                              "offsets of type {}".format(type_str))
         offsets = torch.arange(0, input.numel(), input.size(1),
-                               dtype=torch.long, device=input.device)
+                               dtype=input.dtype, device=input.device)
 
         input = input.reshape(-1)
         if per_sample_weights is not None:
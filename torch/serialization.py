@@ -238,8 +238,12 @@ def _open_file_like(name_or_buffer, mode):
 
 
 class _open_zipfile_reader(_opener):
-    def __init__(self, name_or_buffer) -> None:
-        super(_open_zipfile_reader, self).__init__(torch._C.PyTorchFileReader(name_or_buffer))
+    def __init__(self, name_or_buffer, mmap=False) -> None:
+        if mmap:
+            reader = torch._C.PyTorchFileReader(str(name_or_buffer), True)
+        else:
+            reader = torch._C.PyTorchFileReader(name_or_buffer)
+        super(_open_zipfile_reader, self).__init__(reader)
 
 
 class _open_zipfile_writer_file(_opener):
@@ -491,7 +495,7 @@ def _save(obj, zip_file, pickle_module, pickle_protocol):
         zip_file.write_record(name, storage.data_ptr(), num_bytes)
 
 
-def load(f, map_location=None, pickle_module=pickle, **pickle_load_args):
+def load(f, map_location=None, pickle_module=pickle, *, mmap=False, **pickle_load_args):
     """Loads an object saved with :func:`torch.save` from a file.
 
     :func:`torch.load` uses Python's unpickling facilities but treats storages,
@@ -530,6 +534,12 @@ def load(f, map_location=None, pickle_module=pickle, **pickle_load_args):
             locations
         pickle_module: module used for unpickling metadata and objects (has to
             match the :attr:`pickle_module` used to serialize file)
+        mmap: if ``True``, :attr:`f` must be a file name and the file is mapped
+            into memory instead of being read. Uncompressed CPU storages then alias
+            the mapping (copy-on-write), so loading is not proportional to the file
+            size and processes loading the same file share its physical pages.
+            Not supported for files saved with the legacy format or by
+            :func:`torch.jit.save`.
         pickle_load_args: (Python 3 only) optional keyword arguments passed over to
             :func:`pickle_module.load` and :func:`pickle_module.Unpickler`, e.g.,
             :attr:`errors=...`.
@@ -570,9 +580,14 @@ def load(f, map_location=None, pickle_module=pickle, **pickle_load_args):
         >>> torch.load(buffer)
         # Load a module with 'ascii' encoding for unpickling
         >>> torch.load('module.pt', encoding='ascii')
+        # Map the file into memory instead of reading it
+        >>> torch.load('tensors.pt', mmap=True)
     """
     _check_dill_version(pickle_module)
 
+    if mmap and not _is_path(f):
+        raise ValueError("torch.load: mmap=True requires f to be a file name")
+
     if 'encoding' not in pickle_load_args.keys():
         pickle_load_args['encoding'] = 'utf-8'
 
@@ -582,14 +597,20 @@ def load(f, map_location=None, pickle_module=pickle, **pickle_load_args):
             # If we want to actually tail call to torch.jit.load, we need to
             # reset back to the original position.
             orig_position = opened_file.tell()
-            with _open_zipfile_reader(opened_file) as opened_zipfile:
+            with _open_zipfile_reader(f if mmap else opened_file, mmap) as opened_zipfile:
                 if _is_torchscript_zip(opened_zipfile):
+                    if mmap:
+                        raise RuntimeError("torch.load: mmap=True is not supported for TorchScript "
+                                           "archives, which are loaded by torch.jit.load")
                     warnings.warn("'torch.load' received a zip file that looks like a TorchScript archive"
                                   " dispatching to 'torch.jit.load' (call 'torch.jit.load' directly to"
                                   " silence this warning)", UserWarning)
                     opened_file.seek(orig_position)
                     return torch.jit.load(opened_file)
                 return _load(opened_zipfile, map_location, pickle_module, **pickle_load_args)
+        if mmap:
+            raise RuntimeError("torch.load: mmap=True is only supported for files saved "
+                               "with the zipfile format (the default since 1.6)")
         return _legacy_load(opened_file, map_location, pickle_module, **pickle_load_args)
 
 